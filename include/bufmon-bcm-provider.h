@@ -33,12 +33,53 @@ typedef enum counter_operations
     SET_COUNTER_THRESHOLD = (0x1 << 1),
 } counter_operations_t;
 
-extern const struct bufmon_class bufmon_bcm_provider_class;
+/* High frequency BST sampler intervals in msec */
+#define BST_SAMPLER_DFLT_INTERVAL_MS    (10)
+#define BST_SAMPLER_MIN_INTERVAL_MS     (1)
+#define BST_SAMPLER_MAX_INTERVAL_MS     (1000)
+
+/* opennslSwitchBstTrackingMode value of the current occupancy mode, the
+ * only mode the sampler runs in */
+#define BST_TRACKING_MODE_CURRENT       (0)
+
+/* Triggered BST captures, ring size, counters per capture and rate
+ * limit in captures per second */
+#define BST_CAPTURE_RING_SIZE           (16)
+#define BST_CAPTURE_MAX_COUNTERS        (512)
+#define BST_CAPTURE_DFLT_RATE           (10)
+#define BST_CAPTURE_DFLT_BURST          (4)
+#define BST_CAPTURE_MAX_RATE            (1000)
+
+/* Sampler statistics of a counter, in bytes and msec */
+typedef struct bst_sampler_summary {
+    /* number of samples */
+    uint64_t samples;
+
+    /* last, peak and mean occupancy */
+    int64_t current;
+    int64_t peak;
+    int64_t mean;
 
-void realm_sync_all(void);
+    /* upper bounds of the 50th and 99th percentiles of the occupancy */
+    int64_t p50;
+    int64_t p99;
+
+    /* trigger threshold, time above it and bursts above it */
+    int64_t threshold;
+    uint64_t above_msec;
+    uint64_t bursts;
+    uint64_t max_burst_msec;
+} bst_sampler_summary_t;
+
+struct ds;
+
+extern const struct bufmon_class bufmon_bcm_provider_class;
 
 void handle_bufmon_counter_mgmt(bufmon_counter_info_t *counter,
                                 counter_operations_t type);
+
+void handle_bufmon_counters_stats_get(bufmon_counter_info_t *list,
+                                      int num_counters);
 void bst_init_thresholds(void);
 
 void bst_switch_event_register(bool enable);
@@ -50,4 +91,24 @@ void bst_switch_control_get(int unit, opennsl_switch_control_t type, int *value)
 void bst_switch_event_callback (int asic, opennsl_switch_event_t event,
                                 int bid, int port, int cosq, void *cookie);
 
+bool bst_tracking_mode_is_current(void);
+
+int bst_sampler_set(bool enable, int interval_ms);
+
+void bst_sampler_clear(void);
+
+bool bst_sampler_summary_get(const char *name, int hw_unit,
+                             bst_sampler_summary_t *summary);
+
+void bst_sampler_dump(struct ds *ds);
+
+int bst_capture_set_rate(unsigned int rate, unsigned int burst);
+
+void bst_capture_clear(void);
+
+bool bst_capture_counter_get(const char *name, int hw_unit, int64_t *value,
+                             long long int *when);
+
+void bst_capture_dump(struct ds *ds, uint64_t seq);
+
 #endif /* bufmon-bcm-provider.h */
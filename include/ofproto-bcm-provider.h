@@ -88,6 +88,9 @@ struct ofbundle {
     struct hmap secondary_ip6addr; /* List of secondary IPv6 address */
 
     int lag_sflow_polling_interval; /* sflow polling interval for LAG */
+    uint32_t *lag_sflow_members;    /* LAG member hw unit/port, cached for
+                                     * the sflow LAG poller. */
+    size_t lag_sflow_n_members;     /* Number of 'lag_sflow_members'. */
 };
 
 struct bcmsdk_provider_ofport_node {
@@ -29,6 +29,27 @@
 
 #define OPS_RX_PRIORITY_MAX          100
 
+/* Classes of packets handed by the RX callback to their own worker. */
+enum ops_rx_class_id {
+    OPS_RX_CLASS_SFLOW,
+    OPS_RX_CLASS_ACL_LOG,
+    OPS_RX_CLASS_MAX
+};
+
+/* Rate budget of each RX class, in packets per second and burst size.
+ * sFlow matches the default CoPP policer of its CPU queue. ACL logging
+ * leaves room above its CoPP policer, the records are rate limited by
+ * the classifier with a configurable rate. */
+#define OPS_RX_SFLOW_PPS             5000
+#define OPS_RX_SFLOW_BURST           5000
+#define OPS_RX_ACL_LOG_PPS           100
+#define OPS_RX_ACL_LOG_BURST         100
+
+struct ds;
+
 extern int ops_switch_main(int argc, char *argv[]);
+extern void ops_rx_dispatch_dump(struct ds *ds);
+extern void ops_rx_stats_dump(struct ds *ds);
+extern void ops_rx_stats_reset(void);
 
 #endif // __OPS_BCM_INIT_H__
@@ -45,7 +45,13 @@ inline int ops_cls_error (int rc) {
 
 struct ops_cls_hw_info {
     bool in_asic;                              /* classifer already in asic */
-    opennsl_pbmp_t pbmp;                       /* port classifier is applied */
+    opennsl_pbmp_t pbmp;                       /* port classifier is applied
+                                                  to in asic */
+    opennsl_pbmp_t pending_pbmp;               /* port bitmap to write to the
+                                                  rules in asic */
+    bool pbmp_pending;                         /* pending_pbmp not yet written
+                                                  to the rules in asic */
+    int hw_unit;                               /* unit of the rules in asic */
     struct ovs_list rule_index_list;           /* list of hardware rule index */
     struct ovs_list range_index_list;          /* list of hardware range index */
     struct ovs_list stats_index_list;          /* list of hardware stats index */
@@ -54,6 +60,32 @@ struct ops_cls_hw_info {
     struct ovs_list stats_index_update_list;   /* updated list of stats index */
 };
 
+/* Result of compiling a classifier list into FP entries */
+struct ops_cls_compile_stats {
+    unsigned int aces;                  /* ACEs in the PI list */
+    unsigned int no_action;             /* ACEs without action, not installed */
+    unsigned int shadowed;              /* ACEs covered by an earlier ACE */
+    unsigned int redundant;             /* ACEs covered by a later ACE with
+                                           the same action */
+    unsigned int merged;                /* ACEs merged into a neighbour */
+    unsigned int expanded;              /* port ranges expanded to prefixes */
+    unsigned int entries;               /* predicted FP (TCAM) entries */
+    unsigned int range_checkers;        /* predicted L4 port range checkers */
+    unsigned int unsupported;           /* entries with an L4 port operation
+                                           not supported in hw */
+};
+
+/* Result of the last update of a classifier list */
+struct ops_cls_update_stats {
+    unsigned int updates;               /* list updates */
+    unsigned int full;                  /* updates that reinstalled all
+                                           entries */
+    unsigned int kept;                  /* FP entries kept by last update */
+    unsigned int installed;             /* FP entries installed by last
+                                           update */
+    unsigned int removed;               /* FP entries removed by last update */
+};
+
 struct ops_classifier {
     struct hmap_node node;
     struct uuid id;
@@ -64,6 +96,8 @@ struct ops_classifier {
 
     struct ops_cls_hw_info port_cls;           /* port classifier */
     struct ops_cls_hw_info route_cls;          /* routed classifier */
+    struct ops_cls_compile_stats compile;      /* compile result of entry list */
+    struct ops_cls_update_stats update;        /* last list update */
 };
 
 struct ops_cls_entry {
@@ -76,11 +110,22 @@ struct ops_cls_entry {
 #define act_flags   entry_actions.action_flags
     struct ops_cls_list_entry_match_fields entry_fields;   /* field(s)/value(s) to match */
     struct ops_cls_list_entry_actions entry_actions;        /* action(s) to take */
+    uint16_t rule_index;                /* index of the PI ACE compiled into
+                                           this entry */
+    uint16_t src_port_mask;             /* L4 src port mask for EQ match */
+    uint16_t dst_port_mask;             /* L4 dst port mask for EQ match */
 };
 
 struct ops_cls_rule_entry {
     struct ovs_list node;
     uint32_t index;                     /* classifier index*/
+    int prio;                           /* FP entry priority */
+    struct ops_cls_entry *cls_entry;    /* compiled entry it was installed
+                                           from */
+    struct ops_cls_stats_entry *sentry; /* stats created for this entry,
+                                           NULL if none or shared */
+    struct ops_cls_range_entry *src_rentry; /* L4 src port range, or NULL */
+    struct ops_cls_range_entry *dst_rentry; /* L4 dst port range, or NULL */
 };
 
 struct ops_cls_range_entry {
@@ -103,6 +103,154 @@ ops_cls_opennsl_acl_log_pkt_register_cb(void (*callback_handler)(struct acl_log_
  */
 void acl_log_handle_rx_event(opennsl_pkt_t *pkt);
 
+/**
+ * Copy up to @p max_records ACL logging records queued since the last call
+ * into @p records, oldest first.
+ *
+ * @param records      Array receiving the records
+ * @param max_records  Size of @p records
+ *
+ * @retval number of records copied
+ */
+int ops_cls_opennsl_acl_log_pkt_drain(struct acl_log_info *records,
+                                      int max_records);
+
+/**
+ * Set the rate limit of ACL logging.
+ *
+ * @param rate   Records admitted per second
+ * @param burst  Records admitted in a burst
+ *
+ * @retval OPS_CLS_OK    if the limit was set
+ * @retval OPS_CLS_FAIL  if @p rate or @p burst is invalid
+ */
+int ops_cls_opennsl_acl_log_set_rate(unsigned int rate, unsigned int burst);
+
+struct ds;
+
+/**
+ * Dump the ACL logging configuration and the per rule and per port
+ * admission counters.
+ */
+void ops_cls_opennsl_acl_log_dump(struct ds *ds);
+
+/**
+ * Clear the ACL logging admission counters.
+ */
+void ops_cls_opennsl_acl_log_stats_clear(void);
+
+/**
+ * Dump, per classifier, what the ACL compiler did to its entry list, the
+ * FP entries and L4 port range checkers it needs and how many FP entries
+ * its last update kept, installed and removed.
+ */
+void ops_cls_opennsl_compile_dump(struct ds *ds);
+
+/**
+ * Set the window in which port bitmap changes of ACLs applied to more
+ * ports, or removed from some, are merged before the FP entries are
+ * rewritten.
+ *
+ * @param msec  Batching window, 0 rewrites the entries on each change
+ *
+ * @retval OPS_CLS_OK    if the window was set
+ * @retval OPS_CLS_FAIL  if @p msec is out of range
+ */
+int ops_cls_opennsl_pbmp_batch_set(int msec);
+
+/**
+ * Dump the port bitmap batching configuration and the time spent
+ * rewriting FP entries, synchronously and batched.
+ */
+void ops_cls_opennsl_pbmp_batch_dump(struct ds *ds);
+
+/**
+ * Clear the port bitmap update counters.
+ */
+void ops_cls_opennsl_pbmp_batch_stats_clear(void);
+
+/**
+ * Header fields of an IPv4 packet evaluated by an ACL, in host byte order.
+ */
+struct ops_cls_eval_packet {
+    uint32_t sip;                       /* source address */
+    uint32_t dip;                       /* destination address */
+    uint8_t protocol;                   /* IP protocol */
+    uint16_t sport;                     /* L4 source port */
+    uint16_t dport;                     /* L4 destination port */
+    bool routed;                        /* packet is routed */
+};
+
+/**
+ * Evaluate an ACL in software: find the first ACE of @p list with an
+ * action that matches @p pkt.
+ *
+ * @param list     ACL to evaluate
+ * @param pkt      Packet to classify
+ * @param actions  Set to the actions of the matching ACE, 0 if none
+ *
+ * @retval index of the matching ACE in @p list, -1 if none matches
+ */
+int ops_cls_eval_list(const struct ops_cls_list *list,
+                      const struct ops_cls_eval_packet *pkt,
+                      uint32_t *actions);
+
+/**
+ * Set the number of synthetic packets used to check, after each install
+ * or update of an ACL, that its FP entries implement the ACL.
+ *
+ * @param packets  Packets per check, 0 disables the check
+ *
+ * @retval OPS_CLS_OK    if the number was set
+ * @retval OPS_CLS_FAIL  if @p packets is out of range
+ */
+int ops_cls_opennsl_verify_set(int packets);
+
+/**
+ * Dump the install verification configuration and results.
+ */
+void ops_cls_opennsl_verify_dump(struct ds *ds);
+
+/**
+ * Compile a synthetic ACL of @p n_aces ACEs, evaluate @p n_packets
+ * synthetic packets against the ACL and against its compiled FP entries
+ * and report the mismatches and the evaluation rates.
+ */
+void ops_cls_opennsl_eval_bench(struct ds *ds, int n_aces, int n_packets);
+
+/**
+ * Set the period at which the ACL hit counters are read into the cache
+ * that serves hit count requests.
+ *
+ * @param msec  Sweep period, 0 disables the cache
+ *
+ * @retval OPS_CLS_OK    if the period was set
+ * @retval OPS_CLS_FAIL  if @p msec is negative
+ */
+int ops_cls_opennsl_stats_cache_set_interval(int msec);
+
+/**
+ * Read all ACL hit counters into the cache now.
+ */
+void ops_cls_opennsl_stats_cache_refresh(void);
+
+/**
+ * Dump the ACL hit count cache configuration and counters.
+ */
+void ops_cls_opennsl_stats_cache_dump(struct ds *ds);
+
+/**
+ * Write the batched port bitmaps whose window expired and sweep the ACL
+ * hit counters when due. Called from the ofproto provider run loop.
+ */
+void ops_cls_run(void);
+
+/**
+ * Wake up the run loop when the batched port bitmaps or the hit counter
+ * sweep are due.
+ */
+void ops_cls_wait(void);
+
 
 /**
  * Initialization function for BCM Classifier switchd plug-in
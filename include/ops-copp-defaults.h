@@ -138,27 +138,251 @@
  * Control Plane packet CPU queue number
  * Control Plane packet rate
  * Control Plane packet burst
- * Control plane packet class function name
- * Control Plane packet egress FP qualifier function name
- * Control Plane packet ingress FP qualifier function names
+ * Control Plane packet global rx rules (OPS_COPP_RX_RULES)
+ * Control Plane packet egress FP qualifiers (OPS_COPP_FP_RULE)
+ * Control Plane packet ingress FP rules (OPS_COPP_INGRESS_RULES), one FP
+ * entry per OPS_COPP_FP_RULE
+ *
+ * Every egress FP entry is further qualified on the packet being destined
+ * to the CPU on the CPU queue set by the ingress rules. The qualifiers are
+ * built with the OPS_COPP_QUALIFY_* macros in ops-copp.h, so a new control
+ * packet class only needs a new entry in this file.
  */
-OPS_DEF_COPP_CLASS(ACL_LOGGING_PACKET, "ACL Logging packets", OPS_COPP_QOS_QUEUE_ACL_LOGGING, 5, 5, NULL, ops_copp_egress_fp_acl_logging, OPS_COPP_INGRESS_FUNC_POINTERS())
-OPS_DEF_COPP_CLASS(BROADCAST_ARP_PACKET, "Broadcast ARPs packets", OPS_COPP_QOS_QUEUE_NORMAL, 1000, 1000, NULL, ops_copp_egress_fp_broadcast_arp, OPS_COPP_INGRESS_FUNC_POINTERS(ops_copp_ingress_fp_broadcast_arp))
-OPS_DEF_COPP_CLASS(UNICAST_ARP_PACKET, "Unicast ARPs packets", OPS_COPP_QOS_QUEUE_SWPATH, 1000, 1000, NULL, ops_copp_egress_fp_unicast_arp, OPS_COPP_INGRESS_FUNC_POINTERS(ops_copp_ingress_fp_unicast_arp))
-OPS_DEF_COPP_CLASS(LACP_PACKET, "LACP packets", OPS_COPP_QOS_QUEUE_BPDU, 1000, 1000, NULL, ops_copp_egress_fp_lacp, OPS_COPP_INGRESS_FUNC_POINTERS(ops_copp_ingress_fp_lacp))
-OPS_DEF_COPP_CLASS(LLDP_PACKET, "LLDP packets", OPS_COPP_QOS_QUEUE_BPDU, 500, 500, NULL, ops_copp_egress_fp_lldp, OPS_COPP_INGRESS_FUNC_POINTERS(ops_copp_ingress_fp_lldp, ops_copp_ingress_fp_lldp, ops_copp_ingress_fp_lldp))
-OPS_DEF_COPP_CLASS(STP_PACKET, "STP packets", OPS_COPP_QOS_QUEUE_CRITICAL, 1000, 1000, NULL, ops_copp_egress_fp_stp, OPS_COPP_INGRESS_FUNC_POINTERS(ops_copp_ingress_fp_stp))
-OPS_DEF_COPP_CLASS(IPV4_OPTIONS_PACKET, "IPv4 options packets", OPS_COPP_QOS_QUEUE_SWPATH, 250, 250, NULL, ops_copp_egress_fp_ipv4_options, OPS_COPP_INGRESS_FUNC_POINTERS(ops_copp_ingress_fp_ipv4_options))
-OPS_DEF_COPP_CLASS(IPV6_OPTIONS_PACKET, "IPv6 options packets", OPS_COPP_QOS_QUEUE_SWPATH, 250, 250, NULL, ops_copp_egress_fp_ipv6_options, OPS_COPP_INGRESS_FUNC_POINTERS(ops_copp_ingress_fp_ipv6_options))
-OPS_DEF_COPP_CLASS(BGP_PACKET, "BGP packets", OPS_COPP_QOS_QUEUE_IMPORTANT, 5000, 5000, NULL, ops_copp_egress_fp_bgp, OPS_COPP_INGRESS_FUNC_POINTERS(ops_copp_ingress_fp_bgp))
-OPS_DEF_COPP_CLASS(DHCPV4_PACKET, "DHCPv4 packets", OPS_COPP_QOS_QUEUE_NORMAL, 500, 500, NULL, ops_copp_egress_fp_dhcpv4, OPS_COPP_INGRESS_FUNC_POINTERS(ops_copp_ingress_fp_dhcpv4))
-OPS_DEF_COPP_CLASS(DHCPV6_PACKET, "DHCPv6 packets", OPS_COPP_QOS_QUEUE_NORMAL, 500, 500, NULL, ops_copp_egress_fp_dhcpv6, OPS_COPP_INGRESS_FUNC_POINTERS(ops_copp_ingress_fp_dhcpv6))
-OPS_DEF_COPP_CLASS(ICMPV4_UCAST_PACKET, "ICMPV4 unicast packets", OPS_COPP_QOS_QUEUE_SWPATH, 1000, 1000, NULL, ops_copp_egress_fp_icmpv4_ucast, OPS_COPP_INGRESS_FUNC_POINTERS(ops_copp_ingress_fp_icmpv4_ucast))
-OPS_DEF_COPP_CLASS(ICMPV4_BMCAST_PACKET, "ICMPV4 broadcast/multicast packets", OPS_COPP_QOS_QUEUE_NORMAL, 1000, 1000, NULL, ops_copp_egress_fp_icmpv4_bcast_mcast, OPS_COPP_INGRESS_FUNC_POINTERS(ops_copp_ingress_fp_icmpv4_bcast, ops_copp_ingress_fp_icmpv4_mcast))
-OPS_DEF_COPP_CLASS(ICMPV6_UCAST_PACKET, "ICMPV6 unicast packets", OPS_COPP_QOS_QUEUE_SWPATH, 1000, 1000, NULL, ops_copp_egress_fp_icmpv6_ucast, OPS_COPP_INGRESS_FUNC_POINTERS(ops_copp_ingress_fp_icmpv6_ucast))
-OPS_DEF_COPP_CLASS(ICMPV6_MCAST_PACKET, "ICMPV6 multicast packets", OPS_COPP_QOS_QUEUE_NORMAL, 1000, 1000, NULL, ops_copp_egress_fp_icmpv6_mcast, OPS_COPP_INGRESS_FUNC_POINTERS(ops_copp_ingress_fp_icmpv6_mcast))
-OPS_DEF_COPP_CLASS(OSPFV2_MCAST_PACKET, "OSPFV2 multicast packets", OPS_COPP_QOS_QUEUE_IMPORTANT, 5000, 5000, NULL, ops_copp_egress_fp_ospfv2_mcast, OPS_COPP_INGRESS_FUNC_POINTERS(ops_copp_ingress_fp_ospfv2_dr_mcast, ops_copp_ingress_fp_ospfv2_all_mcast))
-OPS_DEF_COPP_CLASS(OSPFV2_UCAST_PACKET, "OSPFV2 unicast packets", OPS_COPP_QOS_QUEUE_IMPORTANT, 5000, 5000, NULL, ops_copp_egress_fp_ospfv2_ucast, OPS_COPP_INGRESS_FUNC_POINTERS(ops_copp_ingress_fp_ospfv2_ucast))
-OPS_DEF_COPP_CLASS(SFLOW_PACKET, "Sflow packets", OPS_COPP_QOS_QUEUE_SFLOW, 5000, 5000, ops_copp_sflow, ops_copp_egress_fp_sflow, OPS_COPP_INGRESS_FUNC_POINTERS())
-OPS_DEF_COPP_CLASS(UNKNOWN_IP_UNICAST_PACKET, "Unknown IP unicast packets", OPS_COPP_QOS_QUEUE_UNKNOWN_IP, 2500, 2500, ops_copp_unknown_ip_unicast, ops_copp_egress_fp_unknown_ip_unicast, OPS_COPP_INGRESS_FUNC_POINTERS())
-OPS_DEF_COPP_CLASS(UNCLASSIFIED_PACKET, "Unclassified packets", OPS_COPP_QOS_QUEUE_DEFAULT, 5000, 5000, ops_copp_unclassified, ops_copp_egress_fp_unclassified, OPS_COPP_INGRESS_FUNC_POINTERS())
+OPS_DEF_COPP_CLASS(ACL_LOGGING_PACKET, "ACL Logging packets",
+    OPS_COPP_QOS_QUEUE_ACL_LOGGING, 5, 5,
+    OPS_COPP_RX_RULES(),
+    OPS_COPP_FP_RULE(),
+    OPS_COPP_INGRESS_RULES())
+OPS_DEF_COPP_CLASS(BROADCAST_ARP_PACKET, "Broadcast ARPs packets",
+    OPS_COPP_QOS_QUEUE_NORMAL, 1000, 1000,
+    OPS_COPP_RX_RULES(),
+    OPS_COPP_FP_RULE(
+        OPS_COPP_QUALIFY_ETHER_TYPE(OPS_COPP_ARP_ETHER_TYPE),
+        OPS_COPP_QUALIFY_DST_MAC(OPS_COPP_L2_BROADCAST_DEST,
+                                 OPS_COPP_L2_ADDR_MASK)),
+    OPS_COPP_INGRESS_RULES(
+        OPS_COPP_FP_RULE(
+            OPS_COPP_QUALIFY_ETHER_TYPE(OPS_COPP_ARP_ETHER_TYPE),
+            OPS_COPP_QUALIFY_PACKET_RES(OPENNSL_FIELD_PKT_RES_L2BC))))
+OPS_DEF_COPP_CLASS(UNICAST_ARP_PACKET, "Unicast ARPs packets",
+    OPS_COPP_QOS_QUEUE_SWPATH, 1000, 1000,
+    OPS_COPP_RX_RULES(),
+    OPS_COPP_FP_RULE(
+        OPS_COPP_QUALIFY_ETHER_TYPE(OPS_COPP_ARP_ETHER_TYPE)),
+    OPS_COPP_INGRESS_RULES(
+        OPS_COPP_FP_RULE(
+            OPS_COPP_QUALIFY_ETHER_TYPE(OPS_COPP_ARP_ETHER_TYPE))))
+OPS_DEF_COPP_CLASS(LACP_PACKET, "LACP packets",
+    OPS_COPP_QOS_QUEUE_BPDU, 1000, 1000,
+    OPS_COPP_RX_RULES(),
+    OPS_COPP_FP_RULE(
+        OPS_COPP_QUALIFY_DST_MAC(OPS_COPP_LACP_MAC_DEST,
+                                 OPS_COPP_L2_ADDR_MASK)),
+    OPS_COPP_INGRESS_RULES(
+        OPS_COPP_FP_RULE(
+            OPS_COPP_QUALIFY_DST_MAC(OPS_COPP_LACP_MAC_DEST,
+                                     OPS_COPP_L2_ADDR_MASK))))
+OPS_DEF_COPP_CLASS(LLDP_PACKET, "LLDP packets",
+    OPS_COPP_QOS_QUEUE_BPDU, 500, 500,
+    OPS_COPP_RX_RULES(),
+    OPS_COPP_FP_RULE(
+        OPS_COPP_QUALIFY_ETHER_TYPE(OPS_COPP_LLDP_ETHER_TYPE)),
+    OPS_COPP_INGRESS_RULES(
+        OPS_COPP_FP_RULE(
+            OPS_COPP_QUALIFY_ETHER_TYPE(OPS_COPP_LLDP_ETHER_TYPE),
+            OPS_COPP_QUALIFY_DST_MAC(OPS_COPP_LLDP_MAC_DEST_1,
+                                     OPS_COPP_L2_ADDR_MASK)),
+        OPS_COPP_FP_RULE(
+            OPS_COPP_QUALIFY_ETHER_TYPE(OPS_COPP_LLDP_ETHER_TYPE),
+            OPS_COPP_QUALIFY_DST_MAC(OPS_COPP_LLDP_MAC_DEST_2,
+                                     OPS_COPP_L2_ADDR_MASK)),
+        OPS_COPP_FP_RULE(
+            OPS_COPP_QUALIFY_ETHER_TYPE(OPS_COPP_LLDP_ETHER_TYPE),
+            OPS_COPP_QUALIFY_DST_MAC(OPS_COPP_LLDP_MAC_DEST_3,
+                                     OPS_COPP_L2_ADDR_MASK))))
+OPS_DEF_COPP_CLASS(STP_PACKET, "STP packets",
+    OPS_COPP_QOS_QUEUE_CRITICAL, 1000, 1000,
+    OPS_COPP_RX_RULES(),
+    OPS_COPP_FP_RULE(
+        OPS_COPP_QUALIFY_DST_MAC(OPS_COPP_STP_MAC_DEST,
+                                 OPS_COPP_STP_MAC_DEST_MASK)),
+    OPS_COPP_INGRESS_RULES(
+        OPS_COPP_FP_RULE(
+            OPS_COPP_QUALIFY_DST_MAC(OPS_COPP_STP_MAC_DEST,
+                                     OPS_COPP_STP_MAC_DEST_MASK))))
+OPS_DEF_COPP_CLASS(IPV4_OPTIONS_PACKET, "IPv4 options packets",
+    OPS_COPP_QOS_QUEUE_SWPATH, 250, 250,
+    OPS_COPP_RX_RULES(),
+    OPS_COPP_FP_RULE(
+        OPS_COPP_QUALIFY_IP_TYPE(opennslFieldIpTypeIpv4Any),
+        OPS_COPP_QUALIFY_IP_TYPE(opennslFieldIpTypeIpv4WithOpts)),
+    OPS_COPP_INGRESS_RULES(
+        OPS_COPP_FP_RULE(
+            OPS_COPP_QUALIFY_IP_TYPE(opennslFieldIpTypeIpv4Any),
+            OPS_COPP_QUALIFY_IP_TYPE(opennslFieldIpTypeIpv4WithOpts))))
+OPS_DEF_COPP_CLASS(IPV6_OPTIONS_PACKET, "IPv6 options packets",
+    OPS_COPP_QOS_QUEUE_SWPATH, 250, 250,
+    OPS_COPP_RX_RULES(),
+    OPS_COPP_FP_RULE(
+        OPS_COPP_QUALIFY_IP_TYPE(opennslFieldIpTypeIpv6),
+        OPS_COPP_QUALIFY_IP_TYPE(opennslFieldIpTypeIpv6OneExtHdr)),
+    OPS_COPP_INGRESS_RULES(
+        OPS_COPP_FP_RULE(
+            OPS_COPP_QUALIFY_IP_TYPE(opennslFieldIpTypeIpv6),
+            OPS_COPP_QUALIFY_IP_TYPE(opennslFieldIpTypeIpv6OneExtHdr))))
+OPS_DEF_COPP_CLASS(BGP_PACKET, "BGP packets",
+    OPS_COPP_QOS_QUEUE_IMPORTANT, 5000, 5000,
+    OPS_COPP_RX_RULES(),
+    OPS_COPP_FP_RULE(
+        OPS_COPP_QUALIFY_L4_DST_PORT(OPS_COPP_L4_PORT_BGP),
+        OPS_COPP_QUALIFY_IP_PROTOCOL(OPS_COPP_IP_PROTOCOL_IP_NUMBER_TCP)),
+    OPS_COPP_INGRESS_RULES(
+        OPS_COPP_FP_RULE(
+            OPS_COPP_QUALIFY_L4_DST_PORT(OPS_COPP_L4_PORT_BGP),
+            OPS_COPP_QUALIFY_IP_PROTOCOL(OPS_COPP_IP_PROTOCOL_IP_NUMBER_TCP),
+            OPS_COPP_QUALIFY_DST_IP_LOCAL())))
+OPS_DEF_COPP_CLASS(DHCPV4_PACKET, "DHCPv4 packets",
+    OPS_COPP_QOS_QUEUE_NORMAL, 500, 500,
+    OPS_COPP_RX_RULES(),
+    OPS_COPP_FP_RULE(
+        OPS_COPP_QUALIFY_L4_DST_PORT(OPS_COPP_L4_PORT_DHCPV4),
+        OPS_COPP_QUALIFY_IP_PROTOCOL(OPS_COPP_IP_PROTOCOL_IP_NUMBER_UDP),
+        OPS_COPP_QUALIFY_IP_TYPE(opennslFieldIpTypeIpv4Any)),
+    OPS_COPP_INGRESS_RULES(
+        OPS_COPP_FP_RULE(
+            OPS_COPP_QUALIFY_L4_DST_PORT(OPS_COPP_L4_PORT_DHCPV4),
+            OPS_COPP_QUALIFY_IP_PROTOCOL(OPS_COPP_IP_PROTOCOL_IP_NUMBER_UDP),
+            OPS_COPP_QUALIFY_IP_TYPE(opennslFieldIpTypeIpv4Any))))
+OPS_DEF_COPP_CLASS(DHCPV6_PACKET, "DHCPv6 packets",
+    OPS_COPP_QOS_QUEUE_NORMAL, 500, 500,
+    OPS_COPP_RX_RULES(),
+    OPS_COPP_FP_RULE(
+        OPS_COPP_QUALIFY_L4_DST_PORT(OPS_COPP_L4_PORT_DHCPV6),
+        OPS_COPP_QUALIFY_IP6_NEXT_HEADER(OPS_COPP_IP_PROTOCOL_IP_NUMBER_UDP),
+        OPS_COPP_QUALIFY_IP_TYPE(opennslFieldIpTypeIpv6)),
+    OPS_COPP_INGRESS_RULES(
+        OPS_COPP_FP_RULE(
+            OPS_COPP_QUALIFY_L4_DST_PORT(OPS_COPP_L4_PORT_DHCPV6),
+            OPS_COPP_QUALIFY_IP6_NEXT_HEADER(
+                                    OPS_COPP_IP_PROTOCOL_IP_NUMBER_UDP),
+            OPS_COPP_QUALIFY_IP_TYPE(opennslFieldIpTypeIpv6))))
+OPS_DEF_COPP_CLASS(ICMPV4_UCAST_PACKET, "ICMPV4 unicast packets",
+    OPS_COPP_QOS_QUEUE_SWPATH, 1000, 1000,
+    OPS_COPP_RX_RULES(),
+    OPS_COPP_FP_RULE(
+        OPS_COPP_QUALIFY_IP_PROTOCOL(OPS_COPP_IP_PROTOCOL_IPV4_NUMBER_ICMP),
+        OPS_COPP_QUALIFY_IP_TYPE(opennslFieldIpTypeIpv4Any)),
+    OPS_COPP_INGRESS_RULES(
+        OPS_COPP_FP_RULE(
+            OPS_COPP_QUALIFY_IP_PROTOCOL(
+                                    OPS_COPP_IP_PROTOCOL_IPV4_NUMBER_ICMP),
+            OPS_COPP_QUALIFY_IP_TYPE(opennslFieldIpTypeIpv4Any),
+            OPS_COPP_QUALIFY_DST_IP_LOCAL())))
+OPS_DEF_COPP_CLASS(ICMPV4_BMCAST_PACKET, "ICMPV4 broadcast/multicast packets",
+    OPS_COPP_QOS_QUEUE_NORMAL, 1000, 1000,
+    OPS_COPP_RX_RULES(),
+    OPS_COPP_FP_RULE(
+        OPS_COPP_QUALIFY_IP_PROTOCOL(OPS_COPP_IP_PROTOCOL_IPV4_NUMBER_ICMP),
+        OPS_COPP_QUALIFY_IP_TYPE(opennslFieldIpTypeIpv4Any)),
+    OPS_COPP_INGRESS_RULES(
+        OPS_COPP_FP_RULE(
+            OPS_COPP_QUALIFY_IP_PROTOCOL(
+                                    OPS_COPP_IP_PROTOCOL_IPV4_NUMBER_ICMP),
+            OPS_COPP_QUALIFY_IP_TYPE(opennslFieldIpTypeIpv4Any),
+            OPS_COPP_QUALIFY_DST_IP(OPS_COPP_L3_IPV4_BROADCAST_ADDR,
+                                    OPS_COPP_L3_IPV4_ADDR_MASK)),
+        OPS_COPP_FP_RULE(
+            OPS_COPP_QUALIFY_IP_PROTOCOL(
+                                    OPS_COPP_IP_PROTOCOL_IPV4_NUMBER_ICMP),
+            OPS_COPP_QUALIFY_IP_TYPE(opennslFieldIpTypeIpv4Any),
+            OPS_COPP_QUALIFY_DST_IP(OPS_COPP_L3_IPV4_MCAST_ADDR,
+                                    OPS_COPP_L3_IPV4_MCAST_ADDR_MASK))))
+OPS_DEF_COPP_CLASS(ICMPV6_UCAST_PACKET, "ICMPV6 unicast packets",
+    OPS_COPP_QOS_QUEUE_SWPATH, 1000, 1000,
+    OPS_COPP_RX_RULES(),
+    OPS_COPP_FP_RULE(
+        OPS_COPP_QUALIFY_IP6_NEXT_HEADER(
+                                    OPS_COPP_IP_PROTOCOL_IPV6_NUMBER_ICMP),
+        OPS_COPP_QUALIFY_IP_TYPE(opennslFieldIpTypeIpv6)),
+    OPS_COPP_INGRESS_RULES(
+        OPS_COPP_FP_RULE(
+            OPS_COPP_QUALIFY_IP6_NEXT_HEADER(
+                                    OPS_COPP_IP_PROTOCOL_IPV6_NUMBER_ICMP),
+            OPS_COPP_QUALIFY_IP_TYPE(opennslFieldIpTypeIpv6),
+            OPS_COPP_QUALIFY_DST_IP_LOCAL())))
+OPS_DEF_COPP_CLASS(ICMPV6_MCAST_PACKET, "ICMPV6 multicast packets",
+    OPS_COPP_QOS_QUEUE_NORMAL, 1000, 1000,
+    OPS_COPP_RX_RULES(),
+    OPS_COPP_FP_RULE(
+        OPS_COPP_QUALIFY_IP6_NEXT_HEADER(
+                                    OPS_COPP_IP_PROTOCOL_IPV6_NUMBER_ICMP),
+        OPS_COPP_QUALIFY_IP_TYPE(opennslFieldIpTypeIpv6)),
+    OPS_COPP_INGRESS_RULES(
+        OPS_COPP_FP_RULE(
+            OPS_COPP_QUALIFY_IP6_NEXT_HEADER(
+                                    OPS_COPP_IP_PROTOCOL_IPV6_NUMBER_ICMP),
+            OPS_COPP_QUALIFY_IP_TYPE(opennslFieldIpTypeIpv6),
+            OPS_COPP_QUALIFY_DST_IP6(OPS_COPP_L3_IPV6_MCAST_ADDR,
+                                     OPS_COPP_L3_IPV6_MCAST_ADDR_MASK))))
+OPS_DEF_COPP_CLASS(OSPFV2_MCAST_PACKET, "OSPFV2 multicast packets",
+    OPS_COPP_QOS_QUEUE_IMPORTANT, 5000, 5000,
+    OPS_COPP_RX_RULES(),
+    OPS_COPP_FP_RULE(
+        OPS_COPP_QUALIFY_IP_PROTOCOL(OPS_COPP_IP_PROTOCOL_IP_NUMBER_OSPFV2),
+        OPS_COPP_QUALIFY_IP_TYPE(opennslFieldIpTypeIpv4Any),
+        OPS_COPP_QUALIFY_DST_IP(OPS_COPP_L3_IPV4_MCAST_ADDR,
+                                OPS_COPP_L3_IPV4_MCAST_ADDR_MASK),
+        OPS_COPP_QUALIFY_DST_MAC(OPS_COPP_OSPF_MAC_ALL_ROUTERS,
+                                 OPS_COPP_OSPF_MAC_MCAST_MASK)),
+    OPS_COPP_INGRESS_RULES(
+        OPS_COPP_FP_RULE(
+            OPS_COPP_QUALIFY_IP_PROTOCOL(
+                                    OPS_COPP_IP_PROTOCOL_IP_NUMBER_OSPFV2),
+            OPS_COPP_QUALIFY_IP_TYPE(opennslFieldIpTypeIpv4Any),
+            OPS_COPP_QUALIFY_DST_MAC(OPS_COPP_OSPF_MAC_DR_ROUTERS,
+                                     OPS_COPP_L2_ADDR_MASK),
+            OPS_COPP_QUALIFY_DST_IP(OPS_COPP_OSPF_IPV4_DR_POUTERS,
+                                    OPS_COPP_L3_IPV4_ADDR_MASK)),
+        OPS_COPP_FP_RULE(
+            OPS_COPP_QUALIFY_IP_PROTOCOL(
+                                    OPS_COPP_IP_PROTOCOL_IP_NUMBER_OSPFV2),
+            OPS_COPP_QUALIFY_IP_TYPE(opennslFieldIpTypeIpv4Any),
+            OPS_COPP_QUALIFY_DST_MAC(OPS_COPP_OSPF_MAC_ALL_ROUTERS,
+                                     OPS_COPP_L2_ADDR_MASK),
+            OPS_COPP_QUALIFY_DST_IP(OPS_COPP_OSPF_IPV4_ALL_POUTERS,
+                                    OPS_COPP_L3_IPV4_ADDR_MASK))))
+OPS_DEF_COPP_CLASS(OSPFV2_UCAST_PACKET, "OSPFV2 unicast packets",
+    OPS_COPP_QOS_QUEUE_IMPORTANT, 5000, 5000,
+    OPS_COPP_RX_RULES(),
+    OPS_COPP_FP_RULE(
+        OPS_COPP_QUALIFY_IP_PROTOCOL(OPS_COPP_IP_PROTOCOL_IP_NUMBER_OSPFV2),
+        OPS_COPP_QUALIFY_IP_TYPE(opennslFieldIpTypeIpv4Any)),
+    OPS_COPP_INGRESS_RULES(
+        OPS_COPP_FP_RULE(
+            OPS_COPP_QUALIFY_IP_PROTOCOL(
+                                    OPS_COPP_IP_PROTOCOL_IP_NUMBER_OSPFV2),
+            OPS_COPP_QUALIFY_IP_TYPE(opennslFieldIpTypeIpv4Any),
+            OPS_COPP_QUALIFY_DST_IP_LOCAL())))
+OPS_DEF_COPP_CLASS(SFLOW_PACKET, "Sflow packets",
+    OPS_COPP_QOS_QUEUE_SFLOW, 5000, 5000,
+    OPS_COPP_RX_RULES(
+        OPS_COPP_RX_REASON(opennslRxReasonSampleDest),
+        OPS_COPP_RX_REASON(opennslRxReasonSampleSource)),
+    OPS_COPP_FP_RULE(),
+    OPS_COPP_INGRESS_RULES())
+OPS_DEF_COPP_CLASS(UNKNOWN_IP_UNICAST_PACKET, "Unknown IP unicast packets",
+    OPS_COPP_QOS_QUEUE_UNKNOWN_IP, 2500, 2500,
+    OPS_COPP_RX_RULES(
+        OPS_COPP_RX_REASON(opennslRxReasonL3DestMiss),
+        OPS_COPP_RX_PRIORITY(OPS_COPP_UNKNOWN_IP_COS_RESERVED)),
+    OPS_COPP_FP_RULE(),
+    OPS_COPP_INGRESS_RULES())
+OPS_DEF_COPP_CLASS(UNCLASSIFIED_PACKET, "Unclassified packets",
+    OPS_COPP_QOS_QUEUE_DEFAULT, 5000, 5000,
+    OPS_COPP_RX_RULES(
+        OPS_COPP_RX_PRIORITY(0), OPS_COPP_RX_PRIORITY(1),
+        OPS_COPP_RX_PRIORITY(2), OPS_COPP_RX_PRIORITY(3),
+        OPS_COPP_RX_PRIORITY(4), OPS_COPP_RX_PRIORITY(5),
+        OPS_COPP_RX_PRIORITY(6), OPS_COPP_RX_PRIORITY(7)),
+    OPS_COPP_FP_RULE(),
+    OPS_COPP_INGRESS_RULES())
@@ -21,29 +21,13 @@
 #define __OPS_COPP_H__ 1
 
 #include <stdint.h>
+#include <ovs/dynamic-string.h>
 #include <opennsl/field.h>
+#include <opennsl/rx.h>
 #include "platform-defines.h"
 #include "copp-asic-provider.h"
 #include "ops-qos.h"
 
-/*
- * Function pointer structure for qualifying control plane packets in ingress.
- */
-typedef int (*ops_copp_ingress_fp_function_pointer)(uint32 unit,
-                                    opennsl_field_entry_t* ingress_fp_entry);
-
-/*
- * Function pointer structure for qualifying control plane packets in egress.
- */
-typedef int (*ops_copp_egress_fp_function_pointer)(uint32 unit,
-                                    opennsl_field_entry_t* engress_fp_entry,
-                                    uint8 ingress_cpu_queue_number);
-
-/*
- * Function pointer structure for global control packet class rules.
- */
-typedef int (*ops_copp_packet_class_function_pointer)(uint32 unit);
-
 /*
  * CoPP related constants
  */
@@ -182,22 +166,18 @@ typedef int (*ops_copp_packet_class_function_pointer)(uint32 unit);
                                                  0x00,0x00,0x05}
 #define OPS_COPP_OSPF_MAC_DR_ROUTERS            {0x01,0x00,0x5E,\
                                                  0x00,0x00,0x06}
+#define OPS_COPP_OSPF_MAC_MCAST_MASK            {0xFF,0xFF,0xFF,\
+                                                 0xFF,0xFF,0x00}
 #define OPS_COPP_OSPF_IPV4_ALL_POUTERS          "224.0.0.5"
 #define OPS_COPP_OSPF_IPV4_DR_POUTERS           "224.0.0.6"
 
-/*
- * Macro for array for function pointers for a control packet class
- * in ingress pipeline.
- */
-#define OPS_COPP_INGRESS_FUNC_POINTERS(...)
-
 /*
  * Macro for generating the enum names for different control plane
  * packets.
  */
 #define OPS_DEF_COPP_CLASS(name,packet_name,queue,rate,burst,\
-                           pkt_class_func,egress_func,\
-                           ingress_func) PLUGIN_COPP_##name,
+                           rx_rules,egress_rule,\
+                           ingress_rules) PLUGIN_COPP_##name,
 
 /*
  * Enum for storing the indexing id for different control place packets. The
@@ -214,11 +194,6 @@ enum ops_copp_packet_class_code_t
 #include "ops-copp-defaults.h"
 };
 
-/*
- * If OPS_COPP_INGRESS_FUNC_POINTERS is already defined, then undefine it.
- */
-#undef OPS_COPP_INGRESS_FUNC_POINTERS
-
 /*
  * If OPS_DEF_COPP_CLASS is already defined, then undefine it.
  */
@@ -228,143 +203,171 @@ enum ops_copp_packet_class_code_t
  * CoPP constants for dumping configuration and stats for control plane
  * packet classes.
  */
-#define COPP_MAX_PACKET_STAT_BUFFER_SIZE          300 /* Total number of bytes
-                                                         per control plane
-                                                         packet class buffer */
 #define OPS_COPP_MAX_PACKET_NAME_SIZE              50 /* Number of bytes for
                                                          the buffer used for
                                                          storing the packet
                                                          class name */
 
+/*
+ * CoPP statistics collector constants. The per-unit snapshot of the
+ * control plane packet class counters is refreshed at most once per
+ * interval.
+ */
+#define OPS_COPP_STATS_DFLT_INTERVAL_MS         1000 /* Default snapshot
+                                                        refresh interval */
+#define OPS_COPP_STATS_MAX_INTERVAL_MS          60000 /* Maximum snapshot
+                                                         refresh interval */
 
 /*
- * Declarations of the qualifier functions for different control plane
- * packets.
+ * CoPP policer auto-tuning constants. The controller runs once per period
+ * and acts on a class after the given number of consecutive periods.
+ */
+#define OPS_COPP_TUNE_PERIOD_MS                 1000 /* Controller period */
+#define OPS_COPP_TUNE_DROP_PERIODS              3    /* Periods with drops
+                                                        before a raise */
+#define OPS_COPP_TUNE_IDLE_PERIODS              30   /* Idle periods before
+                                                        a lower */
+#define OPS_COPP_TUNE_RESTORE_PERIODS           10   /* Periods without drops
+                                                        before stepping back
+                                                        to the configured
+                                                        rate */
+#define OPS_COPP_TUNE_CEILING_FACTOR            4    /* Default ceiling of a
+                                                        protocol class, in
+                                                        configured rates */
+
+/*
+ * CPU queue monitor constants. The monitor samples the occupancy and the
+ * drop counter of every CPU queue once per interval and keeps log2
+ * histograms of both.
  */
-extern int ops_copp_egress_fp_acl_logging (
-                                      uint32 unit,
-                                      opennsl_field_entry_t* egress_fp_entry,
-                                      uint8 ingress_cpu_queue_number);
-extern int ops_copp_ingress_fp_broadcast_arp (
-                                      uint32 unit,
-                                      opennsl_field_entry_t* ingress_fp_entry);
-extern int ops_copp_egress_fp_broadcast_arp (
-                                      uint32 unit,
-                                      opennsl_field_entry_t* egress_fp_entry,
-                                      uint8 ingress_cpu_queue_number);
-extern int ops_copp_ingress_fp_unicast_arp (
-                                      uint32 unit,
-                                      opennsl_field_entry_t* ingress_fp_entry);
-extern int ops_copp_egress_fp_unicast_arp (
-                                      uint32 unit,
-                                      opennsl_field_entry_t* egress_fp_entry,
-                                      uint8 ingress_cpu_queue_number);
-extern int ops_copp_ingress_fp_lacp (uint32 unit,
-                                     opennsl_field_entry_t* ingress_fp_entry);
-extern int ops_copp_egress_fp_lacp (uint32 unit,
-                                    opennsl_field_entry_t* egress_fp_entry,
-                                    uint8 ingress_cpu_queue_number);
-extern int ops_copp_ingress_fp_lldp (uint32 unit,
-                                     opennsl_field_entry_t* ingress_fp_entry);
-extern int ops_copp_egress_fp_lldp (uint32 unit,
-                                    opennsl_field_entry_t* egress_fp_entry,
-                                    uint8 ingress_cpu_queue_number);
-extern int ops_copp_ingress_fp_stp (uint32 unit,
-                                    opennsl_field_entry_t* ingress_fp_entry);
-extern int ops_copp_egress_fp_stp (uint32 unit,
-                                   opennsl_field_entry_t* egress_fp_entry,
-                                   uint8 ingress_cpu_queue_number);
-extern int ops_copp_ingress_fp_bgp (uint32 unit,
-                                    opennsl_field_entry_t* ingress_fp_entry);
-extern int ops_copp_egress_fp_bgp (uint32 unit,
-                                   opennsl_field_entry_t* egress_fp_entry,
-                                   uint8 ingress_cpu_queue_number);
-extern int ops_copp_ingress_fp_dhcpv4 (uint32 unit,
-                                       opennsl_field_entry_t* ingress_fp_entry);
-extern int ops_copp_egress_fp_dhcpv4 (uint32 unit,
-                                      opennsl_field_entry_t* egress_fp_entry,
-                                      uint8 ingress_cpu_queue_number);
-extern int ops_copp_ingress_fp_dhcpv6 (uint32 unit,
-                                       opennsl_field_entry_t* ingress_fp_entry);
-extern int ops_copp_egress_fp_dhcpv6 (uint32 unit,
-                                      opennsl_field_entry_t* egress_fp_entry,
-                                      uint8 ingress_cpu_queue_number);
-extern int ops_copp_ingress_fp_icmpv4_ucast (
-                                      uint32 unit,
-                                      opennsl_field_entry_t* ingress_fp_entry);
-extern int ops_copp_egress_fp_icmpv4_ucast (
-                                      uint32 unit,
-                                      opennsl_field_entry_t* egress_fp_entry,
-                                      uint8 ingress_cpu_queue_number);
-extern int ops_copp_ingress_fp_icmpv4_bcast (
-                                      uint32 unit,
-                                      opennsl_field_entry_t* ingress_fp_entry);
-extern int ops_copp_ingress_fp_icmpv4_mcast (
-                                      uint32 unit,
-                                      opennsl_field_entry_t* ingress_fp_entry);
-extern int ops_copp_egress_fp_icmpv4_bcast_mcast (
-                                      uint32 unit,
-                                      opennsl_field_entry_t* egress_fp_entry,
-                                      uint8 ingress_cpu_queue_number);
-extern int ops_copp_ingress_fp_icmpv6_ucast (
-                                      uint32 unit,
-                                      opennsl_field_entry_t* ingress_fp_entry);
-extern int ops_copp_egress_fp_icmpv6_ucast (
-                                      uint32 unit,
-                                      opennsl_field_entry_t* egress_fp_entry,
-                                      uint8 ingress_cpu_queue_number);
-extern int ops_copp_ingress_fp_icmpv6_mcast (
-                                      uint32 unit,
-                                      opennsl_field_entry_t* ingress_fp_entry);
-extern int ops_copp_egress_fp_icmpv6_mcast (
-                                      uint32 unit,
-                                      opennsl_field_entry_t* egress_fp_entry,
-                                      uint8 ingress_cpu_queue_number);
-extern int ops_copp_ingress_fp_ospfv2_dr_mcast (
-                                      uint32 unit,
-                                      opennsl_field_entry_t* ingress_fp_entry);
-extern int ops_copp_ingress_fp_ospfv2_all_mcast (
-                                      uint32 unit,
-                                      opennsl_field_entry_t* ingress_fp_entry);
-extern int ops_copp_egress_fp_ospfv2_mcast (
-                                      uint32 unit,
-                                      opennsl_field_entry_t* egress_fp_entry,
-                                      uint8 ingress_cpu_queue_number);
-extern int ops_copp_ingress_fp_ospfv2_ucast (
-                                      uint32 unit,
-                                      opennsl_field_entry_t* ingress_fp_entry);
-extern int ops_copp_egress_fp_ospfv2_ucast (
-                                      uint32 unit,
-                                      opennsl_field_entry_t* egress_fp_entry,
-                                      uint8 ingress_cpu_queue_number);
-extern int ops_copp_ingress_fp_ipv4_options (
-                                      uint32 unit,
-                                      opennsl_field_entry_t* ingress_fp_entry);
-extern int ops_copp_egress_fp_ipv4_options (
-                                      uint32 unit,
-                                      opennsl_field_entry_t* egress_fp_entry,
-                                      uint8 ingress_cpu_queue_number);
-extern int ops_copp_ingress_fp_ipv6_options (
-                                      uint32 unit,
-                                      opennsl_field_entry_t* ingress_fp_entry);
-extern int ops_copp_egress_fp_ipv6_options (
-                                      uint32 unit,
-                                      opennsl_field_entry_t* egress_fp_entry,
-                                      uint8 ingress_cpu_queue_number);
-extern int ops_copp_sflow (uint32 unit);
-extern int ops_copp_egress_fp_sflow (uint32 unit,
-                                     opennsl_field_entry_t* egress_fp_entry,
-                                     uint8 ingress_cpu_queue_number);
-extern int ops_copp_unknown_ip_unicast (uint32 unit);
-extern int ops_copp_egress_fp_unknown_ip_unicast (
-                                      uint32 unit,
-                                      opennsl_field_entry_t* egress_fp_entry,
-                                      uint8 ingress_cpu_queue_number);
-extern int ops_copp_unclassified (uint32 unit);
-extern int ops_copp_egress_fp_unclassified (
-                                      uint32 unit,
-                                      opennsl_field_entry_t* egress_fp_entry,
-                                      uint8 ingress_cpu_queue_number);
+#define OPS_COPP_CPUQ_DFLT_INTERVAL_MS          250  /* Default sampling
+                                                        interval */
+#define OPS_COPP_CPUQ_MIN_INTERVAL_MS           100  /* Minimum sampling
+                                                        interval, bounds the
+                                                        SDK reads done from
+                                                        the main loop */
+#define OPS_COPP_CPUQ_MAX_INTERVAL_MS           1000 /* Maximum sampling
+                                                        interval */
+#define OPS_COPP_CPUQ_HIST_BUCKETS              24   /* Buckets of a
+                                                        histogram, bucket n
+                                                        holding values below
+                                                        2^n */
+#define OPS_COPP_CPUQ_BST_MODE_CURRENT          0    /* BST tracking mode
+                                                        value of the current
+                                                        occupancy mode */
+
+
+/*
+ * Packet fields a CoPP FP entry can qualify on.
+ */
+enum ops_copp_qualifier_type_t {
+    OPS_COPP_QUALIFIER_NONE = 0,        /* Terminates a qualifier list */
+    OPS_COPP_QUALIFIER_ETHER_TYPE,
+    OPS_COPP_QUALIFIER_PACKET_RES,
+    OPS_COPP_QUALIFIER_DST_MAC,
+    OPS_COPP_QUALIFIER_IP_TYPE,
+    OPS_COPP_QUALIFIER_IP_PROTOCOL,
+    OPS_COPP_QUALIFIER_IP6_NEXT_HEADER,
+    OPS_COPP_QUALIFIER_L4_DST_PORT,
+    OPS_COPP_QUALIFIER_DST_IP_LOCAL,
+    OPS_COPP_QUALIFIER_DST_IP,
+    OPS_COPP_QUALIFIER_DST_IP6,
+    OPS_COPP_QUALIFIER_MAX
+};
+
+/*
+ * A qualifier of a CoPP FP entry. Scalar qualifiers use 'value', IPv4
+ * addresses are kept in dotted notation.
+ */
+struct ops_copp_qualifier_t {
+    enum ops_copp_qualifier_type_t  type;
+    union {
+        struct {
+            uint32          data;
+            uint32          mask;
+        } value;
+        struct {
+            const char*     addr;
+            const char*     mask;
+        } ip;
+        struct {
+            opennsl_mac_t   addr;
+            opennsl_mac_t   mask;
+        } mac;
+        struct {
+            opennsl_ip6_t   addr;
+            opennsl_ip6_t   mask;
+        } ip6;
+    } u;
+};
+
+/*
+ * Maximum number of qualifiers of a CoPP FP entry, in addition to the out
+ * port and CPU queue qualifiers every egress entry gets.
+ */
+#define OPS_COPP_MAX_QUALIFIERS                 6
+
+/*
+ * Qualifiers of one CoPP FP entry.
+ */
+struct ops_copp_fp_entry_spec_t {
+    bool                        valid;
+    struct ops_copp_qualifier_t qualifiers[OPS_COPP_MAX_QUALIFIERS];
+};
+
+/*
+ * Maximum number of global rx rules of a control packet class.
+ */
+#define OPS_COPP_MAX_RX_RULES                   8
+
+/*
+ * A global rx rule sending packets with a given rx reason, or with a
+ * given internal priority, to the CPU queue of a control packet class.
+ */
+struct ops_copp_rx_rule_t {
+    bool                    valid;
+    bool                    has_reason;
+    opennsl_rx_reason_t     reason;
+    uint8                   int_prio;
+    uint8                   int_prio_mask;
+};
+
+/*
+ * Macros for declaring the qualifiers of the CoPP rules in the file
+ * ops-copp-defaults.h.
+ */
+#define OPS_COPP_QUALIFY_ETHER_TYPE(ether_type) \
+            {.type = OPS_COPP_QUALIFIER_ETHER_TYPE, \
+             .u.value = {(ether_type), OPS_COPP_L2_ETHER_TYPE_MASK}}
+#define OPS_COPP_QUALIFY_PACKET_RES(packet_res) \
+            {.type = OPS_COPP_QUALIFIER_PACKET_RES, \
+             .u.value = {(packet_res), 0xFFFFFFFF}}
+#define OPS_COPP_QUALIFY_DST_MAC(mac_addr, mac_mask) \
+            {.type = OPS_COPP_QUALIFIER_DST_MAC, \
+             .u.mac = {mac_addr, mac_mask}}
+#define OPS_COPP_QUALIFY_IP_TYPE(ip_type) \
+            {.type = OPS_COPP_QUALIFIER_IP_TYPE, \
+             .u.value = {(ip_type), 0}}
+#define OPS_COPP_QUALIFY_IP_PROTOCOL(protocol) \
+            {.type = OPS_COPP_QUALIFIER_IP_PROTOCOL, \
+             .u.value = {(protocol), OPS_COPP_IP_PROTOCOL_IP_NUMBER_MASK}}
+#define OPS_COPP_QUALIFY_IP6_NEXT_HEADER(protocol) \
+            {.type = OPS_COPP_QUALIFIER_IP6_NEXT_HEADER, \
+             .u.value = {(protocol), OPS_COPP_IP_PROTOCOL_IP_NUMBER_MASK}}
+#define OPS_COPP_QUALIFY_L4_DST_PORT(l4_port) \
+            {.type = OPS_COPP_QUALIFIER_L4_DST_PORT, \
+             .u.value = {(l4_port), OPS_COPP_L4_PORT_MASK}}
+#define OPS_COPP_QUALIFY_DST_IP_LOCAL() \
+            {.type = OPS_COPP_QUALIFIER_DST_IP_LOCAL, \
+             .u.value = {OPS_COPP_DST_IP_LOCAL_DATA, \
+                         OPS_COPP_DST_IP_LOCAL_MASK}}
+#define OPS_COPP_QUALIFY_DST_IP(ip_addr, ip_mask) \
+            {.type = OPS_COPP_QUALIFIER_DST_IP, \
+             .u.ip = {ip_addr, ip_mask}}
+#define OPS_COPP_QUALIFY_DST_IP6(ip6_addr, ip6_mask) \
+            {.type = OPS_COPP_QUALIFIER_DST_IP6, \
+             .u.ip6 = {ip6_addr, ip6_mask}}
+
 
 
 /*
@@ -421,23 +424,22 @@ struct ops_copp_fp_rule_t {
     uint32                 ops_copp_egress_fp_burst;
 
     /*
-     * Function pointer to the control packet class global pipeline
-     * rules.
+     * Global rx rules mapping the control packet class to its CPU queue.
      */
-    ops_copp_packet_class_function_pointer
-                           ops_copp_packet_class_function_pointer;
+    struct ops_copp_rx_rule_t
+                           ops_copp_rx_rules[OPS_COPP_MAX_RX_RULES];
 
     /*
-     * Function pointer to the FP qualifying rules in egress pipeline.
+     * Qualifiers of the FP entry in egress pipeline.
      */
-    ops_copp_egress_fp_function_pointer
-                           ops_copp_egress_fp_funtion_pointer;
+    struct ops_copp_fp_entry_spec_t
+                           ops_copp_egress_fp_rule;
 
     /*
-     * Function pointer to the FP qualifying rules in ingress pipeline.
+     * Qualifiers of the FP entries in ingress pipeline.
      */
-    ops_copp_ingress_fp_function_pointer
-                           ops_copp_ingress_fp_funtion_pointer[
+    struct ops_copp_fp_entry_spec_t
+                           ops_copp_ingress_fp_rules[
                                           OPS_COPP_MAX_RULES_INGRESS];
     /*
      * Status of the fp rule per hw_unit.
@@ -524,8 +526,22 @@ extern int copp_opennsl_hw_status_get(const unsigned int hw_asic_id,
                               const enum copp_protocol_class class,
                               struct copp_hw_status *const hw_status);
 
+extern char* ops_cpu_queue_name[OPS_COPP_QOS_QUEUE_MAX + 1];
+
 extern int ops_copp_init();
-extern int ops_get_all_packet_stats();
+extern void ops_copp_stats_dump(struct ds *ds);
+extern int ops_copp_stats_set_interval(int interval_ms);
+extern void ops_copp_footprint_dump(struct ds *ds);
+extern void ops_copp_run(void);
+extern void ops_copp_wait(void);
+extern int ops_copp_tune_enable(bool enable, uint32 budget_pps);
+extern int ops_copp_tune_set_bounds(
+                        enum ops_copp_packet_class_code_t packet_class,
+                        uint32 floor_rate, uint32 ceiling_rate);
+extern void ops_copp_tune_dump(struct ds *ds);
+extern int ops_copp_cpu_queue_monitor_set(bool enable, int interval_ms);
+extern void ops_copp_cpu_queue_clear(void);
+extern void ops_copp_cpu_queue_dump(struct ds *ds);
 extern int get_copp_counts (uint32 num_packets_classes,
                             struct ops_copp_stats_t* copp_stats_array);
 extern int set_copp_policy (uint32 num_packets_classes,
@@ -48,6 +48,16 @@
 #define OPS_QOS_COS_COUNT                  8
 #define OPS_QOS_DSCP_COUNT                 64
 
+/* Number of internal priorities mapped to COSqs */
+#define OPS_QOS_INT_PRIORITY_COUNT         (OPENNSL_COS_COUNT * 2)
+
+/* Refresh interval of the queue statistics snapshot, in msec */
+#define OPS_QOS_COSQ_STATS_DFLT_INTERVAL_MS    1000
+#define OPS_QOS_COSQ_STATS_MAX_INTERVAL_MS     60000
+
+/* Time after which a port not dumped anymore leaves the sweeps, in msec */
+#define OPS_QOS_COSQ_STATS_AGE_MS              60000
+
 /* QoS scheduling related macros */
 #define OPS_OPENNSL_HSP_SCHED_L0_COUNT     5
 #define OPS_OPENNSL_HSP_SCHED_L1_COUNT     10
@@ -69,6 +79,9 @@ typedef struct ops_cos_map_entry_s {
     /* Internal priority to be assigned */
     int int_priority;
 
+    /* Flag to identify if the entry is programmed in all hardware units */
+    bool programmed;
+
 } ops_cos_map_entry_t;
 
 /* DSCP map structure */
@@ -83,8 +96,34 @@ typedef struct ops_dscp_map_entry_s {
     /* COS remark value */
     int cos_remark;
 
+    /* Flag to identify if the entry is programmed in all hardware units */
+    bool programmed;
+
 } ops_dscp_map_entry_t;
 
+/*
+ * Schedule profile structure
+ *
+ * Schedule profiles are cached by content, so that the ports sharing
+ * a profile share its cache entry.
+ */
+typedef struct ops_qos_sched_profile_s {
+
+    /* Node in the schedule profile cache, hashed by profile content */
+    struct hmap_node node;
+
+    /* Number of COSq entries */
+    int n_entries;
+
+    /* OpenNSL scheduling mode and weight of each COSq */
+    int sched_mode[OPENNSL_COS_COUNT];
+    int weight[OPENNSL_COS_COUNT];
+
+    /* Number of ports programmed with the profile */
+    int n_ports;
+
+} ops_qos_sched_profile_t;
+
 /* Scheduling nodes structure */
 typedef struct ops_qos_sched_nodes_s {
 
@@ -111,6 +150,9 @@ typedef struct ops_qos_sched_nodes_s {
     /* Level 2 (L2) nodes - multicast queue for eash cosq */
     opennsl_gport_t mc_queue[OPENNSL_COS_COUNT];
 
+    /* Schedule profile programmed on the port, NULL if none */
+    ops_qos_sched_profile_t *sched_profile;
+
 } ops_qos_sched_nodes_t;
 
 /* Port config structure */
@@ -165,6 +207,16 @@ typedef struct ops_qos_config_s {
     /* DSCP map id for each hardware unit */
     int dscp_map_id[MAX_SWITCH_UNITS];
 
+    /*
+     * Number of COS and DSCP map entries written to hardware, and of
+     * entries skipped as they were already programmed with the same
+     * config.
+     */
+    uint64_t cos_map_writes;
+    uint64_t cos_map_writes_skipped;
+    uint64_t dscp_map_writes;
+    uint64_t dscp_map_writes_skipped;
+
     /*
      * Date structure for scheduling hierarchy
      * OPS_TODO:
@@ -173,6 +225,21 @@ typedef struct ops_qos_config_s {
      */
     ops_qos_sched_nodes_t *sched_nodes[MAX_SWITCH_UNITS][MAX_HW_PORTS];
 
+    /* COSq of each internal priority programmed in each hardware unit */
+    int cosq_map[MAX_SWITCH_UNITS][OPS_QOS_INT_PRIORITY_COUNT];
+
+    /* Flags to identify the internal priorities programmed in cosq_map */
+    bool cosq_map_programmed[MAX_SWITCH_UNITS][OPS_QOS_INT_PRIORITY_COUNT];
+
+    /*
+     * Number of COSq mappings and of port schedule profiles written to
+     * hardware, and of the ones skipped as they were already programmed.
+     */
+    uint64_t cosq_map_writes;
+    uint64_t cosq_map_writes_skipped;
+    uint64_t sched_profile_applies;
+    uint64_t sched_profile_applies_skipped;
+
 } ops_qos_config_t;
 
 extern int
@@ -197,6 +264,15 @@ ops_qos_get_cosq_stats(int hw_unit, int hw_port,
                        netdev_dump_queue_stats_cb* cb,
                        void *aux);
 
+extern int
+ops_qos_cosq_stats_set_interval(int interval_ms);
+
+extern void
+ops_qos_cosq_stats_port_remove(int hw_unit, int hw_port);
+
+extern void
+ops_qos_cosq_stats_bench(struct ds *ds, int iterations);
+
 extern int
 ops_qos_apply_queue_profile(
                        const struct schedule_profile_settings *s_settings,
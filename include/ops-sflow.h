@@ -83,6 +83,26 @@ struct ops_sflow_port_stats {
     uint32_t out_errors;
 };
 
+/* Per-port sample pool bookkeeping. 'rx_packets'/'tx_packets' hold the
+ * interface counters from the last periodic statistics refresh and the
+ * '*_samples' fields count samples received since that refresh.
+ * 'ingress_rate'/'egress_rate' are the rates programmed in the ASIC for
+ * the port (0 if sampling is off) and the '*_window' fields count samples
+ * since the last run of the adaptive rate controller. '*_reported' hold
+ * the last sample pool reported, which never goes back. */
+struct ops_sflow_sample_pool {
+    uint64_t rx_packets;
+    uint64_t tx_packets;
+    uint64_t rx_reported;
+    uint64_t tx_reported;
+    uint32_t rx_samples;
+    uint32_t tx_samples;
+    uint32_t ingress_rate;
+    uint32_t egress_rate;
+    uint32_t rx_window;
+    uint32_t tx_window;
+};
+
 /* sFlow parameters */
 extern SFLAgent *ops_sflow_agent;
 extern struct ofproto_sflow_options *sflow_options;
@@ -99,6 +119,9 @@ extern int opennsl_port_sample_rate_get(int unit, int port, int *ingress_rate,
 extern int ops_sflow_init(int unit);
 extern void ops_sflow_write_sampled_pkt(int unit, opennsl_pkt_t *pkt);
 extern void print_pkt(const opennsl_pkt_t *pkt);
+extern void ops_sflow_update_sample_pool(int hw_unit, int hw_port,
+                                         uint64_t rx_packets,
+                                         uint64_t tx_packets);
 
 extern void ops_sflow_agent_enable();
 extern void ops_sflow_agent_disable(struct bcmsdk_provider_node *ofproto);
@@ -124,6 +147,9 @@ ops_sflow_set_polling_interval(struct bcmsdk_provider_node *ofproto,
 extern void
 ops_sflow_remove_polling_on_lag_interface(struct ofbundle *lag_bundle);
 
+extern void
+ops_sflow_lag_update_members(struct ofbundle *bundle);
+
 extern void
 sflow_options_update_ports_list(const char *port_name,
                                 bool sflow_is_enabled);
@@ -134,6 +160,9 @@ ops_sflow_port_config_changed(const char *port_name, bool sflow_enabled);
 extern void
 ops_sflow_run(struct bcmsdk_provider_node *ofproto);
 
+extern void
+ops_sflow_wait(void);
+
 extern void
 ops_sflow_add_port(struct netdev *netdev);
 
@@ -150,4 +179,7 @@ ops_sflow_set_collectors(struct sset *ops_targets);
 
 extern void
 sflow_diag_dump_basic_cb(struct ds *ds);
+
+extern void
+ops_sflow_header_bench(struct ds *ds, int iterations);
 #endif /* __OPS_SFLOW_H__ */
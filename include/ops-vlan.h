@@ -30,6 +30,11 @@
 #define OPS_VLAN_COUNT     (OPS_VLAN_MAX - OPS_VLAN_MIN + 1)
 #define OPS_VLAN_VALID(v)  ((v)>OPS_VLAN_MIN && (v)<OPS_VLAN_MAX)
 
+// Default and max link down/up cycles of the h/w pass of the link change
+// benchmark, each one reprograms all the VLANs of the port in h/w.
+#define OPS_VLAN_LINK_BENCH_DFLT_HW_CYCLES  10
+#define OPS_VLAN_LINK_BENCH_MAX_HW_CYCLES   100
+
 extern void ops_vlan_dump(struct ds *ds, int vid);
 extern void ops_hw_vlan_dump(struct ds *ds);
 extern int ops_vlan_init(int hw_unit);
@@ -49,6 +54,8 @@ extern void bcmsdk_add_subinterface_ports(int vid, opennsl_pbmp_t *pbm);
 extern void bcmsdk_del_subinterface_ports(int vid, opennsl_pbmp_t *pbm);
 
 extern void vlan_reconfig_on_link_change(int unit, opennsl_port_t hw_port, int link_is_up);
+extern void ops_vlan_link_bench(struct ds *ds, int hw_port, int iterations,
+                                int hw_cycles);
 extern bool is_vlan_membership_empty(int vid);
 extern bool is_user_created_vlan(int vid);
 extern void set_created_by_user(int vid, bool status);
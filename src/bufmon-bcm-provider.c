@@ -64,19 +64,12 @@ void
 bufmon_counter_stats_get(bufmon_counter_info_t *list,
                          int num_counters)
 {
-    int i = 0;
-
     if (!num_counters) {
         return;
     }
 
-    /* stats sync from ASIC */
-    realm_sync_all();
-
-    for (i = 0; i < num_counters; i++) {
-        bufmon_counter_info_t *counter = &list[i];
-        handle_bufmon_counter_mgmt(counter, GET_COUNTER_VALUE);
-    }
+    /* stats sync from ASIC and read of the counters */
+    handle_bufmon_counters_stats_get(list, num_counters);
 
     return;
 } /* bufmon_counter_stats_get */
@@ -386,6 +386,10 @@ netdev_bcmsdk_destruct(struct netdev *netdev_)
 
     list_remove(&netdev->list_node);
     ovs_mutex_unlock(&bcmsdk_list_mutex);
+
+    if (netdev->hw_id >= 0) {
+        ops_qos_cosq_stats_port_remove(netdev->hw_unit, netdev->hw_id);
+    }
 }
 
 static void
@@ -1230,6 +1234,10 @@ netdev_bcmsdk_get_stats(const struct netdev *netdev_, struct netdev_stats *stats
     netdev->stats.tx_packets = stats->tx_packets;
     ovs_mutex_unlock(&netdev->mutex);
 
+    /* Refresh the sFlow sample pool snapshot for this port. */
+    ops_sflow_update_sample_pool(netdev->hw_unit, netdev->hw_id,
+                                 stats->rx_packets, stats->tx_packets);
+
     /* L3 stats */
     rc = netdev_bcmsdk_populate_l3_stats(netdev, stats);
     if (OPENNSL_FAILURE(rc)) {
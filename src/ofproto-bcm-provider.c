@@ -50,6 +50,7 @@
 #include "ops-stats.h"
 #include "ops-mirrors.h"
 #include "ops-classifier.h"
+#include "ops-copp.h"
 #include "ofproto-ofdpa.h"
 
 #define DEFAULT_VID  (1)
@@ -782,6 +783,8 @@ run(struct ofproto *ofproto_)
     struct bcmsdk_provider_node *ofproto = bcmsdk_provider_node_cast(ofproto_);
 
     ops_sflow_run(ofproto);
+    ops_cls_run();
+    ops_copp_run();
 
     return 0;
 }
@@ -789,7 +792,9 @@ run(struct ofproto *ofproto_)
 static void
 wait(struct ofproto *ofproto_ OVS_UNUSED)
 {
-    return;
+    ops_sflow_wait();
+    ops_cls_wait();
+    ops_copp_wait();
 }
 
 static void
@@ -1079,8 +1084,11 @@ bundle_lookup(const struct bcmsdk_provider_node *ofproto, void *aux)
 static void
 bundle_del_port(struct bcmsdk_provider_ofport_node *port)
 {
+    struct ofbundle *bundle = port->bundle;
+
     list_remove(&port->bundle_node);
     port->bundle = NULL;
+    ops_sflow_lag_update_members(bundle);
 }
 
 static bool
@@ -1100,6 +1108,7 @@ bundle_add_port(struct ofbundle *bundle, ofp_port_t ofp_port,
         }
         port->bundle = bundle;
         list_push_back(&bundle->ports, &port->bundle_node);
+        ops_sflow_lag_update_members(bundle);
     }
 
     return true;
@@ -1207,6 +1216,7 @@ bundle_destroy(struct ofbundle *bundle)
 
     hmap_remove(&ofproto->bundles, &bundle->hmap_node);
     bitmap_free(bundle->trunks);
+    free(bundle->lag_sflow_members);
     free(bundle->name);
     free(bundle);
 }
@@ -1607,6 +1617,8 @@ bundle_set(struct ofproto *ofproto_, void *aux,
         bundle->lacp = NULL;
         bundle->bond = NULL;
         bundle->lag_sflow_polling_interval = 0;
+        bundle->lag_sflow_members = NULL;
+        bundle->lag_sflow_n_members = 0;
 
         bundle->ip4_address = NULL;
         bundle->ip6_address = NULL;
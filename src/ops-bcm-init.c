@@ -19,12 +19,26 @@
  * Purpose: Main file for the implementation of OpenSwitch BCM SDK application initialization.
  */
 
+#include <errno.h>
+#include <inttypes.h>
+#include <semaphore.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
 #include <openvswitch/vlog.h>
 #include <ovs/uuid.h>
+#include <ovs/dynamic-string.h>
+#include <ovs/util.h>
+#include <ovs-atomic.h>
+#include <ovs-thread.h>
+#include <token-bucket.h>
 
 #include <sal/driver.h>
 #include <opennsl/error.h>
 #include <opennsl/rx.h>
+#include <opennsl/cosq.h>
 
 #include "bcm.h"
 #include "platform-defines.h"
@@ -46,66 +60,598 @@
 
 VLOG_DEFINE_THIS_MODULE(ops_bcm_init);
 
-
 extern int
 opennsl_rx_register(int, const char *, opennsl_rx_cb_f, uint8, void *, uint32);
 
-/* TODO: This callback is also sending sFlow pkts to collectors. It must
- * do minimal computation in order to receive subsequent sFlow pkts.
- * Callback should queue up pkts received from ASIC and return.
- * Temporarily, configure a low sampling rate (say 1 in 10 pkts, when
- * incoming rate is 1 pkt/s as in case of 'ping'). Eventually, a different
- * thread will process incoming pkts.
- */
+/* RX dispatch.
+ *
+ * opennsl_rx_callback() runs on the SDK RX thread. It only classifies the
+ * packets by RX reason, copies the first OPS_RX_SNAPLEN bytes and the
+ * descriptor into the ring of the class and returns. Each class has its
+ * own worker thread, scheduling priority and rate budget, so that a burst
+ * of one class (e.g. sFlow samples) can't delay the others (e.g. ACL
+ * logging) nor the SDK RX thread itself.
+ *
+ * Rings are single producer (the RX thread of the unit) and single
+ * consumer (the worker of the class) and don't take any lock. */
+#define OPS_RX_SNAPLEN          512
+#define OPS_RX_RING_SIZE        256     /* Must be a power of 2. */
+
+struct ops_rx_entry {
+    opennsl_pkt_t pkt;              /* Copy of the SDK descriptor. */
+    opennsl_pkt_blk_t blk;          /* Single block, points to 'data'. */
+    uint64_t enqueued;              /* Monotonic time, in nsec. */
+    uint8_t data[OPS_RX_SNAPLEN];
+};
+
+struct ops_rx_ring {
+    atomic_uint32_t head;           /* Written by the producer only. */
+    atomic_uint32_t tail;           /* Written by the consumer only. */
+    struct ops_rx_entry entries[OPS_RX_RING_SIZE];
+};
+
+struct ops_rx_class_stats {
+    atomic_uint64_t received;       /* Packets of the class seen. */
+    atomic_uint64_t queued;         /* Packets handed to the worker. */
+    atomic_uint64_t rate_drops;     /* Dropped, over the rate budget. */
+    atomic_uint64_t queue_drops;    /* Dropped, ring full. */
+    atomic_uint64_t processed;      /* Packets handled by the worker. */
+    atomic_uint64_t wait_ns;        /* Total time spent in the ring. */
+    atomic_uint64_t busy_ns;        /* Total time spent in the handler. */
+    atomic_uint64_t max_wait_ns;
+    atomic_uint64_t max_busy_ns;
+};
+
+struct ops_rx_class {
+    const char *name;
+    void (*handler)(int unit, opennsl_pkt_t *pkt);
+    unsigned int pps;               /* Rate budget. */
+    unsigned int burst;             /* Packets. */
+    int nice;                       /* Priority of the worker thread. */
+
+    struct token_bucket tb[MAX_SWITCH_UNITS];   /* Producer only. */
+    struct ops_rx_ring ring[MAX_SWITCH_UNITS];
+    sem_t sem;                      /* One post per queued packet. */
+    struct ops_rx_class_stats stats;
+};
+
+static void ops_rx_handle_sflow(int unit, opennsl_pkt_t *pkt);
+static void ops_rx_handle_acl_log(int unit, opennsl_pkt_t *pkt);
+
+static struct ops_rx_class rx_classes[OPS_RX_CLASS_MAX] = {
+    [OPS_RX_CLASS_SFLOW] = {
+        .name = "sflow",
+        .handler = ops_rx_handle_sflow,
+        .pps = OPS_RX_SFLOW_PPS,
+        .burst = OPS_RX_SFLOW_BURST,
+        .nice = 5,
+    },
+    [OPS_RX_CLASS_ACL_LOG] = {
+        .name = "acl-log",
+        .handler = ops_rx_handle_acl_log,
+        .pps = OPS_RX_ACL_LOG_PPS,
+        .burst = OPS_RX_ACL_LOG_BURST,
+        .nice = 10,
+    },
+};
+
+/* Packets that don't belong to any class. */
+static atomic_uint64_t rx_unclassified = ATOMIC_VAR_INIT(0);
+
+static bool rx_dispatch_started;
+
+static uint64_t
+ops_rx_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void
+ops_rx_stat_add(atomic_uint64_t *stat, uint64_t value)
+{
+    uint64_t orig;
+
+    atomic_add_relaxed(stat, value, &orig);
+}
+
+static void
+ops_rx_stat_max(atomic_uint64_t *stat, uint64_t value)
+{
+    uint64_t cur;
+
+    /* Single writer, no need for a compare and swap. */
+    atomic_read_relaxed(stat, &cur);
+    if (value > cur) {
+        atomic_store_relaxed(stat, value);
+    }
+}
+
+/* RX instrumentation.
+ *
+ * Per RX reason packet counters and histograms of the time spent in the
+ * RX callback and in the sFlow and ACL logging handlers. Bucket 'i' of a
+ * histogram counts the calls that took less than 2^i usec, the last bucket
+ * counts everything slower. All updates are relaxed atomic increments, so
+ * the RX thread and the workers never block on the readers. */
+#define OPS_RX_HIST_BUCKETS     16
+
+enum ops_rx_hist_id {
+    OPS_RX_HIST_CALLBACK,           /* opennsl_rx_callback(). */
+    OPS_RX_HIST_SFLOW,              /* ops_sflow_write_sampled_pkt(). */
+    OPS_RX_HIST_ACL_LOG,            /* acl_log_handle_rx_event(). */
+    OPS_RX_HIST_MAX
+};
+
+struct ops_rx_hist {
+    const char *name;
+    atomic_uint64_t count;
+    atomic_uint64_t total_ns;
+    atomic_uint64_t max_ns;
+    atomic_uint64_t buckets[OPS_RX_HIST_BUCKETS];
+};
+
+static struct ops_rx_hist rx_hists[OPS_RX_HIST_MAX] = {
+    [OPS_RX_HIST_CALLBACK] = { .name = "opennsl_rx_callback" },
+    [OPS_RX_HIST_SFLOW] = { .name = "ops_sflow_write_sampled_pkt" },
+    [OPS_RX_HIST_ACL_LOG] = { .name = "acl_log_handle_rx_event" },
+};
+
+static atomic_uint64_t rx_reason_count[opennslRxReasonCount];
+
+/* Baseline of the CPU queue drop counters, taken on reset. */
+static uint64_t rx_cpu_queue_drops[MAX_SWITCH_UNITS][OPS_COPP_QOS_QUEUE_MAX + 1];
+
+static void
+ops_rx_hist_add(enum ops_rx_hist_id id, uint64_t ns)
+{
+    struct ops_rx_hist *hist = &rx_hists[id];
+    uint64_t usec = ns / 1000;
+    uint64_t orig;
+    int bucket = 0;
+
+    while (bucket < OPS_RX_HIST_BUCKETS - 1 && usec >= (1ULL << bucket)) {
+        bucket++;
+    }
+
+    atomic_add_relaxed(&hist->count, 1, &orig);
+    atomic_add_relaxed(&hist->total_ns, ns, &orig);
+    atomic_add_relaxed(&hist->buckets[bucket], 1, &orig);
+
+    /* Racy between the RX thread and a worker, but only ever loses a
+     * maximum to a concurrent one of similar size. */
+    atomic_read_relaxed(&hist->max_ns, &orig);
+    if (ns > orig) {
+        atomic_store_relaxed(&hist->max_ns, ns);
+    }
+}
+
+static void
+ops_rx_reasons_count(const opennsl_pkt_t *pkt)
+{
+    uint64_t orig;
+    int reason;
+
+    for (reason = 0; reason < opennslRxReasonCount; reason++) {
+        if (OPENNSL_RX_REASON_GET(pkt->rx_reasons, reason)) {
+            atomic_add_relaxed(&rx_reason_count[reason], 1, &orig);
+        }
+    }
+}
+
+static const char *
+ops_rx_reason_name(int reason)
+{
+    switch (reason) {
+    case opennslRxReasonSampleSource:
+        return "SampleSource";
+    case opennslRxReasonSampleDest:
+        return "SampleDest";
+    case opennslRxReasonFilterMatch:
+        return "FilterMatch";
+    case opennslRxReasonL3DestMiss:
+        return "L3DestMiss";
+    default:
+        return NULL;
+    }
+}
+
+static int
+ops_rx_cpu_queue_drops(int unit, int queue, uint64_t *drops)
+{
+    uint64 value;
+    int rc;
+
+    rc = opennsl_cosq_stat_get(unit, OPENNSL_GPORT_LOCAL_CPU, queue,
+                               opennslCosqStatDroppedPackets, &value);
+    if (OPENNSL_FAILURE(rc)) {
+        return rc;
+    }
+    *drops = value;
+
+    return 0;
+}
+
+static void
+ops_rx_handle_sflow(int unit, opennsl_pkt_t *pkt)
+{
+    uint64_t start;
+
+    /* Uncomment to print the sampled pkt info */
+    /* print_pkt(pkt); */
+
+    if (OPENNSL_RX_REASON_GET(pkt->rx_reasons,
+                              opennslRxReasonSampleSource)) {
+        netdev_bcmsdk_populate_sflow_stats(true, unit,
+                                           pkt->src_port, pkt->pkt_len);
+    }
+
+    if (OPENNSL_RX_REASON_GET(pkt->rx_reasons,
+                              opennslRxReasonSampleDest)) {
+        netdev_bcmsdk_populate_sflow_stats(false, unit,
+                                           pkt->dest_port, pkt->pkt_len);
+    }
+
+    /* Write incoming data to Receivers buffer. When buffer is full,
+     * data is sent to Collectors. */
+    start = ops_rx_now_ns();
+    ops_sflow_write_sampled_pkt(unit, pkt);
+    ops_rx_hist_add(OPS_RX_HIST_SFLOW, ops_rx_now_ns() - start);
+}
+
+static void
+ops_rx_handle_acl_log(int unit OVS_UNUSED, opennsl_pkt_t *pkt)
+{
+    uint64_t start;
+
+    /* Copy relevant parts of the metadata and header to an ACL logging
+     * buffer */
+    start = ops_rx_now_ns();
+    acl_log_handle_rx_event(pkt);
+    ops_rx_hist_add(OPS_RX_HIST_ACL_LOG, ops_rx_now_ns() - start);
+}
+
+/* Queue a copy of 'pkt' for the worker of 'class'. Called from the SDK RX
+ * thread of 'unit'. Falls back to handling the packet inline when the
+ * workers are not running. */
+static void
+ops_rx_dispatch(int unit, opennsl_pkt_t *pkt, enum ops_rx_class_id id)
+{
+    struct ops_rx_class *class = &rx_classes[id];
+    struct ops_rx_ring *ring;
+    struct ops_rx_entry *entry;
+    uint32_t head, tail, copied, chunk;
+    int i;
+
+    ops_rx_stat_add(&class->stats.received, 1);
+
+    if (!rx_dispatch_started || !VALID_HW_UNIT(unit)) {
+        class->handler(unit, pkt);
+        ops_rx_stat_add(&class->stats.processed, 1);
+        return;
+    }
+
+    if (!token_bucket_withdraw(&class->tb[unit], 1000)) {
+        ops_rx_stat_add(&class->stats.rate_drops, 1);
+        return;
+    }
+
+    ring = &class->ring[unit];
+    atomic_read_relaxed(&ring->head, &head);
+    atomic_read_explicit(&ring->tail, &tail, memory_order_acquire);
+    if (head - tail >= OPS_RX_RING_SIZE) {
+        ops_rx_stat_add(&class->stats.queue_drops, 1);
+        return;
+    }
+
+    entry = &ring->entries[head & (OPS_RX_RING_SIZE - 1)];
+    entry->pkt = *pkt;
+
+    /* Gather the head of the packet from all the blocks. The SDK reuses
+     * its buffers as soon as we return. */
+    copied = 0;
+    for (i = 0; i < pkt->blk_count && copied < OPS_RX_SNAPLEN; i++) {
+        chunk = MIN(pkt->pkt_data[i].len, OPS_RX_SNAPLEN - copied);
+        memcpy(entry->data + copied, pkt->pkt_data[i].data, chunk);
+        copied += chunk;
+    }
+    entry->blk.data = entry->data;
+    entry->blk.len = copied;
+    entry->pkt.pkt_data = &entry->blk;
+    entry->pkt.blk_count = 1;
+    entry->enqueued = ops_rx_now_ns();
+
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    ops_rx_stat_add(&class->stats.queued, 1);
+    sem_post(&class->sem);
+}
+
+/* Pops the next packet of 'class' and handles it. Returns false if all
+ * the rings of the class are empty. */
+static bool
+ops_rx_worker_run(struct ops_rx_class *class)
+{
+    struct ops_rx_ring *ring;
+    struct ops_rx_entry *entry;
+    uint32_t head, tail;
+    uint64_t start, end;
+    int unit;
+
+    for (unit = 0; unit < MAX_SWITCH_UNITS; unit++) {
+        ring = &class->ring[unit];
+        atomic_read_relaxed(&ring->tail, &tail);
+        atomic_read_explicit(&ring->head, &head, memory_order_acquire);
+        if (head == tail) {
+            continue;
+        }
+
+        entry = &ring->entries[tail & (OPS_RX_RING_SIZE - 1)];
+        start = ops_rx_now_ns();
+        class->handler(unit, &entry->pkt);
+        end = ops_rx_now_ns();
+
+        ops_rx_stat_add(&class->stats.wait_ns, start - entry->enqueued);
+        ops_rx_stat_add(&class->stats.busy_ns, end - start);
+        ops_rx_stat_max(&class->stats.max_wait_ns, start - entry->enqueued);
+        ops_rx_stat_max(&class->stats.max_busy_ns, end - start);
+        ops_rx_stat_add(&class->stats.processed, 1);
+
+        atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+        return true;
+    }
+
+    return false;
+}
+
+static void *
+ops_rx_worker_main(void *class_)
+{
+    struct ops_rx_class *class = class_;
+
+    if (setpriority(PRIO_PROCESS, syscall(SYS_gettid), class->nice)) {
+        VLOG_WARN("Failed to set the priority of the %s RX worker (%s)",
+                  class->name, ovs_strerror(errno));
+    }
+
+    for (;;) {
+        if (sem_wait(&class->sem) && errno == EINTR) {
+            continue;
+        }
+        ops_rx_worker_run(class);
+    }
+
+    return NULL;
+}
+
+static void
+ops_rx_dispatch_init(void)
+{
+    struct ops_rx_class *class;
+    char name[32];
+    int id, unit, i;
+
+    if (rx_dispatch_started) {
+        return;
+    }
+
+    for (id = 0; id < OPS_RX_CLASS_MAX; id++) {
+        class = &rx_classes[id];
+        for (unit = 0; unit < MAX_SWITCH_UNITS; unit++) {
+            token_bucket_init(&class->tb[unit], class->pps,
+                              class->burst * 1000);
+            atomic_init(&class->ring[unit].head, 0);
+            atomic_init(&class->ring[unit].tail, 0);
+            for (i = 0; i < OPS_RX_RING_SIZE; i++) {
+                class->ring[unit].entries[i].pkt.pkt_data =
+                    &class->ring[unit].entries[i].blk;
+            }
+        }
+        sem_init(&class->sem, 0, 0);
+        snprintf(name, sizeof name, "ops-rx-%s", class->name);
+        ovs_thread_create(name, ops_rx_worker_main, class);
+    }
+
+    rx_dispatch_started = true;
+}
+
+/* Dumps the per class dispatch counters. */
+void
+ops_rx_dispatch_dump(struct ds *ds)
+{
+    struct ops_rx_class_stats *stats;
+    uint64_t received, queued, rate_drops, queue_drops, processed;
+    uint64_t wait_ns, busy_ns, max_wait_ns, max_busy_ns, unclassified;
+    int id;
+
+    ds_put_format(ds, "%-8s %10s %10s %10s %10s %10s %10s %10s %10s %10s\n",
+                  "Class", "Budget", "Received", "Queued", "RateDrop",
+                  "QueueDrop", "Processed", "AvgWait", "MaxWait", "AvgProc");
+    ds_put_format(ds, "%-8s %10s %10s %10s %10s %10s %10s %10s %10s %10s\n",
+                  "", "(pps)", "", "", "", "", "", "(usec)", "(usec)",
+                  "(usec)");
+    for (id = 0; id < OPS_RX_CLASS_MAX; id++) {
+        stats = &rx_classes[id].stats;
+        atomic_read_relaxed(&stats->received, &received);
+        atomic_read_relaxed(&stats->queued, &queued);
+        atomic_read_relaxed(&stats->rate_drops, &rate_drops);
+        atomic_read_relaxed(&stats->queue_drops, &queue_drops);
+        atomic_read_relaxed(&stats->processed, &processed);
+        atomic_read_relaxed(&stats->wait_ns, &wait_ns);
+        atomic_read_relaxed(&stats->busy_ns, &busy_ns);
+        atomic_read_relaxed(&stats->max_wait_ns, &max_wait_ns);
+        atomic_read_relaxed(&stats->max_busy_ns, &max_busy_ns);
+
+        ds_put_format(ds, "%-8s %10u %10"PRIu64" %10"PRIu64" %10"PRIu64
+                      " %10"PRIu64" %10"PRIu64" %10"PRIu64" %10"PRIu64
+                      " %10"PRIu64"\n", rx_classes[id].name,
+                      rx_classes[id].pps, received, queued, rate_drops,
+                      queue_drops, processed,
+                      processed ? wait_ns / processed / 1000 : 0,
+                      max_wait_ns / 1000,
+                      processed ? busy_ns / processed / 1000 : 0);
+    }
+    atomic_read_relaxed(&rx_unclassified, &unclassified);
+    ds_put_format(ds, "Unclassified packets: %"PRIu64"\n", unclassified);
+    ds_put_format(ds, "Workers: %s\n",
+                  rx_dispatch_started ? "running" : "not started");
+}
+
 opennsl_rx_t opennsl_rx_callback(int unit, opennsl_pkt_t *pkt, void *cookie)
 {
+    bool classified = false;
+    uint64_t start;
+
     if (!pkt) {
         VLOG_ERR("Invalid pkt sent by ASIC");
         log_event("SFLOW_CALLBACK_INVALID_PKT", NULL);
         return OPENNSL_RX_HANDLED;
     }
 
+    start = ops_rx_now_ns();
+    ops_rx_reasons_count(pkt);
+
     /* sFlow's sampled pkt */
     if (OPENNSL_RX_REASON_GET(pkt->rx_reasons, opennslRxReasonSampleDest) ||
         OPENNSL_RX_REASON_GET(pkt->rx_reasons, opennslRxReasonSampleSource)) {
+        ops_rx_dispatch(unit, pkt, OPS_RX_CLASS_SFLOW);
+        classified = true;
+    }
+
+    /* ACL logging packet */
+    if (OPENNSL_RX_REASON_GET(pkt->rx_reasons, opennslRxReasonFilterMatch)
+          && (pkt->rx_matched == ACL_LOG_RULE_ID)) {
+        ops_rx_dispatch(unit, pkt, OPS_RX_CLASS_ACL_LOG);
+        classified = true;
+    }
+
+    if (!classified) {
+        ops_rx_stat_add(&rx_unclassified, 1);
+    }
+
+    ops_rx_hist_add(OPS_RX_HIST_CALLBACK, ops_rx_now_ns() - start);
 
-        /* Uncomment to print the sampled pkt info */
-        /* print_pkt(pkt); */
+    return OPENNSL_RX_HANDLED;
+}
+
+/* Dumps the RX counters, histograms and CPU queue drops. */
+void
+ops_rx_stats_dump(struct ds *ds)
+{
+    uint64_t count, total_ns, max_ns, value, drops;
+    const char *name;
+    int id, i, unit, queue;
+
+    ds_put_format(ds, "RX packets per reason:\n");
+    for (i = 0; i < opennslRxReasonCount; i++) {
+        atomic_read_relaxed(&rx_reason_count[i], &count);
+        if (!count) {
+            continue;
+        }
+        name = ops_rx_reason_name(i);
+        if (name) {
+            ds_put_format(ds, "  %-20s %12"PRIu64"\n", name, count);
+        } else {
+            ds_put_format(ds, "  reason %-13d %12"PRIu64"\n", i, count);
+        }
+    }
 
-        if (OPENNSL_RX_REASON_GET(pkt->rx_reasons,
-                                  opennslRxReasonSampleSource)) {
-            netdev_bcmsdk_populate_sflow_stats(true, unit,
-                                               pkt->src_port, pkt->pkt_len);
+    for (id = 0; id < OPS_RX_HIST_MAX; id++) {
+        atomic_read_relaxed(&rx_hists[id].count, &count);
+        atomic_read_relaxed(&rx_hists[id].total_ns, &total_ns);
+        atomic_read_relaxed(&rx_hists[id].max_ns, &max_ns);
+        ds_put_format(ds, "\n%s: %"PRIu64" calls, avg %"PRIu64" nsec, "
+                      "max %"PRIu64" nsec\n", rx_hists[id].name, count,
+                      count ? total_ns / count : 0, max_ns);
+        for (i = 0; i < OPS_RX_HIST_BUCKETS; i++) {
+            atomic_read_relaxed(&rx_hists[id].buckets[i], &value);
+            if (!value) {
+                continue;
+            }
+            if (i < OPS_RX_HIST_BUCKETS - 1) {
+                ds_put_format(ds, "  < %6llu usec %12"PRIu64"\n",
+                              1ULL << i, value);
+            } else {
+                ds_put_format(ds, " >= %6llu usec %12"PRIu64"\n",
+                              1ULL << (i - 1), value);
+            }
         }
+    }
 
-        if (OPENNSL_RX_REASON_GET(pkt->rx_reasons,
-                                  opennslRxReasonSampleDest)) {
-            netdev_bcmsdk_populate_sflow_stats(false, unit,
-                                               pkt->dest_port, pkt->pkt_len);
+    ds_put_format(ds, "\nRX dispatch:\n");
+    ops_rx_dispatch_dump(ds);
+
+    ds_put_format(ds, "\nCPU queue drops:\n");
+    for (unit = 0; unit < MAX_SWITCH_UNITS; unit++) {
+        for (queue = 0; queue <= OPS_COPP_QOS_QUEUE_MAX; queue++) {
+            if (ops_rx_cpu_queue_drops(unit, queue, &drops)) {
+                ds_put_format(ds, "  unit %d queue %-2d %-12s unavailable\n",
+                              unit, queue, ops_cpu_queue_name[queue]);
+                continue;
+            }
+            ds_put_format(ds, "  unit %d queue %-2d %-12s %12"PRIu64"\n",
+                          unit, queue, ops_cpu_queue_name[queue],
+                          drops - rx_cpu_queue_drops[unit][queue]);
         }
+    }
+}
 
-        /* Write incoming data to Receivers buffer. When buffer is full,
-         * data is sent to Collectors. */
-        ops_sflow_write_sampled_pkt(unit, pkt);
+/* Clears the RX counters and histograms. The hardware CPU queue counters
+ * are not cleared, only their current value is used as a new baseline. */
+void
+ops_rx_stats_reset(void)
+{
+    struct ops_rx_class_stats *stats;
+    uint64_t drops;
+    int id, i, unit, queue;
+
+    for (i = 0; i < opennslRxReasonCount; i++) {
+        atomic_store_relaxed(&rx_reason_count[i], 0);
     }
 
-    /* ACL logging packet */
-    if (OPENNSL_RX_REASON_GET(pkt->rx_reasons, opennslRxReasonFilterMatch)
-          && (pkt->rx_matched == ACL_LOG_RULE_ID)) {
-        /* Copy relevant parts of the metadata and header to an ACL logging
-        * buffer */
-        acl_log_handle_rx_event(pkt);
+    for (id = 0; id < OPS_RX_HIST_MAX; id++) {
+        atomic_store_relaxed(&rx_hists[id].count, 0);
+        atomic_store_relaxed(&rx_hists[id].total_ns, 0);
+        atomic_store_relaxed(&rx_hists[id].max_ns, 0);
+        for (i = 0; i < OPS_RX_HIST_BUCKETS; i++) {
+            atomic_store_relaxed(&rx_hists[id].buckets[i], 0);
+        }
     }
 
-    return OPENNSL_RX_HANDLED;
+    for (id = 0; id < OPS_RX_CLASS_MAX; id++) {
+        stats = &rx_classes[id].stats;
+        atomic_store_relaxed(&stats->received, 0);
+        atomic_store_relaxed(&stats->queued, 0);
+        atomic_store_relaxed(&stats->rate_drops, 0);
+        atomic_store_relaxed(&stats->queue_drops, 0);
+        atomic_store_relaxed(&stats->processed, 0);
+        atomic_store_relaxed(&stats->wait_ns, 0);
+        atomic_store_relaxed(&stats->busy_ns, 0);
+        atomic_store_relaxed(&stats->max_wait_ns, 0);
+        atomic_store_relaxed(&stats->max_busy_ns, 0);
+    }
+    atomic_store_relaxed(&rx_unclassified, 0);
+
+    for (unit = 0; unit < MAX_SWITCH_UNITS; unit++) {
+        for (queue = 0; queue <= OPS_COPP_QOS_QUEUE_MAX; queue++) {
+            if (!ops_rx_cpu_queue_drops(unit, queue, &drops)) {
+                rx_cpu_queue_drops[unit][queue] = drops;
+            }
+        }
+    }
 }
 
+
 int
 ops_rx_init(int unit)
 {
     opennsl_error_t  rc = OPENNSL_E_NONE;
     opennsl_rx_cfg_t rx_cfg;
 
+    /* Start the class workers before any packet can be received. */
+    ops_rx_dispatch_init();
+
     rc = opennsl_rx_register(unit,
                             "opennsl rx callback function",
                             opennsl_rx_callback,
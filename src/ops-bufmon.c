@@ -23,8 +23,15 @@
 #include <stdlib.h>
 #include <string.h>
 #include <inttypes.h>
+#include <time.h>
+#include <semaphore.h>
+#include <errno.h>
 
 #include <openvswitch/vlog.h>
+#include <ovs/util.h>
+#include <ovs/hmap.h>
+#include <ovs/dynamic-string.h>
+#include <ovs-thread.h>
 #include <opennsl/error.h>
 #include <opennsl/types.h>
 #include <opennsl/cosq.h>
@@ -34,9 +41,66 @@
 #include "bufmon-bcm-provider.h"
 #include "platform-defines.h"
 #include "ops-debug.h"
+#include "hash.h"
+#include "timeval.h"
+#include "token-bucket.h"
 
 VLOG_DEFINE_THIS_MODULE(ops_bufmon);
 
+#define  BST_SAMPLER_HIST_BUCKETS  (20)
+
+/* shortest sleep of the sampler thread between two sweeps, in usec */
+#define  BST_SAMPLER_MIN_SLEEP_USEC  (500)
+
+/* structure to hold the occupancy samples of a counter */
+typedef struct bst_sampler_stats {
+    /* number of samples, last and peak value in bytes */
+    uint64_t samples;
+    int64_t current;
+    int64_t peak;
+
+    /* sum of the samples in cells, for the mean */
+    uint64_t sum;
+
+    /* log2 histogram of the samples in cells */
+    uint64_t hist[BST_SAMPLER_HIST_BUCKETS];
+
+    /* time above the trigger threshold and bursts above it */
+    uint64_t above_usec;
+    uint64_t bursts;
+    uint64_t burst_usec;
+    uint64_t max_burst_usec;
+    bool in_burst;
+
+    /* time of the last sample */
+    long long int last_usec;
+} bst_sampler_stats_t;
+
+/* structure to hold a counter parsed into its BST stat parameters */
+typedef struct bufmon_counter_desc {
+    /* node in counter_desc_map */
+    struct hmap_node node;
+
+    /* counter name and hw unit */
+    char *name;
+    int hw_unit;
+
+    /* false if the realm or the parameters of the counter are invalid */
+    bool valid;
+
+    /* BST stat id, gport of the port and cosq of the queue, priority group
+     * or service pool */
+    opennsl_bst_stat_id_t statid;
+    opennsl_gport_t gport;
+    int cosq;
+
+    /* trigger threshold in bytes, 0 if unknown */
+    int64_t threshold;
+
+    /* samples of the high frequency sampler, NULL if never sampled */
+    bst_sampler_stats_t *samples;
+} bufmon_counter_desc_t;
+
 /* structure to map realm string to statid  and counter helper functions */
 typedef struct realm_helper {
     /* realm string */
@@ -45,11 +109,19 @@ typedef struct realm_helper {
     /* statid type */
     opennsl_bst_stat_id_t statid;
 
-    /* internal function to collect the statistics or setting threshold */
-    void (*bufmon_counter_handler)(int statid, counter_operations_t type,
-                                   bufmon_counter_info_t *counter);
+    /* internal function to resolve the gport and cosq of a counter */
+    opennsl_error_t (*bufmon_counter_desc)(bufmon_counter_info_t *counter,
+                                           bufmon_counter_desc_t *desc);
 } realm_helper_t;
 
+/*
+ * Counters are parsed once into descriptors, found by counter name and
+ * hw unit on every poll. The sampler thread walks the map, so the map and
+ * the descriptors are updated under bst_sampler_mutex.
+ */
+static struct hmap counter_desc_map = HMAP_INITIALIZER(&counter_desc_map);
+static struct ovs_mutex bst_sampler_mutex = OVS_MUTEX_INITIALIZER;
+
 #define OPENNSL_RV_ERROR_CHECK(_rv, fmt, args...)     \
         if ((_rv) != OPENNSL_E_NONE) {   \
             VLOG_DBG("Opennsl error (%s:%d %d) "fmt, __FILE__,    \
@@ -82,12 +154,12 @@ static int trigger_user_data[MAX_SWITCH_UNITS];
              (_statid) == opennslBstStatIdDevice ||          \
              (_statid) == opennslBstStatIdCpuQueue) ? true : false
 
-/* Checks the input parameters are valid */
-#define INPUT_PARAM_VALIDATE(_param)                   \
+/* Checks the counter parameters are valid */
+#define DESC_PARAM_VALIDATE(_param)                   \
         if ((_param) == BUFMON_INVALID_VALUE) {   \
             VLOG_DBG("%s:%d invalid parameter  ",  \
                      __FUNCTION__, __LINE__); \
-            return;                              \
+            return OPENNSL_E_PARAM;              \
         }
 
 #define MAX_STATS get_max_stats()
@@ -119,423 +191,1053 @@ static int trigger_user_data[MAX_SWITCH_UNITS];
         opennsl_cosq_bst_stat_sync((_unit), (_bid))
 
 static inline unsigned int get_max_stats(void);
-static inline int get_realm_index(int statid, char *str);
 static const realm_helper_t *get_all_realm_list(void);
 static int64_t get_stat_default_threshold (int asic, int statid);
 
-static void
-device_data_stats(int statid, counter_operations_t type,
-                  bufmon_counter_info_t *counter)
+static opennsl_error_t
+device_data_desc(bufmon_counter_info_t *counter, bufmon_counter_desc_t *desc)
 {
-    opennsl_cosq_bst_profile_t profile;
-    opennsl_error_t rv = OPENNSL_E_NONE;
+    desc->gport = 0;
+    desc->cosq = 0;
 
-    if (type == GET_COUNTER_VALUE) {
-        rv = BCM_API_BST_STAT_GET(counter->hw_unit_id, 0, 0,
-                                  statid, 0, &counter->counter_value);
-    } else if (type == SET_COUNTER_THRESHOLD
-               && counter->trigger_threshold) {
-        profile.byte = counter->trigger_threshold;
-        rv = BCM_API_BST_PROFILE_SET(counter->hw_unit_id, 0, 0,
-                                     statid, &profile);
-    }
-
-    OPENNSL_RV_ERROR_CHECK(rv, " %d", statid);
-}/* device_data_stats */
+    return OPENNSL_E_NONE;
+}/* device_data_desc */
 
-static void
-ingress_port_priority_group_stats(int statid, counter_operations_t type,
-                                  bufmon_counter_info_t *counter)
+static opennsl_error_t
+ingress_port_priority_group_desc(bufmon_counter_info_t *counter,
+                                 bufmon_counter_desc_t *desc)
 {
     int port, pg;
-    opennsl_gport_t gport;
-    opennsl_error_t rv = OPENNSL_E_NONE;
-    opennsl_cosq_bst_profile_t profile;
 
     port = smap_get_int(&counter->counter_vendor_specific_info,
                         "port", BUFMON_INVALID_VALUE);
 
-    INPUT_PARAM_VALIDATE(port);
+    DESC_PARAM_VALIDATE(port);
 
     pg = smap_get_int(&counter->counter_vendor_specific_info,
                       "priority-group", BUFMON_INVALID_VALUE);
 
-    INPUT_PARAM_VALIDATE(pg);
-
-    rv = opennsl_port_gport_get(counter->hw_unit_id, port, &gport);
+    DESC_PARAM_VALIDATE(pg);
 
-    OPENNSL_RV_ERROR_CHECK(rv, " %d %d %d", counter->hw_unit_id, port, pg);
+    desc->cosq = pg - 1;
 
-    if (type == GET_COUNTER_VALUE) {
-        rv = BCM_API_BST_STAT_GET(counter->hw_unit_id, gport, pg - 1,
-                                  statid, 0, &counter->counter_value);
-    } else if (type == SET_COUNTER_THRESHOLD
-               && counter->trigger_threshold) {
-        profile.byte = counter->trigger_threshold;
-        rv = BCM_API_BST_PROFILE_SET(counter->hw_unit_id, gport, pg - 1,
-                                     statid, &profile);
-    }
+    return opennsl_port_gport_get(counter->hw_unit_id, port, &desc->gport);
+}/* ingress_port_priority_group_desc */
 
-    OPENNSL_RV_ERROR_CHECK(rv, " %d %d %d", gport, port, pg);
-}/* ingress_port_priority_group_stats */
-
-static void
-ingress_port_service_pool_stats(int statid, counter_operations_t type,
-                                bufmon_counter_info_t *counter)
+static opennsl_error_t
+port_service_pool_desc(bufmon_counter_info_t *counter,
+                       bufmon_counter_desc_t *desc)
 {
     int port, sp;
-    opennsl_gport_t gport;
-    opennsl_error_t rv = OPENNSL_E_NONE;
-    opennsl_cosq_bst_profile_t profile;
 
     port = smap_get_int(&counter->counter_vendor_specific_info,
                         "port", BUFMON_INVALID_VALUE);
 
-    INPUT_PARAM_VALIDATE(port);
+    DESC_PARAM_VALIDATE(port);
 
     sp = smap_get_int(&counter->counter_vendor_specific_info,
                       "service-pool", BUFMON_INVALID_VALUE);
 
-    INPUT_PARAM_VALIDATE(sp);
-
-    rv = opennsl_port_gport_get(counter->hw_unit_id, port, &gport);;
-
-    OPENNSL_RV_ERROR_CHECK(rv, " %d %d", port, gport);
+    DESC_PARAM_VALIDATE(sp);
 
-    if (type == GET_COUNTER_VALUE) {
-        rv = BCM_API_BST_STAT_GET(counter->hw_unit_id, gport, sp - 1,
-                                  statid, 0, &counter->counter_value);
-    } else if (type == SET_COUNTER_THRESHOLD
-               && counter->trigger_threshold) {
-        profile.byte = counter->trigger_threshold;
-        rv = BCM_API_BST_PROFILE_SET(counter->hw_unit_id, gport, sp - 1,
-                                     statid, &profile);
-    }
+    desc->cosq = sp - 1;
 
-    OPENNSL_RV_ERROR_CHECK(rv, " %d %d %d", gport, port, sp);
-}/* ingress_port_service_pool_stats */
+    return opennsl_port_gport_get(counter->hw_unit_id, port, &desc->gport);
+}/* port_service_pool_desc */
 
-static void
-ingress_service_pool_stats(int statid, counter_operations_t type,
-                           bufmon_counter_info_t *counter)
+static opennsl_error_t
+service_pool_desc(bufmon_counter_info_t *counter, bufmon_counter_desc_t *desc)
 {
     int sp;
-    opennsl_error_t rv = OPENNSL_E_NONE;
-    opennsl_cosq_bst_profile_t profile;
 
     sp = smap_get_int(&counter->counter_vendor_specific_info,
                       "service-pool", BUFMON_INVALID_VALUE);
 
-    INPUT_PARAM_VALIDATE(sp);
+    DESC_PARAM_VALIDATE(sp);
 
-    if (type == GET_COUNTER_VALUE) {
-        rv = BCM_API_BST_STAT_GET(counter->hw_unit_id, 0,
-                                  sp - 1, statid, 0,
-                                  &counter->counter_value);
-    } else if (type == SET_COUNTER_THRESHOLD
-               && counter->trigger_threshold) {
-        profile.byte = counter->trigger_threshold;
-        rv = BCM_API_BST_PROFILE_SET(counter->hw_unit_id, 0, sp - 1,
-                                     statid, &profile);
-    }
+    desc->gport = 0;
+    desc->cosq = sp - 1;
 
-    OPENNSL_RV_ERROR_CHECK(rv, " %d", sp);
-}/* ingress_service_pool_stats */
+    return OPENNSL_E_NONE;
+}/* service_pool_desc */
 
-static void
-egress_service_pool_stats(int statid, counter_operations_t type,
-                          bufmon_counter_info_t *counter)
+static opennsl_error_t
+egress_port_queue_desc(bufmon_counter_info_t *counter,
+                       bufmon_counter_desc_t *desc)
 {
-    int sp;
-    opennsl_error_t rv = OPENNSL_E_NONE;
-    opennsl_cosq_bst_profile_t profile;
+    int queue, port;
 
-    sp = smap_get_int(&counter->counter_vendor_specific_info,
-                      "service-pool", BUFMON_INVALID_VALUE);
+    queue = smap_get_int(&counter->counter_vendor_specific_info,
+                         "queue", BUFMON_INVALID_VALUE);
 
-    INPUT_PARAM_VALIDATE(sp);
+    DESC_PARAM_VALIDATE(queue);
 
-    if (type == GET_COUNTER_VALUE) {
-        rv = BCM_API_BST_STAT_GET(counter->hw_unit_id, 0, sp - 1,
-                                  statid, 0, &counter->counter_value);
-    } else if (type == SET_COUNTER_THRESHOLD
-               && counter->trigger_threshold) {
-        profile.byte = counter->trigger_threshold;
-        rv = BCM_API_BST_PROFILE_SET(counter->hw_unit_id, 0, sp - 1,
-                                     statid, &profile);
-    }
+    port = queue / 8 +  1;
+    desc->cosq = queue % 8 - 1;
 
-    OPENNSL_RV_ERROR_CHECK(rv, " %d ", sp);
-}/* egress_service_pool_stats */
+    return opennsl_port_gport_get(counter->hw_unit_id, port, &desc->gport);
+}/* egress_port_queue_desc */
 
-static void
-egress_unicast_stats(int statid, counter_operations_t type,
-                     bufmon_counter_info_t *counter)
+static opennsl_error_t
+egress_cpu_desc(bufmon_counter_info_t *counter, bufmon_counter_desc_t *desc)
 {
-    int queue, port;
-    opennsl_gport_t gport;
-    opennsl_error_t rv = OPENNSL_E_NONE;
-    opennsl_cosq_bst_profile_t profile;
+    int queue;
 
     queue = smap_get_int(&counter->counter_vendor_specific_info,
                          "queue", BUFMON_INVALID_VALUE);
-    INPUT_PARAM_VALIDATE(queue);
-
-    port = queue / 8 +  1;
-    queue = queue % 8;
 
-    rv = opennsl_port_gport_get(counter->hw_unit_id, port, &gport);
+    DESC_PARAM_VALIDATE(queue);
 
-    if (rv != OPENNSL_E_NONE)
-      return;
-
-    if (type == GET_COUNTER_VALUE) {
-        rv = BCM_API_BST_STAT_GET(counter->hw_unit_id, gport, queue - 1,
-                                  statid, 0, &counter->counter_value);
-    } else if (type == SET_COUNTER_THRESHOLD
-               && counter->trigger_threshold) {
-        profile.byte = counter->trigger_threshold;
-        rv = BCM_API_BST_PROFILE_SET(counter->hw_unit_id, gport, queue - 1,
-                                     statid, &profile);
-    }
+    desc->cosq = queue - 1;
 
-    OPENNSL_RV_ERROR_CHECK(rv, " %d %d", port, queue);
-}/* egress_unicast_stats */
+    return opennsl_port_gport_get(counter->hw_unit_id, 0, &desc->gport);
+}/* egress_cpu_desc */
 
-static void
-egress_multicast_stats(int statid, counter_operations_t type,
-                       bufmon_counter_info_t *counter)
+static opennsl_error_t
+egress_queue_desc(bufmon_counter_info_t *counter, bufmon_counter_desc_t *desc)
 {
-    int queue, port;
-    opennsl_gport_t gport;
-    opennsl_error_t rv = OPENNSL_E_NONE;
-    opennsl_cosq_bst_profile_t profile;
+    int queue;
 
     queue = smap_get_int(&counter->counter_vendor_specific_info,
                          "queue", BUFMON_INVALID_VALUE);
 
-    INPUT_PARAM_VALIDATE(queue);
+    DESC_PARAM_VALIDATE(queue);
 
-    port = queue / 8 +  1;
-    queue = queue % 8;
+    desc->gport = 0;
+    desc->cosq = queue - 1;
 
-    rv = opennsl_port_gport_get(counter->hw_unit_id, port, &gport);
+    return OPENNSL_E_NONE;
+}/* egress_queue_desc */
 
-    if (rv != OPENNSL_E_NONE)
-      return;
+static int
+get_realm_index(const char *str)
+{
+    unsigned int i = 0;
+    const realm_helper_t *realm_list = get_all_realm_list();
 
-    if (type == GET_COUNTER_VALUE) {
-        rv = BCM_API_BST_STAT_GET(counter->hw_unit_id, gport, queue - 1,
-                                  statid, 0, &counter->counter_value);
-    } else if (type == SET_COUNTER_THRESHOLD
-               && counter->trigger_threshold) {
-        profile.byte = counter->trigger_threshold;
-        rv = BCM_API_BST_PROFILE_SET(counter->hw_unit_id, gport, queue - 1,
-                                     statid, &profile);
+    for (i = 0; i < MAX_STATS; i++) {
+        if (NULL != strstr(str, realm_list[i].realm)) {
+            return i;
+        }
     }
 
-    OPENNSL_RV_ERROR_CHECK(rv, " %d", queue);
-}/* egress_multicast_stats */
+    return BUFMON_INVALID_VALUE;
+}/* get_realm_index */
 
-static void
-egress_port_service_pool_stats (int statid, counter_operations_t type,
-                                bufmon_counter_info_t *counter)
+static uint32_t
+counter_desc_hash(const char *name, int hw_unit)
+{
+    return hash_string(name, hw_unit);
+}/* counter_desc_hash */
+
+static bufmon_counter_desc_t *
+counter_desc_find(const char *name, int hw_unit)
 {
-    int sp, port;
+    bufmon_counter_desc_t *desc;
+
+    HMAP_FOR_EACH_WITH_HASH (desc, node, counter_desc_hash(name, hw_unit),
+                             &counter_desc_map) {
+        if (desc->hw_unit == hw_unit && !strcmp(desc->name, name)) {
+            return desc;
+        }
+    }
+
+    return NULL;
+}/* counter_desc_find */
+
+/*
+ * Parse the name and the vendor specific info of a counter into its
+ * descriptor, creating the descriptor on first use. Counters whose realm
+ * or parameters cannot be resolved get an invalid descriptor, so that they
+ * are skipped without parsing them again on every poll.
+ */
+static bufmon_counter_desc_t *
+counter_desc_parse(bufmon_counter_info_t *counter)
+{
+    bufmon_counter_desc_t *desc;
+    const realm_helper_t *realm_list = get_all_realm_list();
     opennsl_error_t rv = OPENNSL_E_NONE;
-    opennsl_gport_t gport;
+    int index;
+
+    desc = counter_desc_find(counter->name, counter->hw_unit_id);
+    if (!desc) {
+        desc = xzalloc(sizeof *desc);
+        desc->name = xstrdup(counter->name);
+        desc->hw_unit = counter->hw_unit_id;
+        hmap_insert(&counter_desc_map, &desc->node,
+                    counter_desc_hash(desc->name, desc->hw_unit));
+    }
+
+    desc->valid = false;
+
+    index = get_realm_index(counter->name);
+    if (index == BUFMON_INVALID_VALUE) {
+        VLOG_DBG("%s: no realm for counter %s", __FUNCTION__, counter->name);
+        return desc;
+    }
+
+    desc->statid = realm_list[index].statid;
+    rv = realm_list[index].bufmon_counter_desc(counter, desc);
+    if (rv != OPENNSL_E_NONE) {
+        VLOG_DBG("%s: invalid counter %s (%d)", __FUNCTION__,
+                 counter->name, rv);
+        return desc;
+    }
+
+    desc->valid = true;
+    return desc;
+}/* counter_desc_parse */
+
+static bufmon_counter_desc_t *
+counter_desc_get(bufmon_counter_info_t *counter)
+{
+    bufmon_counter_desc_t *desc;
+
+    desc = counter_desc_find(counter->name, counter->hw_unit_id);
+
+    return desc ? desc : counter_desc_parse(counter);
+}/* counter_desc_get */
+
+void
+handle_bufmon_counter_mgmt(bufmon_counter_info_t *counter,
+                           counter_operations_t type)
+{
+    bufmon_counter_desc_t *desc;
     opennsl_cosq_bst_profile_t profile;
+    opennsl_error_t rv = OPENNSL_E_NONE;
 
-    port = smap_get_int(&counter->counter_vendor_specific_info,
-                        "port", BUFMON_INVALID_VALUE);
+    if (!counter->name || !VALID_HW_UNIT(counter->hw_unit_id)) {
+        return ;
+    }
 
-    INPUT_PARAM_VALIDATE(port);
+    /* The config of a counter may change its parameters, parse it again */
+    ovs_mutex_lock(&bst_sampler_mutex);
+    if (SET_COUNTER_THRESHOLD == type) {
+        desc = counter_desc_parse(counter);
+    } else {
+        desc = counter_desc_get(counter);
+    }
+    ovs_mutex_unlock(&bst_sampler_mutex);
 
-    sp = smap_get_int(&counter->counter_vendor_specific_info,
-                         "service-pool", BUFMON_INVALID_VALUE);
+    if (!desc->valid) {
+        return;
+    }
 
-    INPUT_PARAM_VALIDATE(sp);
+    if (GET_COUNTER_VALUE == type) {
+        rv = BCM_API_BST_STAT_GET(desc->hw_unit, desc->gport, desc->cosq,
+                                  desc->statid, 0, &counter->counter_value);
+        OPENNSL_RV_ERROR_CHECK(rv, " %s", counter->name);
 
-    rv = opennsl_port_gport_get(counter->hw_unit_id, port, &gport);
+        counter->counter_value = (CELL_TO_BYTES * counter->counter_value);
+        VLOG_DBG("%s counter value %" PRId64 " ",
+                 (counter)->name, (counter)->counter_value);
+    } else if (SET_COUNTER_THRESHOLD == type) {
+        /* Set default threshold if counter->trigger_threshold is -1*/
+        if (BUFMON_INVALID_VALUE == counter->trigger_threshold) {
+            counter->trigger_threshold =
+             get_stat_default_threshold (desc->hw_unit, desc->statid);
+        }
 
-    OPENNSL_RV_ERROR_CHECK(rv, " %d %d", port, gport);
+        ovs_mutex_lock(&bst_sampler_mutex);
+        desc->threshold = MAX(counter->trigger_threshold, 0);
+        ovs_mutex_unlock(&bst_sampler_mutex);
 
-    if (type == GET_COUNTER_VALUE) {
-        rv = BCM_API_BST_STAT_GET(counter->hw_unit_id, gport, sp - 1,
-                                  statid, 0, &counter->counter_value);
-    } else if (type == SET_COUNTER_THRESHOLD
-               && counter->trigger_threshold) {
-        profile.byte = counter->trigger_threshold;
-        rv = BCM_API_BST_PROFILE_SET(counter->hw_unit_id, gport, sp - 1,
-                                     statid, &profile);
+        if (counter->trigger_threshold) {
+            profile.byte = counter->trigger_threshold;
+            rv = BCM_API_BST_PROFILE_SET(desc->hw_unit, desc->gport,
+                                         desc->cosq, desc->statid, &profile);
+            OPENNSL_RV_ERROR_CHECK(rv, " %s", counter->name);
+        }
     }
 
-    OPENNSL_RV_ERROR_CHECK(rv, " %d", sp);
-}/* egress_port_service_pool_stats */
+    return;
+}/* handle_bufmon_counter_mgmt */
 
-static void
-egress_cpu_stats (int statid, counter_operations_t type,
-                  bufmon_counter_info_t *counter)
+/*
+ * Read the values of a list of counters. Only the realms of the counters
+ * in the list are synced from the ASIC, then the values are read using
+ * the descriptors of the counters.
+ */
+void
+handle_bufmon_counters_stats_get(bufmon_counter_info_t *list,
+                                 int num_counters)
 {
-    int queue;
+    bool synced[MAX_SWITCH_UNITS][opennslBstStatIdMaxCount];
+    bufmon_counter_desc_t **descs;
+    bufmon_counter_desc_t *desc;
+    bufmon_counter_info_t *counter;
     opennsl_error_t rv = OPENNSL_E_NONE;
+    int i = 0;
+
+    memset(synced, 0, sizeof synced);
+    descs = xmalloc(num_counters * sizeof *descs);
+
+    for (i = 0; i < num_counters; i++) {
+        counter = &list[i];
+        descs[i] = NULL;
+
+        if (!counter->name || !VALID_HW_UNIT(counter->hw_unit_id)) {
+            continue;
+        }
+
+        ovs_mutex_lock(&bst_sampler_mutex);
+        desc = counter_desc_get(counter);
+        ovs_mutex_unlock(&bst_sampler_mutex);
+        if (!desc->valid) {
+            continue;
+        }
+
+        /* stats sync from ASIC */
+        if (!synced[desc->hw_unit][desc->statid]) {
+            BCM_API_COSQ_BST_STAT_SYNC(desc->hw_unit, desc->statid);
+            synced[desc->hw_unit][desc->statid] = true;
+        }
+        descs[i] = desc;
+    }
+
+    for (i = 0; i < num_counters; i++) {
+        desc = descs[i];
+        if (!desc) {
+            continue;
+        }
+
+        counter = &list[i];
+        rv = BCM_API_BST_STAT_GET(desc->hw_unit, desc->gport, desc->cosq,
+                                  desc->statid, 0, &counter->counter_value);
+        if (rv != OPENNSL_E_NONE) {
+            VLOG_DBG("Opennsl error (%s:%d %d) %s", __FILE__, __LINE__, rv,
+                     counter->name);
+            continue;
+        }
+
+        counter->counter_value = (CELL_TO_BYTES * counter->counter_value);
+    }
+
+    free(descs);
+}/* handle_bufmon_counters_stats_get */
+
+/*
+ * High frequency BST sampler
+ *
+ * The polls of switchd only give point in time reads of the counters, too
+ * coarse to see the microbursts that drop traffic. The optional sampler
+ * thread samples the egress unicast queue, service pool and priority group
+ * shared counters configured by bufmon at an interval of down to a msec.
+ * Per counter it keeps the peak, a histogram of the occupancy and the time
+ * spent above the trigger threshold. The statistics are read on demand and
+ * nothing is pushed to switchd.
+ *
+ * The counters are read without clearing them, so the polls of switchd
+ * are not disturbed. The samples are the instantaneous occupancy only with
+ * the BST tracking mode set to current. In peak mode they would be a
+ * watermark that never goes down, so the sampler cannot be enabled in
+ * peak mode and is disabled when bufmon switches to it.
+ *
+ * A sweep only copies the parameters of the sampled counters under
+ * bst_sampler_mutex, reads the ASIC without it and takes it again to
+ * record the samples, so the polls of switchd never wait for the SDK
+ * calls of a sweep. The thread sleeps at least BST_SAMPLER_MIN_SLEEP_USEC
+ * between sweeps, even when a sweep overruns the interval.
+ */
+static struct bst_sampler {
+    /* sampling on and interval */
+    bool enabled;
+    int interval_ms;
+
+    /* sweeps, sweeps longer than the interval and longest sweep */
+    uint64_t sweeps;
+    uint64_t overruns;
+    long long int max_sweep_usec;
+
+    /* time the statistics were cleared */
+    long long int started;
+} bst_sampler = {
+    .interval_ms = BST_SAMPLER_DFLT_INTERVAL_MS,
+};
+
+/* wakes up the sampler thread when sampling is enabled */
+static sem_t bst_sampler_sem;
+
+/* counter read by a sweep, copied out of its descriptor */
+typedef struct bst_sampler_target {
+    /* descriptor the sample is recorded into */
+    bufmon_counter_desc_t *desc;
+
+    /* BST stat parameters of the counter */
+    int hw_unit;
+    opennsl_bst_stat_id_t statid;
     opennsl_gport_t gport;
-    opennsl_cosq_bst_profile_t profile;
+    int cosq;
 
-    queue = smap_get_int(&counter->counter_vendor_specific_info,
-                         "queue", BUFMON_INVALID_VALUE);
+    /* value in cells and time of the read, false if the read failed */
+    uint64 cells;
+    long long int when;
+    bool read;
+} bst_sampler_target_t;
 
-    INPUT_PARAM_VALIDATE(queue);
+/* counters of the current sweep, only used by the sampler thread */
+static bst_sampler_target_t *bst_sampler_targets;
+static size_t bst_sampler_n_allocated;
 
-    rv = opennsl_port_gport_get(counter->hw_unit_id, 0, &gport);
+static bool
+bst_sampler_statid_sampled(opennsl_bst_stat_id_t statid)
+{
+    switch (statid) {
+        case opennslBstStatIdUcast:
+        case opennslBstStatIdEgrPool:
+        case opennslBstStatIdEgrMCastPool:
+        case opennslBstStatIdIngPool:
+        case opennslBstStatIdPriGroupShared:
+            return true;
+        default:
+            return false;
+    }
+}/* bst_sampler_statid_sampled */
 
-    if (type == GET_COUNTER_VALUE) {
-        rv = BCM_API_BST_STAT_GET(counter->hw_unit_id, gport, queue - 1,
-                                  statid, 0, &counter->counter_value);
-    } else if (type == SET_COUNTER_THRESHOLD
-               && counter->trigger_threshold) {
-        profile.byte = counter->trigger_threshold;
-        rv = BCM_API_BST_PROFILE_SET(counter->hw_unit_id, gport, queue - 1,
-                                     statid, &profile);
+/*
+ * Histogram bucket of a value in cells. Bucket 0 holds zero and bucket n
+ * the values from 2^(n-1) to 2^n - 1, the last bucket holds all the values
+ * past the others.
+ */
+static int
+bst_sampler_bucket(uint64_t cells)
+{
+    int bucket = 0;
+
+    while (cells && bucket < BST_SAMPLER_HIST_BUCKETS - 1) {
+        cells >>= 1;
+        bucket++;
     }
 
-    OPENNSL_RV_ERROR_CHECK(rv, " %d", queue);
-}/* egress_cpu_stats */
+    return bucket;
+}/* bst_sampler_bucket */
 
-static void
-egress_rqe_queue_stats (int statid, counter_operations_t type,
-                        bufmon_counter_info_t *counter)
+/*
+ * Upper bound in bytes of the histogram bucket holding the given
+ * percentile of the samples, capped to the peak.
+ */
+static int64_t
+bst_sampler_percentile(const bst_sampler_stats_t *stats, unsigned int percent)
 {
-    int queue;
-    opennsl_error_t rv = OPENNSL_E_NONE;
-    opennsl_cosq_bst_profile_t profile;
+    uint64_t target, seen = 0;
+    int bucket;
 
-    queue = smap_get_int(&counter->counter_vendor_specific_info,
-                         "queue", BUFMON_INVALID_VALUE);
+    if (!stats->samples) {
+        return 0;
+    }
 
-    INPUT_PARAM_VALIDATE(queue);
+    target = (stats->samples * percent + 99) / 100;
+    for (bucket = 0; bucket < BST_SAMPLER_HIST_BUCKETS - 1; bucket++) {
+        seen += stats->hist[bucket];
+        if (seen >= target) {
+            break;
+        }
+    }
 
-    if (type == GET_COUNTER_VALUE) {
-        rv = BCM_API_BST_STAT_GET(counter->hw_unit_id, 0, queue - 1,
-                                  statid, 0, &counter->counter_value);
-    } else if (type == SET_COUNTER_THRESHOLD
-               && counter->trigger_threshold) {
-        profile.byte = counter->trigger_threshold;
-        rv = BCM_API_BST_PROFILE_SET(counter->hw_unit_id, 0, queue - 1,
-                                     statid, &profile);
+    if (!bucket) {
+        return 0;
     }
 
-    OPENNSL_RV_ERROR_CHECK(rv, " %d", queue);
-}/* egress_rqe_queue_stats */
+    return MIN((((int64_t) 1 << bucket) - 1) * CELL_TO_BYTES, stats->peak);
+}/* bst_sampler_percentile */
 
 static void
-egress_unicast_queue_group_stats (int statid, counter_operations_t type,
-                              bufmon_counter_info_t *counter)
+bst_sampler_record(bufmon_counter_desc_t *desc, uint64 cells,
+                   long long int now)
 {
-    int queue;
+    bst_sampler_stats_t *stats;
+    long long int elapsed;
+    int64_t bytes;
+
+    if (!desc->samples) {
+        desc->samples = xzalloc(sizeof *desc->samples);
+    }
+
+    stats = desc->samples;
+    elapsed = stats->last_usec ? now - stats->last_usec : 0;
+    bytes = CELL_TO_BYTES * (int64_t) cells;
+
+    stats->samples++;
+    stats->current = bytes;
+    stats->peak = MAX(stats->peak, bytes);
+    stats->sum += cells;
+    stats->hist[bst_sampler_bucket(cells)]++;
+    stats->last_usec = now;
+
+    /* The time since the last sample counts as spent in the state seen */
+    if (desc->threshold && bytes >= desc->threshold) {
+        if (!stats->in_burst) {
+            stats->in_burst = true;
+            stats->bursts++;
+            stats->burst_usec = 0;
+        }
+        stats->above_usec += elapsed;
+        stats->burst_usec += elapsed;
+        stats->max_burst_usec = MAX(stats->max_burst_usec,
+                                    stats->burst_usec);
+    } else {
+        stats->in_burst = false;
+    }
+}/* bst_sampler_record */
+
+/*
+ * Sample all the sampled counters once. Each realm in use is synced once
+ * per sweep. The ASIC is read without holding bst_sampler_mutex, the
+ * samples of counters parsed again meanwhile are dropped. Descriptors are
+ * never freed, so they can be referenced across the unlocked reads.
+ */
+static void
+bst_sampler_sweep(void)
+{
+    bool synced[MAX_SWITCH_UNITS][opennslBstStatIdMaxCount];
+    bufmon_counter_desc_t *desc;
+    bst_sampler_target_t *target;
     opennsl_error_t rv = OPENNSL_E_NONE;
-    opennsl_cosq_bst_profile_t profile;
+    size_t n_targets = 0;
+    size_t i;
 
-    queue = smap_get_int(&counter->counter_vendor_specific_info,
-                         "queue", BUFMON_INVALID_VALUE);
+    ovs_mutex_lock(&bst_sampler_mutex);
+    HMAP_FOR_EACH (desc, node, &counter_desc_map) {
+        if (!desc->valid || !bst_sampler_statid_sampled(desc->statid)) {
+            continue;
+        }
 
-    INPUT_PARAM_VALIDATE(queue);
+        if (n_targets >= bst_sampler_n_allocated) {
+            bst_sampler_targets = x2nrealloc(bst_sampler_targets,
+                                             &bst_sampler_n_allocated,
+                                             sizeof *bst_sampler_targets);
+        }
 
-    if (type == GET_COUNTER_VALUE) {
-        rv = BCM_API_BST_STAT_GET(counter->hw_unit_id, 0, queue - 1,
-                                  statid, 0, &counter->counter_value);
-    } else if (type == SET_COUNTER_THRESHOLD
-               && counter->trigger_threshold) {
-        profile.byte = counter->trigger_threshold;
-        rv = BCM_API_BST_PROFILE_SET(counter->hw_unit_id, 0, queue - 1,
-                                     statid, &profile);
+        target = &bst_sampler_targets[n_targets++];
+        target->desc = desc;
+        target->hw_unit = desc->hw_unit;
+        target->statid = desc->statid;
+        target->gport = desc->gport;
+        target->cosq = desc->cosq;
     }
+    ovs_mutex_unlock(&bst_sampler_mutex);
 
-    OPENNSL_RV_ERROR_CHECK(rv, " %d", queue);
-}/* egress_rqe_queue_stats */
+    memset(synced, 0, sizeof synced);
+    for (i = 0; i < n_targets; i++) {
+        target = &bst_sampler_targets[i];
 
-static int
-get_realm_stat_id(char *str)
+        if (!synced[target->hw_unit][target->statid]) {
+            BCM_API_COSQ_BST_STAT_SYNC(target->hw_unit, target->statid);
+            synced[target->hw_unit][target->statid] = true;
+        }
+
+        target->cells = 0;
+        rv = BCM_API_BST_STAT_GET(target->hw_unit, target->gport,
+                                  target->cosq, target->statid, 0,
+                                  &target->cells);
+        target->read = (rv == OPENNSL_E_NONE);
+        target->when = time_usec();
+    }
+
+    /* Samples read as the sampler got disabled may come from peak mode */
+    ovs_mutex_lock(&bst_sampler_mutex);
+    for (i = 0; i < n_targets && bst_sampler.enabled; i++) {
+        target = &bst_sampler_targets[i];
+        desc = target->desc;
+        if (!target->read || !desc->valid || desc->statid != target->statid
+            || desc->gport != target->gport || desc->cosq != target->cosq) {
+            continue;
+        }
+
+        bst_sampler_record(desc, target->cells, target->when);
+    }
+    ovs_mutex_unlock(&bst_sampler_mutex);
+}/* bst_sampler_sweep */
+
+static void *
+bst_sampler_main(void *arg OVS_UNUSED)
 {
-    unsigned int i = 0;
-    const realm_helper_t *realm_list = get_all_realm_list();
+    long long int start, elapsed, remaining;
+    struct timespec ts;
+    bool enabled;
+    int interval_ms;
+
+    for (;;) {
+        ovs_mutex_lock(&bst_sampler_mutex);
+        enabled = bst_sampler.enabled;
+        interval_ms = bst_sampler.interval_ms;
+        ovs_mutex_unlock(&bst_sampler_mutex);
+
+        start = time_usec();
+        if (enabled) {
+            bst_sampler_sweep();
+            elapsed = time_usec() - start;
+
+            ovs_mutex_lock(&bst_sampler_mutex);
+            bst_sampler.sweeps++;
+            bst_sampler.max_sweep_usec = MAX(bst_sampler.max_sweep_usec,
+                                             elapsed);
+            if (elapsed > interval_ms * 1000LL) {
+                bst_sampler.overruns++;
+            }
+            ovs_mutex_unlock(&bst_sampler_mutex);
+        }
 
-    for (i = 0; i < MAX_STATS; i++) {
-        if (NULL != strstr(str, realm_list[i].realm)) {
-            return realm_list[i].statid;
+        if (!enabled) {
+            /* Sleep until sampling is enabled again */
+            while (sem_wait(&bst_sampler_sem) && errno == EINTR) {
+                continue;
+            }
+            continue;
         }
+
+        /* Leave the CPU to the rest of switchd even if the sweep overran */
+        remaining = interval_ms * 1000LL - (time_usec() - start);
+        remaining = MAX(remaining, BST_SAMPLER_MIN_SLEEP_USEC);
+        ts.tv_sec = remaining / 1000000;
+        ts.tv_nsec = (remaining % 1000000) * 1000;
+        nanosleep(&ts, NULL);
     }
 
-    return BUFMON_INVALID_VALUE;
-}/* get_realm_stat_id */
+    return NULL;
+}/* bst_sampler_main */
 
-static inline int
-get_realm_index(int statid, char *str)
+/*
+ * Returns true if the BST counters of all the units hold the current
+ * occupancy, false if some unit tracks the peak.
+ */
+bool
+bst_tracking_mode_is_current(void)
 {
-    unsigned int i = 0;
-    const realm_helper_t *realm_list = get_all_realm_list();
+    int hw_unit, mode;
 
-    for (i = 0; i < MAX_STATS; i++) {
-        if (NULL != strstr(str, realm_list[i].realm)
-            && statid == realm_list[i].statid) {
-            return i;
+    for (hw_unit = 0; hw_unit <= MAX_SWITCH_UNIT_ID; hw_unit++) {
+        bst_switch_control_get(hw_unit, opennslSwitchBstTrackingMode, &mode);
+        if (mode != BST_TRACKING_MODE_CURRENT) {
+            return false;
         }
     }
 
-    return BUFMON_INVALID_VALUE;
-}/* get_realm_index */
+    return true;
+}/* bst_tracking_mode_is_current */
+
+/*
+ * Enable the sampler with the given interval in msec, or disable it.
+ * Returns 0 on success, or -1 if the interval is out of range or the BST
+ * tracking mode is not current.
+ */
+int
+bst_sampler_set(bool enable, int interval_ms)
+{
+    static bool thread_started = false;
+
+    if (enable && (interval_ms < BST_SAMPLER_MIN_INTERVAL_MS ||
+                   interval_ms > BST_SAMPLER_MAX_INTERVAL_MS)) {
+        VLOG_ERR("Invalid BST sampler interval %d", interval_ms);
+        return -1;
+    }
+
+    if (enable && !bst_tracking_mode_is_current()) {
+        VLOG_ERR("BST sampler needs the current BST tracking mode");
+        return -1;
+    }
+
+    ovs_mutex_lock(&bst_sampler_mutex);
+    if (enable && !bst_sampler.enabled) {
+        bst_sampler.started = time_msec();
+    }
+    bst_sampler.enabled = enable;
+    if (enable) {
+        bst_sampler.interval_ms = interval_ms;
+    }
+    ovs_mutex_unlock(&bst_sampler_mutex);
+
+    if (!enable) {
+        VLOG_INFO("BST sampler disabled");
+        return 0;
+    }
+
+    if (!thread_started) {
+        sem_init(&bst_sampler_sem, 0, 0);
+        ovs_thread_create("bst-sampler", bst_sampler_main, NULL);
+        thread_started = true;
+    } else {
+        sem_post(&bst_sampler_sem);
+    }
+
+    VLOG_INFO("BST sampler enabled, interval %d msec", interval_ms);
+    return 0;
+}/* bst_sampler_set */
 
 void
-realm_sync_all(void)
+bst_sampler_clear(void)
 {
-    unsigned int i = 0;
-    unsigned int hw_unit = 0;
-    const realm_helper_t *realm_list = get_all_realm_list();
+    bufmon_counter_desc_t *desc;
 
-    for (hw_unit = 0; hw_unit <= MAX_SWITCH_UNIT_ID; hw_unit++) {
-        for (i = 0; i < MAX_STATS; i++) {
-            BCM_API_COSQ_BST_STAT_SYNC(hw_unit, realm_list[i].statid);
+    ovs_mutex_lock(&bst_sampler_mutex);
+    HMAP_FOR_EACH (desc, node, &counter_desc_map) {
+        if (desc->samples) {
+            memset(desc->samples, 0, sizeof *desc->samples);
         }
     }
-}/* realm_sync_all */
+    bst_sampler.sweeps = 0;
+    bst_sampler.overruns = 0;
+    bst_sampler.max_sweep_usec = 0;
+    bst_sampler.started = time_msec();
+    ovs_mutex_unlock(&bst_sampler_mutex);
+}/* bst_sampler_clear */
+
+static void
+bst_sampler_summary_fill(const bufmon_counter_desc_t *desc,
+                         bst_sampler_summary_t *summary)
+{
+    const bst_sampler_stats_t *stats = desc->samples;
+
+    memset(summary, 0, sizeof *summary);
+    summary->threshold = desc->threshold;
+    if (!stats) {
+        return;
+    }
+
+    summary->samples = stats->samples;
+    summary->current = stats->current;
+    summary->peak = stats->peak;
+    summary->mean = stats->samples
+                    ? CELL_TO_BYTES * (int64_t) (stats->sum / stats->samples)
+                    : 0;
+    summary->p50 = bst_sampler_percentile(stats, 50);
+    summary->p99 = bst_sampler_percentile(stats, 99);
+    summary->above_msec = stats->above_usec / 1000;
+    summary->bursts = stats->bursts;
+    summary->max_burst_msec = stats->max_burst_usec / 1000;
+}/* bst_sampler_summary_fill */
+
+/*
+ * Get the sampler statistics of a counter. Returns false if the counter
+ * is not sampled.
+ */
+bool
+bst_sampler_summary_get(const char *name, int hw_unit,
+                        bst_sampler_summary_t *summary)
+{
+    bufmon_counter_desc_t *desc;
+    bool found = false;
+
+    ovs_mutex_lock(&bst_sampler_mutex);
+    desc = counter_desc_find(name, hw_unit);
+    if (desc && desc->samples) {
+        bst_sampler_summary_fill(desc, summary);
+        found = true;
+    }
+    ovs_mutex_unlock(&bst_sampler_mutex);
+
+    return found;
+}/* bst_sampler_summary_get */
 
 void
-handle_bufmon_counter_mgmt(bufmon_counter_info_t *counter,
-                           counter_operations_t type)
+bst_sampler_dump(struct ds *ds)
 {
-    int statid = 0;
-    const realm_helper_t *realm_list = get_all_realm_list();
-    int index = BUFMON_INVALID_VALUE;
+    bst_sampler_summary_t summary;
+    bufmon_counter_desc_t *desc;
+
+    ovs_mutex_lock(&bst_sampler_mutex);
+
+    ds_put_format(ds, "BST sampler %s, interval %d msec, BST tracking mode "
+                  "%s\n", bst_sampler.enabled ? "enabled" : "disabled",
+                  bst_sampler.interval_ms,
+                  bst_tracking_mode_is_current() ? "current"
+                  : "peak (samples would be watermarks)");
+    ds_put_format(ds, "  %"PRIu64" sweeps in %lld msec, %"PRIu64" overruns, "
+                  "longest sweep %lld usec\n\n", bst_sampler.sweeps,
+                  bst_sampler.started ? time_msec() - bst_sampler.started : 0,
+                  bst_sampler.overruns, bst_sampler.max_sweep_usec);
+
+    HMAP_FOR_EACH (desc, node, &counter_desc_map) {
+        if (!desc->samples) {
+            continue;
+        }
 
-    if (!counter->name) {
-        return ;
+        bst_sampler_summary_fill(desc, &summary);
+        ds_put_format(ds, "%s (unit %d)\n", desc->name, desc->hw_unit);
+        ds_put_format(ds, "  samples %"PRIu64", current %"PRId64", "
+                      "peak %"PRId64", mean %"PRId64", p50 %"PRId64", "
+                      "p99 %"PRId64" bytes\n", summary.samples,
+                      summary.current, summary.peak, summary.mean,
+                      summary.p50, summary.p99);
+        if (summary.threshold) {
+            ds_put_format(ds, "  above %"PRId64" bytes for %"PRIu64" msec "
+                          "in %"PRIu64" bursts, longest %"PRIu64" msec\n",
+                          summary.threshold, summary.above_msec,
+                          summary.bursts, summary.max_burst_msec);
+        }
     }
 
-    statid = get_realm_stat_id(counter->name);
+    ovs_mutex_unlock(&bst_sampler_mutex);
+}/* bst_sampler_dump */
 
-    INPUT_PARAM_VALIDATE(statid);
+/*
+ * Triggered BST capture
+ *
+ * By the time switchd reads the counters after a BST trigger the burst is
+ * gone. On a trigger the state of all the counters configured on the unit
+ * is synced and captured right away, in the driver thread, into a
+ * preallocated ring of snapshots holding the time and the bid, port and
+ * cosq of the trigger. The captures are rate limited by a token bucket so
+ * a storm of triggers cannot load the CPU.
+ *
+ * The ring, the token bucket and the capture counters are guarded by
+ * bst_capture_mutex. Like a sampler sweep, a capture holds
+ * bst_sampler_mutex only to copy the parameters of the counters and reads
+ * the ASIC without any lock. The two locks are never held together.
+ */
+typedef struct bst_capture_entry {
+    /* counter and its value in bytes */
+    const bufmon_counter_desc_t *desc;
+    int64_t value;
+} bst_capture_entry_t;
+
+typedef struct bst_capture {
+    /* sequence number, 0 if the slot was never used */
+    uint64_t seq;
+
+    /* wall clock time of the trigger and duration of the capture */
+    long long int when;
+    long long int usec;
+
+    /* trigger */
+    int hw_unit;
+    int bid;
+    int port;
+    int cosq;
+
+    /* counters, and whether some did not fit */
+    int n_entries;
+    bool truncated;
+    bst_capture_entry_t entries[BST_CAPTURE_MAX_COUNTERS];
+} bst_capture_t;
+
+#define  BST_CAPTURE_TOKENS  (1000)
+
+static struct ovs_mutex bst_capture_mutex = OVS_MUTEX_INITIALIZER;
+static bst_capture_t bst_capture_ring[BST_CAPTURE_RING_SIZE];
+static uint64_t bst_capture_seq;
+static struct token_bucket bst_capture_tb =
+    TOKEN_BUCKET_INIT(BST_CAPTURE_DFLT_RATE,
+                      BST_CAPTURE_DFLT_BURST * BST_CAPTURE_TOKENS);
+static unsigned int bst_capture_rate = BST_CAPTURE_DFLT_RATE;
+static unsigned int bst_capture_burst = BST_CAPTURE_DFLT_BURST;
+static uint64_t bst_capture_triggers;
+static uint64_t bst_capture_suppressed;
+
+/* Capture the counters of a unit on a trigger, runs in the driver thread */
+static void
+bst_capture_take(int asic, int bid, int port, int cosq)
+{
+    bool synced[opennslBstStatIdMaxCount];
+    bufmon_counter_desc_t *desc;
+    bst_sampler_target_t *targets, *target;
+    bst_capture_entry_t *entry;
+    bst_capture_t *capture;
+    opennsl_error_t rv = OPENNSL_E_NONE;
+    long long int start, when;
+    bool truncated = false;
+    int n_targets = 0;
+    int i;
 
-    index = get_realm_index(statid, counter->name);
+    if (!VALID_HW_UNIT(asic)) {
+        return;
+    }
 
-    INPUT_PARAM_VALIDATE(index);
-    /* Set default threshold if counter->trigger_threshold is -1*/
-    if (SET_COUNTER_THRESHOLD == type &&
-        BUFMON_INVALID_VALUE == counter->trigger_threshold) {
-        counter->trigger_threshold =
-         get_stat_default_threshold (counter->hw_unit_id, statid);
+    ovs_mutex_lock(&bst_capture_mutex);
+    bst_capture_triggers++;
+    if (!token_bucket_withdraw(&bst_capture_tb, BST_CAPTURE_TOKENS)) {
+        bst_capture_suppressed++;
+        ovs_mutex_unlock(&bst_capture_mutex);
+        return;
     }
-    /* Call the bufmon handler specific to realm */
-    if ((index) < MAX_STATS) {
-        realm_list[index].bufmon_counter_handler(statid, type, counter);
-        if (GET_COUNTER_VALUE == type) {
-          counter->counter_value = (CELL_TO_BYTES * counter->counter_value);
+    ovs_mutex_unlock(&bst_capture_mutex);
+
+    start = time_usec();
+    when = time_wall_msec();
+    targets = xmalloc(BST_CAPTURE_MAX_COUNTERS * sizeof *targets);
+
+    ovs_mutex_lock(&bst_sampler_mutex);
+    HMAP_FOR_EACH (desc, node, &counter_desc_map) {
+        if (!desc->valid || desc->hw_unit != asic) {
+            continue;
         }
-        VLOG_DBG("%s counter value %" PRId64 " ",
-                 (counter)->name, (counter)->counter_value);
+
+        if (n_targets >= BST_CAPTURE_MAX_COUNTERS) {
+            truncated = true;
+            break;
+        }
+
+        target = &targets[n_targets++];
+        target->desc = desc;
+        target->statid = desc->statid;
+        target->gport = desc->gport;
+        target->cosq = desc->cosq;
     }
+    ovs_mutex_unlock(&bst_sampler_mutex);
 
-    return;
-}/* handle_bufmon_counter_mgmt */
+    memset(synced, 0, sizeof synced);
+    for (i = 0; i < n_targets; i++) {
+        target = &targets[i];
+
+        if (!synced[target->statid]) {
+            BCM_API_COSQ_BST_STAT_SYNC(asic, target->statid);
+            synced[target->statid] = true;
+        }
+
+        target->cells = 0;
+        rv = BCM_API_BST_STAT_GET(asic, target->gport, target->cosq,
+                                  target->statid, 0, &target->cells);
+        target->read = (rv == OPENNSL_E_NONE);
+    }
+
+    ovs_mutex_lock(&bst_capture_mutex);
+
+    capture = &bst_capture_ring[bst_capture_seq % BST_CAPTURE_RING_SIZE];
+    capture->seq = ++bst_capture_seq;
+    capture->when = when;
+    capture->hw_unit = asic;
+    capture->bid = bid;
+    capture->port = port;
+    capture->cosq = cosq;
+    capture->n_entries = 0;
+    capture->truncated = truncated;
+
+    for (i = 0; i < n_targets; i++) {
+        target = &targets[i];
+        if (!target->read) {
+            continue;
+        }
+
+        entry = &capture->entries[capture->n_entries++];
+        entry->desc = target->desc;
+        entry->value = CELL_TO_BYTES * (int64_t) target->cells;
+    }
+
+    capture->usec = time_usec() - start;
+
+    ovs_mutex_unlock(&bst_capture_mutex);
+
+    free(targets);
+}/* bst_capture_take */
+
+/*
+ * Set the rate limit of the captures, in captures per second and burst.
+ * Returns 0 on success, or -1 if the values are out of range.
+ */
+int
+bst_capture_set_rate(unsigned int rate, unsigned int burst)
+{
+    if (!rate || rate > BST_CAPTURE_MAX_RATE || !burst
+        || burst > BST_CAPTURE_RING_SIZE) {
+        return -1;
+    }
+
+    ovs_mutex_lock(&bst_capture_mutex);
+    bst_capture_rate = rate;
+    bst_capture_burst = burst;
+    token_bucket_set(&bst_capture_tb, rate, burst * BST_CAPTURE_TOKENS);
+    ovs_mutex_unlock(&bst_capture_mutex);
+
+    return 0;
+}/* bst_capture_set_rate */
+
+void
+bst_capture_clear(void)
+{
+    ovs_mutex_lock(&bst_capture_mutex);
+    memset(bst_capture_ring, 0, sizeof bst_capture_ring);
+    bst_capture_seq = 0;
+    bst_capture_triggers = 0;
+    bst_capture_suppressed = 0;
+    ovs_mutex_unlock(&bst_capture_mutex);
+}/* bst_capture_clear */
+
+/*
+ * Get the value of a counter in the latest capture holding it. Returns
+ * false if no capture holds the counter.
+ */
+bool
+bst_capture_counter_get(const char *name, int hw_unit, int64_t *value,
+                        long long int *when)
+{
+    const bst_capture_t *capture;
+    bufmon_counter_desc_t *desc;
+    bool found = false;
+    uint64_t seq;
+    int i;
+
+    ovs_mutex_lock(&bst_sampler_mutex);
+    desc = counter_desc_find(name, hw_unit);
+    ovs_mutex_unlock(&bst_sampler_mutex);
+
+    ovs_mutex_lock(&bst_capture_mutex);
+
+    for (seq = bst_capture_seq; desc && !found && seq > 0 &&
+         seq + BST_CAPTURE_RING_SIZE > bst_capture_seq; seq--) {
+        capture = &bst_capture_ring[(seq - 1) % BST_CAPTURE_RING_SIZE];
+        if (capture->seq != seq || capture->hw_unit != hw_unit) {
+            continue;
+        }
+        for (i = 0; i < capture->n_entries; i++) {
+            if (capture->entries[i].desc == desc) {
+                *value = capture->entries[i].value;
+                *when = capture->when;
+                found = true;
+                break;
+            }
+        }
+    }
+
+    ovs_mutex_unlock(&bst_capture_mutex);
+
+    return found;
+}/* bst_capture_counter_get */
+
+/* Dump the captures, the newest first, or only the one numbered 'seq' */
+void
+bst_capture_dump(struct ds *ds, uint64_t seq)
+{
+    const bst_capture_entry_t *entry;
+    const bst_capture_t *capture;
+    uint64_t n;
+    int i;
+
+    ovs_mutex_lock(&bst_capture_mutex);
+
+    ds_put_format(ds, "BST trigger captures: %"PRIu64" triggers, "
+                  "%"PRIu64" captured, %"PRIu64" rate limited "
+                  "(%u/s, burst %u)\n", bst_capture_triggers,
+                  bst_capture_seq, bst_capture_suppressed,
+                  bst_capture_rate, bst_capture_burst);
+
+    for (n = bst_capture_seq; n > 0 &&
+         n + BST_CAPTURE_RING_SIZE > bst_capture_seq; n--) {
+        capture = &bst_capture_ring[(n - 1) % BST_CAPTURE_RING_SIZE];
+        if (capture->seq != n || (seq && seq != n)) {
+            continue;
+        }
+
+        ds_put_format(ds, "\nCapture %"PRIu64": unit %d bid %d port %d "
+                      "cosq %d, %lld msec ago, %d counters%s in %lld usec\n",
+                      capture->seq, capture->hw_unit, capture->bid,
+                      capture->port, capture->cosq,
+                      time_wall_msec() - capture->when, capture->n_entries,
+                      capture->truncated ? " (truncated)" : "",
+                      capture->usec);
+
+        /* Only the full state of a single capture is listed */
+        if (!seq) {
+            continue;
+        }
+        for (i = 0; i < capture->n_entries; i++) {
+            entry = &capture->entries[i];
+            ds_put_format(ds, "  %-60s %"PRId64"\n", entry->desc->name,
+                          entry->value);
+        }
+    }
+
+    ovs_mutex_unlock(&bst_capture_mutex);
+}/* bst_capture_dump */
 
 static int
 get_ports (int unit)
@@ -696,6 +1398,17 @@ bst_switch_control_set(opennsl_switch_control_t  type, int arg)
             OPENNSL_RV_ERROR_CHECK(rv, " %d %d %d", hw_unit, type, arg);
         }
     }
+
+    /* The samples of the sampler are only meaningful in current mode */
+    if (type == opennslSwitchBstTrackingMode
+        && arg != BST_TRACKING_MODE_CURRENT) {
+        ovs_mutex_lock(&bst_sampler_mutex);
+        if (bst_sampler.enabled) {
+            bst_sampler.enabled = false;
+            VLOG_WARN("BST tracking mode set to peak, BST sampler disabled");
+        }
+        ovs_mutex_unlock(&bst_sampler_mutex);
+    }
 }/* bst_switch_control_set */
 
 /*
@@ -748,8 +1461,9 @@ bst_switch_event_callback (int asic, opennsl_switch_event_t event,
                 valid_trigger = true;
             }
         }
-        /* notify the vswitchd */
+        /* capture the buffer state and notify the vswitchd */
         if (valid_trigger) {
+            bst_capture_take(asic, bid, port, cosq);
             bufmon_trigger_callback();
         }
     }
@@ -757,59 +1471,59 @@ bst_switch_event_callback (int asic, opennsl_switch_event_t event,
 
 const realm_helper_t realm_list[] = {
     /* Per device BST tracing resource */
-    { "device/data", opennslBstStatIdDevice, device_data_stats},
+    { "device/data", opennslBstStatIdDevice, device_data_desc},
 
     /* Per Egress Pool BST tracing resource */
     { "egress-service-pool/um-share-buffer-count",
-      opennslBstStatIdEgrPool, egress_service_pool_stats},
+      opennslBstStatIdEgrPool, service_pool_desc},
 
     /* Per Egress Pool BST tracing resource(Multicast) */
     { "egress-service-pool/mc-share-buffer-count",
-      opennslBstStatIdEgrMCastPool, egress_service_pool_stats},
+      opennslBstStatIdEgrMCastPool, service_pool_desc},
 
     /* Per Ingress Pool BST tracing resource */
     { "ingress-service-pool/um-share-buffer-count",
-      opennslBstStatIdIngPool, ingress_service_pool_stats},
+      opennslBstStatIdIngPool, service_pool_desc},
 
     /* Per Port Pool BST tracing resource */
     { "ingress-port-service-pool/um-share-buffer-count",
-      opennslBstStatIdPortPool, ingress_port_service_pool_stats},
+      opennslBstStatIdPortPool, port_service_pool_desc},
 
     /* Per Shared Priority Group Pool BST tracing resource */
     { "ingress-port-priority-group/um-share-buffer-count",
-      opennslBstStatIdPriGroupShared, ingress_port_priority_group_stats},
+      opennslBstStatIdPriGroupShared, ingress_port_priority_group_desc},
 
     /* Per Priority Group Headroom BST tracing resource */
     { "ingress-port-priority-group/um-headroom-buffer-count",
-      opennslBstStatIdPriGroupHeadroom, ingress_port_priority_group_stats},
+      opennslBstStatIdPriGroupHeadroom, ingress_port_priority_group_desc},
 
     /* BST Tracing resource for unicast */
     { "egress-uc-queue/uc-buffer-count",
-      opennslBstStatIdUcast, egress_unicast_stats},
+      opennslBstStatIdUcast, egress_port_queue_desc},
 
     /* BST Tracing resource for multicast */
     { "egress-mc-queue/mc-buffer-count",
-      opennslBstStatIdMcast, egress_multicast_stats},
+      opennslBstStatIdMcast, egress_port_queue_desc},
 
     /* BST Tracing resource for Egress Port Service Pool Resource */
     { "egress-port-service-pool/uc-share-buffer-count",
-      opennslBstStatIdEgrUCastPortShared, egress_port_service_pool_stats},
+      opennslBstStatIdEgrUCastPortShared, port_service_pool_desc},
 
     /* BST Tracing resource for Egress Port Service Pool Resource */
     { "egress-port-service-pool/um-share-buffer-count",
-      opennslBstStatIdEgrPortShared, egress_port_service_pool_stats},
+      opennslBstStatIdEgrPortShared, port_service_pool_desc},
 
     /* BST Tracing resource for CPU queue stats */
     { "egress-cpu-queue/cpu-buffer-count",
-      opennslBstStatIdMcast, egress_cpu_stats},
+      opennslBstStatIdMcast, egress_cpu_desc},
 
     /* BST Tracing resource for RQE Queue stats */
     { "egress-rqe-queue/rqe-buffer-count",
-      opennslBstStatIdRQEQueue, egress_rqe_queue_stats},
+      opennslBstStatIdRQEQueue, egress_queue_desc},
 
     /* BST Tracing resource for Unicast Queue Group stats*/
     { "egress-uc-queue-group/uc-buffer-count",
-      opennslBstStatIdUcastGroup, egress_unicast_queue_group_stats}
+      opennslBstStatIdUcastGroup, egress_queue_desc}
 };
 
 static inline unsigned int
@@ -17,6 +17,8 @@
 #include <string.h>
 #include <errno.h>
 #include <assert.h>
+#include <inttypes.h>
+#include <limits.h>
 #include <util.h>
 #include <netinet/ether.h>
 #include <arpa/inet.h>
@@ -30,6 +32,7 @@
 #include <opennsl/l2.h>
 #include <ofproto/ofproto.h>
 #include <ovs/list.h>
+#include <ovs/dynamic-string.h>
 #include <opennsl/port.h>
 #include <opennsl/field.h>
 #include <opennsl/rx.h>
@@ -49,16 +52,37 @@
 #include "platform-defines.h"
 #include "plugin-extensions.h"
 #include "seq.h"
+#include "hash.h"
+#include "token-bucket.h"
+#include "ovs-thread.h"
 #include "ops-classifier.h"
+#include "timeval.h"
+#include "poll-loop.h"
+#include "random.h"
 #include "mac-learning-plugin.h" /* PORT_NAME_SIZE */
 #include "ops-fp.h"
 
 /* Private header for ACL data structure */
 #include "ops-classifier-private.h"
 
-#define ACL_LOGGING_MIN_MS_BETWEEN_PKTS 1000 /**< ignore ACL logging packets
-                                               received within this many ms of
-                                               the previous packet */
+#define ACL_LOG_RING_SIZE       64  /**< ACL logging records kept for the
+                                         PI code */
+#define ACL_LOG_DFLT_RATE       5   /**< ACL logging records per second */
+#define ACL_LOG_DFLT_BURST      5   /**< ACL logging records in a burst */
+#define ACL_LOG_TOKENS          1000 /**< Token bucket cost of a record; the
+                                          bucket adds 'rate' tokens per ms */
+#define OPS_CLS_PBMP_BATCH_MAX_MS 5000 /**< Longest port bitmap batching
+                                            window */
+#define OPS_CLS_STATS_DFLT_INTERVAL_MS 5000 /**< Period of the ACL hit
+                                                 count sweep */
+#define OPS_CLS_STATS_CACHE_MAX_ID 65536 /**< Stat ids above are not cached */
+#define OPS_CLS_VERIFY_MAX_PACKETS 1000000 /**< Packets per install
+                                                verification */
+#define OPS_CLS_BENCH_MAX_ACES  16384 /**< Largest synthetic ACL */
+#define OPS_CLS_PRIO_GAP        1024 /**< FP priority distance between the
+                                          entries of a freshly installed
+                                          classifier, leaves room to insert
+                                          entries on update */
 
 /** Define a module for VLOG_ functionality */
 VLOG_DEFINE_THIS_MODULE(ops_classifier);
@@ -201,6 +225,9 @@ ops_cls_populate_entries(struct ops_classifier  *cls,
                sizeof(struct ops_cls_list_entry_match_fields));
         memcpy(&entry->entry_actions, &cls_entry->entry_actions,
                 sizeof(struct ops_cls_list_entry_actions));
+        entry->rule_index = i;
+        entry->src_port_mask = 0xFFFF;
+        entry->dst_port_mask = 0xFFFF;
 
         list_push_back(list, &entry->node);
     }
@@ -220,6 +247,572 @@ ops_cls_cleanup_entries(struct ovs_list *list)
     }
 }
 
+/*
+ * Get the source port range from classifier
+ */
+static void
+ops_cls_get_src_port_range(struct ops_cls_list_entry_match_fields *field,
+                           uint16_t                               *port_min,
+                           uint16_t                               *port_max)
+{
+    if(field->L4_src_port_op == OPS_CLS_L4_PORT_OP_RANGE) {
+        *port_min = field->L4_src_port_min;
+        *port_max = field->L4_src_port_max;
+    } else if (field->L4_src_port_op == OPS_CLS_L4_PORT_OP_LT) {
+        *port_min = 0;
+        *port_max = field->L4_src_port_max;
+    } else {
+        *port_min = field->L4_src_port_min;
+        *port_max = 65535;
+    }
+}
+
+/*
+ * Get the destination port range from classifier
+ */
+static void
+ops_cls_get_dst_port_range(struct ops_cls_list_entry_match_fields *field,
+                           uint16_t                               *port_min,
+                           uint16_t                               *port_max)
+{
+    if(field->L4_dst_port_op == OPS_CLS_L4_PORT_OP_RANGE) {
+        *port_min = field->L4_dst_port_min;
+        *port_max = field->L4_dst_port_max;
+    } else if (field->L4_dst_port_op == OPS_CLS_L4_PORT_OP_LT) {
+        *port_min = 0;
+        *port_max = field->L4_dst_port_max;
+    } else {
+        *port_min = field->L4_dst_port_min;
+        *port_max = 65535;
+    }
+}
+
+/*
+ * ACL compiler.
+ *
+ * The ACEs copied from the PI list are compiled into the FP entries that are
+ * actually installed.  ACEs without action and ACEs that can never match are
+ * dropped, neighbouring ACEs with the same action are merged and L4 port
+ * ranges are encoded either with a range checker or as masked port values,
+ * whichever is cheaper.  Every compiled entry keeps the index of the PI ACE
+ * it came from so that failures and hit counts are reported against the PI
+ * rule.  ACEs that count hits are never merged into another ACE so that
+ * their counters stay exact.
+ */
+
+/* Largest number of FP entries a port range is expanded into before a
+ * range checker is used instead */
+#define OPS_CLS_PORT_EXPAND_MAX     4
+
+/* Match of a compiled entry, addresses in host byte order */
+struct ops_cls_cmatch {
+    uint32_t sip, sip_mask;
+    uint32_t dip, dip_mask;
+    bool proto_valid;
+    uint8_t proto;
+    bool sport_valid, dport_valid;
+    uint16_t sport_min, sport_max;
+    uint16_t dport_min, dport_max;
+    bool opaque;                /* match the compiler can not reason about */
+};
+
+struct ops_cls_centry {
+    struct ops_cls_entry *entry;
+    struct ops_cls_cmatch m;
+    bool dropped;
+};
+
+static void
+ops_cls_cmatch_load(struct ops_cls_entry *e, struct ops_cls_cmatch *m)
+{
+    struct ops_cls_list_entry_match_fields *f = &e->entry_fields;
+
+    memset(m, 0, sizeof *m);
+    if (e->match_flags & OPS_CLS_SRC_IPADDR_VALID) {
+        m->sip_mask = ntohl(e->src_mask);
+        m->sip = ntohl(e->src_ip) & m->sip_mask;
+    }
+    if (e->match_flags & OPS_CLS_DEST_IPADDR_VALID) {
+        m->dip_mask = ntohl(e->dst_mask);
+        m->dip = ntohl(e->dst_ip) & m->dip_mask;
+    }
+    if (e->match_flags & OPS_CLS_PROTOCOL_VALID) {
+        m->proto_valid = true;
+        m->proto = f->protocol;
+    }
+
+    m->sport_max = m->dport_max = 65535;
+    if (e->match_flags & OPS_CLS_L4_SRC_PORT_VALID) {
+        m->sport_valid = true;
+        switch (f->L4_src_port_op) {
+        case OPS_CLS_L4_PORT_OP_EQ:
+            m->sport_min = m->sport_max = f->L4_src_port_min;
+            break;
+        case OPS_CLS_L4_PORT_OP_RANGE:
+        case OPS_CLS_L4_PORT_OP_LT:
+        case OPS_CLS_L4_PORT_OP_GT:
+            ops_cls_get_src_port_range(f, &m->sport_min, &m->sport_max);
+            break;
+        default:
+            m->opaque = true;
+            break;
+        }
+    }
+    if (e->match_flags & OPS_CLS_L4_DEST_PORT_VALID) {
+        m->dport_valid = true;
+        switch (f->L4_dst_port_op) {
+        case OPS_CLS_L4_PORT_OP_EQ:
+            m->dport_min = m->dport_max = f->L4_dst_port_min;
+            break;
+        case OPS_CLS_L4_PORT_OP_RANGE:
+        case OPS_CLS_L4_PORT_OP_LT:
+        case OPS_CLS_L4_PORT_OP_GT:
+            ops_cls_get_dst_port_range(f, &m->dport_min, &m->dport_max);
+            break;
+        default:
+            m->opaque = true;
+            break;
+        }
+    }
+}
+
+/*
+ * Write a merged match back to the entry
+ */
+static void
+ops_cls_cmatch_store(const struct ops_cls_cmatch *m, struct ops_cls_entry *e)
+{
+    struct ops_cls_list_entry_match_fields *f = &e->entry_fields;
+
+    if (m->sip_mask) {
+        e->match_flags |= OPS_CLS_SRC_IPADDR_VALID;
+    } else {
+        e->match_flags &= ~OPS_CLS_SRC_IPADDR_VALID;
+    }
+    e->src_ip = htonl(m->sip);
+    e->src_mask = htonl(m->sip_mask);
+
+    if (m->dip_mask) {
+        e->match_flags |= OPS_CLS_DEST_IPADDR_VALID;
+    } else {
+        e->match_flags &= ~OPS_CLS_DEST_IPADDR_VALID;
+    }
+    e->dst_ip = htonl(m->dip);
+    e->dst_mask = htonl(m->dip_mask);
+
+    if (m->sport_valid) {
+        f->L4_src_port_op = m->sport_min == m->sport_max
+                            ? OPS_CLS_L4_PORT_OP_EQ : OPS_CLS_L4_PORT_OP_RANGE;
+        f->L4_src_port_min = m->sport_min;
+        f->L4_src_port_max = m->sport_max;
+    }
+    if (m->dport_valid) {
+        f->L4_dst_port_op = m->dport_min == m->dport_max
+                            ? OPS_CLS_L4_PORT_OP_EQ : OPS_CLS_L4_PORT_OP_RANGE;
+        f->L4_dst_port_min = m->dport_min;
+        f->L4_dst_port_max = m->dport_max;
+    }
+}
+
+/*
+ * Return true if every packet matched by 'a' is also matched by 'b'
+ */
+static bool
+ops_cls_cmatch_covers(const struct ops_cls_cmatch *b,
+                      const struct ops_cls_cmatch *a)
+{
+    if (a->opaque || b->opaque) {
+        return false;
+    }
+    if ((a->sip_mask & b->sip_mask) != b->sip_mask ||
+        (a->sip & b->sip_mask) != b->sip ||
+        (a->dip_mask & b->dip_mask) != b->dip_mask ||
+        (a->dip & b->dip_mask) != b->dip) {
+        return false;
+    }
+    if (b->proto_valid && (!a->proto_valid || a->proto != b->proto)) {
+        return false;
+    }
+    if (b->sport_valid && (!a->sport_valid || a->sport_min < b->sport_min ||
+                           a->sport_max > b->sport_max)) {
+        return false;
+    }
+    if (b->dport_valid && (!a->dport_valid || a->dport_min < b->dport_min ||
+                           a->dport_max > b->dport_max)) {
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Return true if some packet may be matched by both 'a' and 'b'
+ */
+static bool
+ops_cls_cmatch_overlaps(const struct ops_cls_cmatch *a,
+                        const struct ops_cls_cmatch *b)
+{
+    if (a->opaque || b->opaque) {
+        return true;
+    }
+    if ((a->sip ^ b->sip) & a->sip_mask & b->sip_mask ||
+        (a->dip ^ b->dip) & a->dip_mask & b->dip_mask) {
+        return false;
+    }
+    if (a->proto_valid && b->proto_valid && a->proto != b->proto) {
+        return false;
+    }
+    if (a->sport_valid && b->sport_valid &&
+        (a->sport_max < b->sport_min || b->sport_max < a->sport_min)) {
+        return false;
+    }
+    if (a->dport_valid && b->dport_valid &&
+        (a->dport_max < b->dport_min || b->dport_max < a->dport_min)) {
+        return false;
+    }
+    return true;
+}
+
+static bool
+ops_cls_mask_is_prefix(uint32_t mask)
+{
+    return mask && !(~mask & (~mask + 1));
+}
+
+/*
+ * Merge 'b' into 'a' if the union of both matches is a single match:
+ * sibling prefixes, or touching port ranges, with all other fields equal.
+ */
+static bool
+ops_cls_cmatch_merge(struct ops_cls_cmatch *a, const struct ops_cls_cmatch *b)
+{
+    bool src_eq, dst_eq, sport_eq, dport_eq;
+
+    if (a->opaque || b->opaque ||
+        a->proto_valid != b->proto_valid || a->proto != b->proto) {
+        return false;
+    }
+
+    src_eq = a->sip == b->sip && a->sip_mask == b->sip_mask;
+    dst_eq = a->dip == b->dip && a->dip_mask == b->dip_mask;
+    sport_eq = a->sport_valid == b->sport_valid &&
+               a->sport_min == b->sport_min && a->sport_max == b->sport_max;
+    dport_eq = a->dport_valid == b->dport_valid &&
+               a->dport_min == b->dport_min && a->dport_max == b->dport_max;
+
+    if (dst_eq && sport_eq && dport_eq) {
+        uint32_t bit = a->sip_mask & -a->sip_mask;
+
+        if (a->sip_mask == b->sip_mask &&
+            ops_cls_mask_is_prefix(a->sip_mask) && (a->sip ^ b->sip) == bit) {
+            a->sip_mask &= ~bit;
+            a->sip &= a->sip_mask;
+            return true;
+        }
+    }
+    if (src_eq && sport_eq && dport_eq) {
+        uint32_t bit = a->dip_mask & -a->dip_mask;
+
+        if (a->dip_mask == b->dip_mask &&
+            ops_cls_mask_is_prefix(a->dip_mask) && (a->dip ^ b->dip) == bit) {
+            a->dip_mask &= ~bit;
+            a->dip &= a->dip_mask;
+            return true;
+        }
+    }
+    if (src_eq && dst_eq && dport_eq && a->sport_valid && b->sport_valid &&
+        (uint32_t) a->sport_max + 1 >= b->sport_min &&
+        (uint32_t) b->sport_max + 1 >= a->sport_min) {
+        a->sport_min = MIN(a->sport_min, b->sport_min);
+        a->sport_max = MAX(a->sport_max, b->sport_max);
+        return true;
+    }
+    if (src_eq && dst_eq && sport_eq && a->dport_valid && b->dport_valid &&
+        (uint32_t) a->dport_max + 1 >= b->dport_min &&
+        (uint32_t) b->dport_max + 1 >= a->dport_min) {
+        a->dport_min = MIN(a->dport_min, b->dport_min);
+        a->dport_max = MAX(a->dport_max, b->dport_max);
+        return true;
+    }
+    return false;
+}
+
+/*
+ * Split port range [min, max] into value/mask prefixes.  Returns the number
+ * of prefixes; at most 'n' of them are stored in 'values'/'masks'.
+ */
+static int
+ops_cls_port_range_prefixes(uint16_t min, uint16_t max, uint16_t *values,
+                            uint16_t *masks, int n)
+{
+    uint32_t lo = min;
+    int count = 0;
+
+    while (lo <= max) {
+        uint32_t size = lo ? lo & -lo : 0x10000;
+
+        while (lo + size - 1 > max) {
+            size >>= 1;
+        }
+        if (count < n) {
+            values[count] = lo;
+            masks[count] = ~(size - 1);
+        }
+        count++;
+        lo += size;
+    }
+    return count;
+}
+
+/*
+ * Return true if L4 port operation 'op' is programmed with a range checker
+ */
+static bool
+ops_cls_port_op_is_range(int op)
+{
+    return op == OPS_CLS_L4_PORT_OP_RANGE || op == OPS_CLS_L4_PORT_OP_LT ||
+           op == OPS_CLS_L4_PORT_OP_GT;
+}
+
+/*
+ * Return true if the FP supports L4 port operation 'op'
+ */
+static bool
+ops_cls_port_op_supported(int op)
+{
+    return op == OPS_CLS_L4_PORT_OP_EQ || ops_cls_port_op_is_range(op);
+}
+
+/*
+ * Encode the L4 port ranges of 'e' as masked port values where that is
+ * cheaper than a range checker: always if a range is a single prefix,
+ * otherwise if the entry expands to at most OPS_CLS_PORT_EXPAND_MAX FP
+ * entries.  The extra entries are inserted right after 'e' and the number
+ * of FP entries 'e' was encoded into is stored in '*n_entries'.  An entry
+ * with a port operation the FP does not support is left as it is, the
+ * install then rejects it, and OPS_CLS_HW_UNSUPPORTED_ERR is returned.
+ */
+static int
+ops_cls_expand_port_ranges(struct ops_cls_entry *e,
+                           struct ops_cls_compile_stats *stats,
+                           int *n_entries)
+{
+    struct ops_cls_list_entry_match_fields *f = &e->entry_fields;
+    uint16_t sval[OPS_CLS_PORT_EXPAND_MAX], smask[OPS_CLS_PORT_EXPAND_MAX];
+    uint16_t dval[OPS_CLS_PORT_EXPAND_MAX], dmask[OPS_CLS_PORT_EXPAND_MAX];
+    struct ovs_list *pos = e->node.next;
+    bool exp_s = false, exp_d = false;
+    int ns = 1, nd = 1;
+    uint16_t min, max;
+
+    *n_entries = 1;
+    if ((e->match_flags & OPS_CLS_L4_SRC_PORT_VALID &&
+         !ops_cls_port_op_supported(f->L4_src_port_op)) ||
+        (e->match_flags & OPS_CLS_L4_DEST_PORT_VALID &&
+         !ops_cls_port_op_supported(f->L4_dst_port_op))) {
+        return OPS_CLS_HW_UNSUPPORTED_ERR;
+    }
+
+    if (e->match_flags & OPS_CLS_L4_SRC_PORT_VALID &&
+        ops_cls_port_op_is_range(f->L4_src_port_op)) {
+        ops_cls_get_src_port_range(f, &min, &max);
+        ns = ops_cls_port_range_prefixes(min, max, sval, smask,
+                                         OPS_CLS_PORT_EXPAND_MAX);
+        exp_s = ns <= OPS_CLS_PORT_EXPAND_MAX;
+    }
+    if (e->match_flags & OPS_CLS_L4_DEST_PORT_VALID &&
+        ops_cls_port_op_is_range(f->L4_dst_port_op)) {
+        ops_cls_get_dst_port_range(f, &min, &max);
+        nd = ops_cls_port_range_prefixes(min, max, dval, dmask,
+                                         OPS_CLS_PORT_EXPAND_MAX);
+        exp_d = nd <= OPS_CLS_PORT_EXPAND_MAX;
+    }
+    if (exp_s && exp_d && ns * nd > OPS_CLS_PORT_EXPAND_MAX) {
+        /* keep the range checker for the range with more prefixes */
+        if (ns >= nd) {
+            exp_s = false;
+        } else {
+            exp_d = false;
+        }
+    }
+    ns = exp_s ? ns : 1;
+    nd = exp_d ? nd : 1;
+
+    if (exp_s) {
+        f->L4_src_port_op = OPS_CLS_L4_PORT_OP_EQ;
+        stats->expanded++;
+    }
+    if (exp_d) {
+        f->L4_dst_port_op = OPS_CLS_L4_PORT_OP_EQ;
+        stats->expanded++;
+    }
+
+    for (int k = 0; k < ns * nd; k++) {
+        struct ops_cls_entry *x = e;
+
+        if (k) {
+            x = xmemdup(e, sizeof *e);
+            list_insert(pos, &x->node);
+        }
+        if (exp_s) {
+            x->entry_fields.L4_src_port_min = sval[k / nd];
+            x->entry_fields.L4_src_port_max = sval[k / nd];
+            x->src_port_mask = smask[k / nd];
+        }
+        if (exp_d) {
+            x->entry_fields.L4_dst_port_min = dval[k % nd];
+            x->entry_fields.L4_dst_port_max = dval[k % nd];
+            x->dst_port_mask = dmask[k % nd];
+        }
+    }
+    *n_entries = ns * nd;
+    return OPS_CLS_OK;
+}
+
+static bool
+ops_cls_centry_mergeable(const struct ops_cls_centry *a,
+                         const struct ops_cls_centry *b)
+{
+    return a->entry->act_flags == b->entry->act_flags &&
+           !(a->entry->act_flags & OPS_CLS_ACTION_COUNT);
+}
+
+/*
+ * Compile the ACEs in 'list' in place into the FP entries to install and
+ * store the predicted hardware cost in 'stats'.
+ */
+static void
+ops_cls_compile_entries(struct ops_classifier        *cls,
+                        struct ovs_list              *list,
+                        struct ops_cls_compile_stats *stats)
+{
+    struct ops_cls_entry *entry;
+    struct ops_cls_centry *ce;
+    struct ovs_list *node;
+    size_t n = 0, i, j, k;
+
+    memset(stats, 0, sizeof *stats);
+    stats->aces = list_size(list);
+    if (!stats->aces) {
+        return;
+    }
+
+    ce = xcalloc(stats->aces, sizeof *ce);
+    LIST_FOR_EACH (entry, node, list) {
+        ce[n].entry = entry;
+        ops_cls_cmatch_load(entry, &ce[n].m);
+        /* According to vswitch.xml:
+         * 'If no action is specified the ACE will not be programmed in hw.'
+         */
+        if (!entry->act_flags) {
+            ce[n].dropped = true;
+            stats->no_action++;
+        }
+        n++;
+    }
+
+    /* An ACE covered by an earlier ACE never matches */
+    for (j = 0; j < n; j++) {
+        for (i = 0; i < j && !ce[j].dropped; i++) {
+            if (!ce[i].dropped && ops_cls_cmatch_covers(&ce[i].m, &ce[j].m)) {
+                ce[j].dropped = true;
+                stats->shadowed++;
+            }
+        }
+    }
+
+    /* An ACE covered by a later ACE with the same action is redundant if
+     * no ACE in between with another action can match its packets */
+    for (i = n; i-- > 0; ) {
+        if (ce[i].dropped || ce[i].entry->act_flags & OPS_CLS_ACTION_COUNT) {
+            continue;
+        }
+        for (k = i + 1; k < n; k++) {
+            if (ce[k].dropped) {
+                continue;
+            }
+            if (ops_cls_centry_mergeable(&ce[i], &ce[k])) {
+                if (ops_cls_cmatch_covers(&ce[k].m, &ce[i].m)) {
+                    ce[i].dropped = true;
+                    stats->redundant++;
+                    break;
+                }
+            } else if (ops_cls_cmatch_overlaps(&ce[i].m, &ce[k].m)) {
+                break;
+            }
+        }
+    }
+
+    /* Merge neighbours; a merged entry may in turn merge with the entry
+     * before it, so step back after each merge */
+    for (i = 0; i < n && ce[i].dropped; i++) {
+        continue;
+    }
+    while (i < n) {
+        for (j = i + 1; j < n && ce[j].dropped; j++) {
+            continue;
+        }
+        if (j >= n) {
+            break;
+        }
+        if (ops_cls_centry_mergeable(&ce[i], &ce[j]) &&
+            ops_cls_cmatch_merge(&ce[i].m, &ce[j].m)) {
+            ce[j].dropped = true;
+            stats->merged++;
+            ops_cls_cmatch_store(&ce[i].m, ce[i].entry);
+            for (k = i; k-- > 0 && ce[k].dropped; ) {
+                continue;
+            }
+            if (k < i) {
+                i = k;
+            }
+        } else {
+            i = j;
+        }
+    }
+
+    for (i = 0; i < n; i++) {
+        if (ce[i].dropped) {
+            list_remove(&ce[i].entry->node);
+            free(ce[i].entry);
+        }
+    }
+    free(ce);
+
+    /* Pick the port range encoding; entries expanded from a range are
+     * inserted after the entry they come from and are skipped here */
+    node = list->next;
+    while (node != list) {
+        int entries;
+
+        entry = CONTAINER_OF(node, struct ops_cls_entry, node);
+        if (ops_cls_error(ops_cls_expand_port_ranges(entry, stats,
+                                                     &entries))) {
+            VLOG_DBG("Classifier %s rule %d has an L4 port operation not "
+                     "supported in hw", cls->name, entry->rule_index);
+            stats->unsupported++;
+        }
+        stats->entries += entries;
+        if (entry->match_flags & OPS_CLS_L4_SRC_PORT_VALID &&
+            ops_cls_port_op_is_range(entry->entry_fields.L4_src_port_op)) {
+            stats->range_checkers += entries;
+        }
+        if (entry->match_flags & OPS_CLS_L4_DEST_PORT_VALID &&
+            ops_cls_port_op_is_range(entry->entry_fields.L4_dst_port_op)) {
+            stats->range_checkers += entries;
+        }
+        while (entries--) {
+            node = node->next;
+        }
+    }
+
+    VLOG_DBG("Classifier %s compiled %u ACEs into %u entries and %u range "
+             "checkers (%u without action, %u shadowed, %u redundant, "
+             "%u merged, %u ranges expanded, %u unsupported)", cls->name,
+             stats->aces, stats->entries, stats->range_checkers,
+             stats->no_action, stats->shadowed, stats->redundant,
+             stats->merged, stats->expanded, stats->unsupported);
+}
+
 /*
  * Initialize orig list
  */
@@ -250,6 +843,7 @@ ops_cls_init_hw_info(struct ops_cls_hw_info *hw_cls)
 {
     hw_cls->in_asic = false;
     OPENNSL_PBMP_CLEAR(hw_cls->pbmp);
+    OPENNSL_PBMP_CLEAR(hw_cls->pending_pbmp);
 
     ops_cls_init_orig_list(hw_cls);
     ops_cls_init_update_list(hw_cls);
@@ -283,6 +877,7 @@ ops_cls_add(struct ops_cls_list  *clist)
     if (clist->num_entries > 0) {
         VLOG_DBG("%s has %d rule entries", cls->name, clist->num_entries);
         ops_cls_populate_entries(cls, &cls->cls_entry_list, clist);
+        ops_cls_compile_entries(cls, &cls->cls_entry_list, &cls->compile);
     }
 
     hmap_insert(&classifier_map, &cls->node, uuid_hash(&clist->list_id));
@@ -467,42 +1062,196 @@ ops_cls_get_port_bitmap(struct ofproto *ofproto_,
 }
 
 /*
- * Set rule action
+ * Hit count cache.
+ *
+ * ops_cls_run() reads the packet counter of every classifier stat every
+ * 'cls_stats_interval_ms' into a per unit table indexed by stat id, and
+ * hit count requests are answered from that table instead of reading the
+ * counters of the classifier again for each interface it is applied to.
+ * A stat is read directly if it was created after the last sweep or if the
+ * cache is disabled (interval 0).  Clearing the counters of a classifier
+ * also clears their cached values.
  */
-static int
-ops_cls_set_action(int                          unit,
-                   opennsl_field_entry_t        entry,
-                   struct ops_classifier       *cls,
-                   struct ops_cls_entry        *cls_entry,
-                   int                         *stat_index,
-                   bool                        *isStatEnabled)
-{
-    opennsl_error_t rc = OPENNSL_E_NONE;
-    opennsl_field_stat_t stats_type = opennslFieldStatPackets;
-    int stat_id;
+struct ops_cls_stat_snapshot {
+    uint64_t packets;
+    bool valid;                         /* read since the stat was created */
+};
 
-    VLOG_DBG("Classifier list entry action flag: 0x%x", cls_entry->act_flags);
+struct ops_cls_stats_cache {
+    struct ops_cls_stat_snapshot *stats;    /* indexed by stat id */
+    int n_stats;                            /* size of 'stats' */
+};
 
-    if (cls_entry->act_flags & OPS_CLS_ACTION_LOG &&
-        cls_entry->act_flags & OPS_CLS_ACTION_PERMIT) {
-        VLOG_ERR("Logging with permit action is unsupported");
-        return OPS_CLS_HW_UNSUPPORTED_ERR;
+static struct ops_cls_stats_cache cls_stats_cache[MAX_SWITCH_UNITS];
+static int cls_stats_interval_ms = OPS_CLS_STATS_DFLT_INTERVAL_MS;
+static long long int cls_stats_next_sweep;
+
+static struct {
+    uint64_t sweeps;                    /* sweeps of all stats */
+    uint64_t reads;                     /* counter reads by sweeps */
+    uint64_t failures;                  /* failed counter reads by sweeps */
+    long long int last_usec;            /* duration of the last sweep */
+    uint64_t hits;                      /* requested stats served cached */
+    uint64_t misses;                    /* requested stats read directly */
+} cls_stats_sweep;
+
+/*
+ * Return the cache slot of 'stat_id' on 'unit', growing the table as
+ * needed, or NULL if the id can not be cached
+ */
+static struct ops_cls_stat_snapshot *
+ops_cls_stats_cache_slot(int unit, int stat_id)
+{
+    struct ops_cls_stats_cache *cache = &cls_stats_cache[unit];
+
+    if (stat_id < 0 || stat_id >= OPS_CLS_STATS_CACHE_MAX_ID) {
+        return NULL;
     }
 
-    if (cls_entry->act_flags & OPS_CLS_ACTION_DENY) {
-        rc = opennsl_field_action_add(unit, entry, opennslFieldActionDrop,
-                                      0, 0);
-        if (OPENNSL_FAILURE(rc)) {
-            VLOG_ERR("Failed to set drop action at entry 0x%x: rc=%s", entry,
-                     opennsl_errmsg(rc));
-            return rc;
-        } else {
-            VLOG_DBG("Drop action added at entry 0x%x.", entry);
-        }
+    if (stat_id >= cache->n_stats) {
+        int n = MAX(stat_id + 1, cache->n_stats * 2);
+
+        cache->stats = xrealloc(cache->stats, n * sizeof *cache->stats);
+        memset(&cache->stats[cache->n_stats], 0,
+               (n - cache->n_stats) * sizeof *cache->stats);
+        cache->n_stats = n;
     }
+    return &cache->stats[stat_id];
+}
 
-    if (cls_entry->act_flags & OPS_CLS_ACTION_COUNT) {
-        rc = opennsl_field_stat_create(unit, ip_group[unit], 1, &stats_type, &stat_id);
+static void
+ops_cls_stats_cache_set(int unit, int stat_id, uint64_t packets)
+{
+    struct ops_cls_stat_snapshot *snap = ops_cls_stats_cache_slot(unit,
+                                                                  stat_id);
+
+    if (snap) {
+        snap->packets = packets;
+        snap->valid = true;
+    }
+}
+
+static void
+ops_cls_stats_cache_invalidate(int unit, int stat_id)
+{
+    struct ops_cls_stats_cache *cache = &cls_stats_cache[unit];
+
+    if (stat_id >= 0 && stat_id < cache->n_stats) {
+        cache->stats[stat_id].valid = false;
+    }
+}
+
+/*
+ * Read the packet counter of 'stat_id', from the cache if it holds it
+ */
+static int
+ops_cls_stats_cache_get(int unit, int stat_id, uint64 *packets)
+{
+    struct ops_cls_stats_cache *cache = &cls_stats_cache[unit];
+    int rc;
+
+    if (cls_stats_interval_ms && stat_id >= 0 && stat_id < cache->n_stats
+        && cache->stats[stat_id].valid) {
+        *packets = cache->stats[stat_id].packets;
+        cls_stats_sweep.hits++;
+        return OPENNSL_E_NONE;
+    }
+
+    cls_stats_sweep.misses++;
+    rc = opennsl_field_stat_get(unit, stat_id, opennslFieldStatPackets,
+                                packets);
+    if (OPENNSL_SUCCESS(rc)) {
+        ops_cls_stats_cache_set(unit, stat_id, *packets);
+    }
+    return rc;
+}
+
+static void
+ops_cls_stats_sweep_hw(struct ops_cls_hw_info *hw_info)
+{
+    struct ops_cls_stats_entry *sentry;
+    uint64 packets;
+    int rc;
+
+    if (!hw_info->in_asic) {
+        return;
+    }
+
+    LIST_FOR_EACH (sentry, node, &hw_info->stats_index_list) {
+        cls_stats_sweep.reads++;
+        rc = opennsl_field_stat_get(hw_info->hw_unit, sentry->index,
+                                    opennslFieldStatPackets, &packets);
+        if (OPENNSL_FAILURE(rc)) {
+            cls_stats_sweep.failures++;
+            ops_cls_stats_cache_invalidate(hw_info->hw_unit, sentry->index);
+            continue;
+        }
+        ops_cls_stats_cache_set(hw_info->hw_unit, sentry->index, packets);
+    }
+}
+
+/*
+ * Read the counters of all classifiers into the cache
+ */
+static void
+ops_cls_stats_sweep(void)
+{
+    struct ops_classifier *cls;
+    long long int start = time_usec();
+
+    HMAP_FOR_EACH (cls, node, &classifier_map) {
+        ops_cls_stats_sweep_hw(&cls->port_cls);
+        ops_cls_stats_sweep_hw(&cls->route_cls);
+    }
+    cls_stats_sweep.sweeps++;
+    cls_stats_sweep.last_usec = time_usec() - start;
+}
+
+/*
+ * Set rule action
+ */
+static int
+ops_cls_set_action(int                          unit,
+                   opennsl_field_entry_t        entry,
+                   struct ops_classifier       *cls,
+                   struct ops_cls_entry        *cls_entry,
+                   int                         *stat_index,
+                   bool                        *isStatEnabled)
+{
+    opennsl_error_t rc = OPENNSL_E_NONE;
+    opennsl_field_stat_t stats_type = opennslFieldStatPackets;
+    int stat_id;
+
+    VLOG_DBG("Classifier list entry action flag: 0x%x", cls_entry->act_flags);
+
+    if (cls_entry->act_flags & OPS_CLS_ACTION_LOG &&
+        cls_entry->act_flags & OPS_CLS_ACTION_PERMIT) {
+        VLOG_ERR("Logging with permit action is unsupported");
+        return OPS_CLS_HW_UNSUPPORTED_ERR;
+    }
+
+    if (cls_entry->act_flags & OPS_CLS_ACTION_DENY) {
+        rc = opennsl_field_action_add(unit, entry, opennslFieldActionDrop,
+                                      0, 0);
+        if (OPENNSL_FAILURE(rc)) {
+            VLOG_ERR("Failed to set drop action at entry 0x%x: rc=%s", entry,
+                     opennsl_errmsg(rc));
+            return rc;
+        } else {
+            VLOG_DBG("Drop action added at entry 0x%x.", entry);
+        }
+    }
+
+    if (cls_entry->act_flags & OPS_CLS_ACTION_COUNT && *isStatEnabled) {
+        /* entry expanded from the same ACE, share its counter */
+        rc = opennsl_field_entry_stat_attach(unit, entry, *stat_index);
+        if (OPENNSL_FAILURE(rc)) {
+            VLOG_ERR("Failed to attach stats %d to entry 0x%x in ACL %s rc=%s",
+                     *stat_index, entry, cls->name, opennsl_errmsg(rc));
+            return rc;
+        }
+    } else if (cls_entry->act_flags & OPS_CLS_ACTION_COUNT) {
+        rc = opennsl_field_stat_create(unit, ip_group[unit], 1, &stats_type, &stat_id);
         if (OPENNSL_FAILURE(rc)) {
             VLOG_ERR("Failed to create stats for ACL %s at entry 0x%x rc=%s",
                      cls->name, entry, opennsl_errmsg(rc));
@@ -510,6 +1259,7 @@ ops_cls_set_action(int                          unit,
         } else {
             VLOG_DBG("Stat index %d attached to entry 0x%x.", stat_id, entry);
         }
+        ops_cls_stats_cache_invalidate(unit, stat_id);
 
         rc = opennsl_field_entry_stat_attach(unit, entry, stat_id);
         if (OPENNSL_FAILURE(rc)) {
@@ -739,46 +1489,6 @@ ops_cls_set_pd_list_status(int                             rc,
     }
 }
 
-/*
- * Get the source port range from classifier
- */
-static void
-ops_cls_get_src_port_range(struct ops_cls_list_entry_match_fields *field,
-                           uint16_t                               *port_min,
-                           uint16_t                               *port_max)
-{
-    if(field->L4_src_port_op == OPS_CLS_L4_PORT_OP_RANGE) {
-        *port_min = field->L4_src_port_min;
-        *port_max = field->L4_src_port_max;
-    } else if (field->L4_src_port_op == OPS_CLS_L4_PORT_OP_RANGE) {
-        *port_min = 0;
-        *port_max = field->L4_src_port_max;
-    } else {
-        *port_min = field->L4_src_port_min;
-        *port_max = 65535;
-    }
-}
-
-/*
- * Get the destination port range from classifier
- */
-static void
-ops_cls_get_dst_port_range(struct ops_cls_list_entry_match_fields *field,
-                           uint16_t                               *port_min,
-                           uint16_t                               *port_max)
-{
-    if(field->L4_dst_port_op == OPS_CLS_L4_PORT_OP_RANGE) {
-        *port_min = field->L4_dst_port_min;
-        *port_max = field->L4_dst_port_max;
-    } else if (field->L4_dst_port_op == OPS_CLS_L4_PORT_OP_RANGE) {
-        *port_min = 0;
-        *port_max = field->L4_dst_port_max;
-    } else {
-        *port_min = field->L4_dst_port_min;
-        *port_max = 65535;
-    }
-}
-
 /*
  * Add rule in FP
  */
@@ -788,23 +1498,25 @@ ops_cls_install_rule_in_asic(int                            unit,
                              struct ops_cls_entry          *cls_entry,
                              opennsl_pbmp_t                *pbmp,
                              int                            index,
+                             int                            prio,
                              struct ops_cls_interface_info *intf_info,
-                             bool                           isUpdate)
+                             bool                           isUpdate,
+                             int                           *shared_stat)
 {
     opennsl_error_t rc = OPENNSL_E_NONE;
     opennsl_field_entry_t entry;
     opennsl_field_range_t src_range, dst_range;
     opennsl_pbmp_t pbmp_mask;
-    uint16_t port_mask = 0xFFFF;
     uint8_t protocol_mask = 0XFF;
     uint16_t min_port, max_port;
-    int stat_index = 0;
-    bool statEnabled = FALSE;
+    int stat_index = *shared_stat;
+    bool statShared = *shared_stat >= 0;
+    bool statEnabled = statShared;
     bool src_rangeEnabled = FALSE;
     bool dst_rangeEnabled = FALSE;
     struct ops_cls_rule_entry *rulep;
-    struct ops_cls_stats_entry *sentry;
-    struct ops_cls_range_entry *rentry;
+    struct ops_cls_stats_entry *sentry = NULL;
+    struct ops_cls_range_entry *src_rentry = NULL, *dst_rentry = NULL;
     struct ovs_list *listp;
     struct ops_cls_hw_info *hw_info;
 
@@ -836,7 +1548,14 @@ ops_cls_install_rule_in_asic(int                            unit,
         return rc;
     }
 
-    VLOG_DBG("Classifier %s entry id 0x%x", cls->name, entry);
+    VLOG_DBG("Classifier %s entry id 0x%x prio %d", cls->name, entry, prio);
+
+    rc = opennsl_field_entry_prio_set(unit, entry, prio);
+    if (OPENNSL_FAILURE(rc)) {
+        VLOG_ERR("Failed to set priority %d of entry 0x%x rc=%s", prio, entry,
+                 opennsl_errmsg(rc));
+        goto cleanup;
+    }
 
     rc = opennsl_field_qualify_EtherType(unit, entry, OPS_ETHER_TYPE_IP,
                                          OPS_ETHER_TYPE_MASK);
@@ -924,11 +1643,11 @@ ops_cls_install_rule_in_asic(int                            unit,
         case OPS_CLS_L4_PORT_OP_EQ:
             rc = opennsl_field_qualify_L4SrcPort(unit, entry,
                                                  match->L4_src_port_min,
-                                                 port_mask);
+                                                 cls_entry->src_port_mask);
             if (OPENNSL_FAILURE(rc)) {
                 VLOG_ERR("Failed to add entry L4 src port 0x%x and mask 0x%x: "
-                         "rc=%s", match->L4_src_port_min, port_mask,
-                         opennsl_errmsg(rc));
+                         "rc=%s", match->L4_src_port_min,
+                         cls_entry->src_port_mask, opennsl_errmsg(rc));
                 goto cleanup;
             }
             break;
@@ -984,11 +1703,11 @@ ops_cls_install_rule_in_asic(int                            unit,
         case OPS_CLS_L4_PORT_OP_EQ:
             rc = opennsl_field_qualify_L4DstPort(unit, entry,
                                                  match->L4_dst_port_min,
-                                                 port_mask);
+                                                 cls_entry->dst_port_mask);
             if (OPENNSL_FAILURE(rc)) {
                 VLOG_ERR("Failed to add entry L4 dst port 0x%x and mask 0x%x: "
-                         "rc=%s", match->L4_dst_port_min, port_mask,
-                         opennsl_errmsg(rc));
+                         "rc=%s", match->L4_dst_port_min,
+                         cls_entry->dst_port_mask, opennsl_errmsg(rc));
                 goto cleanup;
             }
             break;
@@ -1051,8 +1770,8 @@ ops_cls_install_rule_in_asic(int                            unit,
     VLOG_DBG("Classifier %s rule id 0x%x successfully installed",
              cls->name, entry);
 
-    /* store stats entry */
-    if (statEnabled) {
+    /* store stats entry, once for all entries sharing it */
+    if (statEnabled && !statShared) {
         /* add it in range list of acl entry */
         sentry = xzalloc(sizeof(struct ops_cls_stats_entry));
         sentry->index = stat_index;
@@ -1060,28 +1779,34 @@ ops_cls_install_rule_in_asic(int                            unit,
         listp = isUpdate ? &hw_info->stats_index_update_list
                             : &hw_info->stats_index_list;
         list_push_back(listp, &sentry->node);
+        *shared_stat = stat_index;
     }
 
     /* store range entry */
     if (src_rangeEnabled) {
-        rentry = xzalloc(sizeof(struct ops_cls_range_entry));
-        rentry->index = src_range;
+        src_rentry = xzalloc(sizeof(struct ops_cls_range_entry));
+        src_rentry->index = src_range;
         listp = isUpdate ? &hw_info->range_index_update_list
                             : &hw_info->range_index_list;
-        list_push_back(listp, &rentry->node);
+        list_push_back(listp, &src_rentry->node);
     }
 
     if (dst_rangeEnabled) {
-        rentry = xzalloc(sizeof(struct ops_cls_range_entry));
-        rentry->index = dst_range;
+        dst_rentry = xzalloc(sizeof(struct ops_cls_range_entry));
+        dst_rentry->index = dst_range;
         listp = isUpdate ? &hw_info->range_index_update_list
                             : &hw_info->range_index_list;
-        list_push_back(listp, &rentry->node);
+        list_push_back(listp, &dst_rentry->node);
     }
 
     /* Save the entry id in  field */
     rulep =  xzalloc(sizeof(struct ops_cls_rule_entry));
     rulep->index = entry;
+    rulep->prio = prio;
+    rulep->cls_entry = cls_entry;
+    rulep->sentry = sentry;
+    rulep->src_rentry = src_rentry;
+    rulep->dst_rentry = dst_rentry;
     listp = isUpdate ? &hw_info->rule_index_update_list
                         : &hw_info->rule_index_list;
     list_push_back(listp, &rulep->node);
@@ -1108,7 +1833,7 @@ cleanup:
         }
     }
 
-    if (statEnabled) {
+    if (statEnabled && !statShared) {
         rc = opennsl_field_stat_destroy(unit, stat_index);
         if (OPENNSL_FAILURE(rc)) {
             VLOG_ERR("Failed to destroy stats 0x%x for ACL %s rc=%s",
@@ -1137,16 +1862,43 @@ ops_cls_install_classifier_in_asic(int                             hw_unit,
     opennsl_error_t rc = OPENNSL_E_NONE;
     struct ops_cls_entry *cls_entry = NULL, *next_cls_entry;
     struct ops_cls_hw_info *hw_info;
+    int free_entries = MAX_INGRESS_IPv4_ACL_RULES
+                       - cls_ingress_ipv4_rule_count[hw_unit];
+    int needed = list_size(list);
+    int shared_stat = -1;
+    int rule_index = -1;
+    int prio = needed * OPS_CLS_PRIO_GAP;
+
+    /* Fail before touching the hardware if the compiled list can not fit */
+    if (needed > free_entries) {
+        int n = 0;
+
+        LIST_FOR_EACH (cls_entry, node, list) {
+            if (n++ == free_entries) {
+                *fail_index = cls_entry->rule_index;
+                break;
+            }
+        }
+        VLOG_ERR("Classifier %s needs %d entries, %d free", cls->name,
+                 needed, free_entries);
+        return OPS_CLS_FAIL;
+    }
 
     /* Install in ASIC */
     LIST_FOR_EACH_SAFE(cls_entry, next_cls_entry, node, list) {
+        if (cls_entry->rule_index != rule_index) {
+            rule_index = cls_entry->rule_index;
+            shared_stat = -1;
+        }
+        *fail_index = rule_index;
         rc = ops_cls_install_rule_in_asic(hw_unit, cls, cls_entry, port_bmp,
-                                          *fail_index, intf_info, isUpdate);
+                                          rule_index, prio, intf_info,
+                                          isUpdate, &shared_stat);
         if (ops_cls_error(rc)) {
             VLOG_ERR("Failed to install classifier %s rule(s) ", cls->name);
             return rc;
         }
-        (*fail_index)++;
+        prio -= OPS_CLS_PRIO_GAP;
     }
 
     if (intf_info && (intf_info->flags & OPS_CLS_INTERFACE_L3ONLY)) {
@@ -1156,6 +1908,7 @@ ops_cls_install_classifier_in_asic(int                             hw_unit,
     }
 
     hw_info->in_asic = true;
+    hw_info->hw_unit = hw_unit;
 
     /* save the port bit map */
     OPENNSL_PBMP_ASSIGN(hw_info->pbmp, *port_bmp);
@@ -1164,6 +1917,42 @@ ops_cls_install_classifier_in_asic(int                             hw_unit,
     return rc;
 }
 
+/*
+ * Port bitmap updates.
+ *
+ * Applying a classifier to, or removing it from, one more port rewrites the
+ * port bitmap of every FP entry of the classifier.  When batching is
+ * enabled ('cls_pbmp_batch_ms' > 0) adding a port only records the new
+ * bitmap as pending; ops_cls_run() writes the final bitmap of each
+ * classifier once the batching window expires, so rolling an ACL out to
+ * many ports costs one reinstall pass instead of one per port.  Removing a
+ * port is always written synchronously, together with the pending
+ * additions, so a port never keeps matching a classifier removed from it.
+ * Any other change of the classifier's entries writes its pending bitmaps
+ * first.  hw_info->pbmp is only updated once a bitmap is written to all
+ * the rules.
+ */
+struct ops_cls_pbmp_timing {
+    uint64_t passes;                    /* bitmap writes to all entries */
+    uint64_t reinstalls;                /* FP entry reinstalls */
+    long long int usec;                 /* time spent in the passes */
+    long long int max_usec;             /* longest pass */
+};
+
+struct ops_cls_pbmp_stats {
+    uint64_t requests;                  /* port adds/removes of classifiers
+                                           in asic */
+    uint64_t deferred;                  /* requests merged into a pending
+                                           bitmap */
+    uint64_t failures;                  /* failed batched writes */
+    struct ops_cls_pbmp_timing sync;    /* passes done by the request */
+    struct ops_cls_pbmp_timing batch;   /* passes done at window expiry */
+};
+
+static int cls_pbmp_batch_ms;           /* 0: update rules synchronously */
+static long long int cls_pbmp_flush_time = LLONG_MAX;
+static struct ops_cls_pbmp_stats cls_pbmp_stats;
+
 /*
  * Update rule(s) port bitmap in FP
  */
@@ -1172,14 +1961,16 @@ ops_cls_pbmp_update(int                             hw_unit,
                     struct ops_classifier          *cls,
                     opennsl_pbmp_t                 *port_bmp,
                     int                            *fail_index,
-                    struct ops_cls_interface_info  *intf_info)
+                    struct ops_cls_hw_info         *hw_info,
+                    struct ops_cls_pbmp_timing     *timing)
 {
     opennsl_error_t rc = OPENNSL_E_NONE;
     struct ops_cls_rule_entry *rule_entry = NULL, *next_rule_entry;
     opennsl_pbmp_t pbmp_mask;
     char pbmp_string[200];
     int entry;
-    struct ovs_list *listp;
+    long long int start = time_usec();
+    long long int elapsed;
 
     OPENNSL_PBMP_CLEAR(pbmp_mask);
     OPENNSL_PBMP_NEGATE(pbmp_mask, pbmp_mask);
@@ -1187,20 +1978,15 @@ ops_cls_pbmp_update(int                             hw_unit,
     VLOG_DBG("Updated port bit map: [ %s ]",
              ops_cls_display_port_bit_map(port_bmp, pbmp_string, 200));
 
-    if (intf_info && (intf_info->flags & OPS_CLS_INTERFACE_L3ONLY)) {
-        listp =  &cls->route_cls.rule_index_list;
-    } else {
-        listp =  &cls->port_cls.rule_index_list;
-    }
-
-    LIST_FOR_EACH_SAFE(rule_entry, next_rule_entry, node, listp) {
+    LIST_FOR_EACH_SAFE(rule_entry, next_rule_entry, node,
+                       &hw_info->rule_index_list) {
         entry = rule_entry->index;
         rc = opennsl_field_qualify_InPorts(hw_unit, entry, *port_bmp,
                                            pbmp_mask);
         if (OPENNSL_FAILURE(rc)) {
             VLOG_ERR("Failed to update classifier %s rule port bitmask rc:%s",
                      cls->name, opennsl_errmsg(rc));
-            return rc;
+            break;
         }
 
         /*
@@ -1210,14 +1996,83 @@ ops_cls_pbmp_update(int                             hw_unit,
         if (OPENNSL_FAILURE(rc)) {
             VLOG_ERR("Failed to reinstall classifier %s rule entry 0x%x rc:%s",
                      cls->name, entry, opennsl_errmsg(rc));
-            return rc;
+            break;
         }
 
+        timing->reinstalls++;
         (*fail_index)++;
     }
+
+    elapsed = time_usec() - start;
+    timing->passes++;
+    timing->usec += elapsed;
+    timing->max_usec = MAX(timing->max_usec, elapsed);
     return rc;
 }
 
+/*
+ * Write the pending port bitmap of 'hw_info' to its rules in asic
+ */
+static void
+ops_cls_pbmp_flush_hw(struct ops_classifier *cls,
+                      struct ops_cls_hw_info *hw_info)
+{
+    opennsl_error_t rc;
+    int fail_index = 0;
+
+    if (!hw_info->pbmp_pending) {
+        return;
+    }
+    hw_info->pbmp_pending = false;
+
+    rc = ops_cls_pbmp_update(hw_info->hw_unit, cls, &hw_info->pending_pbmp,
+                             &fail_index, hw_info, &cls_pbmp_stats.batch);
+    if (OPENNSL_FAILURE(rc)) {
+        VLOG_ERR("Failed to apply batched port bitmap of classifier %s, "
+                 "%d of %zu rules updated", cls->name, fail_index,
+                 list_size(&hw_info->rule_index_list));
+        cls_pbmp_stats.failures++;
+        return;
+    }
+    OPENNSL_PBMP_ASSIGN(hw_info->pbmp, hw_info->pending_pbmp);
+}
+
+/*
+ * Write the pending port bitmaps of 'cls' to its rules in asic
+ */
+static void
+ops_cls_pbmp_flush(struct ops_classifier *cls)
+{
+    ops_cls_pbmp_flush_hw(cls, &cls->port_cls);
+    ops_cls_pbmp_flush_hw(cls, &cls->route_cls);
+}
+
+static void
+ops_cls_pbmp_flush_all(void)
+{
+    struct ops_classifier *cls;
+
+    HMAP_FOR_EACH (cls, node, &classifier_map) {
+        ops_cls_pbmp_flush(cls);
+    }
+    cls_pbmp_flush_time = LLONG_MAX;
+}
+
+/*
+ * Record 'pbmp' as the port bitmap of 'hw_info', to be written to its rules
+ * when the batching window expires
+ */
+static void
+ops_cls_pbmp_defer(struct ops_cls_hw_info *hw_info, opennsl_pbmp_t *pbmp)
+{
+    OPENNSL_PBMP_ASSIGN(hw_info->pending_pbmp, *pbmp);
+    hw_info->pbmp_pending = true;
+    if (cls_pbmp_flush_time == LLONG_MAX) {
+        cls_pbmp_flush_time = time_msec() + cls_pbmp_batch_ms;
+    }
+    cls_pbmp_stats.deferred++;
+}
+
 /*
  * Delete rules in asic
  */
@@ -1265,100 +2120,1081 @@ ops_cls_delete_rules_in_asic(int                             hw_unit,
                 *fail_index = index;
             }
         }
-        index++;
-    }
+        index++;
+    }
+
+    LIST_FOR_EACH_SAFE(rentry, next_rentry, node, range_index_list) {
+        entry = rentry->index;
+        rc = opennsl_field_range_destroy(hw_unit, entry);
+        if (OPENNSL_FAILURE(rc)) {
+            VLOG_ERR("Failed to destroy classifier %s range 0x%x rc:%s",
+                     cls->name, entry, opennsl_errmsg(rc));
+        }
+    }
+
+    LIST_FOR_EACH_SAFE(sentry, next_sentry, node, stats_index_list) {
+        entry = sentry->index;
+        rc = opennsl_field_stat_destroy(hw_unit, entry);
+        if (OPENNSL_FAILURE(rc)) {
+            VLOG_ERR("Failed to destroy classifier %s stats 0x%x rc:%s",
+                     cls->name, entry, opennsl_errmsg(rc));
+        }
+    }
+
+    return rc;
+}
+
+
+/*
+ * Update port bitmap of classifier
+ */
+static int
+ops_cls_update_classifier_in_asic(int                             hw_unit,
+                                  struct ops_classifier          *cls,
+                                  opennsl_pbmp_t                 *port_bmp,
+                                  enum ops_update_pbmp            action,
+                                  int                            *fail_index,
+                                  struct ops_cls_interface_info  *intf_info)
+{
+    opennsl_error_t rc = OPENNSL_E_NONE;
+    struct ops_cls_hw_info *hw_info;
+    opennsl_pbmp_t pbmp;
+
+    if (intf_info && (intf_info->flags & OPS_CLS_INTERFACE_L3ONLY)) {
+        hw_info = &cls->route_cls;
+    } else {
+        hw_info = &cls->port_cls;
+    }
+
+    cls_pbmp_stats.requests++;
+
+    /* start from the bitmap the rules will have once the pending
+     * additions are written */
+    OPENNSL_PBMP_CLEAR(pbmp);
+    OPENNSL_PBMP_OR(pbmp, hw_info->pbmp_pending ? hw_info->pending_pbmp
+                                                : hw_info->pbmp);
+    switch (action) {
+    case OPS_PBMP_ADD:
+        OPENNSL_PBMP_OR(pbmp, *port_bmp);
+        if (cls_pbmp_batch_ms) {
+            ops_cls_pbmp_defer(hw_info, &pbmp);
+            break;
+        }
+        rc = ops_cls_pbmp_update(hw_unit, cls, &pbmp, fail_index, hw_info,
+                                 &cls_pbmp_stats.sync);
+        if (OPENNSL_SUCCESS(rc)) {
+            OPENNSL_PBMP_ASSIGN(hw_info->pbmp, pbmp);
+            hw_info->pbmp_pending = false;
+        }
+        break;
+
+    case OPS_PBMP_DEL:
+        /* check clasiifier is used as routed (L3) or port (L2) */
+        OPENNSL_PBMP_XOR(pbmp, *port_bmp);
+        if (OPENNSL_PBMP_IS_NULL(pbmp)) {
+            if (intf_info && (intf_info->flags & OPS_CLS_INTERFACE_L3ONLY)) {
+                VLOG_DBG("Routed port bit map is NULL, remove classifier %s "
+                          "routed rules in asic", cls->name);
+            } else {
+                VLOG_DBG("Port bit map is NULL, remove classifier %s "
+                          "port rules in asic", cls->name);
+            }
+            hw_info->pbmp_pending = false;
+            rc = ops_cls_delete_rules_in_asic(hw_unit, cls, fail_index,
+                                              intf_info, FALSE);
+        } else {
+            rc = ops_cls_pbmp_update(hw_unit, cls, &pbmp, fail_index,
+                                     hw_info, &cls_pbmp_stats.sync);
+        }
+
+        if (OPENNSL_SUCCESS(rc)) {
+            OPENNSL_PBMP_ASSIGN(hw_info->pbmp, pbmp);
+            hw_info->pbmp_pending = false;
+        } else if (hw_info->pbmp_pending) {
+            /* the batched write must not add the removed port back */
+            OPENNSL_PBMP_ASSIGN(hw_info->pending_pbmp, pbmp);
+        }
+
+        if (OPENNSL_PBMP_IS_NULL(cls->port_cls.pbmp) &&
+            OPENNSL_PBMP_IS_NULL(cls->route_cls.pbmp)) {
+            VLOG_DBG("All port bit is NULL, remove classifer %s from hash",
+                     cls->name);
+            ops_cls_delete(cls);
+        }
+
+        break;
+
+    default:
+        break;
+
+    }
+
+    return rc;
+}
+
+/*
+ * Incremental classifier update.
+ *
+ * The compiled entries of an updated list are compared with the FP entries
+ * installed for the current list.  Entries are compared per PI ACE, since
+ * the entries expanded from one ACE share a counter.  ACEs installed with
+ * the same match and action are kept with their counters, as long as they
+ * keep their relative order; everything else is installed in the priority
+ * gaps between the kept entries.  The kept entries are handed over to the
+ * new list only once all new entries are installed and the obsolete ones
+ * are removed last, so a packet always hits a rule of either list and the
+ * cost of an update is proportional to the change.
+ */
+struct ops_cls_diff {
+    struct ops_cls_hw_info *from;       /* hw info of the installed list */
+    int n;                              /* compiled entries of the new list */
+    struct ops_cls_entry **entries;     /* compiled entries of the new list */
+    struct ops_cls_rule_entry **kept;   /* installed entry kept for each
+                                           compiled entry, or NULL */
+    int *prio;                          /* FP priority of each entry */
+    int n_kept;                         /* entries kept */
+    int n_removed;                      /* installed entries not kept */
+};
+
+/* Run of entries installed from (or compiled from) the same PI ACE */
+struct ops_cls_diff_group {
+    int first;
+    int n;
+    int match;                          /* matching group, or -1 */
+};
+
+/*
+ * Return true if 'a' and 'b' program the same FP entry
+ */
+static bool
+ops_cls_entry_equal(const struct ops_cls_entry *a,
+                    const struct ops_cls_entry *b)
+{
+    const struct ops_cls_list_entry_match_fields *fa = &a->entry_fields;
+    const struct ops_cls_list_entry_match_fields *fb = &b->entry_fields;
+
+    if (a->match_flags != b->match_flags || a->act_flags != b->act_flags) {
+        return false;
+    }
+    if (a->match_flags & OPS_CLS_SRC_IPADDR_VALID &&
+        (a->src_ip != b->src_ip || a->src_mask != b->src_mask)) {
+        return false;
+    }
+    if (a->match_flags & OPS_CLS_DEST_IPADDR_VALID &&
+        (a->dst_ip != b->dst_ip || a->dst_mask != b->dst_mask)) {
+        return false;
+    }
+    if (a->match_flags & OPS_CLS_PROTOCOL_VALID &&
+        fa->protocol != fb->protocol) {
+        return false;
+    }
+    if (a->match_flags & OPS_CLS_L4_SRC_PORT_VALID &&
+        (fa->L4_src_port_op != fb->L4_src_port_op ||
+         fa->L4_src_port_min != fb->L4_src_port_min ||
+         fa->L4_src_port_max != fb->L4_src_port_max ||
+         a->src_port_mask != b->src_port_mask)) {
+        return false;
+    }
+    if (a->match_flags & OPS_CLS_L4_DEST_PORT_VALID &&
+        (fa->L4_dst_port_op != fb->L4_dst_port_op ||
+         fa->L4_dst_port_min != fb->L4_dst_port_min ||
+         fa->L4_dst_port_max != fb->L4_dst_port_max ||
+         a->dst_port_mask != b->dst_port_mask)) {
+        return false;
+    }
+    return true;
+}
+
+static int
+ops_cls_rule_prio_cmp(const void *a_, const void *b_)
+{
+    const struct ops_cls_rule_entry *a = *(struct ops_cls_rule_entry **) a_;
+    const struct ops_cls_rule_entry *b = *(struct ops_cls_rule_entry **) b_;
+
+    return a->prio > b->prio ? -1 : a->prio < b->prio;
+}
+
+/*
+ * Split 'n' entries, of which 'rule_index' returns the PI ACE, into groups
+ */
+static int
+ops_cls_diff_groups(void **items, int n,
+                    int (*rule_index)(const void *item),
+                    struct ops_cls_diff_group *groups)
+{
+    int n_groups = 0;
+
+    for (int i = 0; i < n; i++) {
+        if (!i || rule_index(items[i]) != rule_index(items[i - 1])) {
+            groups[n_groups].first = i;
+            groups[n_groups].n = 0;
+            groups[n_groups].match = -1;
+            n_groups++;
+        }
+        groups[n_groups - 1].n++;
+    }
+    return n_groups;
+}
+
+static int
+ops_cls_rule_entry_rule_index(const void *item)
+{
+    return ((const struct ops_cls_rule_entry *) item)->cls_entry->rule_index;
+}
+
+static int
+ops_cls_entry_rule_index(const void *item)
+{
+    return ((const struct ops_cls_entry *) item)->rule_index;
+}
+
+/*
+ * Keep the longest chain of matched new groups whose old groups are in
+ * the same order, unmatch the others
+ */
+static void
+ops_cls_diff_keep_ordered(struct ops_cls_diff_group *ng, int n_ng,
+                          struct ops_cls_diff_group *og)
+{
+    int *tail = xmalloc(n_ng * sizeof *tail);  /* group ending chain of len */
+    int *prev = xmalloc(n_ng * sizeof *prev);
+    bool *keep = xzalloc(n_ng * sizeof *keep);
+    int len = 0;
+
+    for (int i = 0; i < n_ng; i++) {
+        int lo = 0, hi = len;
+
+        prev[i] = -1;
+        if (ng[i].match < 0) {
+            continue;
+        }
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+
+            if (ng[tail[mid]].match < ng[i].match) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        prev[i] = lo ? tail[lo - 1] : -1;
+        tail[lo] = i;
+        len = MAX(len, lo + 1);
+    }
+    for (int i = len ? tail[len - 1] : -1; i >= 0; i = prev[i]) {
+        keep[i] = true;
+    }
+    for (int i = 0; i < n_ng; i++) {
+        if (ng[i].match >= 0 && !keep[i]) {
+            og[ng[i].match].match = -1;
+            ng[i].match = -1;
+        }
+    }
+    free(keep);
+    free(prev);
+    free(tail);
+}
+
+/*
+ * Assign priorities to the entries of 'diff' that are not kept, spread
+ * over the gaps between kept entries.  Returns false if a gap is too small.
+ */
+static bool
+ops_cls_diff_assign_prio(struct ops_cls_diff *diff)
+{
+    int i = 0;
+
+    while (i < diff->n) {
+        int start = i, hi, lo, step;
+
+        if (diff->kept[i]) {
+            diff->prio[i] = diff->kept[i]->prio;
+            i++;
+            continue;
+        }
+        while (i < diff->n && !diff->kept[i]) {
+            i++;
+        }
+        lo = i < diff->n ? diff->kept[i]->prio : 0;
+        if (start) {
+            hi = diff->prio[start - 1];
+        } else if (lo > INT_MAX - (i - start + 1) * OPS_CLS_PRIO_GAP) {
+            return false;
+        } else {
+            hi = lo + (i - start + 1) * OPS_CLS_PRIO_GAP;
+        }
+        step = (hi - lo) / (i - start + 1);
+        if (step < 1) {
+            return false;
+        }
+        for (int k = start; k < i; k++) {
+            diff->prio[k] = hi - step * (k - start + 1);
+        }
+    }
+    return true;
+}
+
+static void
+ops_cls_diff_destroy(struct ops_cls_diff *diff)
+{
+    free(diff->entries);
+    free(diff->kept);
+    free(diff->prio);
+    memset(diff, 0, sizeof *diff);
+}
+
+/*
+ * Plan the update of the entries installed in 'from' to the compiled
+ * entries in 'list'.  Returns false if the update has to reinstall all
+ * entries.
+ */
+static bool
+ops_cls_diff_plan(struct ops_cls_diff   *diff,
+                  struct ops_cls_hw_info *from,
+                  struct ovs_list        *list)
+{
+    struct ops_cls_rule_entry **old, *rule;
+    struct ops_cls_diff_group *og, *ng;
+    struct ops_cls_entry *entry;
+    int n_old = list_size(&from->rule_index_list);
+    int n_og, n_ng, i;
+
+    memset(diff, 0, sizeof *diff);
+    diff->from = from;
+    diff->n = list_size(list);
+    diff->entries = xmalloc(MAX(diff->n, 1) * sizeof *diff->entries);
+    diff->kept = xzalloc(MAX(diff->n, 1) * sizeof *diff->kept);
+    diff->prio = xmalloc(MAX(diff->n, 1) * sizeof *diff->prio);
+
+    i = 0;
+    LIST_FOR_EACH (entry, node, list) {
+        diff->entries[i++] = entry;
+    }
+
+    old = xmalloc(MAX(n_old, 1) * sizeof *old);
+    i = 0;
+    LIST_FOR_EACH (rule, node, &from->rule_index_list) {
+        old[i++] = rule;
+    }
+    qsort(old, n_old, sizeof *old, ops_cls_rule_prio_cmp);
+
+    og = xmalloc(MAX(n_old, 1) * sizeof *og);
+    ng = xmalloc(MAX(diff->n, 1) * sizeof *ng);
+    n_og = ops_cls_diff_groups((void **) old, n_old,
+                               ops_cls_rule_entry_rule_index, og);
+    n_ng = ops_cls_diff_groups((void **) diff->entries, diff->n,
+                               ops_cls_entry_rule_index, ng);
+
+    /* Match every new ACE with the first unmatched identical old ACE */
+    for (int g = 0; g < n_ng; g++) {
+        for (int h = 0; h < n_og; h++) {
+            int k;
+
+            if (og[h].match >= 0 || og[h].n != ng[g].n) {
+                continue;
+            }
+            for (k = 0; k < ng[g].n; k++) {
+                if (!ops_cls_entry_equal(old[og[h].first + k]->cls_entry,
+                                         diff->entries[ng[g].first + k])) {
+                    break;
+                }
+            }
+            if (k == ng[g].n) {
+                og[h].match = g;
+                ng[g].match = h;
+                break;
+            }
+        }
+    }
+    ops_cls_diff_keep_ordered(ng, n_ng, og);
+
+    for (int g = 0; g < n_ng; g++) {
+        if (ng[g].match < 0) {
+            continue;
+        }
+        for (int k = 0; k < ng[g].n; k++) {
+            diff->kept[ng[g].first + k] = old[og[ng[g].match].first + k];
+            diff->n_kept++;
+        }
+    }
+    diff->n_removed = n_old - diff->n_kept;
+
+    free(ng);
+    free(og);
+    free(old);
+
+    return ops_cls_diff_assign_prio(diff);
+}
+
+/*
+ * Install the entries of 'diff' that are not kept
+ */
+static int
+ops_cls_diff_install(int                             hw_unit,
+                     struct ops_classifier          *cls,
+                     struct ops_cls_diff            *diff,
+                     opennsl_pbmp_t                 *port_bmp,
+                     int                            *fail_index,
+                     bool                            isUpdate,
+                     struct ops_cls_interface_info  *intf_info)
+{
+    opennsl_error_t rc = OPENNSL_E_NONE;
+    struct ops_cls_hw_info *hw_info;
+    int needed = diff->n - diff->n_kept;
+    int free_entries = MAX_INGRESS_IPv4_ACL_RULES
+                       - cls_ingress_ipv4_rule_count[hw_unit];
+    int shared_stat = -1;
+    int rule_index = -1;
+
+    if (needed > free_entries) {
+        VLOG_ERR("Classifier %s update needs %d entries, %d free", cls->name,
+                 needed, free_entries);
+        *fail_index = diff->n ? diff->entries[0]->rule_index : 0;
+        return OPS_CLS_FAIL;
+    }
+
+    for (int i = 0; i < diff->n; i++) {
+        struct ops_cls_entry *cls_entry = diff->entries[i];
+
+        if (diff->kept[i]) {
+            continue;
+        }
+        if (cls_entry->rule_index != rule_index) {
+            rule_index = cls_entry->rule_index;
+            shared_stat = -1;
+        }
+        *fail_index = rule_index;
+        rc = ops_cls_install_rule_in_asic(hw_unit, cls, cls_entry, port_bmp,
+                                          rule_index, diff->prio[i],
+                                          intf_info, isUpdate, &shared_stat);
+        if (ops_cls_error(rc)) {
+            VLOG_ERR("Failed to install classifier %s rule(s) ", cls->name);
+            return rc;
+        }
+    }
+
+    if (intf_info && (intf_info->flags & OPS_CLS_INTERFACE_L3ONLY)) {
+        hw_info = &cls->route_cls;
+    } else {
+        hw_info = &cls->port_cls;
+    }
+    hw_info->in_asic = true;
+    hw_info->hw_unit = hw_unit;
+    OPENNSL_PBMP_ASSIGN(hw_info->pbmp, *port_bmp);
+
+    VLOG_DBG("Classifier %s updated: %d entries kept, %d installed, "
+             "%d to remove", cls->name, diff->n_kept, needed,
+             diff->n_removed);
+    return rc;
+}
+
+/*
+ * Hand the kept entries of 'diff' over to the lists of 'cls' the new
+ * entries were installed in.  What is left in 'diff->from' is obsolete.
+ */
+static void
+ops_cls_diff_commit(struct ops_classifier          *cls,
+                    struct ops_cls_diff            *diff,
+                    bool                            isUpdate,
+                    bool                            clear_stats,
+                    int                             hw_unit,
+                    struct ops_cls_interface_info  *intf_info)
+{
+    struct ops_cls_hw_info *hw_info;
+    struct ovs_list *rule_list, *range_list, *stats_list;
+
+    if (intf_info && (intf_info->flags & OPS_CLS_INTERFACE_L3ONLY)) {
+        hw_info = &cls->route_cls;
+    } else {
+        hw_info = &cls->port_cls;
+    }
+    rule_list = isUpdate ? &hw_info->rule_index_update_list
+                         : &hw_info->rule_index_list;
+    range_list = isUpdate ? &hw_info->range_index_update_list
+                          : &hw_info->range_index_list;
+    stats_list = isUpdate ? &hw_info->stats_index_update_list
+                          : &hw_info->stats_index_list;
+
+    for (int i = 0; i < diff->n; i++) {
+        struct ops_cls_rule_entry *rule = diff->kept[i];
+
+        if (!rule) {
+            continue;
+        }
+        rule->cls_entry = diff->entries[i];
+        list_remove(&rule->node);
+        list_push_back(rule_list, &rule->node);
+        if (rule->sentry) {
+            rule->sentry->rule_index = diff->entries[i]->rule_index;
+            list_remove(&rule->sentry->node);
+            list_push_back(stats_list, &rule->sentry->node);
+            if (clear_stats) {
+                opennsl_field_stat_all_set(hw_unit, rule->sentry->index, 0);
+                ops_cls_stats_cache_set(hw_unit, rule->sentry->index, 0);
+            }
+        }
+        if (rule->src_rentry) {
+            list_remove(&rule->src_rentry->node);
+            list_push_back(range_list, &rule->src_rentry->node);
+        }
+        if (rule->dst_rentry) {
+            list_remove(&rule->dst_rentry->node);
+            list_push_back(range_list, &rule->dst_rentry->node);
+        }
+    }
+}
+
+/*
+ * ACL evaluation.
+ *
+ * ops_cls_eval_list() evaluates a PI list as the ACL is specified: the
+ * first ACE with an action that matches the packet wins.  The FP is modeled
+ * by ops_cls_eval_entry(), which matches a compiled entry with the
+ * parameters install_rule programs (value/mask qualifiers, L4 port range
+ * checkers and the L3 routable bit of routed classifiers), the installed
+ * rules of a classifier being ordered by their FP priority.
+ *
+ * When verification is enabled, every install and update of a classifier
+ * is checked by running synthetic packets, aimed at the boundaries of the
+ * ACEs, through both.  The same check runs offline on a synthetic ACL with
+ * "plugin/debug acl-verify bench", which also times both evaluators.
+ */
+struct ops_cls_verify_stats {
+    uint64_t runs;                      /* classifiers verified */
+    uint64_t packets;                   /* packets evaluated */
+    uint64_t mismatches;                /* packets the FP model handles
+                                           differently than the list */
+};
+
+static int cls_verify_packets;          /* packets per verification, 0: off */
+static struct ops_cls_verify_stats cls_verify_stats;
+
+static bool
+ops_cls_eval_l4_port(uint16_t port, int op, uint16_t min, uint16_t max)
+{
+    switch (op) {
+    case OPS_CLS_L4_PORT_OP_EQ:
+        return port == min;
+    case OPS_CLS_L4_PORT_OP_NEQ:
+        return port != min;
+    case OPS_CLS_L4_PORT_OP_LT:
+        return port <= max;
+    case OPS_CLS_L4_PORT_OP_GT:
+        return port >= min;
+    case OPS_CLS_L4_PORT_OP_RANGE:
+        return port >= min && port <= max;
+    case OPS_CLS_L4_PORT_OP_NONE:
+    default:
+        return true;
+    }
+}
+
+static bool
+ops_cls_eval_ace(const struct ops_cls_list_entry_match_fields *f,
+                 const struct ops_cls_eval_packet *pkt)
+{
+    if (f->entry_flags & OPS_CLS_SRC_IPADDR_VALID &&
+        (pkt->sip ^ ntohl(f->src_ip_address.v4.s_addr)) &
+        ntohl(f->src_ip_address_mask.v4.s_addr)) {
+        return false;
+    }
+    if (f->entry_flags & OPS_CLS_DEST_IPADDR_VALID &&
+        (pkt->dip ^ ntohl(f->dst_ip_address.v4.s_addr)) &
+        ntohl(f->dst_ip_address_mask.v4.s_addr)) {
+        return false;
+    }
+    if (f->entry_flags & OPS_CLS_PROTOCOL_VALID &&
+        pkt->protocol != f->protocol) {
+        return false;
+    }
+    if (f->entry_flags & OPS_CLS_L4_SRC_PORT_VALID &&
+        !ops_cls_eval_l4_port(pkt->sport, f->L4_src_port_op,
+                              f->L4_src_port_min, f->L4_src_port_max)) {
+        return false;
+    }
+    if (f->entry_flags & OPS_CLS_L4_DEST_PORT_VALID &&
+        !ops_cls_eval_l4_port(pkt->dport, f->L4_dst_port_op,
+                              f->L4_dst_port_min, f->L4_dst_port_max)) {
+        return false;
+    }
+    return true;
+}
+
+int
+ops_cls_eval_list(const struct ops_cls_list *list,
+                  const struct ops_cls_eval_packet *pkt, uint32_t *actions)
+{
+    for (int i = 0; i < list->num_entries; i++) {
+        const struct ops_cls_list_entry *ace = &list->entries[i];
+
+        /* ACEs without action are not programmed */
+        if (ace->entry_actions.action_flags &&
+            ops_cls_eval_ace(&ace->entry_fields, pkt)) {
+            *actions = ace->entry_actions.action_flags;
+            return i;
+        }
+    }
+    *actions = 0;
+    return -1;
+}
+
+/*
+ * Match an L4 port the way install_rule programs it, an entry with an
+ * operation the FP does not support is never installed
+ */
+static bool
+ops_cls_eval_entry_port(uint16_t port, int op, uint16_t value, uint16_t mask,
+                        uint16_t min, uint16_t max)
+{
+    switch (op) {
+    case OPS_CLS_L4_PORT_OP_EQ:
+        return !((port ^ value) & mask);
+    case OPS_CLS_L4_PORT_OP_RANGE:
+    case OPS_CLS_L4_PORT_OP_LT:
+    case OPS_CLS_L4_PORT_OP_GT:
+        return port >= min && port <= max;
+    default:
+        return false;
+    }
+}
+
+/*
+ * Return true if the FP entry programmed for 'entry' matches 'pkt'
+ */
+static bool
+ops_cls_eval_entry(struct ops_cls_entry *entry,
+                   const struct ops_cls_eval_packet *pkt, bool l3only)
+{
+    struct ops_cls_list_entry_match_fields *match = &entry->entry_fields;
+    uint16_t min_port, max_port;
+
+    if (!entry->act_flags || (l3only && !pkt->routed)) {
+        return false;
+    }
+    if (entry->match_flags & OPS_CLS_SRC_IPADDR_VALID &&
+        (pkt->sip ^ htonl(entry->src_ip)) & htonl(entry->src_mask)) {
+        return false;
+    }
+    if (entry->match_flags & OPS_CLS_DEST_IPADDR_VALID &&
+        (pkt->dip ^ htonl(entry->dst_ip)) & htonl(entry->dst_mask)) {
+        return false;
+    }
+    if (entry->match_flags & OPS_CLS_PROTOCOL_VALID &&
+        pkt->protocol != match->protocol) {
+        return false;
+    }
+    if (entry->match_flags & OPS_CLS_L4_SRC_PORT_VALID) {
+        ops_cls_get_src_port_range(match, &min_port, &max_port);
+        if (!ops_cls_eval_entry_port(pkt->sport, match->L4_src_port_op,
+                                     match->L4_src_port_min,
+                                     entry->src_port_mask,
+                                     min_port, max_port)) {
+            return false;
+        }
+    }
+    if (entry->match_flags & OPS_CLS_L4_DEST_PORT_VALID) {
+        ops_cls_get_dst_port_range(match, &min_port, &max_port);
+        if (!ops_cls_eval_entry_port(pkt->dport, match->L4_dst_port_op,
+                                     match->L4_dst_port_min,
+                                     entry->dst_port_mask,
+                                     min_port, max_port)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Return the compiled entry of the highest priority rule of 'hw_info' that
+ * matches 'pkt', or NULL.  '*ambiguous' is set if another rule of the same
+ * priority matches as well, the FP may then pick either.
+ */
+static struct ops_cls_entry *
+ops_cls_eval_rules(struct ops_cls_hw_info *hw_info, bool l3only,
+                   const struct ops_cls_eval_packet *pkt, bool *ambiguous)
+{
+    struct ops_cls_rule_entry *rule, *best = NULL;
+
+    *ambiguous = false;
+    LIST_FOR_EACH (rule, node, &hw_info->rule_index_list) {
+        if (!rule->cls_entry ||
+            !ops_cls_eval_entry(rule->cls_entry, pkt, l3only)) {
+            continue;
+        }
+        if (!best || rule->prio > best->prio) {
+            best = rule;
+            *ambiguous = false;
+        } else if (rule->prio == best->prio) {
+            *ambiguous = true;
+        }
+    }
+    return best ? best->cls_entry : NULL;
+}
+
+/*
+ * Return true if FP entry 'entry' (NULL if none matched) implements ACE
+ * 'ace' with 'actions' (-1 if none matched).  The hits of an ACE with a
+ * counter must also be counted by that ACE's counter.
+ */
+static bool
+ops_cls_eval_agree(int ace, uint32_t actions, const struct ops_cls_entry *entry)
+{
+    if (ace < 0 || !entry) {
+        return ace < 0 && !entry;
+    }
+    if (entry->act_flags != actions) {
+        return false;
+    }
+    return !(actions & OPS_CLS_ACTION_COUNT) || entry->rule_index == ace;
+}
+
+/*
+ * Pick an L4 port on or next to the bounds of an ACE
+ */
+static uint16_t
+ops_cls_eval_gen_port(uint16_t min, uint16_t max)
+{
+    const uint16_t ports[] = { min - 1, min, min + 1, max - 1, max, max + 1 };
+    uint32_t r = random_uint32();
+
+    if (r & 1) {
+        return r >> 16;
+    }
+    return ports[(r >> 1) % ARRAY_SIZE(ports)];
+}
+
+/*
+ * Generate a packet, most of the time aimed at an ACE of 'list'
+ */
+static void
+ops_cls_eval_gen_packet(const struct ops_cls_list *list,
+                        struct ops_cls_eval_packet *pkt)
+{
+    static const uint8_t protocols[] = { 1, 6, 17, 47 };
+    const struct ops_cls_list_entry_match_fields *f;
+    uint32_t r = random_uint32();
+    uint32_t mask;
+
+    pkt->sip = random_uint32();
+    pkt->dip = random_uint32();
+    pkt->protocol = protocols[r % ARRAY_SIZE(protocols)];
+    pkt->sport = random_uint32();
+    pkt->dport = random_uint32();
+    pkt->routed = r & 4;
+
+    if (!list->num_entries || !(r & 0x18)) {
+        return;
+    }
+
+    f = &list->entries[random_range(list->num_entries)].entry_fields;
+    if (f->entry_flags & OPS_CLS_SRC_IPADDR_VALID) {
+        mask = ntohl(f->src_ip_address_mask.v4.s_addr);
+        pkt->sip = (ntohl(f->src_ip_address.v4.s_addr) & mask) |
+                   (pkt->sip & ~mask);
+    }
+    if (f->entry_flags & OPS_CLS_DEST_IPADDR_VALID) {
+        mask = ntohl(f->dst_ip_address_mask.v4.s_addr);
+        pkt->dip = (ntohl(f->dst_ip_address.v4.s_addr) & mask) |
+                   (pkt->dip & ~mask);
+    }
+    if (f->entry_flags & OPS_CLS_PROTOCOL_VALID && r & 0x20) {
+        pkt->protocol = f->protocol;
+    }
+    if (f->entry_flags & OPS_CLS_L4_SRC_PORT_VALID) {
+        pkt->sport = ops_cls_eval_gen_port(f->L4_src_port_min,
+                                           f->L4_src_port_max);
+    }
+    if (f->entry_flags & OPS_CLS_L4_DEST_PORT_VALID) {
+        pkt->dport = ops_cls_eval_gen_port(f->L4_dst_port_min,
+                                           f->L4_dst_port_max);
+    }
+}
+
+static void
+ops_cls_eval_format(struct ds *ds, const struct ops_cls_eval_packet *pkt,
+                    int ace, const struct ops_cls_entry *entry)
+{
+    char sip[INET_ADDRSTRLEN], dip[INET_ADDRSTRLEN];
+    struct in_addr addr;
+
+    addr.s_addr = htonl(pkt->sip);
+    inet_ntop(AF_INET, &addr, sip, sizeof sip);
+    addr.s_addr = htonl(pkt->dip);
+    inet_ntop(AF_INET, &addr, dip, sizeof dip);
+
+    ds_put_format(ds, "%s -> %s proto %u ports %u -> %u%s: ACE %d, "
+                  "FP entry of ACE %d (actions 0x%x)", sip, dip,
+                  pkt->protocol, pkt->sport, pkt->dport,
+                  pkt->routed ? " routed" : "", ace,
+                  entry ? (int) entry->rule_index : -1,
+                  entry ? entry->act_flags : 0);
+}
+
+/*
+ * Check the installed rules of 'hw_info' against 'list'
+ */
+static void
+ops_cls_verify_hw(struct ops_classifier *cls, struct ops_cls_hw_info *hw_info,
+                  bool l3only, const struct ops_cls_list *list)
+{
+    struct ops_cls_eval_packet pkt;
+    struct ops_cls_entry *entry;
+    uint64_t mismatches = 0;
+    uint32_t actions;
+    bool ambiguous;
+    int ace;
+
+    for (int i = 0; i < cls_verify_packets; i++) {
+        ops_cls_eval_gen_packet(list, &pkt);
+        ace = ops_cls_eval_list(list, &pkt, &actions);
+        if (l3only && !pkt.routed) {
+            ace = -1;
+        }
+        entry = ops_cls_eval_rules(hw_info, l3only, &pkt, &ambiguous);
+        if (ambiguous || !ops_cls_eval_agree(ace, actions, entry)) {
+            if (!mismatches++) {
+                struct ds ds = DS_EMPTY_INITIALIZER;
+
+                ops_cls_eval_format(&ds, &pkt, ace, entry);
+                VLOG_WARN("Classifier %s %s rules do not implement the ACL "
+                          "%s%s", cls->name, l3only ? "routed" : "port",
+                          ds_cstr(&ds), ambiguous ? ", ambiguous" : "");
+                ds_destroy(&ds);
+            }
+        }
+    }
+
+    cls_verify_stats.runs++;
+    cls_verify_stats.packets += cls_verify_packets;
+    cls_verify_stats.mismatches += mismatches;
+}
+
+/*
+ * Check the rules installed for 'cls' against 'list', if enabled
+ */
+static void
+ops_cls_verify(struct ops_classifier *cls, const struct ops_cls_list *list)
+{
+    if (!cls_verify_packets || !list) {
+        return;
+    }
+    if (cls->port_cls.in_asic) {
+        ops_cls_verify_hw(cls, &cls->port_cls, false, list);
+    }
+    if (cls->route_cls.in_asic) {
+        ops_cls_verify_hw(cls, &cls->route_cls, true, list);
+    }
+}
+
+int
+ops_cls_opennsl_verify_set(int packets)
+{
+    if (packets < 0 || packets > OPS_CLS_VERIFY_MAX_PACKETS) {
+        return OPS_CLS_FAIL;
+    }
+    cls_verify_packets = packets;
+    return OPS_CLS_OK;
+}
+
+void
+ops_cls_opennsl_verify_dump(struct ds *ds)
+{
+    if (cls_verify_packets) {
+        ds_put_format(ds, "ACL install verification with %d packets\n",
+                      cls_verify_packets);
+    } else {
+        ds_put_format(ds, "ACL install verification disabled\n");
+    }
+    ds_put_format(ds, "Verified %"PRIu64" classifiers, %"PRIu64" packets, "
+                  "%"PRIu64" mismatches\n", cls_verify_stats.runs,
+                  cls_verify_stats.packets, cls_verify_stats.mismatches);
+}
+
+/*
+ * Fill 'list' with 'n' random ACEs over a small address and port space, so
+ * that some ACEs overlap and shadow each other
+ */
+static void
+ops_cls_eval_gen_list(struct ops_cls_list *list, int n)
+{
+    static const uint32_t actions[] = {
+        OPS_CLS_ACTION_PERMIT, OPS_CLS_ACTION_DENY,
+        OPS_CLS_ACTION_PERMIT | OPS_CLS_ACTION_COUNT,
+        OPS_CLS_ACTION_DENY | OPS_CLS_ACTION_COUNT,
+    };
+    static const int ops[] = {
+        OPS_CLS_L4_PORT_OP_EQ, OPS_CLS_L4_PORT_OP_LT,
+        OPS_CLS_L4_PORT_OP_GT, OPS_CLS_L4_PORT_OP_RANGE,
+        OPS_CLS_L4_PORT_OP_NEQ,
+    };
+
+    list->entries = xcalloc(n, sizeof *list->entries);
+    list->num_entries = n;
+
+    for (int i = 0; i < n; i++) {
+        struct ops_cls_list_entry_match_fields *f =
+            &list->entries[i].entry_fields;
+        uint32_t r = random_uint32();
+        uint32_t mask;
+
+        mask = ~0u << random_range(17);
+        f->entry_flags |= OPS_CLS_SRC_IPADDR_VALID;
+        f->src_ip_address_mask.v4.s_addr = htonl(mask);
+        f->src_ip_address.v4.s_addr =
+            htonl(((10u << 24) | (random_uint32() & 0x0f0f0f)) & mask);
+        if (r & 3) {
+            mask = ~0u << random_range(17);
+            f->entry_flags |= OPS_CLS_DEST_IPADDR_VALID;
+            f->dst_ip_address_mask.v4.s_addr = htonl(mask);
+            f->dst_ip_address.v4.s_addr =
+                htonl(((10u << 24) | (random_uint32() & 0x0f0f0f)) & mask);
+        }
+        if (r & 4) {
+            f->entry_flags |= OPS_CLS_PROTOCOL_VALID;
+            f->protocol = r & 8 ? 6 : 17;
+        }
+        if (r & 0x10) {
+            uint16_t a = random_range(2048), b = random_range(2048);
 
-    LIST_FOR_EACH_SAFE(rentry, next_rentry, node, range_index_list) {
-        entry = rentry->index;
-        rc = opennsl_field_range_destroy(hw_unit, entry);
-        if (OPENNSL_FAILURE(rc)) {
-            VLOG_ERR("Failed to destroy classifier %s range 0x%x rc:%s",
-                     cls->name, entry, opennsl_errmsg(rc));
+            f->entry_flags |= OPS_CLS_L4_SRC_PORT_VALID;
+            f->L4_src_port_op = ops[(r >> 8) % ARRAY_SIZE(ops)];
+            f->L4_src_port_min = MIN(a, b);
+            f->L4_src_port_max = MAX(a, b);
         }
-    }
+        if (r & 0x20) {
+            uint16_t a = random_range(2048), b = random_range(2048);
 
-    LIST_FOR_EACH_SAFE(sentry, next_sentry, node, stats_index_list) {
-        entry = sentry->index;
-        rc = opennsl_field_stat_destroy(hw_unit, entry);
-        if (OPENNSL_FAILURE(rc)) {
-            VLOG_ERR("Failed to destroy classifier %s stats 0x%x rc:%s",
-                     cls->name, entry, opennsl_errmsg(rc));
+            f->entry_flags |= OPS_CLS_L4_DEST_PORT_VALID;
+            f->L4_dst_port_op = ops[(r >> 12) % ARRAY_SIZE(ops)];
+            f->L4_dst_port_min = MIN(a, b);
+            f->L4_dst_port_max = MAX(a, b);
         }
+        list->entries[i].entry_actions.action_flags =
+            actions[(r >> 16) % ARRAY_SIZE(actions)];
     }
-
-    return rc;
 }
 
-
 /*
- * Update port bitmap of classifier
+ * Return true if the FP supports the L4 port operations of 'ace'
  */
-static int
-ops_cls_update_classifier_in_asic(int                             hw_unit,
-                                  struct ops_classifier          *cls,
-                                  opennsl_pbmp_t                 *port_bmp,
-                                  enum ops_update_pbmp            action,
-                                  int                            *fail_index,
-                                  struct ops_cls_interface_info  *intf_info)
+static bool
+ops_cls_eval_ace_supported(const struct ops_cls_list_entry *ace)
 {
-    opennsl_error_t rc = OPENNSL_E_NONE;
-    struct ops_cls_hw_info *hw_info;
-    opennsl_pbmp_t pbmp;
+    const struct ops_cls_list_entry_match_fields *f = &ace->entry_fields;
 
-    if (intf_info && (intf_info->flags & OPS_CLS_INTERFACE_L3ONLY)) {
-        hw_info = &cls->route_cls;
-    } else {
-        hw_info = &cls->port_cls;
+    return (!(f->entry_flags & OPS_CLS_L4_SRC_PORT_VALID) ||
+            ops_cls_port_op_supported(f->L4_src_port_op)) &&
+           (!(f->entry_flags & OPS_CLS_L4_DEST_PORT_VALID) ||
+            ops_cls_port_op_supported(f->L4_dst_port_op));
+}
+
+/*
+ * Compile a synthetic ACL of 'n_aces' ACEs and evaluate 'n_packets'
+ * synthetic packets against the ACL and against its compiled entries,
+ * installed in list order as ops_cls_install_classifier_in_asic does.
+ * The install of an ACE the FP does not support fails, so packets decided
+ * by such an ACE are counted apart from the mismatches.
+ */
+void
+ops_cls_opennsl_eval_bench(struct ds *ds, int n_aces, int n_packets)
+{
+    enum { BATCH = 1024 };
+    struct ops_cls_eval_packet *pkts;
+    int aces[BATCH];
+    uint32_t actions[BATCH];
+    struct ops_classifier cls;
+    struct ops_cls_list list;
+    struct ops_cls_entry **entries, *entry;
+    long long int list_usec = 0, fp_usec = 0, start;
+    uint64_t mismatches = 0, unsupported = 0;
+    size_t n_entries = 0;
+    bool first = true;
+
+    if (n_aces <= 0 || n_aces > OPS_CLS_BENCH_MAX_ACES || n_packets <= 0) {
+        ds_put_format(ds, "ACEs must be 1-%d and packets positive\n",
+                      OPS_CLS_BENCH_MAX_ACES);
+        return;
     }
 
-    OPENNSL_PBMP_CLEAR(pbmp);
-    OPENNSL_PBMP_OR(pbmp, hw_info->pbmp);
-    switch (action) {
-    case OPS_PBMP_ADD:
-        OPENNSL_PBMP_OR(pbmp, *port_bmp);
-        rc = ops_cls_pbmp_update(hw_unit, cls, &pbmp, fail_index, intf_info);
-        if (OPENNSL_SUCCESS(rc)) {
-            OPENNSL_PBMP_ASSIGN(hw_info->pbmp, pbmp);
-        }
-        break;
+    pkts = xmalloc(BATCH * sizeof *pkts);
+    memset(&cls, 0, sizeof cls);
+    memset(&list, 0, sizeof list);
+    cls.name = CONST_CAST(char *, "acl-verify-bench");
+    list_init(&cls.cls_entry_list);
+
+    ops_cls_eval_gen_list(&list, n_aces);
+    start = time_usec();
+    ops_cls_populate_entries(&cls, &cls.cls_entry_list, &list);
+    ops_cls_compile_entries(&cls, &cls.cls_entry_list, &cls.compile);
+    ds_put_format(ds, "%d ACEs compiled into %u FP entries, %u range "
+                  "checkers in %lld us\n", n_aces, cls.compile.entries,
+                  cls.compile.range_checkers, time_usec() - start);
+    ds_put_format(ds, "%u FP entries not supported in hw\n",
+                  cls.compile.unsupported);
+
+    entries = xmalloc(list_size(&cls.cls_entry_list) * sizeof *entries);
+    LIST_FOR_EACH (entry, node, &cls.cls_entry_list) {
+        entries[n_entries++] = entry;
+    }
 
-    case OPS_PBMP_DEL:
-        /* check clasiifier is used as routed (L3) or port (L2) */
-        OPENNSL_PBMP_XOR(pbmp, *port_bmp);
-        if (OPENNSL_PBMP_IS_NULL(pbmp)) {
-            if (intf_info && (intf_info->flags & OPS_CLS_INTERFACE_L3ONLY)) {
-                VLOG_DBG("Routed port bit map is NULL, remove classifier %s "
-                          "routed rules in asic", cls->name);
-            } else {
-                VLOG_DBG("Port bit map is NULL, remove classifier %s "
-                          "port rules in asic", cls->name);
-            }
-            rc = ops_cls_delete_rules_in_asic(hw_unit, cls, fail_index,
-                                              intf_info, FALSE);
-        } else {
-            rc = ops_cls_pbmp_update(hw_unit, cls, &pbmp, fail_index,
-                                     intf_info);
-        }
+    for (int done = 0; done < n_packets; done += BATCH) {
+        int n = MIN(BATCH, n_packets - done);
 
-        if (OPENNSL_SUCCESS(rc)) {
-            OPENNSL_PBMP_ASSIGN(hw_info->pbmp, pbmp);
+        for (int i = 0; i < n; i++) {
+            ops_cls_eval_gen_packet(&list, &pkts[i]);
         }
 
-        if (OPENNSL_PBMP_IS_NULL(cls->port_cls.pbmp) &&
-            OPENNSL_PBMP_IS_NULL(cls->route_cls.pbmp)) {
-            VLOG_DBG("All port bit is NULL, remove classifer %s from hash",
-                     cls->name);
-            ops_cls_delete(cls);
+        start = time_usec();
+        for (int i = 0; i < n; i++) {
+            aces[i] = ops_cls_eval_list(&list, &pkts[i], &actions[i]);
         }
+        list_usec += time_usec() - start;
 
-        break;
+        start = time_usec();
+        for (int i = 0; i < n; i++) {
+            size_t j;
 
-    default:
-        break;
+            for (j = 0; j < n_entries; j++) {
+                if (ops_cls_eval_entry(entries[j], &pkts[i], false)) {
+                    break;
+                }
+            }
+            entry = j < n_entries ? entries[j] : NULL;
+            if (aces[i] >= 0 &&
+                !ops_cls_eval_ace_supported(&list.entries[aces[i]])) {
+                unsupported++;
+            } else if (!ops_cls_eval_agree(aces[i], actions[i], entry)) {
+                if (first) {
+                    ds_put_format(ds, "First mismatch: ");
+                    ops_cls_eval_format(ds, &pkts[i], aces[i], entry);
+                    ds_put_format(ds, "\n");
+                    first = false;
+                }
+                mismatches++;
+            }
+        }
+        fp_usec += time_usec() - start;
+    }
 
+    ds_put_format(ds, "%d packets, %"PRIu64" mismatches, %"PRIu64" matched "
+                  "by an entry not supported in hw\n", n_packets, mismatches,
+                  unsupported);
+    ds_put_format(ds, "ACL evaluation: %lld us", list_usec);
+    if (list_usec > 0) {
+        ds_put_format(ds, " (%lld packets/s)",
+                      (long long int) n_packets * 1000000 / list_usec);
+    }
+    ds_put_format(ds, "\nFP entry evaluation: %lld us", fp_usec);
+    if (fp_usec > 0) {
+        ds_put_format(ds, " (%lld packets/s)",
+                      (long long int) n_packets * 1000000 / fp_usec);
     }
+    ds_put_format(ds, "\n");
 
-    return rc;
+    free(entries);
+    ops_cls_cleanup_entries(&cls.cls_entry_list);
+    free(list.entries);
+    free(pkts);
 }
 
 /*
@@ -1428,6 +3264,7 @@ ops_cls_opennsl_apply(struct ops_cls_list            *list,
             }
             goto apply_fail;
         }
+        ops_cls_verify(cls, list);
     } else {
         /* already in asic update port bitmap */
         rc = ops_cls_update_classifier_in_asic(hw_unit, cls, &port_bmp,
@@ -1535,6 +3372,7 @@ ops_cls_opennsl_replace(const struct uuid               *list_id_orig,
     int fail_index = 0; /* rule index to PI on failure */
     bool *in_asic_orig = false;
     bool *in_asic_new = false;
+    struct ops_cls_hw_info *hw_orig;
 
     VLOG_DBG("Replace classifier "UUID_FMT" by "UUID_FMT"",
               UUID_ARGS(list_id_orig), UUID_ARGS(&list_new->list_id));
@@ -1568,6 +3406,9 @@ ops_cls_opennsl_replace(const struct uuid               *list_id_orig,
         goto replace_fail;
     }
 
+    /* the entries of the original classifier may be taken over */
+    ops_cls_pbmp_flush(cls_orig);
+
     VLOG_DBG("Replace classifier %s with %s on port(s) [ %s ]",
              cls_orig->name, cls_new->name,
              ops_cls_display_port_bit_map(&port_bmp, pbmp_string, 200));
@@ -1577,26 +3418,46 @@ ops_cls_opennsl_replace(const struct uuid               *list_id_orig,
                   cls_orig->name, cls_new->name);
         in_asic_orig = &cls_orig->route_cls.in_asic;
         in_asic_new = &cls_new->route_cls.in_asic;
+        hw_orig = &cls_orig->route_cls;
     } else {
         VLOG_DBG("Replace %s classifier and  apply %s as port classifier",
                   cls_orig->name, cls_new->name);
         in_asic_orig = &cls_orig->port_cls.in_asic;
         in_asic_new = &cls_new->port_cls.in_asic;
+        hw_orig = &cls_orig->port_cls;
     }
 
 
     if (!(*in_asic_new)) {
-        /* first binding of classifier*/
-        rc = ops_cls_install_classifier_in_asic(hw_unit, cls_new,
-                                                &cls_new->cls_entry_list,
-                                                &port_bmp, &fail_index,
-                                                FALSE, interface_info);
+        struct ops_cls_diff diff;
+
+        /* first binding of classifier. If the original classifier is only
+         * applied to these port(s) its entries go away with this replace,
+         * take over the identical ones instead of installing them again */
+        memset(&diff, 0, sizeof diff);
+        if (*in_asic_orig && cls_orig != cls_new &&
+            OPENNSL_PBMP_EQ(hw_orig->pbmp, port_bmp) &&
+            ops_cls_diff_plan(&diff, hw_orig, &cls_new->cls_entry_list)) {
+            rc = ops_cls_diff_install(hw_unit, cls_new, &diff, &port_bmp,
+                                      &fail_index, FALSE, interface_info);
+            if (!ops_cls_error(rc)) {
+                ops_cls_diff_commit(cls_new, &diff, FALSE, true, hw_unit,
+                                    interface_info);
+            }
+        } else {
+            rc = ops_cls_install_classifier_in_asic(hw_unit, cls_new,
+                                                    &cls_new->cls_entry_list,
+                                                    &port_bmp, &fail_index,
+                                                    FALSE, interface_info);
+        }
+        ops_cls_diff_destroy(&diff);
         if (ops_cls_error(rc)) {
             int index = 0;
             ops_cls_delete_rules_in_asic(hw_unit, cls_new, &index,
                                          interface_info, FALSE);
             goto replace_fail;
         }
+        ops_cls_verify(cls_new, list_new);
     } else {
         /* already in asic update port bitmap */
         rc = ops_cls_update_classifier_in_asic(hw_unit, cls_new, &port_bmp,
@@ -1638,6 +3499,9 @@ ops_cls_opennsl_list_update(struct ops_cls_list                 *list,
     opennsl_pbmp_t port_bmp;
     int fail_index = 0; /* rule index to PI on failure */
     struct ops_cls_interface_info intf_info;
+    struct ops_cls_compile_stats compile;
+    struct ops_cls_diff port_diff, route_diff;
+    bool incremental = true;
 
     VLOG_DBG("Update classifier "UUID_FMT" (%s)", UUID_ARGS(&list->list_id),
              list->list_name);
@@ -1651,6 +3515,9 @@ ops_cls_opennsl_list_update(struct ops_cls_list                 *list,
         VLOG_DBG("Classifier %s exist in haspmap", list->list_name);
     }
 
+    /* kept entries must carry the current port bitmap */
+    ops_cls_pbmp_flush(cls);
+
     if (cls->route_cls.in_asic) {
         intf_info.flags = OPS_CLS_INTERFACE_L3ONLY;
     }
@@ -1665,28 +3532,55 @@ ops_cls_opennsl_list_update(struct ops_cls_list                 *list,
          */
 
         ops_cls_populate_entries(cls, &cls->cls_entry_update_list, list);
+        ops_cls_compile_entries(cls, &cls->cls_entry_update_list, &compile);
+
+        memset(&port_diff, 0, sizeof port_diff);
+        memset(&route_diff, 0, sizeof route_diff);
+
+        /* Only install what changed if the new entries fit in the
+         * priority gaps of the kept ones, otherwise reinstall all */
+        if (cls->port_cls.in_asic) {
+            incremental &= ops_cls_diff_plan(&port_diff, &cls->port_cls,
+                                             &cls->cls_entry_update_list);
+        }
+        if (cls->route_cls.in_asic) {
+            incremental &= ops_cls_diff_plan(&route_diff, &cls->route_cls,
+                                             &cls->cls_entry_update_list);
+        }
 
         if (cls->port_cls.in_asic) {
             OPENNSL_PBMP_CLEAR(port_bmp);
             OPENNSL_PBMP_ASSIGN(port_bmp, cls->port_cls.pbmp);
 
-            rc = ops_cls_install_classifier_in_asic(hw_unit, cls,
+            if (incremental) {
+                rc = ops_cls_diff_install(hw_unit, cls, &port_diff,
+                                          &port_bmp, &fail_index, TRUE, NULL);
+            } else {
+                rc = ops_cls_install_classifier_in_asic(hw_unit, cls,
                                                     &cls->cls_entry_update_list,
                                                     &port_bmp, &fail_index,
                                                     TRUE, NULL);
+            }
         }
 
         if (!ops_cls_error(rc) && cls->route_cls.in_asic) {
             OPENNSL_PBMP_CLEAR(port_bmp);
             OPENNSL_PBMP_ASSIGN(port_bmp, cls->route_cls.pbmp);
-            rc = ops_cls_install_classifier_in_asic(hw_unit, cls,
+            if (incremental) {
+                rc = ops_cls_diff_install(hw_unit, cls, &route_diff,
+                                          &port_bmp, &fail_index, TRUE,
+                                          &intf_info);
+            } else {
+                rc = ops_cls_install_classifier_in_asic(hw_unit, cls,
                                                     &cls->cls_entry_update_list,
                                                     &port_bmp, &fail_index,
                                                     TRUE, &intf_info);
+            }
         }
 
         int index = 0;
         if(ops_cls_error(rc)) {
+            /* only new entries are in the update lists at this point */
             if (cls->port_cls.in_asic) {
                 ops_cls_delete_rules_in_asic(hw_unit, cls, &index,
                                              NULL, TRUE);
@@ -1697,8 +3591,37 @@ ops_cls_opennsl_list_update(struct ops_cls_list                 *list,
                                              &intf_info, TRUE);
             }
             ops_cls_delete_updated_entries(cls);
+            ops_cls_diff_destroy(&port_diff);
+            ops_cls_diff_destroy(&route_diff);
             goto update_fail;
         } else {
+            struct ops_cls_update_stats *us = &cls->update;
+
+            us->updates++;
+            us->kept = 0;
+            us->removed = list_size(&cls->port_cls.rule_index_list)
+                          + list_size(&cls->route_cls.rule_index_list);
+            if (incremental) {
+                if (cls->port_cls.in_asic) {
+                    ops_cls_diff_commit(cls, &port_diff, TRUE, false,
+                                        hw_unit, NULL);
+                }
+                if (cls->route_cls.in_asic) {
+                    ops_cls_diff_commit(cls, &route_diff, TRUE, false,
+                                        hw_unit, &intf_info);
+                }
+                us->kept = port_diff.n_kept + route_diff.n_kept;
+                us->removed -= us->kept;
+            } else {
+                us->full++;
+            }
+            us->installed = list_size(&cls->port_cls.rule_index_update_list)
+                            + list_size(&cls->route_cls.rule_index_update_list)
+                            - us->kept;
+            ops_cls_diff_destroy(&port_diff);
+            ops_cls_diff_destroy(&route_diff);
+
+            /* remove the obsolete entries */
             if (cls->port_cls.in_asic) {
                 ops_cls_delete_rules_in_asic(hw_unit, cls, &index,
                                              NULL, FALSE);
@@ -1710,6 +3633,8 @@ ops_cls_opennsl_list_update(struct ops_cls_list                 *list,
             }
             ops_cls_delete_orig_entries(cls);
             ops_cls_update_entries(cls);
+            cls->compile = compile;
+            ops_cls_verify(cls, list);
         }
 
     }
@@ -1740,7 +3665,6 @@ ops_cls_opennsl_statistics_get(const struct uuid              *list_id,
     opennsl_pbmp_t port_bmp;
     uint64 packets = 0;
     struct ops_cls_stats_entry *sentry = NULL, *next_sentry;
-    opennsl_field_stat_t stats_type = opennslFieldStatPackets;
     struct ovs_list *stats_index_listp;
 
     VLOG_DBG("Get stats classifier "UUID_FMT"", UUID_ARGS(list_id));
@@ -1770,7 +3694,7 @@ ops_cls_opennsl_statistics_get(const struct uuid              *list_id,
 
     LIST_FOR_EACH_SAFE(sentry, next_sentry, node, stats_index_listp) {
         if (sentry && sentry->rule_index < num_entries) {
-            rc = opennsl_field_stat_get(hw_unit, sentry->index, stats_type, &packets);
+            rc = ops_cls_stats_cache_get(hw_unit, sentry->index, &packets);
             if (OPENNSL_FAILURE(rc)) {
                 VLOG_ERR("Failed to get packets stats for stats index"
                          " %d in classifier %s rc:%s",
@@ -1845,6 +3769,7 @@ ops_cls_opennsl_statistics_clear(const struct uuid               *list_id,
             fail_index = sentry->rule_index;
             goto stats_clear_fail;
         }
+        ops_cls_stats_cache_set(hw_unit, sentry->index, value);
         VLOG_DBG("Clear hit count: stats index %d", sentry->index);
     }
 
@@ -1874,64 +3799,442 @@ ops_cls_opennsl_acl_log_pkt_register_cb(void (*callback_handler)(struct acl_log_
     return OPS_CLS_OK;
 }
 
+/*
+ * Dump the predicted hardware cost and the last update of each classifier
+ */
+void
+ops_cls_opennsl_compile_dump(struct ds *ds)
+{
+    struct ops_classifier *cls;
+
+    ds_put_format(ds, "%-24s %6s %7s %8s %9s %6s %8s %7s %6s %11s\n",
+                  "Classifier", "ACEs", "No-act", "Shadowed", "Redundant",
+                  "Merged", "Expanded", "Entries", "Ranges", "Unsupported");
+    HMAP_FOR_EACH (cls, node, &classifier_map) {
+        const struct ops_cls_compile_stats *c = &cls->compile;
+
+        ds_put_format(ds, "%-24s %6u %7u %8u %9u %6u %8u %7u %6u %11u\n",
+                      cls->name, c->aces, c->no_action, c->shadowed,
+                      c->redundant, c->merged, c->expanded, c->entries,
+                      c->range_checkers, c->unsupported);
+    }
+
+    ds_put_format(ds, "\n%-24s %7s %6s %6s %9s %7s\n", "Classifier",
+                  "Updates", "Full", "Kept", "Installed", "Removed");
+    HMAP_FOR_EACH (cls, node, &classifier_map) {
+        const struct ops_cls_update_stats *u = &cls->update;
+
+        ds_put_format(ds, "%-24s %7u %6u %6u %9u %7u\n", cls->name,
+                      u->updates, u->full, u->kept, u->installed,
+                      u->removed);
+    }
+    for (int unit = 0; unit < MAX_SWITCH_UNITS; unit++) {
+        ds_put_format(ds, "Unit %d: %d of %d IPv4 ACL entries installed\n",
+                      unit, cls_ingress_ipv4_rule_count[unit],
+                      MAX_INGRESS_IPv4_ACL_RULES);
+    }
+}
+
+/*
+ * Write the port bitmaps of the classifiers whose batching window expired
+ */
+void
+ops_cls_run(void)
+{
+    long long int now = time_msec();
+
+    if (now >= cls_pbmp_flush_time) {
+        ops_cls_pbmp_flush_all();
+    }
+
+    if (cls_stats_interval_ms && now >= cls_stats_next_sweep) {
+        ops_cls_stats_sweep();
+        cls_stats_next_sweep = now + cls_stats_interval_ms;
+    }
+}
+
+void
+ops_cls_wait(void)
+{
+    if (cls_pbmp_flush_time != LLONG_MAX) {
+        poll_timer_wait_until(cls_pbmp_flush_time);
+    }
+    if (cls_stats_interval_ms) {
+        poll_timer_wait_until(cls_stats_next_sweep);
+    }
+}
+
+int
+ops_cls_opennsl_stats_cache_set_interval(int msec)
+{
+    if (msec < 0) {
+        return OPS_CLS_FAIL;
+    }
+
+    cls_stats_interval_ms = msec;
+    cls_stats_next_sweep = time_msec() + msec;
+    return OPS_CLS_OK;
+}
+
+void
+ops_cls_opennsl_stats_cache_refresh(void)
+{
+    ops_cls_stats_sweep();
+    if (cls_stats_interval_ms) {
+        cls_stats_next_sweep = time_msec() + cls_stats_interval_ms;
+    }
+}
+
+void
+ops_cls_opennsl_stats_cache_dump(struct ds *ds)
+{
+    int cached = 0;
+
+    for (int unit = 0; unit < MAX_SWITCH_UNITS; unit++) {
+        const struct ops_cls_stats_cache *cache = &cls_stats_cache[unit];
+
+        for (int i = 0; i < cache->n_stats; i++) {
+            cached += cache->stats[i].valid;
+        }
+    }
+
+    if (cls_stats_interval_ms) {
+        ds_put_format(ds, "ACL hit counts swept every %d ms\n",
+                      cls_stats_interval_ms);
+    } else {
+        ds_put_format(ds, "ACL hit count cache disabled\n");
+    }
+    ds_put_format(ds, "Cached stats %d\n", cached);
+    ds_put_format(ds, "Sweeps %"PRIu64", counter reads %"PRIu64
+                  ", failed reads %"PRIu64", last sweep %lld us\n",
+                  cls_stats_sweep.sweeps, cls_stats_sweep.reads,
+                  cls_stats_sweep.failures, cls_stats_sweep.last_usec);
+    ds_put_format(ds, "Requested stats served from cache %"PRIu64
+                  ", read directly %"PRIu64"\n",
+                  cls_stats_sweep.hits, cls_stats_sweep.misses);
+}
+
+int
+ops_cls_opennsl_pbmp_batch_set(int msec)
+{
+    if (msec < 0 || msec > OPS_CLS_PBMP_BATCH_MAX_MS) {
+        return OPS_CLS_FAIL;
+    }
+
+    cls_pbmp_batch_ms = msec;
+    if (!msec) {
+        ops_cls_pbmp_flush_all();
+    }
+    return OPS_CLS_OK;
+}
+
+static void
+ops_cls_pbmp_timing_dump(struct ds *ds, const char *name,
+                         const struct ops_cls_pbmp_timing *t)
+{
+    ds_put_format(ds, "%-12s %8"PRIu64" %10"PRIu64" %12lld %10lld %10lld\n",
+                  name, t->passes, t->reinstalls, t->usec,
+                  t->passes ? t->usec / (long long int) t->passes : 0,
+                  t->max_usec);
+}
+
+void
+ops_cls_opennsl_pbmp_batch_dump(struct ds *ds)
+{
+    const struct ops_cls_pbmp_stats *s = &cls_pbmp_stats;
+    struct ops_classifier *cls;
+    int pending = 0;
+
+    HMAP_FOR_EACH (cls, node, &classifier_map) {
+        pending += cls->port_cls.pbmp_pending + cls->route_cls.pbmp_pending;
+    }
+
+    if (cls_pbmp_batch_ms) {
+        ds_put_format(ds, "Port bitmap updates batched for %d ms\n",
+                      cls_pbmp_batch_ms);
+    } else {
+        ds_put_format(ds, "Port bitmap updates applied synchronously\n");
+    }
+    ds_put_format(ds, "Requests %"PRIu64", deferred %"PRIu64", "
+                  "failed batches %"PRIu64", pending %d\n\n",
+                  s->requests, s->deferred, s->failures, pending);
+    ds_put_format(ds, "%-12s %8s %10s %12s %10s %10s\n", "Path", "Passes",
+                  "Reinstalls", "Total(us)", "Avg(us)", "Max(us)");
+    ops_cls_pbmp_timing_dump(ds, "synchronous", &s->sync);
+    ops_cls_pbmp_timing_dump(ds, "batched", &s->batch);
+}
+
+void
+ops_cls_opennsl_pbmp_batch_stats_clear(void)
+{
+    memset(&cls_pbmp_stats, 0, sizeof cls_pbmp_stats);
+}
+
 int
 register_ops_cls_plugin()
 {
     return (register_plugin_extension(&ops_cls_extension));
 }
 
+/*
+ * ACL logging.
+ *
+ * Packets copied to the CPU by logging ACEs are admitted by a token bucket
+ * and stored as acl_log_info records in a bounded ring. The PI code is
+ * still notified of every admitted record through the registered callback
+ * and can collect all the records queued since its last visit in one
+ * batch with ops_cls_opennsl_acl_log_pkt_drain(). When the ring is full
+ * the oldest record is overwritten. Packets over the rate are counted per
+ * rule (ASIC match id) and per ingress port.
+ */
+struct acl_log_rule_stats {
+    struct hmap_node node;      /* In 'acl_log_rules', hashed by 'rule_id'. */
+    uint32_t rule_id;
+    uint64_t admitted;
+    uint64_t suppressed;
+};
+
+struct acl_log_port_stats {
+    uint64_t admitted;
+    uint64_t suppressed;
+};
+
+static struct ovs_mutex acl_log_mutex = OVS_MUTEX_INITIALIZER;
+static struct acl_log_info acl_log_ring[ACL_LOG_RING_SIZE]
+    OVS_GUARDED_BY(acl_log_mutex);
+static unsigned int acl_log_head OVS_GUARDED_BY(acl_log_mutex);
+static unsigned int acl_log_tail OVS_GUARDED_BY(acl_log_mutex);
+static struct token_bucket acl_log_tb OVS_GUARDED_BY(acl_log_mutex)
+    = TOKEN_BUCKET_INIT(ACL_LOG_DFLT_RATE,
+                        ACL_LOG_DFLT_BURST * ACL_LOG_TOKENS);
+static unsigned int acl_log_rate OVS_GUARDED_BY(acl_log_mutex)
+    = ACL_LOG_DFLT_RATE;
+static unsigned int acl_log_burst OVS_GUARDED_BY(acl_log_mutex)
+    = ACL_LOG_DFLT_BURST;
+static struct hmap acl_log_rules OVS_GUARDED_BY(acl_log_mutex)
+    = HMAP_INITIALIZER(&acl_log_rules);
+static struct acl_log_port_stats
+    acl_log_ports[MAX_SWITCH_UNITS][MAX_HW_PORTS] OVS_GUARDED_BY(acl_log_mutex);
+static uint64_t acl_log_received OVS_GUARDED_BY(acl_log_mutex);
+static uint64_t acl_log_admitted OVS_GUARDED_BY(acl_log_mutex);
+static uint64_t acl_log_suppressed OVS_GUARDED_BY(acl_log_mutex);
+static uint64_t acl_log_overwritten OVS_GUARDED_BY(acl_log_mutex);
+static uint64_t acl_log_drained OVS_GUARDED_BY(acl_log_mutex);
+
+static struct acl_log_rule_stats *
+acl_log_rule_stats_get(uint32_t rule_id)
+    OVS_REQUIRES(acl_log_mutex)
+{
+    struct acl_log_rule_stats *rule;
+
+    HMAP_FOR_EACH_WITH_HASH (rule, node, hash_int(rule_id, 0),
+                             &acl_log_rules) {
+        if (rule->rule_id == rule_id) {
+            return rule;
+        }
+    }
+
+    rule = xzalloc(sizeof *rule);
+    rule->rule_id = rule_id;
+    hmap_insert(&acl_log_rules, &rule->node, hash_int(rule_id, 0));
+
+    return rule;
+}
+
+/* Runs the admission control for a logging packet of 'rule_id' received
+ * on 'port' and updates the counters. Returns true if the packet must be
+ * logged. */
+static bool
+acl_log_admit(int unit, int port, uint32_t rule_id)
+    OVS_REQUIRES(acl_log_mutex)
+{
+    struct acl_log_rule_stats *rule = acl_log_rule_stats_get(rule_id);
+    struct acl_log_port_stats *port_stats = NULL;
+    bool admit;
+
+    if (VALID_HW_UNIT(unit) && VALID_HW_UNIT_PORT(unit, port)) {
+        port_stats = &acl_log_ports[unit][port];
+    }
+
+    acl_log_received++;
+    admit = token_bucket_withdraw(&acl_log_tb, ACL_LOG_TOKENS);
+    if (admit) {
+        acl_log_admitted++;
+        rule->admitted++;
+        if (port_stats) {
+            port_stats->admitted++;
+        }
+    } else {
+        acl_log_suppressed++;
+        rule->suppressed++;
+        if (port_stats) {
+            port_stats->suppressed++;
+        }
+    }
+
+    return admit;
+}
+
+static void
+acl_log_ring_push(const struct acl_log_info *info)
+    OVS_REQUIRES(acl_log_mutex)
+{
+    if (acl_log_head - acl_log_tail >= ACL_LOG_RING_SIZE) {
+        acl_log_tail++;
+        acl_log_overwritten++;
+    }
+    acl_log_ring[acl_log_head++ % ACL_LOG_RING_SIZE] = *info;
+}
+
+int
+ops_cls_opennsl_acl_log_pkt_drain(struct acl_log_info *records,
+                                  int max_records)
+{
+    int n = 0;
+
+    if (!records || max_records <= 0) {
+        return 0;
+    }
+
+    ovs_mutex_lock(&acl_log_mutex);
+    while (n < max_records && acl_log_tail != acl_log_head) {
+        records[n++] = acl_log_ring[acl_log_tail++ % ACL_LOG_RING_SIZE];
+    }
+    acl_log_drained += n;
+    ovs_mutex_unlock(&acl_log_mutex);
+
+    return n;
+}
+
+int
+ops_cls_opennsl_acl_log_set_rate(unsigned int rate, unsigned int burst)
+{
+    if (!rate || rate > INT_MAX || !burst
+        || burst > UINT_MAX / ACL_LOG_TOKENS) {
+        return OPS_CLS_FAIL;
+    }
+
+    ovs_mutex_lock(&acl_log_mutex);
+    acl_log_rate = rate;
+    acl_log_burst = burst;
+    token_bucket_set(&acl_log_tb, rate, burst * ACL_LOG_TOKENS);
+    ovs_mutex_unlock(&acl_log_mutex);
+
+    return OPS_CLS_OK;
+}
+
+void
+ops_cls_opennsl_acl_log_stats_clear(void)
+{
+    struct acl_log_rule_stats *rule, *next;
+
+    ovs_mutex_lock(&acl_log_mutex);
+    HMAP_FOR_EACH_SAFE (rule, next, node, &acl_log_rules) {
+        hmap_remove(&acl_log_rules, &rule->node);
+        free(rule);
+    }
+    memset(acl_log_ports, 0, sizeof acl_log_ports);
+    acl_log_received = acl_log_admitted = acl_log_suppressed = 0;
+    acl_log_overwritten = acl_log_drained = 0;
+    ovs_mutex_unlock(&acl_log_mutex);
+}
+
+void
+ops_cls_opennsl_acl_log_dump(struct ds *ds)
+{
+    struct acl_log_rule_stats *rule;
+    struct acl_log_port_stats *port_stats;
+    char port_name[PORT_NAME_SIZE + 1];
+    int unit, port;
+
+    ovs_mutex_lock(&acl_log_mutex);
+    ds_put_format(ds, "ACL logging rate %u records/s, burst %u\n",
+                  acl_log_rate, acl_log_burst);
+    ds_put_format(ds, "Ring: %u of %d records queued\n",
+                  acl_log_head - acl_log_tail, ACL_LOG_RING_SIZE);
+    ds_put_format(ds, "Received %"PRIu64", admitted %"PRIu64", suppressed "
+                  "%"PRIu64", overwritten %"PRIu64", drained %"PRIu64"\n",
+                  acl_log_received, acl_log_admitted, acl_log_suppressed,
+                  acl_log_overwritten, acl_log_drained);
+
+    ds_put_format(ds, "\n%-10s %12s %12s\n", "Rule", "Admitted",
+                  "Suppressed");
+    HMAP_FOR_EACH (rule, node, &acl_log_rules) {
+        ds_put_format(ds, "%-10"PRIu32" %12"PRIu64" %12"PRIu64"\n",
+                      rule->rule_id, rule->admitted, rule->suppressed);
+    }
+
+    ds_put_format(ds, "\n%-10s %12s %12s\n", "Port", "Admitted",
+                  "Suppressed");
+    for (unit = 0; unit < MAX_SWITCH_UNITS; unit++) {
+        for (port = 0; port < MAX_HW_PORTS; port++) {
+            port_stats = &acl_log_ports[unit][port];
+            if (!port_stats->admitted && !port_stats->suppressed) {
+                continue;
+            }
+            memset(port_name, 0, sizeof port_name);
+            netdev_port_name_from_hw_id(unit, port, port_name);
+            ds_put_format(ds, "%-10s %12"PRIu64" %12"PRIu64"\n",
+                          port_name[0] ? port_name : "-",
+                          port_stats->admitted, port_stats->suppressed);
+        }
+    }
+    ovs_mutex_unlock(&acl_log_mutex);
+}
+
 void
 acl_log_handle_rx_event(opennsl_pkt_t *pkt)
 {
-    static long long int last_pkt_rxd_time = 0;
-    long long int cur_time;
-    static uint64_t pkt_counter = 0;
+    struct acl_log_info pkt_info = { .valid_fields = 0 };
+    char   port_name[PORT_NAME_SIZE+1] = { 0 };
+    bool admit;
 
     if (!pkt) {
         VLOG_ERR("Acl logging received invalid pkt from the ASIC");
         return;
     }
 
-    pkt_counter++;
-    cur_time = time_msec();
-    /* ignore packets received within a small time window after the last ACL
-     * logging packet
-     */
-    if (cur_time >= (last_pkt_rxd_time + ACL_LOGGING_MIN_MS_BETWEEN_PKTS)) {
-        struct acl_log_info pkt_info = { .valid_fields = 0 };
-        char   port_name[PORT_NAME_SIZE+1] = { 0 };
-
-        VLOG_DBG("ACL logging packet of length %d received; "
-                "total packets received so far %lu", pkt->pkt_len, pkt_counter);
-        last_pkt_rxd_time = cur_time;
-
-        /* fill in the acl_log_info struct */
-        /* first fill in fields only available from the ASIC */
-        pkt_info.ingress_port  = pkt->src_port;
-        netdev_port_name_from_hw_id(pkt->unit, pkt->src_port,
-                                    port_name);
-        snprintf(pkt_info.ingress_port_name,
-                 sizeof(pkt_info.ingress_port_name), port_name);
-        pkt_info.ingress_port_name[sizeof(pkt_info.ingress_port_name)-1] = 0;
-        pkt_info.valid_fields |= ACL_LOG_INGRESS_PORT;
-        pkt_info.egress_port   = pkt->dest_port;
-        pkt_info.valid_fields |= ACL_LOG_EGRESS_PORT;
-        pkt_info.ingress_vlan  = pkt->vlan;
-        pkt_info.valid_fields |= ACL_LOG_INGRESS_VLAN;
-        pkt_info.node          = pkt->unit;
-        pkt_info.valid_fields |= ACL_LOG_NODE;
-        pkt_info.in_cos        = pkt->cos;
-        pkt_info.valid_fields |= ACL_LOG_IN_COS;
-
-        /* fill in fields related to packet data */
-        pkt_info.total_pkt_len = pkt->tot_len;
-        pkt_info.pkt_buffer_len = MIN(pkt->pkt_len, sizeof(pkt_info.pkt_data));
-        pkt_info.pkt_buffer_len =
-            MIN(pkt->pkt_data[0].len, pkt_info.pkt_buffer_len);
-        memcpy(&pkt_info.pkt_data, pkt->pkt_data[0].data,
-                pkt_info.pkt_buffer_len);
-
-        /* submit packet data for PI code to retrieve */
+    ovs_mutex_lock(&acl_log_mutex);
+    admit = acl_log_admit(pkt->unit, pkt->src_port, pkt->rx_matched);
+    ovs_mutex_unlock(&acl_log_mutex);
+    if (!admit) {
+        return;
+    }
+
+    VLOG_DBG("ACL logging packet of length %d received", pkt->pkt_len);
+
+    /* fill in the acl_log_info struct */
+    /* first fill in fields only available from the ASIC */
+    pkt_info.ingress_port  = pkt->src_port;
+    netdev_port_name_from_hw_id(pkt->unit, pkt->src_port,
+                                port_name);
+    snprintf(pkt_info.ingress_port_name,
+             sizeof(pkt_info.ingress_port_name), "%s", port_name);
+    pkt_info.ingress_port_name[sizeof(pkt_info.ingress_port_name)-1] = 0;
+    pkt_info.valid_fields |= ACL_LOG_INGRESS_PORT;
+    pkt_info.egress_port   = pkt->dest_port;
+    pkt_info.valid_fields |= ACL_LOG_EGRESS_PORT;
+    pkt_info.ingress_vlan  = pkt->vlan;
+    pkt_info.valid_fields |= ACL_LOG_INGRESS_VLAN;
+    pkt_info.node          = pkt->unit;
+    pkt_info.valid_fields |= ACL_LOG_NODE;
+    pkt_info.in_cos        = pkt->cos;
+    pkt_info.valid_fields |= ACL_LOG_IN_COS;
+
+    /* fill in fields related to packet data */
+    pkt_info.total_pkt_len = pkt->tot_len;
+    pkt_info.pkt_buffer_len = MIN(pkt->pkt_len, sizeof(pkt_info.pkt_data));
+    pkt_info.pkt_buffer_len =
+        MIN(pkt->pkt_data[0].len, pkt_info.pkt_buffer_len);
+    memcpy(&pkt_info.pkt_data, pkt->pkt_data[0].data,
+            pkt_info.pkt_buffer_len);
+
+    ovs_mutex_lock(&acl_log_mutex);
+    acl_log_ring_push(&pkt_info);
+    ovs_mutex_unlock(&acl_log_mutex);
+
+    /* submit packet data for PI code to retrieve */
+    if (acl_pd_log_pkt_data_set) {
         (*acl_pd_log_pkt_data_set)(&pkt_info);
     }
 }
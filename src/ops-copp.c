@@ -24,6 +24,7 @@
 #include <stdio.h>
 #include <errno.h>
 #include <assert.h>
+#include <inttypes.h>
 #include <util.h>
 #include <openvswitch/vlog.h>
 #include <opennsl/error.h>
@@ -32,9 +33,14 @@
 #include <opennsl/policer.h>
 #include <opennsl/pkt.h>
 #include <opennsl/rx.h>
+#include <opennsl/cosq.h>
+#include <opennsl/switch.h>
 #include "ops-copp.h"
+#include "ops-bcm-init.h"
 #include "eventlog.h"
 #include "ops-fp.h"
+#include "timeval.h"
+#include "poll-loop.h"
 
 /*
  * Logging module for CoPP.
@@ -59,10 +65,18 @@ static opennsl_field_group_t
 static int ops_copp_packet_class_rx_index[OPS_COPP_MAX_UNITS];
 
 /*
- * Macro for array of function pointers for qualifying different control
- * packet types in a control packet class in the ingress pipeline.
+ * Macros for declaring the rx rules, the egress FP rule and the ingress FP
+ * rules of a control packet class in the file ops-copp-defaults.h.
  */
-#define OPS_COPP_INGRESS_FUNC_POINTERS(...) {__VA_ARGS__}
+#define OPS_COPP_RX_RULES(...) {__VA_ARGS__}
+#define OPS_COPP_RX_REASON(rx_reason) {.valid = true, \
+                                       .has_reason = true, \
+                                       .reason = (rx_reason)}
+#define OPS_COPP_RX_PRIORITY(prio) {.valid = true, \
+                                    .int_prio = (prio), \
+                                    .int_prio_mask = 0xff}
+#define OPS_COPP_FP_RULE(...) {.valid = true, .qualifiers = {__VA_ARGS__}}
+#define OPS_COPP_INGRESS_RULES(...) {__VA_ARGS__}
 
 /*
  * Macro for populating the structure ops_copp_fp_rule_t with the default
@@ -74,23 +88,20 @@ static int ops_copp_packet_class_rx_index[OPS_COPP_MAX_UNITS];
  *    value.
  * 3. Egress rate is set to platform packet default value.
  * 4. Egress burst is set to platform packet default value.
- * 5. Global control packet rule programming function pointer is pointed to
- *    the control packet class programming function.
- * 6. Egress FP entry programming function pointer is pointed to the
- *    egress implementation function.
- * 7. Ingress FP entry  programming function pointer array is pointed to the
- *    ingress implementation function pointers.
+ * 5. Global rx rules mapping the control packet class to its CPU queue.
+ * 6. Qualifiers of the egress FP entry.
+ * 7. Qualifiers of each of the ingress FP entries.
  */
 #define OPS_DEF_COPP_CLASS(id,packet_name,queue,rate,\
-                           burst,packet_class_func,\
-                           egress_func,ingress_func) {\
+                           burst,rx_rules,\
+                           egress_rule,ingress_rules) {\
                            .ops_copp_packet_name=packet_name,\
                            .ops_copp_ingress_fp_queue_number=queue, \
                            .ops_copp_egress_fp_rate=rate, \
                            .ops_copp_egress_fp_burst=burst, \
-                           .ops_copp_packet_class_function_pointer=packet_class_func,\
-                           .ops_copp_egress_fp_funtion_pointer=egress_func,\
-                           .ops_copp_ingress_fp_funtion_pointer=ingress_func},
+                           .ops_copp_rx_rules=rx_rules,\
+                           .ops_copp_egress_fp_rule=egress_rule,\
+                           .ops_copp_ingress_fp_rules=ingress_rules},
 /*
  * Static array for ingress and egress FP rules. The number of entries in
  * this array is equal to the number of control plane packet rules given
@@ -102,9 +113,13 @@ static struct ops_copp_fp_rule_t ops_copp_packet_class_t[] =
 };
 
 /*
- * If OPS_COPP_INGRESS_FUNC_POINTERS is already defined, then undefine it.
+ * Undefine the rule declaration macros used by ops-copp-defaults.h.
  */
-#undef OPS_COPP_INGRESS_FUNC_POINTERS
+#undef OPS_COPP_RX_RULES
+#undef OPS_COPP_RX_REASON
+#undef OPS_COPP_RX_PRIORITY
+#undef OPS_COPP_FP_RULE
+#undef OPS_COPP_INGRESS_RULES
 
 /*
  * If OPS_DEF_COPP_CLASS is already defined, then undefine it.
@@ -117,13 +132,6 @@ static struct ops_copp_fp_rule_t ops_copp_packet_class_t[] =
 #define PLUGIN_COPP_MAX_CLASSES  sizeof(ops_copp_packet_class_t)/\
                               sizeof(struct ops_copp_fp_rule_t)
 
-/*
- * Buffer for storing all the control plane packet configuration and
- * statistics.
- */
-char ops_copp_all_packet_stat_buffer[COPP_MAX_PACKET_STAT_BUFFER_SIZE
-                                     * PLUGIN_COPP_MAX_CLASSES];
-
 /*
  * Array of strings for names for CPU queue numbers
  */
@@ -381,6 +389,31 @@ ops_copp_get_packet_class_from_packet_name (char* packet_name)
     return(found_packet_class);
 }
 
+/*
+ * ops_copp_egress_policer_config
+ *
+ * This function fills the configuration of an egress policer with a given
+ * rate and burst.
+ */
+static void ops_copp_egress_policer_config (opennsl_policer_config_t* pol_cfg,
+                                            uint32 rate, uint32 burst)
+{
+    /*
+     * Intialize the policier configuration.
+     */
+    opennsl_policer_config_t_init(pol_cfg);
+
+    /*
+     * Populate the policier parameters with the rate and the
+     * burst values.
+     */
+    pol_cfg->mode = opennslPolicerModeSrTcm;
+    pol_cfg->ckbits_sec = rate; /*Eg: Limit = 100 pkts per sec */
+    pol_cfg->ckbits_burst = burst; /*Eg. burst = 100 pkts */
+    pol_cfg->flags = OPENNSL_POLICER_MODE_PACKETS;
+    pol_cfg->flags |= OPENNSL_POLICER_COLOR_BLIND;
+}
+
 /*
  * ops_copp_create_egress_policer_id
  *
@@ -400,20 +433,7 @@ static int ops_copp_create_egress_policer_id (
         return(OPS_COPP_FAILURE_CODE);
     }
 
-    /*
-     * Intialize the policier configuration.
-     */
-    opennsl_policer_config_t_init(&pol_cfg);
-
-    /*
-     * Populate the policier parameters with the rate and the
-     * burst values.
-     */
-    pol_cfg.mode = opennslPolicerModeSrTcm;
-    pol_cfg.ckbits_sec = rate; /*Eg: Limit = 100 pkts per sec */
-    pol_cfg.ckbits_burst = burst; /*Eg. burst = 100 pkts */
-    pol_cfg.flags = OPENNSL_POLICER_MODE_PACKETS;
-    pol_cfg.flags |= OPENNSL_POLICER_COLOR_BLIND;
+    ops_copp_egress_policer_config(&pol_cfg, rate, burst);
 
     memset(policer_id, 0, sizeof(opennsl_policer_t));
 
@@ -430,6 +450,38 @@ static int ops_copp_create_egress_policer_id (
     return(OPS_COPP_SUCCESS_CODE);
 }
 
+/*
+ * ops_copp_set_egress_policer
+ *
+ * This function changes the rate and the burst of an existing egress
+ * policer in place. The policer stays attached to its FP entry, so the
+ * packets are policed all along. This function is called per hardware
+ * unit.
+ */
+static int ops_copp_set_egress_policer (uint32 unit,
+                                        opennsl_policer_t* policer_id,
+                                        uint32 rate, uint32 burst)
+{
+    opennsl_policer_config_t   pol_cfg;
+    int32                      retval = -1;
+
+    if (!policer_id) {
+        VLOG_ERR("     Egress: The policer id is NULL");
+        return(OPS_COPP_FAILURE_CODE);
+    }
+
+    ops_copp_egress_policer_config(&pol_cfg, rate, burst);
+
+    retval = opennsl_policer_set(unit, *policer_id, &pol_cfg);
+    if (OPENNSL_FAILURE(retval)) {
+        VLOG_ERR("     Egress: Failed to set policer = %s\n",
+                 opennsl_errmsg(retval));
+        return(OPS_COPP_FAILURE_CODE);
+    }
+
+    return(OPS_COPP_SUCCESS_CODE);
+}
+
 /*
  * ops_copp_create_egress_stat_id
  *
@@ -533,32 +585,164 @@ static inline void ops_copp_fp_statid_cleanup (uint32 unit, int* stat_id)
 }
 
 /*
- * ops_copp_egress_fp_acl_logging
+ * Names of the CoPP FP qualifiers for the error logs and the footprint
+ * report.
+ */
+static const char* ops_copp_qualifier_name[OPS_COPP_QUALIFIER_MAX] = {
+                                    [OPS_COPP_QUALIFIER_NONE] = "none",
+                                    [OPS_COPP_QUALIFIER_ETHER_TYPE] =
+                                                          "ether type",
+                                    [OPS_COPP_QUALIFIER_PACKET_RES] =
+                                                          "packet resolution",
+                                    [OPS_COPP_QUALIFIER_DST_MAC] =
+                                                          "destination MAC",
+                                    [OPS_COPP_QUALIFIER_IP_TYPE] = "IP type",
+                                    [OPS_COPP_QUALIFIER_IP_PROTOCOL] =
+                                                          "IP protocol",
+                                    [OPS_COPP_QUALIFIER_IP6_NEXT_HEADER] =
+                                                          "IPv6 next header",
+                                    [OPS_COPP_QUALIFIER_L4_DST_PORT] =
+                                                          "L4 destination port",
+                                    [OPS_COPP_QUALIFIER_DST_IP_LOCAL] =
+                                                          "destination IP local",
+                                    [OPS_COPP_QUALIFIER_DST_IP] =
+                                                          "destination IP",
+                                    [OPS_COPP_QUALIFIER_DST_IP6] =
+                                                          "destination IPv6"};
+
+/*
+ * ops_copp_fp_qualify
+ *
+ * This function programs one qualifier of a CoPP rule into the FP
+ * entry 'fp_entry'.
+ */
+static int ops_copp_fp_qualify (uint32 unit,
+                                opennsl_field_entry_t fp_entry,
+                                const struct ops_copp_qualifier_t* qualifier)
+{
+    opennsl_mac_t          mac_addr;
+    opennsl_mac_t          mac_mask;
+    opennsl_ip6_t          ip6_addr;
+    opennsl_ip6_t          ip6_mask;
+    int32                  retval = OPENNSL_E_PARAM;
+
+    switch (qualifier->type) {
+        case OPS_COPP_QUALIFIER_ETHER_TYPE:
+            retval = opennsl_field_qualify_EtherType(unit, fp_entry,
+                                             qualifier->u.value.data,
+                                             qualifier->u.value.mask);
+            break;
+        case OPS_COPP_QUALIFIER_PACKET_RES:
+            retval = opennsl_field_qualify_PacketRes(unit, fp_entry,
+                                             qualifier->u.value.data,
+                                             qualifier->u.value.mask);
+            break;
+        case OPS_COPP_QUALIFIER_DST_MAC:
+            memcpy(mac_addr, qualifier->u.mac.addr, sizeof(mac_addr));
+            memcpy(mac_mask, qualifier->u.mac.mask, sizeof(mac_mask));
+            retval = opennsl_field_qualify_DstMac(unit, fp_entry,
+                                                  mac_addr, mac_mask);
+            break;
+        case OPS_COPP_QUALIFIER_IP_TYPE:
+            retval = opennsl_field_qualify_IpType(unit, fp_entry,
+                                                  qualifier->u.value.data);
+            break;
+        case OPS_COPP_QUALIFIER_IP_PROTOCOL:
+            retval = opennsl_field_qualify_IpProtocol(unit, fp_entry,
+                                             qualifier->u.value.data,
+                                             qualifier->u.value.mask);
+            break;
+        case OPS_COPP_QUALIFIER_IP6_NEXT_HEADER:
+            retval = opennsl_field_qualify_Ip6NextHeader(unit, fp_entry,
+                                             qualifier->u.value.data,
+                                             qualifier->u.value.mask);
+            break;
+        case OPS_COPP_QUALIFIER_L4_DST_PORT:
+            retval = opennsl_field_qualify_L4DstPort(unit, fp_entry,
+                                             qualifier->u.value.data,
+                                             qualifier->u.value.mask);
+            break;
+        case OPS_COPP_QUALIFIER_DST_IP_LOCAL:
+            retval = opennsl_field_qualify_DstIpLocal(unit, fp_entry,
+                                             qualifier->u.value.data,
+                                             qualifier->u.value.mask);
+            break;
+        case OPS_COPP_QUALIFIER_DST_IP:
+            retval = opennsl_field_qualify_DstIp(unit, fp_entry,
+                                        inet_network(qualifier->u.ip.addr),
+                                        inet_network(qualifier->u.ip.mask));
+            break;
+        case OPS_COPP_QUALIFIER_DST_IP6:
+            memcpy(ip6_addr, qualifier->u.ip6.addr, sizeof(ip6_addr));
+            memcpy(ip6_mask, qualifier->u.ip6.mask, sizeof(ip6_mask));
+            retval = opennsl_field_qualify_DstIp6(unit, fp_entry,
+                                                  ip6_addr, ip6_mask);
+            break;
+        default:
+            break;
+    }
+
+    return(retval);
+}
+
+/*
+ * ops_copp_fp_entry_qualify
  *
- * This function programs the qualifiers for identifying an ACL Logging
- * packet in egress pipeline.
+ * This function programs the qualifiers of the CoPP rule 'rule' into the
+ * FP entry 'fp_entry'. Egress entries are further qualified on the packet
+ * being destined to the CPU on the CPU queue set in ingress pipeline.
  */
-int ops_copp_egress_fp_acl_logging (uint32 unit,
-                                    opennsl_field_entry_t* egress_fp_entry,
-                                    uint8 ingress_cpu_queue_number)
-{
-    int32                      retval = -1;
-    opennsl_port_t             port = OPS_COPP_OUT_PORT;
-    opennsl_port_t             port_mask = OPS_COPP_OUT_PORT_MASK;
+static int ops_copp_fp_entry_qualify (
+                               uint32 unit,
+                               opennsl_field_entry_t* fp_entry,
+                               const struct ops_copp_fp_entry_spec_t* rule,
+                               bool egress,
+                               uint8 ingress_cpu_queue_number,
+                               const char* packet_name)
+{
+    const struct ops_copp_qualifier_t* qualifier;
+    const char*            pipeline = egress ? "Egress" : "Ingress";
+    int32                  retval = -1;
+    int                    index;
 
-    if (!egress_fp_entry) {
+    if (!fp_entry || !rule) {
         return(OPS_COPP_FAILURE_CODE);
     }
 
+    for (index = 0; index < OPS_COPP_MAX_QUALIFIERS; index++) {
+
+        qualifier = &rule->qualifiers[index];
+        if (qualifier->type == OPS_COPP_QUALIFIER_NONE) {
+            break;
+        }
+
+        if (qualifier->type >= OPS_COPP_QUALIFIER_MAX) {
+            VLOG_ERR("     %s: Invalid qualifier %d for %s\n", pipeline,
+                     qualifier->type, packet_name);
+            return(OPS_COPP_FAILURE_CODE);
+        }
+
+        retval = ops_copp_fp_qualify(unit, *fp_entry, qualifier);
+        if (OPENNSL_FAILURE(retval)) {
+            VLOG_ERR("     %s: Failed to qualify on %s for %s %s\n", pipeline,
+                     ops_copp_qualifier_name[qualifier->type], packet_name,
+                     opennsl_errmsg(retval));
+            return(OPS_COPP_FAILURE_CODE);
+        }
+    }
+
+    if (!egress) {
+        return(OPS_COPP_SUCCESS_CODE);
+    }
+
     /*
-     * Add the FP qualifier rules for ACL Logging. Qualify the ACL Logging
-     * on the following rules:-
-     * 1. The out port should be zero as the packet is destined to CPU.
-     * 2  The packet's meta data should contain the CPU queue set in ingress
-     *    pipeline.
+     * The out port should be zero as the packet is destined to CPU and
+     * the packet's meta data should contain the CPU queue set in ingress
+     * pipeline.
      */
-    retval = opennsl_field_qualify_OutPort(unit, *egress_fp_entry,
-                                           port, port_mask);
+    retval = opennsl_field_qualify_OutPort(unit, *fp_entry,
+                                           OPS_COPP_OUT_PORT,
+                                           OPS_COPP_OUT_PORT_MASK);
     if (OPENNSL_FAILURE(retval)) {
         VLOG_ERR("     Egress: Failed to qualify on out port %s\n",
                  opennsl_errmsg(retval));
@@ -566,7 +750,7 @@ int ops_copp_egress_fp_acl_logging (uint32 unit,
     }
 
     retval = opennsl_field_qualify_CpuQueue(unit,
-                             *egress_fp_entry, ingress_cpu_queue_number, 0xff);
+                             *fp_entry, ingress_cpu_queue_number, 0xff);
     if (OPENNSL_FAILURE(retval)) {
         VLOG_ERR("     Egress: Failed to qualify on CPU queue %s\n",
                  opennsl_errmsg(retval));
@@ -577,3252 +761,2230 @@ int ops_copp_egress_fp_acl_logging (uint32 unit,
 }
 
 /*
- * ops_copp_ingress_fp_broadcast_arp
+ * ops_copp_rx_rules_program
  *
- * This function programs the qualifiers for identifying an broadcast ARP
- * packet in ingress pipeline.
+ * This function programs the global rx rules of a control packet class,
+ * mapping the packets matching a rx reason or an internal priority to the
+ * CPU queue of the class.
  */
-int ops_copp_ingress_fp_broadcast_arp (
-                                      uint32 unit,
-                                      opennsl_field_entry_t* ingress_fp_entry)
+static int ops_copp_rx_rules_program (uint32 unit,
+                                      struct ops_copp_fp_rule_t* copp_class)
 {
-    int32                  retval = -1;
-    uint16                 ether_type = OPS_COPP_ARP_ETHER_TYPE;
-    uint16                 ether_mask = OPS_COPP_L2_ETHER_TYPE_MASK;
+    const struct ops_copp_rx_rule_t* rx_rule;
+    opennsl_rx_reasons_t    rx_reasons;
+    opennsl_rx_reasons_t    rx_reasons_mask;
+    int32                   retval = -1;
+    int                     index;
 
-    if (!ingress_fp_entry) {
-        return(OPS_COPP_FAILURE_CODE);
-    }
+    for (index = 0; index < OPS_COPP_MAX_RX_RULES; index++) {
 
-    /*
-     * Add the FP qualifier rules for broadcast ARP. Qualify the broadcast ARP
-     * on the following rules:-
-     * 1. Ethertype in L2 frame should be 0x0806
-     * 2. The destination MAC should be broadcast.
-     */
-    retval = opennsl_field_qualify_EtherType(unit, *ingress_fp_entry,
-                                             ether_type, ether_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on ether type for "
-                 "broadcast ARP %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
+        rx_rule = &copp_class->ops_copp_rx_rules[index];
+        if (!rx_rule->valid) {
+            break;
+        }
 
-    retval = opennsl_field_qualify_PacketRes(unit, *ingress_fp_entry,
-                                             OPENNSL_FIELD_PKT_RES_L2BC,
-                                             0xFFFFFFFF);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on broadcast "
-                 "destination MAC address %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
+        OPENNSL_RX_REASON_CLEAR_ALL(rx_reasons);
+        OPENNSL_RX_REASON_CLEAR_ALL(rx_reasons_mask);
+        if (rx_rule->has_reason) {
+            OPENNSL_RX_REASON_SET(rx_reasons, rx_rule->reason);
+            OPENNSL_RX_REASON_SET(rx_reasons_mask, rx_rule->reason);
+        }
+
+        retval = opennsl_rx_cosq_mapping_set(unit,
+                                 ops_copp_packet_class_rx_index[unit],
+                                 rx_reasons, rx_reasons_mask,
+                                 rx_rule->int_prio, rx_rule->int_prio_mask,
+                                 0, 0,
+                                 copp_class->ops_copp_ingress_fp_queue_number);
+        if (OPENNSL_FAILURE(retval)) {
+            VLOG_ERR("     Packet class: Failed to program the "
+                     "packet class rule %d for %s %s\n", index,
+                     copp_class->ops_copp_packet_name,
+                     opennsl_errmsg(retval));
+            return(OPS_COPP_FAILURE_CODE);
+        }
+
+        /*
+         * Increment the rx index counter
+         */
+        ops_copp_packet_class_rx_index[unit]++;
     }
 
     return(OPS_COPP_SUCCESS_CODE);
 }
 
 /*
- * ops_copp_egress_fp_broadcast_arp
+ * CoPP statistics collector.
  *
- * This function programs the qualifiers for identifying an broadcast ARP
- * packet in egress pipeline.
+ * switchd polls the stats and the hardware status of every control plane
+ * packet class separately. Instead of reading the FP counters of a class
+ * on each of these calls, the counters and the programmed queue, rate and
+ * burst of all the classes of a hardware unit are read in one sweep into
+ * a per-unit snapshot table. The table is refreshed at most once per
+ * 'ops_copp_stats_interval_ms', so a poll round of switchd costs a single
+ * sweep, and the getters only copy values out of the table.
  */
-int ops_copp_egress_fp_broadcast_arp (
-                                      uint32 unit,
-                                      opennsl_field_entry_t* egress_fp_entry,
-                                      uint8 ingress_cpu_queue_number)
-{
-    int32                      retval = -1;
-    uint16                     ether_type = OPS_COPP_ARP_ETHER_TYPE;
-    uint16                     ether_mask = OPS_COPP_L2_ETHER_TYPE_MASK;
-    opennsl_mac_t              ether_dst_mac = OPS_COPP_L2_BROADCAST_DEST;
-    opennsl_mac_t              ether_dst_mask = OPS_COPP_L2_ADDR_MASK;
-    opennsl_port_t             port = OPS_COPP_OUT_PORT;
-    opennsl_port_t             port_mask = OPS_COPP_OUT_PORT_MASK;
-
-    if (!egress_fp_entry) {
-        return(OPS_COPP_FAILURE_CODE);
-    }
+struct ops_copp_class_snapshot {
+    uint64      packets_allowed;
+    uint64      bytes_allowed;
+    uint64      packets_dropped;
+    uint64      bytes_dropped;
+    uint32      queue_number;
+    uint32      rate;
+    uint32      burst;
+    bool        stats_valid;   /* Counters were read in the last sweep. */
+    bool        hw_valid;      /* FP rules of the class are programmed. */
+};
 
-    /*
-     * Add the FP qualifier rules for broadcast ARP. Qualify the broadcast ARP
-     * on the following rules:-
-     * 1. Ethertype in L2 frame should be 0x0806
-     * 2. Check if the destination MAC in the L2 frame is broadcast.
-     * 3. The out port should be zero as the packet is destined to CPU.
-     * 4  The packet's meta data should contain the CPU queue set in ingress
-     *    pipeline.
-     */
-    retval = opennsl_field_qualify_EtherType(unit, *egress_fp_entry,
-                                             ether_type, ether_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on ether type for "
-                 "broadcast ARP %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
+struct ops_copp_stats_snapshot {
+    struct ops_copp_class_snapshot
+                classes[PLUGIN_COPP_MAX_CLASSES];
+    long long int
+                taken;         /* time_msec() of the last sweep. */
+    bool        valid;         /* False until swept or once invalidated. */
+    uint64      sweeps;        /* Number of sweeps of the unit. */
+    uint64      read_failures; /* Classes whose counters failed to read. */
+};
 
-    retval = opennsl_field_qualify_DstMac(unit, *egress_fp_entry,
-                                          ether_dst_mac, ether_dst_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on broadcast "
-                 "destination MAC address %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
+static struct ops_copp_stats_snapshot
+                    ops_copp_stats_table[OPS_COPP_MAX_UNITS];
 
-    retval = opennsl_field_qualify_OutPort(unit, *egress_fp_entry,
-                                           port, port_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on out port %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
+static long long int ops_copp_stats_interval_ms =
+                                        OPS_COPP_STATS_DFLT_INTERVAL_MS;
 
-    retval = opennsl_field_qualify_CpuQueue(unit,
-                             *egress_fp_entry, ingress_cpu_queue_number, 0xff);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on CPU queue %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
+/*
+ * Counters of the egress FP stat object, in the order they are stored in
+ * the snapshot.
+ */
+static const opennsl_field_stat_t ops_copp_snapshot_stats[] = {
+                                        opennslFieldStatGreenPackets,
+                                        opennslFieldStatGreenBytes,
+                                        opennslFieldStatRedPackets,
+                                        opennslFieldStatRedBytes
+                                                              };
 
-    return(OPS_COPP_SUCCESS_CODE);
+/*
+ * ops_copp_stats_invalidate
+ *
+ * This function marks the snapshot of a hardware unit stale, so that the
+ * next lookup sweeps the unit again. A negative unit invalidates the
+ * snapshots of all the hardware units.
+ */
+static void ops_copp_stats_invalidate (int unit)
+{
+    int unit_iterator;
+
+    for (unit_iterator = 0; unit_iterator < OPS_COPP_MAX_UNITS;
+                                                        ++unit_iterator) {
+        if ((unit < 0) || (unit == unit_iterator)) {
+            ops_copp_stats_table[unit_iterator].valid = false;
+        }
+    }
 }
 
 /*
- * ops_copp_ingress_fp_unicast_arp
+ * ops_copp_stats_sweep
  *
- * This function programs the qualifiers for identifying an unicast ARP
- * packet in ingress pipeline.
+ * This function reads the counters and the configuration of all the
+ * control plane packet classes of a hardware unit into its snapshot.
  */
-int ops_copp_ingress_fp_unicast_arp (uint32 unit,
-                                     opennsl_field_entry_t* ingress_fp_entry)
+static void ops_copp_stats_sweep (uint32 unit)
 {
-    int32                  retval = -1;
-    uint16                 ether_type = OPS_COPP_ARP_ETHER_TYPE;
-    uint16                 ether_mask = OPS_COPP_L2_ETHER_TYPE_MASK;
+    struct ops_copp_stats_snapshot*     snapshot;
+    struct ops_copp_class_snapshot*     class_snapshot;
+    struct ops_copp_fp_rule_t*          copp_packet_class;
+    uint64                              values[
+                                         ARRAY_SIZE(ops_copp_snapshot_stats)];
+    int                                 packet_class;
+    int                                 index;
+    int                                 retval = OPENNSL_E_NONE;
+
+    snapshot = &ops_copp_stats_table[unit];
+
+    for (packet_class = 0; packet_class < PLUGIN_COPP_MAX_CLASSES;
+         ++packet_class) {
+        copp_packet_class = &ops_copp_packet_class_t[packet_class];
+        class_snapshot = &snapshot->classes[packet_class];
+
+        class_snapshot->hw_valid = copp_packet_class->status[unit];
+        class_snapshot->queue_number =
+                        copp_packet_class->ops_copp_ingress_fp_queue_number;
+        class_snapshot->rate = copp_packet_class->ops_copp_egress_fp_rate;
+        class_snapshot->burst = copp_packet_class->ops_copp_egress_fp_burst;
+        class_snapshot->stats_valid = false;
 
-    if (!ingress_fp_entry) {
-        return(OPS_COPP_FAILURE_CODE);
-    }
+        /*
+         * Classes without a stat object on this unit have no counters.
+         */
+        if (!copp_packet_class->ops_copp_egress_fp_stat_id[unit]) {
+            continue;
+        }
 
-    /*
-     * Add the FP qualifier rules for unicast ARP. Qualify the unicast ARP
-     * on the following rules:-
-     * 1. Ethertype in L2 frame should be 0x0806
-     * 2. The destination MAC should be unicast.
-     */
-    retval = opennsl_field_qualify_EtherType(
-                                unit,
-                                *ingress_fp_entry,
-                                ether_type, ether_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on ether type for "
-                 "unicast ARP %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
+        for (index = 0; index < ARRAY_SIZE(ops_copp_snapshot_stats);
+             ++index) {
+            retval = opennsl_field_stat_get(
+                        unit,
+                        *(copp_packet_class->ops_copp_egress_fp_stat_id[unit]),
+                        ops_copp_snapshot_stats[index],
+                        &values[index]);
+            if (OPENNSL_FAILURE(retval)) {
+                break;
+            }
+        }
 
-#if 0
-    /*
-     * TODO: This needs to be uncommented once the support for
-     *       opennsl_field_qualify_PacketRes for unicast ARP
-     *       is available again.
-     */
-    retval = opennsl_field_qualify_PacketRes(
-                                unit,
-                                *ingress_fp_entry,
-                                OPENNSL_FIELD_PKT_RES_L2UC, 0xFFFFFFFF);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on unicast "
-                 "destination MAC address %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
+        if (index < ARRAY_SIZE(ops_copp_snapshot_stats)) {
+            VLOG_DBG("Unit %u: failed to read stats of %s = %s", unit,
+                     copp_packet_class->ops_copp_packet_name,
+                     opennsl_errmsg(retval));
+            snapshot->read_failures++;
+            continue;
+        }
+
+        class_snapshot->packets_allowed = values[0];
+        class_snapshot->bytes_allowed = values[1];
+        class_snapshot->packets_dropped = values[2];
+        class_snapshot->bytes_dropped = values[3];
+        class_snapshot->stats_valid = true;
     }
-#endif
 
-    return(OPS_COPP_SUCCESS_CODE);
+    snapshot->taken = time_msec();
+    snapshot->valid = true;
+    snapshot->sweeps++;
 }
 
 /*
- * ops_copp_egress_fp_unicast_arp
+ * ops_copp_stats_lookup
  *
- * This function programs the qualifiers for identifying an unicast ARP
- * packet in egress pipeline.
+ * This function returns the snapshot of a hardware unit, sweeping the
+ * unit first if the snapshot is older than the refresh interval. It
+ * returns NULL for an invalid hardware unit.
  */
-int ops_copp_egress_fp_unicast_arp (uint32 unit,
-                                    opennsl_field_entry_t* egress_fp_entry,
-                                    uint8 ingress_cpu_queue_number)
+static const struct ops_copp_stats_snapshot*
+ops_copp_stats_lookup (uint32 unit)
 {
-    int32                      retval = -1;
-    uint16                     ether_type = OPS_COPP_ARP_ETHER_TYPE;
-    uint16                     ether_mask = OPS_COPP_L2_ETHER_TYPE_MASK;
-    opennsl_port_t             port = OPS_COPP_OUT_PORT;
-    opennsl_port_t             port_mask = OPS_COPP_OUT_PORT_MASK;
-
-    if (!egress_fp_entry) {
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    /*
-     * Add the FP qualifier rules for unicast ARP. Qualify the unicast ARP
-     * on the following rules:-
-     * 1. Ethertype in L2 frame should be 0x0806
-     * 2. The out port should be zero as the packet is destined to CPU.
-     * 3  The packet's meta data should contain the CPU queue set in ingress
-     *    pipeline.
-     */
-    retval = opennsl_field_qualify_EtherType(
-                                unit,
-                                *egress_fp_entry,
-                                ether_type, ether_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on ether type for "
-                 "unicast ARP %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
+    struct ops_copp_stats_snapshot*     snapshot;
 
-    retval = opennsl_field_qualify_OutPort(unit, *egress_fp_entry,
-                                           port, port_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on out port %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
+    if (unit >= OPS_COPP_MAX_UNITS) {
+        return(NULL);
     }
 
-    retval = opennsl_field_qualify_CpuQueue(unit,
-                             *egress_fp_entry, ingress_cpu_queue_number, 0xff);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on CPU queue %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
+    snapshot = &ops_copp_stats_table[unit];
+    if (!snapshot->valid ||
+        (time_msec() - snapshot->taken >= ops_copp_stats_interval_ms)) {
+        ops_copp_stats_sweep(unit);
     }
 
-    return(OPS_COPP_SUCCESS_CODE);
+    return(snapshot);
 }
 
 /*
- * ops_copp_ingress_fp_lacp
+ * ops_copp_stats_set_interval
  *
- * This function programs the qualifiers for identifying a LACP
- * packet in ingress pipeline.
+ * This function sets the refresh interval of the CoPP stats snapshot. An
+ * interval of 0 reads the hardware on every lookup.
  */
-int ops_copp_ingress_fp_lacp (uint32 unit,
-                              opennsl_field_entry_t* ingress_fp_entry)
+int ops_copp_stats_set_interval (int interval_ms)
 {
-    int32                  retval = -1;
-    opennsl_mac_t          ether_dst_mac = OPS_COPP_LACP_MAC_DEST;
-    opennsl_mac_t          ether_dst_mask = OPS_COPP_L2_ADDR_MASK;
-
-    if (!ingress_fp_entry) {
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    /*
-     * Add the FP qualifier rules for LACP packets. Qualify the LACP packets
-     * on the following rules:-
-     * 1. The destination MAC should be 01:80:c2:00:00:02.
-     */
-    retval = opennsl_field_qualify_DstMac(unit, *ingress_fp_entry,
-                                          ether_dst_mac, ether_dst_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on LACP "
-                 "destination MAC address %s \n", opennsl_errmsg(retval));
+    if ((interval_ms < 0) || (interval_ms > OPS_COPP_STATS_MAX_INTERVAL_MS)) {
         return(OPS_COPP_FAILURE_CODE);
     }
 
+    ops_copp_stats_interval_ms = interval_ms;
     return(OPS_COPP_SUCCESS_CODE);
 }
 
 /*
- * ops_copp_egress_fp_lacp
+ * ops_copp_packet_class_set_status
  *
- * This function programs the qualifiers for identifying a LACP
- * packet in egress pipeline.
+ * This function sets the status value in the global structure for copp
+ * to the value specified in the input parameters.
  */
-int ops_copp_egress_fp_lacp (uint32 unit,
-                             opennsl_field_entry_t* egress_fp_entry,
-                             uint8 ingress_cpu_queue_number)
+static int ops_copp_packet_class_set_status(
+                              uint32 unit,
+                              enum ops_copp_packet_class_code_t packet_class,
+                              bool status_value)
 {
-    int32                  retval = -1;
-    opennsl_mac_t          ether_dst_mac = OPS_COPP_LACP_MAC_DEST;
-    opennsl_mac_t          ether_dst_mask = OPS_COPP_L2_ADDR_MASK;
-    opennsl_port_t         port = OPS_COPP_OUT_PORT;
-    opennsl_port_t         port_mask = OPS_COPP_OUT_PORT_MASK;
+    struct ops_copp_fp_rule_t* copp_packet_class = NULL;
 
-    if (!egress_fp_entry) {
+    /*
+     * If the packet class is not valid, then do not do anything and
+     * return from this function.
+     */
+    if ((packet_class < 0) ||
+        (packet_class >= PLUGIN_COPP_MAX_CLASSES)) {
+        VLOG_ERR("Not a valid packet class");
         return(OPS_COPP_FAILURE_CODE);
     }
 
     /*
-     * Add the FP qualifier rules for LACP packets. Qualify the LACP packets
-     * on the following rules:-
-     * 1. The destination MAC should be 01:80:c2:00:00:02.
-     * 2. The out port should be zero as the packet is destined to CPU.
-     * 3  The packet's meta data should contain the CPU queue set in ingress
-     *    pipeline.
+     * If the unit is not valid, then do not do anything and
+     * return from this function raising a failure.
      */
-    retval = opennsl_field_qualify_DstMac(unit, *egress_fp_entry,
-                                          ether_dst_mac, ether_dst_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on LACP "
-                 "destination MAC address %s \n", opennsl_errmsg(retval));
+    if ((unit < 0) || (unit >= OPS_COPP_MAX_UNITS)) {
+        VLOG_ERR("Not a valid unit");
         return(OPS_COPP_FAILURE_CODE);
     }
 
-    retval = opennsl_field_qualify_OutPort(unit, *egress_fp_entry,
-                                           port, port_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on out port %s\n",
-                 opennsl_errmsg(retval));
+    /*
+     * Get the pointer reference to the control packet rule.
+     */
+    copp_packet_class = &ops_copp_packet_class_t[packet_class];
+    if (copp_packet_class == NULL) {
+        VLOG_ERR("Global Copp structure not present for pkt class %d",
+                  packet_class);
         return(OPS_COPP_FAILURE_CODE);
     }
 
-    retval = opennsl_field_qualify_CpuQueue(unit,
-                             *egress_fp_entry, ingress_cpu_queue_number, 0xff);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on CPU queue %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
+    /*
+     * Set the status value passed into the function for the hw_unit.
+     */
+    copp_packet_class->status[unit] = status_value;
+    ops_copp_stats_invalidate(unit);
 
     return(OPS_COPP_SUCCESS_CODE);
 }
 
 /*
- * ops_copp_ingress_fp_lldp
+ * ops_copp_packet_class_programmer
  *
- * This function programs the qualifiers for identifying a LLDP
- * packet in ingress pipeline.
+ * This function programs the global packet rules for some packet types for a
+ * given hardware unit if only the function pointer for the control plane
+ * packet is defined.
  */
-int ops_copp_ingress_fp_lldp (uint32 unit,
-                              opennsl_field_entry_t* ingress_fp_entry)
+static int ops_copp_packet_class_programmer(
+                              uint32 unit,
+                              enum ops_copp_packet_class_code_t packet_class)
 {
-    int32                  retval = -1;
-    uint16                 ether_type = OPS_COPP_LLDP_ETHER_TYPE;
-    uint16                 ether_mask = OPS_COPP_L2_ETHER_TYPE_MASK;
-    opennsl_mac_t          ether_dst_mac_array[] = {OPS_COPP_LLDP_MAC_DEST_1,
-                                                    OPS_COPP_LLDP_MAC_DEST_2,
-                                                    OPS_COPP_LLDP_MAC_DEST_3};
-    opennsl_mac_t          ether_dst_mask = OPS_COPP_L2_ADDR_MASK;
-    static int             index;
-
-
-    if (!ingress_fp_entry) {
-        return(OPS_COPP_FAILURE_CODE);
-    }
+    int32                      retval = -1;
+    struct ops_copp_fp_rule_t* copp_packet_class = NULL;
 
     /*
-     * Add the FP qualifier rules for LLDP packets. Qualify the LLDP packets
-     * on the following rules:-
-     * 1. Ethertype in L2 frame should be 0x88CC
-     * 2. Program the L@ destination MAC as one of OPS_COPP_LLDP_MAC_DEST_1,
-     *     OPS_COPP_LLDP_MAC_DEST_2 and OPS_COPP_LLDP_MAC_DEST_3.
+     * If the packet class is not valid, then do not do anything and
+     * return from this function.
      */
-    retval = opennsl_field_qualify_EtherType(unit, *ingress_fp_entry,
-                                             ether_type, ether_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on ether type for "
-                 "LLDP packet %s \n", opennsl_errmsg(retval));
+    if ((packet_class < 0) ||
+        (packet_class >= PLUGIN_COPP_MAX_CLASSES)) {
+        VLOG_ERR("Not a valid packet class");
         return(OPS_COPP_FAILURE_CODE);
     }
 
-    if (index < sizeof(ether_dst_mac_array)/sizeof(opennsl_mac_t)) {
-
-        retval = opennsl_field_qualify_DstMac(unit, *ingress_fp_entry,
-                                              ether_dst_mac_array[index],
-                                              ether_dst_mask);
-        if (OPENNSL_FAILURE(retval)) {
-            VLOG_ERR("     Ingress: Failed to qualify on  "
-                     "destination MAC address %s \n", opennsl_errmsg(retval));
-            return(OPS_COPP_FAILURE_CODE);
-        }
-
-        ++index;
-
-        if ((index % (sizeof(ether_dst_mac_array)/sizeof(opennsl_mac_t))) == 0) {
-            index = 0;
-        }
-    }
-
-    return(OPS_COPP_SUCCESS_CODE);
-}
-
-/*
- * ops_copp_egress_fp_lldp
- *
- * This function programs the qualifiers for identifying a LLDP
- * packet in egress pipeline.
- */
-int ops_copp_egress_fp_lldp (uint32 unit,
-                             opennsl_field_entry_t* egress_fp_entry,
-                             uint8 ingress_cpu_queue_number)
-{
-    int32                      retval = -1;
-    uint16                     ether_type = OPS_COPP_LLDP_ETHER_TYPE;
-    uint16                     ether_mask = OPS_COPP_L2_ETHER_TYPE_MASK;
-    opennsl_port_t             port = OPS_COPP_OUT_PORT;
-    opennsl_port_t             port_mask = OPS_COPP_OUT_PORT_MASK;
+    /*
+     * Get the pointer reference to the control packet rule.
+     */
+    copp_packet_class = &ops_copp_packet_class_t[packet_class];
 
-    if (!egress_fp_entry) {
+    if (!copp_packet_class) {
+        VLOG_ERR("Invalid pointer to packet class");
         return(OPS_COPP_FAILURE_CODE);
     }
 
     /*
-     * Add the FP qualifier rules for LLDP packets. Qualify the LLDP packets
-     * on the following rules:-
-     * 1. Ethertype in L2 frame should be 0x0806
-     * 2. The out port should be zero as the packet is destined to CPU.
-     * 3  The packet's meta data should contain the CPU queue set in ingress
-     *    pipeline.
+     * If the control packet class has global rx rules, then program
+     * them into the hardware.
      */
-    retval = opennsl_field_qualify_EtherType(unit, *egress_fp_entry,
-                                             ether_type, ether_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on ether type for "
-                 "broadcast ARP %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_OutPort(unit, *egress_fp_entry,
-                                           port, port_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on out port %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
+    if (copp_packet_class->ops_copp_rx_rules[0].valid) {
+        retval = ops_copp_rx_rules_program(unit, copp_packet_class);
+        if (retval != OPS_COPP_SUCCESS_CODE) {
+            VLOG_ERR("     Packet class: Failed to program the "
+                     "packet class rules for %s\n",
+                     copp_packet_class->ops_copp_packet_name);
+            return(OPS_COPP_FAILURE_CODE);
+        }
 
-    retval = opennsl_field_qualify_CpuQueue(unit,
-                             *egress_fp_entry, ingress_cpu_queue_number, 0xff);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on CPU queue %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
+        VLOG_DBG("     Packet class: Successfully programmed the "
+                 "packet class rule for %s",
+                 copp_packet_class->ops_copp_packet_name);
     }
 
     return(OPS_COPP_SUCCESS_CODE);
 }
 
 /*
- * ops_copp_ingress_fp_stp
+ * ops_copp_ingress_fp_programmer
  *
- * This function programs the qualifiers for identifying a STP
- * packet (for bridges and provider bridges) in ingress pipeline.
+ * This function does the following two operations for the control packets:-
+ * 1. If the ingress FP entry for the control packet is NULL, then this
+ *    function creates a new ingress FP entry and attaches the default CPU
+ *    queue number for the control packets. This is the case at the
+ *    initialization time when the plugin gets loaded in vswitchd for the
+ *    first time.
+ * 2. If the ingress FP entry for the control packet is not NULL, then this
+ *    function updates the CPU queue for the control packet with the
+ *    CPU queue value passed to this function.
  */
-int ops_copp_ingress_fp_stp (uint32 unit,
-                             opennsl_field_entry_t* ingress_fp_entry)
+static int ops_copp_ingress_fp_programmer (
+                              uint32 unit,
+                              enum ops_copp_packet_class_code_t packet_class,
+                              uint32* ingress_fp_queue)
 {
-    int32                  retval = -1;
-    opennsl_mac_t          ether_dst_mac = OPS_COPP_STP_MAC_DEST;
-    opennsl_mac_t          ether_dst_mask = OPS_COPP_STP_MAC_DEST_MASK;
-
-    if (!ingress_fp_entry) {
-        return(OPS_COPP_FAILURE_CODE);
-    }
+    int32                        retval = -1;
+    bool                         if_init_ingress_fp_program = false;
+    bool                         if_config_ingress_fp_program = false;
+    int                          ingress_fp_rule_number;
+    struct ops_copp_fp_rule_t*   copp_packet_class = NULL;
 
     /*
-     * Add the FP qualifier rules for STP packets. Qualify the STP packets
-     * on the following rules:-
-     * 1. The destination MAC should be 01:80:c2:00:00:00.
+     * If the packet class is not valid, then do not do anything and
+     * return from this function.
      */
-    retval = opennsl_field_qualify_DstMac(unit, *ingress_fp_entry,
-                                          ether_dst_mac, ether_dst_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on STP "
-                 "destination MAC address %s \n", opennsl_errmsg(retval));
+    if ((packet_class < 0) ||
+        (packet_class >= PLUGIN_COPP_MAX_CLASSES)) {
+        VLOG_ERR("Not a valid packet class");
         return(OPS_COPP_FAILURE_CODE);
     }
 
-    return(OPS_COPP_SUCCESS_CODE);
-}
-
-/*
- * ops_copp_egress_fp_stp
- *
- * This function programs the qualifiers for identifying a STP
- * packet (for bridges and provider bridges) in egress pipeline.
- */
-int ops_copp_egress_fp_stp (uint32 unit,
-                            opennsl_field_entry_t* egress_fp_entry,
-                            uint8 ingress_cpu_queue_number)
-{
-    int32                  retval = -1;
-    opennsl_mac_t          ether_dst_mac = OPS_COPP_STP_MAC_DEST;
-    opennsl_mac_t          ether_dst_mask = OPS_COPP_STP_MAC_DEST_MASK;
-    opennsl_port_t         port = OPS_COPP_OUT_PORT;
-    opennsl_port_t         port_mask = OPS_COPP_OUT_PORT_MASK;
+    /*
+     * Get the pointer reference to the control packet rule.
+     */
+    copp_packet_class = &ops_copp_packet_class_t[packet_class];
 
-    if (!egress_fp_entry) {
+    if (!copp_packet_class) {
+        VLOG_ERR("Invalid pointer to packet class");
         return(OPS_COPP_FAILURE_CODE);
     }
 
     /*
-     * Add the FP qualifier rules for STP packets. Qualify the STP packets
-     * on the following rules:-
-     * 1. The destination MAC should be 01:80:c2:00:00:00.
-     * 2. The out port should be zero as the packet is destined to CPU.
-     * 3  The packet's meta data should contain the CPU queue set in ingress
-     *    pipeline.
+     * There are no ingress FP rules for ACL logging, sflow, unknown IP
+     * and unclassified packets. So return from this function.
      */
-    retval = opennsl_field_qualify_DstMac(unit, *egress_fp_entry,
-                                          ether_dst_mac, ether_dst_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on STP "
-                 "destination MAC address %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_OutPort(unit, *egress_fp_entry,
-                                           port, port_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on out port %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
+    if (!copp_packet_class->ops_copp_ingress_fp_rules[0].valid) {
+        return(OPS_COPP_SUCCESS_CODE);
     }
 
-    retval = opennsl_field_qualify_CpuQueue(unit,
-                             *egress_fp_entry, ingress_cpu_queue_number, 0xff);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on CPU queue %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
+    /*
+     * If the ingress FP entry pointer for the control packet is NULL,
+     * then we need to allocate a new FP entry and program the hardware.
+     */
+    if (!(copp_packet_class->ops_copp_ingress_fp_entry[unit][0])) {
+        if_init_ingress_fp_program = true;
     }
 
-    return(OPS_COPP_SUCCESS_CODE);
-}
-
-/*
- * ops_copp_ingress_fp_bgp
- *
- * This function programs the qualifiers for identifying a BGP packet
- * in ingress pipeline.
- */
-int ops_copp_ingress_fp_bgp (uint32 unit,
-                             opennsl_field_entry_t* ingress_fp_entry)
-{
-    opennsl_l4_port_t      L4_dst_port = OPS_COPP_L4_PORT_BGP;
-    opennsl_l4_port_t      L4_dst_port_mask = OPS_COPP_L4_PORT_MASK;
-    uint8                  address_data = OPS_COPP_DST_IP_LOCAL_DATA;
-    uint8                  address_mask = OPS_COPP_DST_IP_LOCAL_MASK;
-    uint8                  prot_type = OPS_COPP_IP_PROTOCOL_IP_NUMBER_TCP;
-    uint8                  prot_mask = OPS_COPP_IP_PROTOCOL_IP_NUMBER_MASK;
-    int32                  retval = -1;
-
-    if (!ingress_fp_entry) {
-        return(OPS_COPP_FAILURE_CODE);
+    /*
+     * If the ingress FP entry pointer for the control packet is not NULL,
+     * then we need to update the FP entry with the new CPU queue value.
+     */
+    if (copp_packet_class->ops_copp_ingress_fp_entry[unit][0] &&
+        ingress_fp_queue) {
+        if_config_ingress_fp_program = true;
     }
 
     /*
-     * Add the FP qualifier rules for BGP. Qualify the BGP packets
-     * on the following rules:-
-     * 1. L4 destination port is 179
-     * 2. The destination IP address is local to the box
-     * 3. The protocol in IP packet is TCP.
+     * If we find that this function is neither called at init time or
+     * at CPU queue modification time, then return from this function.
      */
-    retval = opennsl_field_qualify_L4DstPort(unit, *ingress_fp_entry,
-                                             L4_dst_port, L4_dst_port_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on L4 destination "
-                 "port %s \n", opennsl_errmsg(retval));
+    if (!if_init_ingress_fp_program && !if_config_ingress_fp_program) {
+        VLOG_ERR("Invalid use of the ingress function for %s",
+                 copp_packet_class->ops_copp_packet_name);
         return(OPS_COPP_FAILURE_CODE);
     }
 
-    retval = opennsl_field_qualify_IpProtocol(unit, *ingress_fp_entry,
-                                              prot_type, prot_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on IP protocol "
-                 "number %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
+    /*
+     * If the function is called at the initialization time, then allocate
+     * a new FP entry and program the ingress pipeline with the FP rule.
+     */
+    if (if_init_ingress_fp_program) {
 
-    retval = opennsl_field_qualify_DstIpLocal(unit, *ingress_fp_entry,
-                                              address_data, address_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on destination "
-                 "IP being Local %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
+        VLOG_DBG("Create a new ingress FP %s entry with default queue number "
+                 "for unit %u", copp_packet_class->ops_copp_packet_name, unit);
 
-    return(OPS_COPP_SUCCESS_CODE);
-}
+        ingress_fp_rule_number = 0;
+        while ((ingress_fp_rule_number < OPS_COPP_MAX_RULES_INGRESS) &&
+               copp_packet_class->ops_copp_ingress_fp_rules[
+                                            ingress_fp_rule_number].valid) {
 
-/*
- * ops_copp_egress_fp_bgp
- *
- * This function programs the qualifiers for identifying a BGP packet
- * in egress pipeline.
- */
-int ops_copp_egress_fp_bgp (uint32 unit,
-                            opennsl_field_entry_t* egress_fp_entry,
-                            uint8 ingress_cpu_queue_number)
-{
-    int32                  retval = -1;
-    opennsl_l4_port_t      L4_dst_port = OPS_COPP_L4_PORT_BGP;
-    opennsl_l4_port_t      L4_dst_port_mask = OPS_COPP_L4_PORT_MASK;
-    uint8                  prot_type = OPS_COPP_IP_PROTOCOL_IP_NUMBER_TCP;
-    uint8                  prot_mask = OPS_COPP_IP_PROTOCOL_IP_NUMBER_MASK;
-    opennsl_port_t         port = OPS_COPP_OUT_PORT;
-    opennsl_port_t         port_mask = OPS_COPP_OUT_PORT_MASK;
-
-    if (!egress_fp_entry) {
-        return(OPS_COPP_FAILURE_CODE);
-    }
+            /*
+             * Allocate a new FP ingress entry.
+             */
+            copp_packet_class->ops_copp_ingress_fp_entry[unit][
+                                                ingress_fp_rule_number] =
+                                        xzalloc(sizeof(opennsl_field_entry_t));
 
-    /*
-     * Add the FP qualifier rules for BGP. Qualify the BGP packets
-     * on the following rules:-
-     * 1. L4 destination port is 179
-     * 2. The destination IP address is local to the box
-     * 3. The out port should be zero as the packet is destined to CPU.
-     * 4  The packet's meta data should contain the CPU queue set in ingress
-     *    pipeline.
-     */
-    retval = opennsl_field_qualify_L4DstPort(unit, *egress_fp_entry,
-                                             L4_dst_port, L4_dst_port_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on L4 destination "
-                 "port %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
+            /*
+             * Create a new ingress FP entry in the ingress group for the
+             * given unit.
+             */
+            retval = opennsl_field_entry_create(
+                        unit, ops_copp_ingress_fp_group_array[unit],
+                        copp_packet_class->ops_copp_ingress_fp_entry[unit][
+                                                     ingress_fp_rule_number]);
 
-    retval = opennsl_field_qualify_IpProtocol(unit, *egress_fp_entry,
-                                              prot_type, prot_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on IP protocol "
-                 "number %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
+            if (OPENNSL_FAILURE(retval)) {
+                VLOG_ERR("     Ingress: Failed to create entry: %s\n",
+                         opennsl_errmsg(retval));
+                free(copp_packet_class->ops_copp_ingress_fp_entry[unit][
+                                                    ingress_fp_rule_number]);
+                return(OPS_COPP_FAILURE_CODE);
+            }
 
-    retval = opennsl_field_qualify_OutPort(unit, *egress_fp_entry,
-                                           port, port_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on out port %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
+            /*
+             * Program the FP qualifiers of this ingress rule of the
+             * packet class.
+             */
+            retval = ops_copp_fp_entry_qualify(
+                            unit,
+                            copp_packet_class->ops_copp_ingress_fp_entry[unit][
+                                                      ingress_fp_rule_number],
+                            &copp_packet_class->ops_copp_ingress_fp_rules[
+                                                      ingress_fp_rule_number],
+                            false, 0, copp_packet_class->ops_copp_packet_name);
+            if (retval != OPS_COPP_SUCCESS_CODE) {
+                VLOG_ERR("     Ingress: Failed to add FP qualifiers\n");
+                ops_copp_fp_entry_cleanup(unit,
+                        copp_packet_class->ops_copp_ingress_fp_entry[unit][
+                                                          ingress_fp_rule_number]);
+                return(OPS_COPP_FAILURE_CODE);
+            }
 
-    retval = opennsl_field_qualify_CpuQueue(unit,
-                             *egress_fp_entry, ingress_cpu_queue_number, 0xff);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on CPU queue %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
+            /*
+             * Add the action for the ingress FP entry to be the default CPU
+             * queue for the control packet.
+             */
+            retval = opennsl_field_action_add(
+                        unit,
+                        *(copp_packet_class->ops_copp_ingress_fp_entry[unit][
+                                                         ingress_fp_rule_number]),
+                        opennslFieldActionCosQCpuNew,
+                        copp_packet_class->ops_copp_ingress_fp_queue_number, 0);
+            if (OPENNSL_FAILURE(retval)) {
+                VLOG_ERR("     Ingress: Failed to add action for "
+                         "the FP entry %s\n", opennsl_errmsg(retval));
+                ops_copp_fp_entry_cleanup(unit,
+                        copp_packet_class->ops_copp_ingress_fp_entry[unit][
+                                                         ingress_fp_rule_number]);
+                return(OPS_COPP_FAILURE_CODE);
+            }
 
-    return(OPS_COPP_SUCCESS_CODE);
-}
+            /*
+             * Install the FP entry into the hardware.
+             */
+            retval = opennsl_field_entry_install(
+                        unit,
+                        *(copp_packet_class->ops_copp_ingress_fp_entry[unit][
+                                                       ingress_fp_rule_number]));
+            if (OPENNSL_FAILURE(retval)) {
+                VLOG_ERR("     Ingress entry program failure: %s\n",
+                         opennsl_errmsg(retval));
+                ops_copp_fp_entry_cleanup(unit,
+                        copp_packet_class->ops_copp_ingress_fp_entry[unit][
+                                                         ingress_fp_rule_number]);
+                return(OPS_COPP_FAILURE_CODE);
+            }
 
-/*
- * ops_copp_ingress_fp_dhcpv4
- *
- * This function programs the qualifiers for identifying a DHCPv4 packet
- * in ingress pipeline. The DHCPv4 packet in destined for the DHCP server.
- */
-int ops_copp_ingress_fp_dhcpv4 (uint32 unit,
-                                opennsl_field_entry_t* ingress_fp_entry)
-{
-    opennsl_l4_port_t      L4_dst_port = OPS_COPP_L4_PORT_DHCPV4;
-    opennsl_l4_port_t      L4_dst_port_mask = OPS_COPP_L4_PORT_MASK;
-    uint8                  prot_type = OPS_COPP_IP_PROTOCOL_IP_NUMBER_UDP;
-    uint8                  prot_mask = OPS_COPP_IP_PROTOCOL_IP_NUMBER_MASK;
-    int32                  retval = -1;
+            ingress_fp_rule_number++;
+        }
 
-    if (!ingress_fp_entry) {
-        return(OPS_COPP_FAILURE_CODE);
+        VLOG_DBG("     Ingress: Successfully programmed the FP rule "
+                 "for %s", copp_packet_class->ops_copp_packet_name);
     }
 
     /*
-     * Add the FP qualifier rules for DHCPv4. Qualify the DHCPv4 packets
-     * on the following rules:-
-     * 1. L4 destination port is 67
-     * 2. The protocol in IP packet is UDP
-     * 3. The packet should be an IPv4 packet
+     * If the function is called at the configuration time, then delete
+     * CPU queue current action, attach the new CPU queue action and
+     * install the FP entry into the hardware.
      */
-    retval = opennsl_field_qualify_L4DstPort(unit, *ingress_fp_entry,
-                                             L4_dst_port, L4_dst_port_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on L4 destination "
-                 "port %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
+    if (if_config_ingress_fp_program) {
 
-    retval = opennsl_field_qualify_IpProtocol(unit, *ingress_fp_entry,
-                                              prot_type, prot_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on IP protocol "
-                 "number %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
+        /*
+         * If the new CPU queue value is same as the already configured
+         * value, then do nothing and return from this function.
+         */
+        if (copp_packet_class->ops_copp_ingress_fp_queue_number ==
+            *ingress_fp_queue) {
 
-    retval = opennsl_field_qualify_IpType(unit, *ingress_fp_entry,
-                                          opennslFieldIpTypeIpv4Any);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on ipv4 packet type "
-                 " %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
+            VLOG_DBG("     Ingress: The previous CPU queue "
+                     "value %u is same as the new intended value %u for %s",
+                     copp_packet_class->ops_copp_ingress_fp_queue_number,
+                     *ingress_fp_queue,
+                     copp_packet_class->ops_copp_packet_name);
+        } else {
 
-    return(OPS_COPP_SUCCESS_CODE);
-}
+            ingress_fp_rule_number = 0;
+            while ((ingress_fp_rule_number < OPS_COPP_MAX_RULES_INGRESS) &&
+                   copp_packet_class->ops_copp_ingress_fp_rules[
+                                            ingress_fp_rule_number].valid) {
+                /*
+                 * Delete the current CPU queue from the FP entry.
+                 */
+                retval = opennsl_field_action_delete(
+                            unit,
+                            *(copp_packet_class->ops_copp_ingress_fp_entry[unit][
+                                                          ingress_fp_rule_number]),
+                            opennslFieldActionCosQCpuNew,
+                            copp_packet_class->ops_copp_ingress_fp_queue_number,
+                            0);
+                if (OPENNSL_FAILURE(retval)) {
+                    VLOG_ERR("     Ingress action update failure: %s\n",
+                             opennsl_errmsg(retval));
+                    return(OPS_COPP_FAILURE_CODE);
+                }
 
-/*
- * ops_copp_egress_fp_dhcpv4
- *
- * This function programs the qualifiers for identifying a DHCPv4 packet
- * in egress pipeline. The DHCPv4 packet in destined for the DHCP server.
- */
-int ops_copp_egress_fp_dhcpv4 (uint32 unit,
-                               opennsl_field_entry_t* egress_fp_entry,
-                               uint8 ingress_cpu_queue_number)
-{
-    opennsl_l4_port_t      L4_dst_port = OPS_COPP_L4_PORT_DHCPV4;
-    opennsl_l4_port_t      L4_dst_port_mask = OPS_COPP_L4_PORT_MASK;
-    uint8                  prot_type = OPS_COPP_IP_PROTOCOL_IP_NUMBER_UDP;
-    uint8                  prot_mask = OPS_COPP_IP_PROTOCOL_IP_NUMBER_MASK;
-    opennsl_port_t         port = OPS_COPP_OUT_PORT;
-    opennsl_port_t         port_mask = OPS_COPP_OUT_PORT_MASK;
-    int32                  retval = -1;
+                /*
+                 * Add the new CPU queue to the FP entry.
+                 */
+                retval = opennsl_field_action_add(
+                            unit,
+                            *(copp_packet_class->ops_copp_ingress_fp_entry[unit][
+                                                           ingress_fp_rule_number]),
+                            opennslFieldActionCosQCpuNew,
+                            *ingress_fp_queue, 0);
+                if (OPENNSL_FAILURE(retval)) {
+                    VLOG_ERR("     Ingress:  Failed to add new action = %s\n",
+                             opennsl_errmsg(retval));
+                    return(OPS_COPP_FAILURE_CODE);
+                }
 
-    if (!egress_fp_entry) {
-        return(OPS_COPP_FAILURE_CODE);
-    }
+                /*
+                 * Install the FP entry into the hardware.
+                 */
+                retval = opennsl_field_entry_install(
+                          unit,
+                          *(copp_packet_class->ops_copp_ingress_fp_entry[unit][
+                                                        ingress_fp_rule_number]));
+                if (OPENNSL_FAILURE(retval)) {
+                    VLOG_ERR("     Ingress entry program failure: %s\n",
+                             opennsl_errmsg(retval));
+                    return(OPS_COPP_FAILURE_CODE);
+                }
 
-    /*
-     * Add the FP qualifier rules for DHCPv4. Qualify the DHCPv4 packets
-     * on the following rules:-
-     * 1. L4 destination port is 67
-     * 2. The protocol in IP packet is UDP.
-     * 3. The packet should be an IPv4 packet
-     * 4. The out port should be zero as the packet is destined to CPU.
-     * 5  The packet's meta data should contain the CPU queue set in ingress
-     *    pipeline.
-     */
-    retval = opennsl_field_qualify_L4DstPort(unit, *egress_fp_entry,
-                                             L4_dst_port, L4_dst_port_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on L4 destination "
-                 "port %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
+                ingress_fp_rule_number++;
+            }
 
-    retval = opennsl_field_qualify_IpProtocol(unit, *egress_fp_entry,
-                                              prot_type, prot_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on IP protocol "
-                 "number %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
+            /*
+             * Need to update the FP entry in the egress as the
+             * qualifier in egress uses CPU QoS Queue.
+             */
+            retval = opennsl_field_qualify_CpuQueue(unit,
+                             *(copp_packet_class->ops_copp_egress_fp_entry[unit]),
+                             *ingress_fp_queue, 0xff);
+            if (OPENNSL_FAILURE(retval)) {
+                VLOG_ERR("     Egress: Failed to qualify on CPU queue %s\n",
+                         opennsl_errmsg(retval));
+                return(OPS_COPP_FAILURE_CODE);
+            }
 
-    retval = opennsl_field_qualify_IpType(unit, *egress_fp_entry,
-                                          opennslFieldIpTypeIpv4Any);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on ipv4 packet type "
-                 " %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
+            /*
+             * Install the egress FP entry into the hardware.
+             */
+            retval = opennsl_field_entry_install(
+                        unit,
+                        *(copp_packet_class->ops_copp_egress_fp_entry[unit]));
+            if (OPENNSL_FAILURE(retval)) {
+                VLOG_ERR("     Ingress entry program failure: %s\n",
+                         opennsl_errmsg(retval));
+                return(OPS_COPP_FAILURE_CODE);
+            }
 
-    retval = opennsl_field_qualify_OutPort(unit, *egress_fp_entry,
-                                           port, port_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on out port %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
+            /*
+             * Copy the new CPU queue value into the configured FP rules.
+             */
+            copp_packet_class->ops_copp_ingress_fp_queue_number =
+                                                    *ingress_fp_queue;
 
-    retval = opennsl_field_qualify_CpuQueue(unit,
-                             *egress_fp_entry, ingress_cpu_queue_number, 0xff);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on CPU queue %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
+            VLOG_DBG("     Ingress: Successfully reprogrammed the FP rule "
+                     "for %s with new CPU queue %u",
+                     copp_packet_class->ops_copp_packet_name,
+                     *ingress_fp_queue);
+        }
     }
 
     return(OPS_COPP_SUCCESS_CODE);
 }
 
 /*
- * ops_copp_ingress_fp_dhcpv6
+ * ops_copp_egress_fp_programmer
  *
- * This function programs the qualifiers for identifying a DHCPv6 packet
- * in ingress pipeline. The DHCPv6 packet in destined for the DHCP server.
+ * This function does the following two operations for a given control packet:-
+ * 1. If the egress FP entry for the control packet is NULL, then this
+ *    function creates a new ingress FP entry and attaches a policier with
+ *    the default rate and burst value and a stats object to the egress FP
+ *    entry. This is the case at the initialization time when the plugin
+ *    gets loaded in vswitchd for the first time.
+ * 2. If the egress FP entry for the control packet is not NULL, then this
+ *    function updates the rate and the burst in the policier for the control
+ *    packet with the rate and burst values passed to this function.
  */
-int ops_copp_ingress_fp_dhcpv6 (uint32 unit,
-                                opennsl_field_entry_t* ingress_fp_entry)
+static int ops_copp_egress_fp_programmer (
+                               uint32 unit,
+                               enum ops_copp_packet_class_code_t packet_class,
+                               uint32* egress_fp_rate,
+                               uint32* egress_fp_burst)
 {
-    opennsl_l4_port_t      L4_dst_port = OPS_COPP_L4_PORT_DHCPV6;
-    opennsl_l4_port_t      L4_dst_port_mask = OPS_COPP_L4_PORT_MASK;
-    uint8                  prot_type = OPS_COPP_IP_PROTOCOL_IP_NUMBER_UDP;
-    uint8                  prot_mask = OPS_COPP_IP_PROTOCOL_IP_NUMBER_MASK;
-    int32                  retval = -1;
-
-    if (!ingress_fp_entry) {
-        return(OPS_COPP_FAILURE_CODE);
-    }
+    int32                      retval = -1;
+    bool                       if_init_egress_fp_program = false;
+    bool                       if_config_egress_fp_program = false;
+    struct ops_copp_fp_rule_t* copp_packet_class = NULL;
 
     /*
-     * Add the FP qualifier rules for DHCPv6. Qualify the DHCPv6 packets
-     * on the following rules:-
-     * 1. L4 destination port is 547
-     * 2. The protocol in IP packet is UDP
-     * 3. The packet should be an IPv6 packet
+     * If the packet class is not valid, then do not do anything and
+     * return from this function.
      */
-    retval = opennsl_field_qualify_L4DstPort(unit, *ingress_fp_entry,
-                                             L4_dst_port, L4_dst_port_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on L4 destination "
-                 "port %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_Ip6NextHeader(unit, *ingress_fp_entry,
-                                                 prot_type, prot_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on IPv6 protocol "
-                 "number %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_IpType(unit, *ingress_fp_entry,
-                                          opennslFieldIpTypeIpv6);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on ipv6 packet type "
-                 " %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    return(OPS_COPP_SUCCESS_CODE);
-}
-
-/*
- * ops_copp_egress_fp_dhcpv6
- *
- * This function programs the qualifiers for identifying a DHCPv6 packet
- * in egress pipeline. The DHCPv6 packet in destined for the DHCP server.
- */
-int ops_copp_egress_fp_dhcpv6 (uint32 unit,
-                               opennsl_field_entry_t* egress_fp_entry,
-                               uint8 ingress_cpu_queue_number)
-{
-    opennsl_l4_port_t      L4_dst_port = OPS_COPP_L4_PORT_DHCPV6;
-    opennsl_l4_port_t      L4_dst_port_mask = OPS_COPP_L4_PORT_MASK;
-    uint8                  prot_type = OPS_COPP_IP_PROTOCOL_IP_NUMBER_UDP;
-    uint8                  prot_mask = OPS_COPP_IP_PROTOCOL_IP_NUMBER_MASK;
-    opennsl_port_t         port = OPS_COPP_OUT_PORT;
-    opennsl_port_t         port_mask = OPS_COPP_OUT_PORT_MASK;
-    int32                  retval = -1;
-
-    if (!egress_fp_entry) {
+    if ((packet_class < 0) ||
+        (packet_class >= PLUGIN_COPP_MAX_CLASSES)) {
+        VLOG_ERR("Not a valid packet class");
         return(OPS_COPP_FAILURE_CODE);
     }
 
     /*
-     * Add the FP qualifier rules for DHCPv6. Qualify the DHCPv6 packets
-     * on the following rules:-
-     * 1. L4 destination port is 547
-     * 2. The protocol in IP packet is UDP
-     * 3. The packet should be an IPv6 packet
-     * 4. The out port should be zero as the packet is destined to CPU.
-     * 5  The packet's meta data should contain the CPU queue set in ingress
-     *    pipeline.
+     * Get the pointer reference to the control packet rule.
      */
-    retval = opennsl_field_qualify_L4DstPort(unit, *egress_fp_entry,
-                                             L4_dst_port, L4_dst_port_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on L4 destination "
-                 "port %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_Ip6NextHeader(unit, *egress_fp_entry,
-                                                 prot_type, prot_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on IPv6 protocol "
-                 "number %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
+    copp_packet_class = &ops_copp_packet_class_t[packet_class];
 
-    retval = opennsl_field_qualify_IpType(unit, *egress_fp_entry,
-                                          opennslFieldIpTypeIpv6);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on ipv6 packet type "
-                 " %s \n", opennsl_errmsg(retval));
+    if (!copp_packet_class) {
+        VLOG_ERR("Invalid pointer to packet class");
         return(OPS_COPP_FAILURE_CODE);
     }
 
-    retval = opennsl_field_qualify_OutPort(unit, *egress_fp_entry,
-                                           port, port_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on out port %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
+    /*
+     * If the egress FP entry pointer for the control packet is NULL, then
+     * we need to allocate a new FP entry and program the hardware.
+     */
+    if (!(copp_packet_class->ops_copp_egress_fp_entry[unit]) &&
+        copp_packet_class->ops_copp_egress_fp_rule.valid) {
+        if_init_egress_fp_program = true;
     }
 
-    retval = opennsl_field_qualify_CpuQueue(unit,
-                             *egress_fp_entry, ingress_cpu_queue_number, 0xff);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on CPU queue %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
+    /*
+     * If the egress FP entry pointer for the control packet is not NULL,
+     * then we need to update the FP entry with the new rate and burst values.
+     */
+    if (copp_packet_class->ops_copp_egress_fp_entry[unit] && egress_fp_rate
+        && egress_fp_burst) {
+        if_config_egress_fp_program = true;
     }
 
-    return(OPS_COPP_SUCCESS_CODE);
-}
-
-/*
- * ops_copp_ingress_fp_icmpv4_ucast
- *
- * This function programs the qualifiers for identifying a ICMPv4 unicast
- * packet in ingress pipeline.
- */
-int ops_copp_ingress_fp_icmpv4_ucast (
-                                uint32 unit,
-                                opennsl_field_entry_t* ingress_fp_entry)
-{
-    uint8                  address_data = OPS_COPP_DST_IP_LOCAL_DATA;
-    uint8                  address_mask = OPS_COPP_DST_IP_LOCAL_MASK;
-    uint8                  prot_type = OPS_COPP_IP_PROTOCOL_IPV4_NUMBER_ICMP;
-    uint8                  prot_mask = OPS_COPP_IP_PROTOCOL_IP_NUMBER_MASK;
-    int32                  retval = -1;
-
-    if (!ingress_fp_entry) {
+    /*
+     * If we find that this function is neither called at init time or
+     * at rate/burst modification time, then return from this function.
+     */
+    if (!if_init_egress_fp_program && !if_config_egress_fp_program) {
+        VLOG_ERR("Invalid use of the egress function for %s",
+                 copp_packet_class->ops_copp_packet_name);
         return(OPS_COPP_FAILURE_CODE);
     }
 
     /*
-     * Add the FP qualifier rules for ICMPv4 unicast packets. Qualify the
-     * ICMPv4 unicast packets on the following rules:-
-     * 1. The protocol in IP packet is ICMP.
-     * 2. The packet should be an IPv4 packet
-     * 3. The destination IP address is local to the box
+     * If the function is called at the initialization time, then allocate
+     * a new FP entry and program the egress pipeline with the FP rule.
      */
-    retval = opennsl_field_qualify_IpProtocol(unit, *ingress_fp_entry,
-                                              prot_type, prot_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on IP protocol "
-                 "number %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
+    if (if_init_egress_fp_program) {
 
-    retval = opennsl_field_qualify_IpType(unit, *ingress_fp_entry,
-                                          opennslFieldIpTypeIpv4Any);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on ipv4 packet type "
-                 " %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
+        VLOG_DBG("Create a new egress FP %s entry with default rate/burst",
+                 copp_packet_class->ops_copp_packet_name);
 
-    retval = opennsl_field_qualify_DstIpLocal(unit, *ingress_fp_entry,
-                                              address_data, address_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on destination "
-                 "IP being Local %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
+        /*
+         * Allocate a new FP egress entry.
+         */
+        copp_packet_class->ops_copp_egress_fp_entry[unit] =
+                                xzalloc(sizeof(opennsl_field_entry_t));
 
-    return(OPS_COPP_SUCCESS_CODE);
-}
+        /*
+         * Create a new egress FP entry in the egress group for the
+         * given unit.
+         */
+        retval= opennsl_field_entry_create(
+                            unit, ops_copp_egress_fp_group_array[unit],
+                            copp_packet_class->ops_copp_egress_fp_entry[unit]);
 
-/*
- * ops_copp_egress_fp_icmpv4_ucast
- *
- * This function programs the qualifiers for identifying a ICMPv4 unicast
- * packet in egress pipeline.
- */
-int ops_copp_egress_fp_icmpv4_ucast (uint32 unit,
-                                     opennsl_field_entry_t* egress_fp_entry,
-                                     uint8 ingress_cpu_queue_number)
-{
-    uint8                  prot_type = OPS_COPP_IP_PROTOCOL_IPV4_NUMBER_ICMP;
-    uint8                  prot_mask = OPS_COPP_IP_PROTOCOL_IP_NUMBER_MASK;
-    opennsl_port_t         port = OPS_COPP_OUT_PORT;
-    opennsl_port_t         port_mask = OPS_COPP_OUT_PORT_MASK;
-    int32                  retval = -1;
-
-    if (!egress_fp_entry) {
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    /*
-     * Add the FP qualifier rules for ICMPv4 unicast packets. Qualify the
-     * ICMPv4 unicast packets on the following rules:-
-     * 1. The protocol in IP packet is ICMP.
-     * 2. The packet should be an IPv4 packet
-     * 3. The out port should be zero as the packet is destined to CPU.
-     * 4  The packet's meta data should contain the CPU queue set in ingress
-     *    pipeline.
-     */
-    retval = opennsl_field_qualify_IpProtocol(unit, *egress_fp_entry,
-                                              prot_type, prot_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on IP protocol "
-                 "number %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_IpType(unit, *egress_fp_entry,
-                                          opennslFieldIpTypeIpv4Any);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on ipv4 packet type "
-                 " %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_OutPort(unit, *egress_fp_entry,
-                                           port, port_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on out port %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_CpuQueue(unit,
-                             *egress_fp_entry, ingress_cpu_queue_number, 0xff);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on CPU queue %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    return(OPS_COPP_SUCCESS_CODE);
-}
-
-/*
- * ops_copp_ingress_fp_icmpv4_bcast
- *
- * This function programs the qualifiers for identifying a ICMPv4 broadcast
- * packet in ingress pipeline.
- */
-int ops_copp_ingress_fp_icmpv4_bcast (
-                                uint32 unit,
-                                opennsl_field_entry_t* ingress_fp_entry)
-{
-    uint8                  prot_type = OPS_COPP_IP_PROTOCOL_IPV4_NUMBER_ICMP;
-    uint8                  prot_mask = OPS_COPP_IP_PROTOCOL_IP_NUMBER_MASK;
-    int32                  retval = -1;
-
-    if (!ingress_fp_entry) {
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    /*
-     * Add the FP qualifier rules for ICMPv4 broadcast packets. Qualify the
-     * ICMPv4 broadcast packets on the following rules:-
-     * 1. The protocol in IP packet is ICMP.
-     * 2. The packet should be an IPv4 packet
-     * 3. The destination IP address is 255.255.255.255
-     */
-    retval = opennsl_field_qualify_IpProtocol(unit, *ingress_fp_entry,
-                                              prot_type, prot_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on IP protocol "
-                 "number %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_IpType(unit, *ingress_fp_entry,
-                                          opennslFieldIpTypeIpv4Any);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on ipv4 packet type "
-                 " %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_DstIp(
-                                unit, *ingress_fp_entry,
-                                inet_network(OPS_COPP_L3_IPV4_BROADCAST_ADDR),
-                                inet_network(OPS_COPP_L3_IPV4_ADDR_MASK));
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on broadcast "
-                 "IP address  %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    return(OPS_COPP_SUCCESS_CODE);
-}
-
-/*
- * ops_copp_ingress_fp_icmpv4_mcast
- *
- * This function programs the qualifiers for identifying a ICMPv4 multicast
- * packet in ingress pipeline.
- */
-int ops_copp_ingress_fp_icmpv4_mcast (
-                                uint32 unit,
-                                opennsl_field_entry_t* ingress_fp_entry)
-{
-    uint8                  prot_type = OPS_COPP_IP_PROTOCOL_IPV4_NUMBER_ICMP;
-    uint8                  prot_mask = OPS_COPP_IP_PROTOCOL_IP_NUMBER_MASK;
-    int32                  retval = -1;
-
-    if (!ingress_fp_entry) {
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    /*
-     * Add the FP qualifier rules for ICMPv4 multicast packets. Qualify the
-     * ICMPv4 multicast packets on the following rules:-
-     * 1. The protocol in IP packet is ICMP.
-     * 2. The packet should be an IPv4 packet
-     * 3. The destination IP address is within the range 224.0.0.0 to
-     *    239.255.255.255.
-     */
-    retval = opennsl_field_qualify_IpProtocol(unit, *ingress_fp_entry,
-                                              prot_type, prot_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on IP protocol "
-                 "number %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_IpType(unit, *ingress_fp_entry,
-                                          opennslFieldIpTypeIpv4Any);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on ipv4 packet type "
-                 " %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_DstIp(
-                                unit, *ingress_fp_entry,
-                                inet_network(OPS_COPP_L3_IPV4_MCAST_ADDR),
-                                inet_network(OPS_COPP_L3_IPV4_MCAST_ADDR_MASK));
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on multicast "
-                 "IP address  %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    return(OPS_COPP_SUCCESS_CODE);
-}
-
-/*
- * ops_copp_egress_fp_icmpv4_bcast_mcast
- *
- * This function programs the qualifiers for identifying a ICMPv4 broadcast
- * or multicast packet in egress pipeline.
- */
-int ops_copp_egress_fp_icmpv4_bcast_mcast (
-                                      uint32 unit,
-                                      opennsl_field_entry_t* egress_fp_entry,
-                                      uint8 ingress_cpu_queue_number)
-{
-    uint8                  prot_type = OPS_COPP_IP_PROTOCOL_IPV4_NUMBER_ICMP;
-    uint8                  prot_mask = OPS_COPP_IP_PROTOCOL_IP_NUMBER_MASK;
-    opennsl_port_t         port = OPS_COPP_OUT_PORT;
-    opennsl_port_t         port_mask = OPS_COPP_OUT_PORT_MASK;
-    int32                  retval = -1;
-
-    if (!egress_fp_entry) {
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    /*
-     * Add the FP qualifier rules for ICMPv4 broadcast/multicast packets.
-     * Qualify the ICMPv4 broadcast/multicast packets on the following rules:-
-     * 1. The protocol in IP packet is ICMP.
-     * 2. The packet should be an IPv4 packet
-     * 3. The out port should be zero as the packet is destined to CPU.
-     * 4  The packet's meta data should contain the CPU queue set in ingress
-     *    pipeline.
-     */
-    retval = opennsl_field_qualify_IpProtocol(unit, *egress_fp_entry,
-                                              prot_type, prot_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on IP protocol "
-                 "number %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_IpType(unit, *egress_fp_entry,
-                                          opennslFieldIpTypeIpv4Any);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on ipv4 packet type "
-                 " %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_OutPort(unit, *egress_fp_entry,
-                                           port, port_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on out port %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_CpuQueue(unit,
-                             *egress_fp_entry, ingress_cpu_queue_number, 0xff);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on CPU queue %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    return(OPS_COPP_SUCCESS_CODE);
-}
-
-/*
- * ops_copp_ingress_fp_icmpv6_ucast
- *
- * This function programs the qualifiers for identifying a ICMPv6 unicast
- * packet in ingress pipeline.
- */
-int ops_copp_ingress_fp_icmpv6_ucast (
-                                uint32 unit,
-                                opennsl_field_entry_t* ingress_fp_entry)
-{
-    uint8                  address_data = OPS_COPP_DST_IP_LOCAL_DATA;
-    uint8                  address_mask = OPS_COPP_DST_IP_LOCAL_MASK;
-    uint8                  prot_type = OPS_COPP_IP_PROTOCOL_IPV6_NUMBER_ICMP;
-    uint8                  prot_mask = OPS_COPP_IP_PROTOCOL_IP_NUMBER_MASK;
-    int32                  retval = -1;
-
-    if (!ingress_fp_entry) {
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    /*
-     * Add the FP qualifier rules for ICMPv4 unicast packets. Qualify the
-     * ICMPv6 unicast packets on the following rules:-
-     * 1. The destination IPv6 address is local to the box
-     * 2. The packet should be an IPv6 packet
-     * 3. The protocol in IPv6 packet is ICMPv6.
-     */
-    retval = opennsl_field_qualify_Ip6NextHeader(unit, *ingress_fp_entry,
-                                                 prot_type, prot_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on IPv6 protocol "
-                 "number %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_IpType(unit, *ingress_fp_entry,
-                                          opennslFieldIpTypeIpv6);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on ipv4 packet type "
-                 " %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_DstIpLocal(unit, *ingress_fp_entry,
-                                              address_data, address_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on destination "
-                 "IP being Local %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    return(OPS_COPP_SUCCESS_CODE);
-}
-
-/*
- * ops_copp_egress_fp_icmpv6_ucast
- *
- * This function programs the qualifiers for identifying a ICMPv6 unicast
- * packet in ingress pipeline.
- */
-int ops_copp_egress_fp_icmpv6_ucast (uint32 unit,
-                                     opennsl_field_entry_t* egress_fp_entry,
-                                     uint8 ingress_cpu_queue_number)
-{
-    uint8                  prot_type = OPS_COPP_IP_PROTOCOL_IPV6_NUMBER_ICMP;
-    uint8                  prot_mask = OPS_COPP_IP_PROTOCOL_IP_NUMBER_MASK;
-    opennsl_port_t         port = OPS_COPP_OUT_PORT;
-    opennsl_port_t         port_mask = OPS_COPP_OUT_PORT_MASK;
-    int32                  retval = -1;
-
-    if (!egress_fp_entry) {
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    /*
-     * Add the FP qualifier rules for ICMPv4 unicast packets. Qualify the
-     * ICMPv4 unicast packets on the following rules:-
-     * 1. The protocol in IPv6 packet is ICMPv6.
-     * 2. The packet should be an IPv6 packet
-     * 3. The out port should be zero as the packet is destined to CPU.
-     * 4  The packet's meta data should contain the CPU queue set in ingress
-     *    pipeline.
-     */
-    retval = opennsl_field_qualify_Ip6NextHeader(unit, *egress_fp_entry,
-                                                 prot_type, prot_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on IPv6 protocol "
-                 "number %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_IpType(unit, *egress_fp_entry,
-                                          opennslFieldIpTypeIpv6);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on ipv4 packet type "
-                 " %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_OutPort(unit, *egress_fp_entry,
-                                           port, port_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on out port %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_CpuQueue(unit,
-                             *egress_fp_entry, ingress_cpu_queue_number, 0xff);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on CPU queue %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    return(OPS_COPP_SUCCESS_CODE);
-}
-
-/*
- * ops_copp_ingress_fp_icmpv6_mcast
- *
- * This function programs the qualifiers for identifying a ICMPv6 multicast
- * packet in ingress pipeline.
- */
-int ops_copp_ingress_fp_icmpv6_mcast (
-                                uint32 unit,
-                                opennsl_field_entry_t* ingress_fp_entry)
-{
-    uint8                  prot_type = OPS_COPP_IP_PROTOCOL_IPV6_NUMBER_ICMP;
-    uint8                  prot_mask = OPS_COPP_IP_PROTOCOL_IP_NUMBER_MASK;
-    opennsl_ip6_t          ipv6_mcast_addr = OPS_COPP_L3_IPV6_MCAST_ADDR;
-    opennsl_ip6_t          ipv6_mcast_addr_mask = OPS_COPP_L3_IPV6_MCAST_ADDR_MASK;
-    int32                  retval = -1;
-
-    if (!ingress_fp_entry) {
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    /*
-     * Add the FP qualifier rules for ICMPv6 multicast packets. Qualify the
-     * ICMPv6 multicast packets on the following rules:-
-     * 1. The destination IPv6 address should be IPv6 multicast
-     * 2. The packet should be an IPv6 packet
-     * 3. The protocol in IPv6 packet is ICMPv6.
-     */
-    retval = opennsl_field_qualify_Ip6NextHeader(unit, *ingress_fp_entry,
-                                                 prot_type, prot_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on IPv6 protocol "
-                 "number %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_IpType(unit, *ingress_fp_entry,
-                                          opennslFieldIpTypeIpv6);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on ipv4 packet type "
-                 " %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_DstIp6(unit, *ingress_fp_entry,
-                                          ipv6_mcast_addr, ipv6_mcast_addr_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on destination "
-                 "IPv6 being multicast %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    return(OPS_COPP_SUCCESS_CODE);
-}
-
-/*
- * ops_copp_egress_fp_icmpv6_mcast
- *
- * This function programs the qualifiers for identifying a ICMPv6 multicast
- * packet in ingress pipeline.
- */
-int ops_copp_egress_fp_icmpv6_mcast (uint32 unit,
-                                     opennsl_field_entry_t* egress_fp_entry,
-                                     uint8 ingress_cpu_queue_number)
-{
-    uint8                  prot_type = OPS_COPP_IP_PROTOCOL_IPV6_NUMBER_ICMP;
-    uint8                  prot_mask = OPS_COPP_IP_PROTOCOL_IP_NUMBER_MASK;
-    opennsl_port_t         port = OPS_COPP_OUT_PORT;
-    opennsl_port_t         port_mask = OPS_COPP_OUT_PORT_MASK;
-    int32                  retval = -1;
-
-    if (!egress_fp_entry) {
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    /*
-     * Add the FP qualifier rules for ICMPv6 multicast packets. Qualify the
-     * ICMPv6 multicast packets on the following rules:-
-     * 1. The protocol in IPv6 packet is ICMPv6.
-     * 2. The packet should be an IPv6 packet
-     * 3. The out port should be zero as the packet is destined to CPU.
-     * 4  The packet's meta data should contain the CPU queue set in ingress
-     *    pipeline.
-     */
-    retval = opennsl_field_qualify_Ip6NextHeader(unit, *egress_fp_entry,
-                                                 prot_type, prot_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on IPv6 protocol "
-                 "number %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_IpType(unit, *egress_fp_entry,
-                                          opennslFieldIpTypeIpv6);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on ipv4 packet type "
-                 " %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_OutPort(unit, *egress_fp_entry,
-                                           port, port_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on out port %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_CpuQueue(unit,
-                             *egress_fp_entry, ingress_cpu_queue_number, 0xff);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on CPU queue %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    return(OPS_COPP_SUCCESS_CODE);
-}
-
-/*
- * ops_copp_ingress_fp_ospfv2_dr_mcast
- *
- * This function programs the qualifiers for identifying a OSPFv2 dr
- * multicast packet in ingress pipeline.
- */
-int ops_copp_ingress_fp_ospfv2_dr_mcast (
-                                uint32 unit,
-                                opennsl_field_entry_t* ingress_fp_entry)
-{
-    uint8                  prot_type = OPS_COPP_IP_PROTOCOL_IP_NUMBER_OSPFV2;
-    uint8                  prot_mask = OPS_COPP_IP_PROTOCOL_IP_NUMBER_MASK;
-    int32                  retval = -1;
-    opennsl_mac_t          dr_mac = OPS_COPP_OSPF_MAC_DR_ROUTERS;
-    opennsl_mac_t          mac_mask = OPS_COPP_L2_ADDR_MASK;
-
-    if (!ingress_fp_entry) {
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    /*
-     * Add the FP qualifier rules for OSPFv2 dr multicast packets. Qualify the
-     * OSPFv2 dr multicast packets on the following rules:-
-     * 1. The protocol in IP packet is OSPFv2.
-     * 2. The packet should be an IPv4 packet
-     * 3. The destination MAC address should be OSPFv2 dr router MAC
-     * 4. The destination IP address should be OSPFv2 dr router IP.
-     */
-    retval = opennsl_field_qualify_IpProtocol(unit, *ingress_fp_entry,
-                                              prot_type, prot_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on IP protocol "
-                 "number %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_IpType(unit, *ingress_fp_entry,
-                                          opennslFieldIpTypeIpv4Any);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on ipv4 packet type "
-                 " %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_DstMac(unit, *ingress_fp_entry,
-                                          dr_mac, mac_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on dr multicast "
-                 "OSPFv2 MAC  %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_DstIp(
-                                unit, *ingress_fp_entry,
-                                inet_network(OPS_COPP_OSPF_IPV4_DR_POUTERS),
-                                inet_network(OPS_COPP_L3_IPV4_ADDR_MASK));
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on dr multicast "
-                 "OSPFv2 IP address  %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    return(OPS_COPP_SUCCESS_CODE);
-}
-
-/*
- * ops_copp_ingress_fp_ospfv2_all_mcast
- *
- * This function programs the qualifiers for identifying a OSPFv2 all
- * multicast packet in ingress pipeline.
- */
-int ops_copp_ingress_fp_ospfv2_all_mcast (
-                                uint32 unit,
-                                opennsl_field_entry_t* ingress_fp_entry)
-{
-    uint8                  prot_type = OPS_COPP_IP_PROTOCOL_IP_NUMBER_OSPFV2;
-    uint8                  prot_mask = OPS_COPP_IP_PROTOCOL_IP_NUMBER_MASK;
-    int32                  retval = -1;
-    opennsl_mac_t          all_mac = OPS_COPP_OSPF_MAC_ALL_ROUTERS;
-    opennsl_mac_t          mac_mask = OPS_COPP_L2_ADDR_MASK;
-
-    if (!ingress_fp_entry) {
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    /*
-     * Add the FP qualifier rules for OSPFv2 all multicast packets. Qualify the
-     * OSPFv2 all multicast packets on the following rules:-
-     * 1. The protocol in IP packet is OSPFv2.
-     * 2. The packet should be an IPv4 packet
-     * 3. The destination MAC address should be OSPFv2 all router MAC
-     * 4. The destination IP address should be OSPFv2 all router IP.
-     */
-    retval = opennsl_field_qualify_IpProtocol(unit, *ingress_fp_entry,
-                                              prot_type, prot_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on IP protocol "
-                 "number %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_IpType(unit, *ingress_fp_entry,
-                                          opennslFieldIpTypeIpv4Any);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on ipv4 packet type "
-                 " %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_DstMac(unit, *ingress_fp_entry,
-                                          all_mac, mac_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on all multicast "
-                 "OSPFv2 MAC  %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_DstIp(
-                                unit, *ingress_fp_entry,
-                                inet_network(OPS_COPP_OSPF_IPV4_ALL_POUTERS),
-                                inet_network(OPS_COPP_L3_IPV4_ADDR_MASK));
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on all multicast "
-                 "OSPFv2 IP address  %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    return(OPS_COPP_SUCCESS_CODE);
-}
-
-/*
- * ops_copp_egress_fp_ospfv2_mcast
- *
- * This function programs the qualifiers for identifying an OSPFv2
- * multicast packet in egress pipeline.
- */
-int ops_copp_egress_fp_ospfv2_mcast (uint32 unit,
-                                     opennsl_field_entry_t* egress_fp_entry,
-                                     uint8 ingress_cpu_queue_number)
-{
-    uint8                  prot_type = OPS_COPP_IP_PROTOCOL_IP_NUMBER_OSPFV2;
-    uint8                  prot_mask = OPS_COPP_IP_PROTOCOL_IP_NUMBER_MASK;
-    opennsl_port_t         port = OPS_COPP_OUT_PORT;
-    opennsl_port_t         port_mask = OPS_COPP_OUT_PORT_MASK;
-    opennsl_mac_t          all_mac = OPS_COPP_OSPF_MAC_ALL_ROUTERS;
-    opennsl_mac_t          mac_mask = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00};
-    int32                  retval = -1;
-
-    if (!egress_fp_entry) {
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    /*
-     * Add the FP qualifier rules for OSPFv2 multicast packets.
-     * Qualify the OSPFv2 multicast packets on the following rules:-
-     * 1. The protocol in IP packet is OSPFv2.
-     * 2. The packet should be an IPv4 packet
-     * 3. The destination IP address is within the range 224.0.0.0 to
-     *    239.255.255.255.
-     * 4. The destination MAC should match 01:00:5E:00:00:XX.
-     * 5. The out port should be zero as the packet is destined to CPU.
-     * 6  The packet's meta data should contain the CPU queue set in ingress
-     *    pipeline.
-     */
-    retval = opennsl_field_qualify_IpProtocol(unit, *egress_fp_entry,
-                                              prot_type, prot_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on IP protocol "
-                 "number %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_IpType(unit, *egress_fp_entry,
-                                          opennslFieldIpTypeIpv4Any);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on ipv4 packet type "
-                 " %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_DstIp(
-                                unit, *egress_fp_entry,
-                                inet_network(OPS_COPP_L3_IPV4_MCAST_ADDR),
-                                inet_network(OPS_COPP_L3_IPV4_MCAST_ADDR_MASK));
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on multicast "
-                 "IP address  %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_DstMac(unit, *egress_fp_entry,
-                                          all_mac, mac_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on all multicast "
-                 "OSPFv2 MAC  %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_OutPort(unit, *egress_fp_entry,
-                                           port, port_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on out port %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_CpuQueue(unit,
-                             *egress_fp_entry, ingress_cpu_queue_number, 0xff);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on CPU queue %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    return(OPS_COPP_SUCCESS_CODE);
-}
-
-/*
- * ops_copp_ingress_fp_ospfv2_ucast
- *
- * This function programs the qualifiers for identifying a OSPFv2 unicast
- * packet in ingress pipeline.
- */
-int ops_copp_ingress_fp_ospfv2_ucast (
-                                uint32 unit,
-                                opennsl_field_entry_t* ingress_fp_entry)
-{
-    uint8                  address_data = OPS_COPP_DST_IP_LOCAL_DATA;
-    uint8                  address_mask = OPS_COPP_DST_IP_LOCAL_MASK;
-    uint8                  prot_type = OPS_COPP_IP_PROTOCOL_IP_NUMBER_OSPFV2;
-    uint8                  prot_mask = OPS_COPP_IP_PROTOCOL_IP_NUMBER_MASK;
-    int32                  retval = -1;
-
-    if (!ingress_fp_entry) {
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    /*
-     * Add the FP qualifier rules for OSPFv2 unicast packets. Qualify the
-     * OSPFv2 unicast packets on the following rules:-
-     * 1. The protocol in IP packet is OSPFv2.
-     * 2. The packet should be an IPv4 packet
-     * 3. The destination IP address is local to the box
-     */
-    retval = opennsl_field_qualify_IpProtocol(unit, *ingress_fp_entry,
-                                              prot_type, prot_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on IP protocol "
-                 "number %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_IpType(unit, *ingress_fp_entry,
-                                          opennslFieldIpTypeIpv4Any);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on ipv4 packet type "
-                 " %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_DstIpLocal(unit, *ingress_fp_entry,
-                                              address_data, address_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on destination "
-                 "IP being Local %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    return(OPS_COPP_SUCCESS_CODE);
-}
-
-/*
- * ops_copp_egress_fp_ospfv2_ucast
- *
- * This function programs the qualifiers for identifying a OSPFv2 unicast
- * packet in ingress pipeline.
- */
-int ops_copp_egress_fp_ospfv2_ucast (uint32 unit,
-                                     opennsl_field_entry_t* egress_fp_entry,
-                                     uint8 ingress_cpu_queue_number)
-{
-    uint8                  prot_type = OPS_COPP_IP_PROTOCOL_IP_NUMBER_OSPFV2;
-    uint8                  prot_mask = OPS_COPP_IP_PROTOCOL_IP_NUMBER_MASK;
-    opennsl_port_t         port = OPS_COPP_OUT_PORT;
-    opennsl_port_t         port_mask = OPS_COPP_OUT_PORT_MASK;
-    int32                  retval = -1;
-
-    if (!egress_fp_entry) {
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    /*
-     * Add the FP qualifier rules for OSPFv2 unicast packets. Qualify the
-     * OSPFv2 unicast packets on the following rules:-
-     * 1. The protocol in IP packet is OSPFv2.
-     * 2. The packet should be an IPv4 packet
-     * 3. The out port should be zero as the packet is destined to CPU.
-     * 4  The packet's meta data should contain the CPU queue set in ingress
-     *    pipeline.
-     */
-    retval = opennsl_field_qualify_IpProtocol(unit, *egress_fp_entry,
-                                              prot_type, prot_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on IP protocol "
-                 "number %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_IpType(unit, *egress_fp_entry,
-                                          opennslFieldIpTypeIpv4Any);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on ipv4 packet type "
-                 " %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_OutPort(unit, *egress_fp_entry,
-                                           port, port_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on out port %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_CpuQueue(unit,
-                             *egress_fp_entry, ingress_cpu_queue_number, 0xff);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on CPU queue %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    return(OPS_COPP_SUCCESS_CODE);
-}
-
-/*
- * ops_copp_ingress_fp_ipv4_options
- *
- * This function programs the qualifiers for identifying an IPv4 options
- * packet in ingress pipeline.
- */
-int ops_copp_ingress_fp_ipv4_options (
-                                uint32 unit,
-                                opennsl_field_entry_t* ingress_fp_entry)
-{
-    int32                  retval = -1;
-
-    if (!ingress_fp_entry) {
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    /*
-     * Add the FP qualifier rules for IPv4 oprions packets. Qualify the
-     * IPv4 options packets on the following rules:-
-     * 1. The packet should be an IPv4 packet
-     * 2. The IP packet should have options feild should be set.
-     */
-    retval = opennsl_field_qualify_IpType(unit, *ingress_fp_entry,
-                                          opennslFieldIpTypeIpv4Any);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on ipv4 packet type "
-                 " %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_IpType(unit, *ingress_fp_entry,
-                                          opennslFieldIpTypeIpv4WithOpts);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on ipv4 options"
-                 " %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    return(OPS_COPP_SUCCESS_CODE);
-}
-
-/*
- * ops_copp_egress_fp_ipv4_options
- *
- * This function programs the qualifiers for identifying an IPv4 options
- * packet in egress pipeline.
- */
-int ops_copp_egress_fp_ipv4_options (uint32 unit,
-                                     opennsl_field_entry_t* egress_fp_entry,
-                                     uint8 ingress_cpu_queue_number)
-{
-    int32                  retval = -1;
-    opennsl_port_t         port = OPS_COPP_OUT_PORT;
-    opennsl_port_t         port_mask = OPS_COPP_OUT_PORT_MASK;
-
-    if (!egress_fp_entry) {
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    /*
-     * Add the FP qualifier rules for IPv4 oprions packets. Qualify the
-     * IPv4 options packets on the following rules:-
-     * 1. The packet should be an IPv4 packet
-     * 2. The IP packet should have options feild should be set.
-     * 3. The out port should be zero as the packet is destined to CPU.
-     * 4  The packet's meta data should contain the CPU queue set in ingress
-     *    pipeline.
-     */
-    retval = opennsl_field_qualify_IpType(unit, *egress_fp_entry,
-                                          opennslFieldIpTypeIpv4Any);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on ipv4 packet type "
-                 " %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_IpType(unit, *egress_fp_entry,
-                                          opennslFieldIpTypeIpv4WithOpts);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on ipv4 options"
-                 " %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_OutPort(unit, *egress_fp_entry,
-                                           port, port_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on out port %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_CpuQueue(unit,
-                             *egress_fp_entry, ingress_cpu_queue_number, 0xff);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on CPU queue %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    return(OPS_COPP_SUCCESS_CODE);
-}
-
-/*
- * ops_copp_ingress_fp_ipv6_options
- *
- * This function programs the qualifiers for identifying an IPv6 options
- * packet in ingress pipeline.
- */
-int ops_copp_ingress_fp_ipv6_options (
-                                uint32 unit,
-                                opennsl_field_entry_t* ingress_fp_entry)
-{
-    int32                  retval = -1;
-
-    if (!ingress_fp_entry) {
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    /*
-     * Add the FP qualifier rules for IPv6 oprions packets. Qualify the
-     * IPv4 options packets on the following rules:-
-     * 1. The packet should be an IPv6 packet
-     * 2. The IPv6 packet should have options feild should be set.
-     */
-    retval = opennsl_field_qualify_IpType(unit, *ingress_fp_entry,
-                                          opennslFieldIpTypeIpv6);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on ipv6 packet type "
-                 " %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_IpType(unit, *ingress_fp_entry,
-                                          opennslFieldIpTypeIpv6OneExtHdr);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Ingress: Failed to qualify on ipv6 options"
-                 " %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    return(OPS_COPP_SUCCESS_CODE);
-}
-
-/*
- * ops_copp_egress_fp_ipv6_options
- *
- * This function programs the qualifiers for identifying an IPv6 options
- * packet in egress pipeline.
- */
-int ops_copp_egress_fp_ipv6_options (uint32 unit,
-                                     opennsl_field_entry_t* egress_fp_entry,
-                                     uint8 ingress_cpu_queue_number)
-{
-    int32                  retval = -1;
-    opennsl_port_t         port = OPS_COPP_OUT_PORT;
-    opennsl_port_t         port_mask = OPS_COPP_OUT_PORT_MASK;
-
-    if (!egress_fp_entry) {
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    /*
-     * Add the FP qualifier rules for IPv6 oprions packets. Qualify the
-     * IPv6 options packets on the following rules:-
-     * 1. The packet should be an IPv6 packet
-     * 2. The IPv6 packet should have options feild should be set.
-     * 3. The out port should be zero as the packet is destined to CPU.
-     * 4  The packet's meta data should contain the CPU queue set in ingress
-     *    pipeline.
-     */
-    retval = opennsl_field_qualify_IpType(unit, *egress_fp_entry,
-                                          opennslFieldIpTypeIpv6);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on ipv6 packet type "
-                 " %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_IpType(unit, *egress_fp_entry,
-                                          opennslFieldIpTypeIpv6OneExtHdr);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on ipv6 options"
-                 " %s \n", opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_OutPort(unit, *egress_fp_entry,
-                                           port, port_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on out port %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_CpuQueue(unit,
-                             *egress_fp_entry, ingress_cpu_queue_number, 0xff);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on CPU queue %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    return(OPS_COPP_SUCCESS_CODE);
-}
-
-/*
- * ops_copp_sflow
- *
- * This function programs the global rx rule for sflow packets.
- */
-int ops_copp_sflow (uint32 unit)
-{
-    uint8                   int_prio=0;
-    uint8                   int_prio_mask=0;
-    uint32                  packet_type = 0;
-    uint32                  packet_type_mask = 0;
-    opennsl_rx_reasons_t    rx_reasons;
-    opennsl_rx_reasons_t    rx_reasons_mask;
-    opennsl_cos_queue_t     cpu_cosq = OPS_COPP_QOS_QUEUE_SFLOW;
-    int32                   retval = -1;
-
-    /*
-     * Set rx reason code for Sampled destination
-     */
-    OPENNSL_RX_REASON_CLEAR_ALL(rx_reasons);
-    OPENNSL_RX_REASON_CLEAR_ALL(rx_reasons_mask);
-    OPENNSL_RX_REASON_SET(rx_reasons, opennslRxReasonSampleDest);
-    OPENNSL_RX_REASON_SET(rx_reasons_mask, opennslRxReasonSampleDest);
-
-    retval = opennsl_rx_cosq_mapping_set(unit, ops_copp_packet_class_rx_index[unit],
-                                         rx_reasons, rx_reasons_mask,
-                                         int_prio, int_prio_mask, packet_type,
-                                         packet_type_mask, cpu_cosq);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Packet class: Failed to program the "
-                 "packet class rule for sampled destination sflow %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    /*
-     * Increment the rx index counter
-     */
-    ops_copp_packet_class_rx_index[unit]++;
-
-    /*
-     * Set rx reason code for Sampled source
-     */
-    OPENNSL_RX_REASON_CLEAR_ALL(rx_reasons);
-    OPENNSL_RX_REASON_CLEAR_ALL(rx_reasons_mask);
-    OPENNSL_RX_REASON_SET(rx_reasons, opennslRxReasonSampleSource);
-    OPENNSL_RX_REASON_SET(rx_reasons_mask, opennslRxReasonSampleSource);
-
-    retval = opennsl_rx_cosq_mapping_set(unit, ops_copp_packet_class_rx_index[unit],
-                                         rx_reasons, rx_reasons_mask,
-                                         int_prio, int_prio_mask, packet_type,
-                                         packet_type_mask, cpu_cosq);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Packet class: Failed to program the "
-                 "packet class rule for sampled source sflow %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    /*
-     * Increment the rx index counter
-     */
-    ops_copp_packet_class_rx_index[unit]++;
-
-    return(OPS_COPP_SUCCESS_CODE);
-}
-
-/*
- * ops_copp_egress_fp_sflow
- *
- * This function programs the qualifiers for matching all sflow
- * packets in egress pipeline.
- */
-int ops_copp_egress_fp_sflow (uint32 unit,
-                              opennsl_field_entry_t* egress_fp_entry,
-                              uint8 ingress_cpu_queue_number)
-{
-    opennsl_port_t         port = OPS_COPP_OUT_PORT;
-    opennsl_port_t         port_mask = OPS_COPP_OUT_PORT_MASK;
-    int32                  retval = -1;
-
-    if (!egress_fp_entry) {
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    /*
-     * Add the FP qualifier rules for sflow packets. Qualify the
-     * sflow packets on the following rules:-
-     * 1. The out port should be zero as the packet is destined to CPU.
-     * 2  The packet's meta data should contain the CPU queue set in ingress
-     *    pipeline.
-     */
-    retval = opennsl_field_qualify_OutPort(unit, *egress_fp_entry,
-                                           port, port_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on out port %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    retval = opennsl_field_qualify_CpuQueue(unit,
-                             *egress_fp_entry, ingress_cpu_queue_number, 0xff);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on CPU queue %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    return(OPS_COPP_SUCCESS_CODE);
-}
-
-/*
- * ops_copp_unknown_ip_unicast
- *
- * This function programs the rx rule for unknown IP packets.
- */
-int ops_copp_unknown_ip_unicast (uint32 unit)
-{
-    uint8                   int_prio=0;
-    uint8                   int_prio_mask=0;
-    uint32                  packet_type = 0;
-    uint32                  packet_type_mask = 0;
-    opennsl_rx_reasons_t    rx_reasons;
-    opennsl_rx_reasons_t    rx_reasons_mask;
-    opennsl_cos_queue_t     cpu_cosq = OPS_COPP_QOS_QUEUE_UNKNOWN_IP;
-    int32                   retval = -1;
-
-    /*
-     * Program rx rule for directing unknown destination IP packets to
-     * appropriate CPU queue.
-     */
-    OPENNSL_RX_REASON_CLEAR_ALL(rx_reasons);
-    OPENNSL_RX_REASON_CLEAR_ALL(rx_reasons_mask);
-    OPENNSL_RX_REASON_SET(rx_reasons, opennslRxReasonL3DestMiss);
-    OPENNSL_RX_REASON_SET(rx_reasons_mask, opennslRxReasonL3DestMiss);
-
-    retval = opennsl_rx_cosq_mapping_set(unit, ops_copp_packet_class_rx_index[unit],
-                                         rx_reasons, rx_reasons_mask,
-                                         int_prio, int_prio_mask, packet_type,
-                                         packet_type_mask, cpu_cosq);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Packet class: Failed to program the "
-                 "packet class rule for dest unknown IP %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    /*
-     * Increment the rx index counter
-     */
-    ops_copp_packet_class_rx_index[unit]++;
-
-    /*
-     * Program the rx rule to send packets with priroty
-     * OPS_COPP_UNKNOWN_IP_COS_RESERVED to unknown IP cpuq
-     */
-    int_prio = OPS_COPP_UNKNOWN_IP_COS_RESERVED;
-    int_prio_mask = 0xff;
-
-    OPENNSL_RX_REASON_CLEAR_ALL(rx_reasons);
-    OPENNSL_RX_REASON_CLEAR_ALL(rx_reasons_mask);
-    retval  = opennsl_rx_cosq_mapping_set(unit,
-                                             ops_copp_packet_class_rx_index[unit],
-                                             rx_reasons, rx_reasons_mask,
-                                             int_prio, int_prio_mask, packet_type,
-                                             packet_type_mask, cpu_cosq);
-
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Packet class: Failed to program the packet"
-                 "class rule for glean packets  %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    /*
-     * Increment the rx index counter
-     */
-    ops_copp_packet_class_rx_index[unit]++;
+        if (OPENNSL_FAILURE(retval)) {
+            VLOG_ERR("     Egress: Failed to create entry: %s\n",
+                     opennsl_errmsg(retval));
+            free(copp_packet_class->ops_copp_egress_fp_entry[unit]);
+            return(OPS_COPP_FAILURE_CODE);
+        }
 
-    return(OPS_COPP_SUCCESS_CODE);
-}
+        /*
+         * Program the FP qualifiers of the egress rule of this packet class.
+         */
+        retval = ops_copp_fp_entry_qualify(unit,
+                          copp_packet_class->ops_copp_egress_fp_entry[unit],
+                          &copp_packet_class->ops_copp_egress_fp_rule, true,
+                          copp_packet_class->ops_copp_ingress_fp_queue_number,
+                          copp_packet_class->ops_copp_packet_name);
+        if (retval != OPS_COPP_SUCCESS_CODE) {
+            VLOG_ERR("     Egress: Failed to add FP qualifiers\n");
+            ops_copp_fp_entry_cleanup(unit,
+                    copp_packet_class->ops_copp_egress_fp_entry[unit]);
+            return(OPS_COPP_FAILURE_CODE);
+        }
 
-/*
- * ops_copp_egress_fp_unknown_ip_unicast
- *
- * This function programs the qualifiers for matching all unknown unicast IP
- * packets in egress pipeline.
- */
-int ops_copp_egress_fp_unknown_ip_unicast (
-                                   uint32 unit,
-                                   opennsl_field_entry_t* egress_fp_entry,
-                                   uint8 ingress_cpu_queue_number)
-{
-    opennsl_port_t         port = OPS_COPP_OUT_PORT;
-    opennsl_port_t         port_mask = OPS_COPP_OUT_PORT_MASK;
-    int32                  retval = -1;
+        /*
+         * Add the action for the egress FP entry to drop the packet if the
+         * rate/burst is exceeded for the control packet.
+         */
+        retval = opennsl_field_action_add(
+                     unit,
+                     *(copp_packet_class->ops_copp_egress_fp_entry[unit]),
+                     opennslFieldActionRpDrop, 0, 0);
+        if (retval != OPS_COPP_SUCCESS_CODE) {
+            VLOG_ERR("     Egress:  Failed to add action  = %s\n",
+                     opennsl_errmsg(retval));
+            ops_copp_fp_entry_cleanup(unit,
+                    copp_packet_class->ops_copp_egress_fp_entry[unit]);
+            return(OPS_COPP_FAILURE_CODE);
+        }
 
-    if (!egress_fp_entry) {
-        return(OPS_COPP_FAILURE_CODE);
-    }
+        /*
+         * Allocate a new policer.
+         */
+        copp_packet_class->ops_copp_egress_fp_policer_id[unit] =
+                                            xzalloc(sizeof(opennsl_policer_t));
 
-    /*
-     * Add the FP qualifier rules for unknown unicast IP packets. Qualify the
-     * unknown unicast IP packets on the following rules:-
-     * 1. The out port should be zero as the packet is destined to CPU.
-     * 2  The packet's meta data should contain the CPU queue set in ingress
-     *    pipeline.
-     */
-    retval = opennsl_field_qualify_OutPort(unit, *egress_fp_entry,
-                                           port, port_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on out port %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
+        if(!(copp_packet_class->ops_copp_egress_fp_policer_id[unit])) {
+            VLOG_ERR("      Egress: Unable to allocate memory for policer");
+            ops_copp_fp_entry_cleanup(unit,
+                    copp_packet_class->ops_copp_egress_fp_entry[unit]);
+            return(OPS_COPP_FAILURE_CODE);
+        }
 
-    retval = opennsl_field_qualify_CpuQueue(unit,
-                             *egress_fp_entry, ingress_cpu_queue_number, 0xff);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on CPU queue %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
+        /*
+         * Create the policier having the default rate/burst.
+         */
+        retval = ops_copp_create_egress_policer_id(
+                       unit,
+                       copp_packet_class->ops_copp_egress_fp_policer_id[unit],
+                       copp_packet_class->ops_copp_egress_fp_rate,
+                       copp_packet_class->ops_copp_egress_fp_burst);
+        if (retval != OPS_COPP_SUCCESS_CODE) {
+            VLOG_ERR("     Egress policer program failure");
+            ops_copp_fp_entry_cleanup(unit,
+                    copp_packet_class->ops_copp_egress_fp_entry[unit]);
+            free(copp_packet_class->ops_copp_egress_fp_policer_id[unit]);
+            return(OPS_COPP_FAILURE_CODE);
+        }
 
-    return(OPS_COPP_SUCCESS_CODE);
-}
+        /*
+         * Attach the policier to the egress FP entry for unicast ARP.
+         */
+        retval = opennsl_field_entry_policer_attach(
+                   unit,
+                   *(copp_packet_class->ops_copp_egress_fp_entry[unit]),
+                   0,
+                   *(copp_packet_class->ops_copp_egress_fp_policer_id[unit]));
+        if (OPENNSL_FAILURE(retval)) {
+            VLOG_ERR("     Egress: Failed to attach the action to FP "
+                     "entry = %s\n", opennsl_errmsg(retval));
+            ops_copp_fp_policer_cleanup(unit,
+                    copp_packet_class->ops_copp_egress_fp_policer_id[unit]);
+            ops_copp_fp_entry_cleanup(unit,
+                    copp_packet_class->ops_copp_egress_fp_entry[unit]);
+            return(OPS_COPP_FAILURE_CODE);
+        }
 
-/*
- * ops_copp_unclassified
- *
- * This function programs the rx rule for unclassified packets.
- * We determine if a control plane packet is unclassified based on
- * the priority set in the packet.
- */
-int ops_copp_unclassified (uint32 unit)
-{
-    uint8                   int_prio_min = OPS_COPP_INT_PRIORITY_MIN;
-    uint8                   int_prio_max = OPS_COPP_INT_PRIORITY_MAX;
-    uint8                   int_prio = 0;
-    uint8                   int_prio_mask = 0xff;
-    uint32                  packet_type = 0;
-    uint32                  packet_type_mask = 0;
-    opennsl_rx_reasons_t    rx_reasons;
-    opennsl_rx_reasons_t    rx_reasons_mask;
-    opennsl_cos_queue_t     cpu_cosq = OPS_COPP_QOS_QUEUE_DEFAULT;
-    int32                   retval = -1;
+        copp_packet_class->ops_copp_egress_fp_stat_id[unit] =
+                                                        xzalloc(sizeof(int));
 
-    OPENNSL_RX_REASON_CLEAR_ALL(rx_reasons);
-    OPENNSL_RX_REASON_CLEAR_ALL(rx_reasons_mask);
+        if (!(copp_packet_class->ops_copp_egress_fp_stat_id[unit])) {
+            VLOG_ERR("     Egress: Unable to allocate for stat id");
+            ops_copp_fp_policer_cleanup(unit,
+                    copp_packet_class->ops_copp_egress_fp_policer_id[unit]);
+            ops_copp_fp_entry_cleanup(unit,
+                    copp_packet_class->ops_copp_egress_fp_entry[unit]);
+            return(OPS_COPP_FAILURE_CODE);
+        }
 
-    for (int_prio = int_prio_min; int_prio <= int_prio_max; ++int_prio) {
+        /*
+         * Create the stats object to count the number of control packets
+         * dropped from being pushed to CPU or sent to CPU from the egress
+         * pipeline.
+         */
+        retval = ops_copp_create_egress_stat_id(
+                    unit, copp_packet_class->ops_copp_egress_fp_stat_id[unit]);
+        if (retval != OPS_COPP_SUCCESS_CODE) {
+            VLOG_ERR("     Egress stat object program failure");
+            ops_copp_fp_policer_cleanup(unit,
+                    copp_packet_class->ops_copp_egress_fp_policer_id[unit]);
+            ops_copp_fp_entry_cleanup(unit,
+                    copp_packet_class->ops_copp_egress_fp_entry[unit]);
+            free(copp_packet_class->ops_copp_egress_fp_stat_id[unit]);
+            return(OPS_COPP_FAILURE_CODE);
+        }
 
         /*
-         * TODO: We could program just one mapping using the appropriate
-         *       mask on the internal priority range from 0-7. But we are keeping
-         *       this logic unless we know that the range of priority values are
-         *       from 0-7 only.
+         * Attach the stats object to the egress FP entry
          */
-        retval = opennsl_rx_cosq_mapping_set(unit,
-                                             ops_copp_packet_class_rx_index[unit],
-                                             rx_reasons, rx_reasons_mask,
-                                             int_prio, int_prio_mask, packet_type,
-                                             packet_type_mask, cpu_cosq);
+        retval = opennsl_field_entry_stat_attach(
+                      unit,
+                      *(copp_packet_class->ops_copp_egress_fp_entry[unit]),
+                      *(copp_packet_class->ops_copp_egress_fp_stat_id[unit]));
         if (OPENNSL_FAILURE(retval)) {
-            VLOG_ERR("     Packet class: Failed to program the "
-                     "packet class rule for unclassified packets %s\n",
-                     opennsl_errmsg(retval));
+            VLOG_ERR("     Egress: Failed to attach the stats object "
+                     "to FP entry = %s\n", opennsl_errmsg(retval));
+            ops_copp_fp_policer_cleanup(unit,
+                    copp_packet_class->ops_copp_egress_fp_policer_id[unit]);
+            ops_copp_fp_statid_cleanup(unit,
+                    copp_packet_class->ops_copp_egress_fp_stat_id[unit]);
+            ops_copp_fp_entry_cleanup(unit,
+                    copp_packet_class->ops_copp_egress_fp_entry[unit]);
             return(OPS_COPP_FAILURE_CODE);
         }
 
         /*
-         * Increment the rx index counter
+         * Install the FP entry into the hardware.
          */
-        ops_copp_packet_class_rx_index[unit]++;
-    }
+        retval = opennsl_field_entry_install(
+                   unit, *(copp_packet_class->ops_copp_egress_fp_entry[unit]));
+        if (OPENNSL_FAILURE(retval)) {
+            VLOG_ERR("     Egress entry program failure: %s\n",
+                     opennsl_errmsg(retval));
+            ops_copp_fp_policer_cleanup(unit,
+                    copp_packet_class->ops_copp_egress_fp_policer_id[unit]);
+            ops_copp_fp_statid_cleanup(unit,
+                    copp_packet_class->ops_copp_egress_fp_stat_id[unit]);
+            ops_copp_fp_entry_cleanup(unit,
+                    copp_packet_class->ops_copp_egress_fp_entry[unit]);
+            return(OPS_COPP_FAILURE_CODE);
+        }
 
-    return(OPS_COPP_SUCCESS_CODE);
-}
+        VLOG_DBG("     Egress: Successfully programmed the FP rule "
+                 "for %s", copp_packet_class->ops_copp_packet_name);
+    }
 
+    /*
+     * If the function is called at the configuration time, then detach
+     * the egress policier and attach a new policier having the new rate
+     * and burst values.
+     */
+    if (if_config_egress_fp_program) {
+        if ((copp_packet_class->ops_copp_egress_fp_rate == *egress_fp_rate)
+            && (copp_packet_class->ops_copp_egress_fp_burst
+                                                    == *egress_fp_burst)) {
 
-/*
- * ops_copp_egress_fp_unclassified
- *
- * This function programs the qualifiers for matching all control packets
- * pn egress pipeline which do not match any preceeding FP rules.
- */
-int ops_copp_egress_fp_unclassified (
-                                   uint32 unit,
-                                   opennsl_field_entry_t* egress_fp_entry,
-                                   uint8 ingress_cpu_queue_number)
-{
-    opennsl_port_t         port = OPS_COPP_OUT_PORT;
-    opennsl_port_t         port_mask = OPS_COPP_OUT_PORT_MASK;
-    int32                  retval = -1;
+            /*
+             * If the new rate and burst values are same as the already
+             * configured values, then do nothing and return from this
+             * function.
+             */
+            VLOG_DBG("     Egress: The current rate/burst %u/%u is same new "
+                     " intended rate/burst %u/%u for %s",
+                     copp_packet_class->ops_copp_egress_fp_rate,
+                     copp_packet_class->ops_copp_egress_fp_burst,
+                     *egress_fp_rate, *egress_fp_burst,
+                     copp_packet_class->ops_copp_packet_name);
+        } else {
 
-    if (!egress_fp_entry) {
-        return(OPS_COPP_FAILURE_CODE);
-    }
+            /*
+             * Detach the current policier from the egress FP entry.
+             */
+            retval = opennsl_field_entry_policer_detach(
+                         unit,
+                         *(copp_packet_class->ops_copp_egress_fp_entry[unit]),
+                         0);
+            if (OPENNSL_FAILURE(retval)) {
+                VLOG_ERR("     Egress: policy detach failed: %s\n",
+                         opennsl_errmsg(retval));
+                return(OPS_COPP_FAILURE_CODE);
+            }
 
-    /*
-     * Add the FP qualifier rules for unclassified packets. Qualify the
-     * unclassified packets on the following rules:-
-     * 1. The out port should be zero as the packet is destined to CPU.
-     * 2  The packet's meta data should contain the CPU queue set in ingress
-     *    pipeline.
-     */
-    retval = opennsl_field_qualify_OutPort(unit, *egress_fp_entry,
-                                           port, port_mask);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on out port %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
+            /*
+             * Install the FP entry into the hardware to detach the policer
+             * completely from the egress FP entry.
+             */
+            retval = opennsl_field_entry_install(
+                       unit,
+                       *(copp_packet_class->ops_copp_egress_fp_entry[unit]));
+            if (OPENNSL_FAILURE(retval)) {
+                VLOG_ERR("     Egress entry reprogram failure: %s\n",
+                        opennsl_errmsg(retval));
+                return(OPS_COPP_FAILURE_CODE);
+            }
 
-    retval = opennsl_field_qualify_CpuQueue(unit,
-                             *egress_fp_entry, ingress_cpu_queue_number, 0xff);
-    if (OPENNSL_FAILURE(retval)) {
-        VLOG_ERR("     Egress: Failed to qualify on CPU queue %s\n",
-                 opennsl_errmsg(retval));
-        return(OPS_COPP_FAILURE_CODE);
-    }
+            /*
+             * Destroy the policer and free hardware resources.
+             */
+            retval = opennsl_policer_destroy(unit,
+                        *(copp_packet_class->ops_copp_egress_fp_policer_id[unit]));
+            if (OPENNSL_FAILURE(retval)) {
+                VLOG_ERR("     Egress policer destroy failure: %s\n",
+                        opennsl_errmsg(retval));
+                return(OPS_COPP_FAILURE_CODE);
+            }
 
-    return(OPS_COPP_SUCCESS_CODE);
-}
+            /*
+             * Create a new policier with the new rate/burst values.
+             */
+            retval = ops_copp_create_egress_policer_id(
+                         unit,
+                         copp_packet_class->ops_copp_egress_fp_policer_id[unit],
+                         *egress_fp_rate,
+                         *egress_fp_burst);
+            if (retval != OPS_COPP_SUCCESS_CODE) {
+                VLOG_ERR("     Egress policer update failure: %s\n",
+                        opennsl_errmsg(retval));
+                return(OPS_COPP_FAILURE_CODE);
+            }
 
-/*
- * ops_copp_packet_class_set_status
- *
- * This function sets the status value in the global structure for copp
- * to the value specified in the input parameters.
- */
-static int ops_copp_packet_class_set_status(
-                              uint32 unit,
-                              enum ops_copp_packet_class_code_t packet_class,
-                              bool status_value)
-{
-    struct ops_copp_fp_rule_t* copp_packet_class = NULL;
+            /*
+             * Attach the new policier from the FP entry.
+             * Install the FP entry into the hardware.
+             */
+            retval = opennsl_field_entry_policer_attach(
+                     unit,
+                     *(copp_packet_class->ops_copp_egress_fp_entry[unit]),
+                     0,
+                     *(copp_packet_class->ops_copp_egress_fp_policer_id[unit]));
+            if (OPENNSL_FAILURE(retval)) {
+                VLOG_ERR("     Egress: Failure to attach a new policer to "
+                         "the FP entry = %s\n", opennsl_errmsg(retval));
+                return(OPS_COPP_FAILURE_CODE);
+            }
 
-    /*
-     * If the packet class is not valid, then do not do anything and
-     * return from this function.
-     */
-    if ((packet_class < 0) ||
-        (packet_class >= PLUGIN_COPP_MAX_CLASSES)) {
-        VLOG_ERR("Not a valid packet class");
-        return(OPS_COPP_FAILURE_CODE);
-    }
+            /*
+             * Install the FP entry into the hardware.
+             */
+            retval = opennsl_field_entry_install(
+                       unit,
+                       *(copp_packet_class->ops_copp_egress_fp_entry[unit]));
+            if (OPENNSL_FAILURE(retval)) {
+                VLOG_ERR("     Egress entry reprogram failure: %s\n",
+                        opennsl_errmsg(retval));
+                return(OPS_COPP_FAILURE_CODE);
+            }
 
-    /*
-     * If the unit is not valid, then do not do anything and
-     * return from this function raising a failure.
-     */
-    if ((unit < 0) || (unit >= OPS_COPP_MAX_UNITS)) {
-        VLOG_ERR("Not a valid unit");
-        return(OPS_COPP_FAILURE_CODE);
-    }
+            VLOG_DBG("     Egress: Successfully updated rate/burst %u/%u "
+                     "to new rate/burst %u/%u for %s",
+                     copp_packet_class->ops_copp_egress_fp_rate,
+                     copp_packet_class->ops_copp_egress_fp_burst,
+                     *egress_fp_rate, *egress_fp_burst,
+                     copp_packet_class->ops_copp_packet_name);
 
-    /*
-     * Get the pointer reference to the control packet rule.
-     */
-    copp_packet_class = &ops_copp_packet_class_t[packet_class];
-    if (copp_packet_class == NULL) {
-        VLOG_ERR("Global Copp structure not present for pkt class %d",
-                  packet_class);
-        return(OPS_COPP_FAILURE_CODE);
+            /*
+             * Copy the new rates/burst into the configured FP rules.
+             */
+            copp_packet_class->ops_copp_egress_fp_rate = *egress_fp_rate;
+            copp_packet_class->ops_copp_egress_fp_burst = *egress_fp_burst;
+        }
     }
 
-    /*
-     * Set the status value passed into the function for the hw_unit.
-     */
-    copp_packet_class->status[unit] = status_value;
-
     return(OPS_COPP_SUCCESS_CODE);
 }
 
 /*
- * ops_copp_packet_class_programmer
+ * ops_copp_ingress_fp_group_create
  *
- * This function programs the global packet rules for some packet types for a
- * given hardware unit if only the function pointer for the control plane
- * packet is defined.
+ * This function forms group for CoPP FP rules in ingress pipeline on all the
+ * available hardware units. This function sets the qualifiers needed in the
+ * CoPP group and then iterates over all the hardware units to create the CoPP
+ * group ids.
  */
-static int ops_copp_packet_class_programmer(
-                              uint32 unit,
-                              enum ops_copp_packet_class_code_t packet_class)
+static int ops_copp_ingress_fp_group_create ()
 {
+    opennsl_field_qset_t       OpennslFPQualSetIngress;
     int32                      retval = -1;
-    struct ops_copp_fp_rule_t* copp_packet_class = NULL;
+    int                        unit_iterator;
 
-    /*
-     * If the packet class is not valid, then do not do anything and
-     * return from this function.
-     */
-    if ((packet_class < 0) ||
-        (packet_class >= PLUGIN_COPP_MAX_CLASSES)) {
-        VLOG_ERR("Not a valid packet class");
-        return(OPS_COPP_FAILURE_CODE);
-    }
+    OPENNSL_FIELD_QSET_INIT(OpennslFPQualSetIngress);
+    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetIngress,
+                                    opennslFieldQualifyStageIngress);
+    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetIngress,
+                                    opennslFieldQualifyEtherType);
+    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetIngress,
+                                    opennslFieldQualifyPacketRes);
+    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetIngress,
+                                    opennslFieldQualifyL4DstPort);
+    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetIngress,
+                                    opennslFieldQualifyIpProtocol);
+    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetIngress,
+                                    opennslFieldQualifyDstIpLocal);
+    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetIngress,
+                                    opennslFieldQualifyDstIp);
+    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetIngress,
+                                    opennslFieldQualifyIp6NextHeader);
+    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetIngress,
+                                    opennslFieldQualifyIpType);
+    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetIngress,
+                                    opennslFieldQualifyDstMac);
+    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetIngress,
+                                    opennslFieldQualifyDstIp6);
 
     /*
-     * Get the pointer reference to the control packet rule.
+     * Iterate over all the units and create the ingress FP groups
      */
-    copp_packet_class = &ops_copp_packet_class_t[packet_class];
-
-    if (!copp_packet_class) {
-        VLOG_ERR("Invalid pointer to packet class");
-        return(OPS_COPP_FAILURE_CODE);
-    }
+    for (unit_iterator = 0; unit_iterator < OPS_COPP_MAX_UNITS;
+                                                ++unit_iterator) {
+        retval = opennsl_field_group_create(
+                                unit_iterator, OpennslFPQualSetIngress,
+                                FP_GROUP_PRIORITY_2,
+                                &ops_copp_ingress_fp_group_array[
+                                                        unit_iterator]);
 
-    /*
-     * If the function pointer for the control packet is defined,
-     * then call the function for programming the rx rule.
-     */
-    if (copp_packet_class->ops_copp_packet_class_function_pointer) {
-        retval = (*copp_packet_class->ops_copp_packet_class_function_pointer)
-                                                                      (unit);
         if (OPENNSL_FAILURE(retval)) {
-            VLOG_ERR("     Packet class: Failed to program the "
-                     "packet class rule %s\n",
+            VLOG_ERR("\nIngress group create failed : %s\n",
                      opennsl_errmsg(retval));
             return(OPS_COPP_FAILURE_CODE);
         }
-
-        VLOG_DBG("     Packet class: Successfully programmed the "
-                 "packet class rule for %s",
-                 copp_packet_class->ops_copp_packet_name);
     }
 
     return(OPS_COPP_SUCCESS_CODE);
 }
 
 /*
- * ops_copp_ingress_fp_programmer
+ * ops_copp_egress_fp_group_create
  *
- * This function does the following two operations for the control packets:-
- * 1. If the ingress FP entry for the control packet is NULL, then this
- *    function creates a new ingress FP entry and attaches the default CPU
- *    queue number for the control packets. This is the case at the
- *    initialization time when the plugin gets loaded in vswitchd for the
- *    first time.
- * 2. If the ingress FP entry for the control packet is not NULL, then this
- *    function updates the CPU queue for the control packet with the
- *    CPU queue value passed to this function.
+ * This function forms group for CoPP FP rules in egress pipeline on all the
+ * available hardware units. This function sets the qualifiers needed in the
+ * CoPP group and then iterates over all the hardware units to create the CoPP
+ * group ids.
  */
-static int ops_copp_ingress_fp_programmer (
-                              uint32 unit,
-                              enum ops_copp_packet_class_code_t packet_class,
-                              uint32* ingress_fp_queue)
+static int ops_copp_egress_fp_group_create ()
 {
-    int32                        retval = -1;
-    bool                         if_init_ingress_fp_program = false;
-    bool                         if_config_ingress_fp_program = false;
-    int                          ingress_fp_rule_number;
-    struct ops_copp_fp_rule_t*   copp_packet_class = NULL;
-
-    /*
-     * If the packet class is not valid, then do not do anything and
-     * return from this function.
-     */
-    if ((packet_class < 0) ||
-        (packet_class >= PLUGIN_COPP_MAX_CLASSES)) {
-        VLOG_ERR("Not a valid packet class");
-        return(OPS_COPP_FAILURE_CODE);
-    }
-
-    /*
-     * Get the pointer reference to the control packet rule.
-     */
-    copp_packet_class = &ops_copp_packet_class_t[packet_class];
+    opennsl_field_qset_t       OpennslFPQualSetEgress;
+    int32                      retval = -1;
+    int                        unit_iterator;
 
-    if (!copp_packet_class) {
-        VLOG_ERR("Invalid pointer to packet class");
-        return(OPS_COPP_FAILURE_CODE);
-    }
+    OPENNSL_FIELD_QSET_INIT(OpennslFPQualSetEgress);
+    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetEgress,
+                                        opennslFieldQualifyStageEgress);
+    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetEgress,
+                                        opennslFieldQualifyEtherType);
+    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetEgress,
+                                        opennslFieldQualifyOutPort);
+    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetEgress,
+                                        opennslFieldQualifyL4DstPort);
+    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetEgress,
+                                        opennslFieldQualifyIpProtocol);
+    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetEgress,
+                                        opennslFieldQualifyCpuQueue);
+    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetEgress,
+                                        opennslFieldQualifyDstMac);
+    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetEgress,
+                                        opennslFieldQualifyIp6NextHeader);
+    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetEgress,
+                                        opennslFieldQualifyIpType);
+    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetEgress,
+                                        opennslFieldQualifyDstIp);
 
     /*
-     * There are no ingress FP function pointers for ACL logging, sflow,
-     * unknown IP and unclassified packets. So return from this function.
+     * Iterate over all the units and create the egress FP groups
      */
-    if ((packet_class == PLUGIN_COPP_ACL_LOGGING_PACKET) ||
-        (packet_class == PLUGIN_COPP_SFLOW_PACKET) ||
-        (packet_class == PLUGIN_COPP_UNCLASSIFIED_PACKET) ||
-        (packet_class == PLUGIN_COPP_UNKNOWN_IP_UNICAST_PACKET)) {
-        return(OPS_COPP_SUCCESS_CODE);
-    }
+    for (unit_iterator = 0; unit_iterator < OPS_COPP_MAX_UNITS;
+                                                    ++unit_iterator) {
+        retval = opennsl_field_group_create(
+                                    unit_iterator, OpennslFPQualSetEgress,
+                                    FP_GROUP_PRIORITY_2,
+                                    &ops_copp_egress_fp_group_array[
+                                                            unit_iterator]);
 
-    /*
-     * If the ingress FP entry pointer for the control packet is NULL,
-     * then we need to allocate a new FP entry and program the hardware.
-     */
-    if (!(copp_packet_class->ops_copp_ingress_fp_entry[unit][0]) &&
-        copp_packet_class->ops_copp_ingress_fp_funtion_pointer[0]) {
-        if_init_ingress_fp_program = true;
+        if (OPENNSL_FAILURE(retval)) {
+            VLOG_ERR("\nEgress group create failed : %s\n",
+                     opennsl_errmsg(retval));
+            return(OPS_COPP_FAILURE_CODE);
+        }
     }
 
-    /*
-     * If the ingress FP entry pointer for the control packet is not NULL,
-     * then we need to update the FP entry with the new CPU queue value.
-     */
-    if (copp_packet_class->ops_copp_ingress_fp_entry[unit][0] &&
-        ingress_fp_queue) {
-        if_config_ingress_fp_program = true;
-    }
+    return(OPS_COPP_SUCCESS_CODE);
+}
 
-    /*
-     * If we find that this function is neither called at init time or
-     * at CPU queue modification time, then return from this function.
-     */
-    if (!if_init_ingress_fp_program && !if_config_ingress_fp_program) {
-        VLOG_ERR("Invalid use of the ingress function for %s",
-                 copp_packet_class->ops_copp_packet_name);
-        return(OPS_COPP_FAILURE_CODE);
-    }
+/*
+ * ops_copp_program_fp_defaults
+ *
+ * This function iterates over all the hardware units and all the FP
+ * rules for CoPP feature and programs the FP rule entries in the ingress
+ * and egress pipelines with the default values.
+ */
+static int ops_copp_program_fp_defaults ()
+{
+    int32                  retval = -1;
+    int                    unit_iterator;
+    int                    fp_rule_iterator;
 
     /*
-     * If the function is called at the initialization time, then allocate
-     * a new FP entry and program the ingress pipeline with the FP rule.
+     * Iterate over all the hardware units
      */
-    if (if_init_ingress_fp_program) {
-
-        VLOG_DBG("Create a new ingress FP %s entry with default queue number "
-                 "for unit %u", copp_packet_class->ops_copp_packet_name, unit);
-
-        ingress_fp_rule_number = 0;
-        while (copp_packet_class->ops_copp_ingress_fp_funtion_pointer[
-                                                    ingress_fp_rule_number]) {
+    for (unit_iterator = 0; unit_iterator < OPS_COPP_MAX_UNITS;
+                                                        ++unit_iterator) {
 
-            /*
-             * Allocate a new FP ingress entry.
-             */
-            copp_packet_class->ops_copp_ingress_fp_entry[unit][
-                                                ingress_fp_rule_number] =
-                                        xzalloc(sizeof(opennsl_field_entry_t));
+        /*
+         * Iterate over all the FP rules for control packets and program
+         * ingress and egress FP entries.
+         */
+        for (fp_rule_iterator = 0; fp_rule_iterator < PLUGIN_COPP_MAX_CLASSES;
+             ++fp_rule_iterator) {
 
             /*
-             * Create a new ingress FP entry in the ingress group for the
-             * given unit.
+             * Program the control packet class rules for some
+             * control plane packets.
              */
-            retval = opennsl_field_entry_create(
-                        unit, ops_copp_ingress_fp_group_array[unit],
-                        copp_packet_class->ops_copp_ingress_fp_entry[unit][
-                                                     ingress_fp_rule_number]);
+            retval = ops_copp_packet_class_programmer(
+                       unit_iterator, fp_rule_iterator);
 
-            if (OPENNSL_FAILURE(retval)) {
-                VLOG_ERR("     Ingress: Failed to create entry: %s\n",
-                         opennsl_errmsg(retval));
-                free(copp_packet_class->ops_copp_ingress_fp_entry[unit][
-                                                    ingress_fp_rule_number]);
+            if (retval != OPS_COPP_SUCCESS_CODE) {
+                VLOG_ERR("Packet class rule create failed");
+                log_event("COPP_CLASS_PACKET_RULE_FAILURE",
+                           EV_KV("class", "%s",
+                           (ops_copp_packet_class_t[fp_rule_iterator])
+                           .ops_copp_packet_name));
                 return(OPS_COPP_FAILURE_CODE);
             }
 
             /*
-             * Call the function pointer for programming the FP qualifier for this
-             * packet class.
+             * Program the ingress FP entry with default values.
              */
-            retval = (*copp_packet_class->ops_copp_ingress_fp_funtion_pointer[
-                                                      ingress_fp_rule_number])(
-                            unit,
-                            copp_packet_class->ops_copp_ingress_fp_entry[unit][
-                                                         ingress_fp_rule_number]);
+            retval = ops_copp_ingress_fp_programmer(
+                       unit_iterator, fp_rule_iterator, NULL);
+
             if (retval != OPS_COPP_SUCCESS_CODE) {
-                VLOG_ERR("     Ingress: Failed to add FP qualifiers\n");
-                ops_copp_fp_entry_cleanup(unit,
-                        copp_packet_class->ops_copp_ingress_fp_entry[unit][
-                                                          ingress_fp_rule_number]);
+                VLOG_ERR("Ingress FP rule create failed");
+                log_event("COPP_CLASS_INGRESS_FP_CREATE_FAILURE",
+                           EV_KV("class", "%s",
+                           (ops_copp_packet_class_t[fp_rule_iterator])
+                           .ops_copp_packet_name));
                 return(OPS_COPP_FAILURE_CODE);
             }
 
             /*
-             * Add the action for the ingress FP entry to be the default CPU
-             * queue for the control packet.
+             * Program the egress FP entry with default values.
              */
-            retval = opennsl_field_action_add(
-                        unit,
-                        *(copp_packet_class->ops_copp_ingress_fp_entry[unit][
-                                                         ingress_fp_rule_number]),
-                        opennslFieldActionCosQCpuNew,
-                        copp_packet_class->ops_copp_ingress_fp_queue_number, 0);
-            if (OPENNSL_FAILURE(retval)) {
-                VLOG_ERR("     Ingress: Failed to add action for "
-                         "the FP entry %s\n", opennsl_errmsg(retval));
-                ops_copp_fp_entry_cleanup(unit,
-                        copp_packet_class->ops_copp_ingress_fp_entry[unit][
-                                                         ingress_fp_rule_number]);
+            retval = ops_copp_egress_fp_programmer(
+                       unit_iterator, fp_rule_iterator, NULL, NULL);
+
+            if (retval != OPS_COPP_SUCCESS_CODE) {
+                VLOG_ERR("Egress FP rule create failed");
+                log_event("COPP_CLASS_EGRESS_FP_CREATE_FAILURE",
+                           EV_KV("class", "%s",
+                           (ops_copp_packet_class_t[fp_rule_iterator])
+                           .ops_copp_packet_name));
                 return(OPS_COPP_FAILURE_CODE);
             }
 
             /*
-             * Install the FP entry into the hardware.
+             * Set the hardware status in the fp rule structure as valid (true)
              */
-            retval = opennsl_field_entry_install(
-                        unit,
-                        *(copp_packet_class->ops_copp_ingress_fp_entry[unit][
-                                                       ingress_fp_rule_number]));
-            if (OPENNSL_FAILURE(retval)) {
-                VLOG_ERR("     Ingress entry program failure: %s\n",
-                         opennsl_errmsg(retval));
-                ops_copp_fp_entry_cleanup(unit,
-                        copp_packet_class->ops_copp_ingress_fp_entry[unit][
-                                                         ingress_fp_rule_number]);
+            retval = ops_copp_packet_class_set_status(
+                       unit_iterator, fp_rule_iterator, true);
+            if (retval != OPS_COPP_SUCCESS_CODE) {
+                VLOG_ERR("Valid status set for  FP rule create failed");
                 return(OPS_COPP_FAILURE_CODE);
             }
-
-            ingress_fp_rule_number++;
         }
-
-        VLOG_DBG("     Ingress: Successfully programmed the FP rule "
-                 "for %s", copp_packet_class->ops_copp_packet_name);
     }
 
-    /*
-     * If the function is called at the configuration time, then delete
-     * CPU queue current action, attach the new CPU queue action and
-     * install the FP entry into the hardware.
-     */
-    if (if_config_ingress_fp_program) {
+    return(OPS_COPP_SUCCESS_CODE);
+}
 
-        /*
-         * If the new CPU queue value is same as the already configured
-         * value, then do nothing and return from this function.
-         */
-        if (copp_packet_class->ops_copp_ingress_fp_queue_number ==
-            *ingress_fp_queue) {
+/*
+ * CoPP policer auto-tuning.
+ *
+ * When enabled, ops_copp_run() looks once per OPS_COPP_TUNE_PERIOD_MS at
+ * the allowed and dropped packet counters of every control packet class,
+ * taken from the stats snapshot, and at the drop counters of the CPU
+ * queues:-
+ * 1. A protocol class (one having ingress FP rules) dropping packets for
+ *    OPS_COPP_TUNE_DROP_PERIODS periods in a row gets its rate raised by
+ *    half, up to its ceiling, unless its CPU queue drops as well, as a
+ *    higher rate would only move the drops to the queue.
+ * 2. A class using less than a quarter of its rate for
+ *    OPS_COPP_TUNE_IDLE_PERIODS periods in a row gets its rate lowered by
+ *    a quarter, down to its floor. It goes back to its configured rate as
+ *    soon as it drops or uses most of its rate again.
+ * 3. A raised class steps back towards its configured rate once it has
+ *    not dropped for OPS_COPP_TUNE_RESTORE_PERIODS periods, or right away
+ *    when its CPU queue drops or a lowered class needs its rate back.
+ * 4. No rate is ever raised past the point where the sum of the rates of
+ *    all the classes exceeds the CPU budget. When the sum exceeds the
+ *    budget, for instance after the budget was lowered, the raised classes
+ *    are stepped back to their configured rate first, then all the classes
+ *    are lowered towards their floor until the sum fits.
+ *
+ * The configured rate of a class is its default rate, or the last one set
+ * by switchd through set_copp_policy(). Disabling the controller puts the
+ * configured rates back.
+ */
+struct ops_copp_tune_class {
+    uint32      base_rate;      /* Configured rate. */
+    uint32      base_burst;     /* Configured burst. */
+    uint32      floor_rate;     /* Set by the operator, 0 for the default. */
+    uint32      ceiling_rate;   /* Set by the operator, 0 for the default. */
+    uint64      allowed;        /* Counters at the last run. */
+    uint64      dropped;
+    uint64      allowed_pps;    /* Rates seen in the last period. */
+    uint64      dropped_pps;
+    int         drop_periods;   /* Consecutive periods with drops. */
+    int         idle_periods;   /* Consecutive idle periods. */
+    int         calm_periods;   /* Consecutive periods without drops. */
+};
 
-            VLOG_DBG("     Ingress: The previous CPU queue "
-                     "value %u is same as the new intended value %u for %s",
-                     copp_packet_class->ops_copp_ingress_fp_queue_number,
-                     *ingress_fp_queue,
-                     copp_packet_class->ops_copp_packet_name);
-        } else {
+struct ops_copp_tune_state {
+    bool        enabled;
+    uint32      budget_pps;     /* Bound of the sum of all the rates. */
+    long long int
+                last_run;       /* time_msec() of the last run. */
+    uint64      queue_drops[OPS_COPP_MAX_UNITS][OPS_COPP_QOS_QUEUE_MAX + 1];
+    bool        queue_pressure[OPS_COPP_QOS_QUEUE_MAX + 1];
+    uint64      runs;
+    uint64      raises;
+    uint64      lowers;
+    uint64      restores;
+    uint64      budget_limited; /* Raises cut short by the budget. */
+    uint64      budget_lowers;  /* Rates lowered to fit the budget. */
+    uint64      failures;       /* Failed policer updates. */
+    struct ops_copp_tune_class
+                classes[PLUGIN_COPP_MAX_CLASSES];
+};
 
-            ingress_fp_rule_number = 0;
-            while (copp_packet_class->ops_copp_ingress_fp_funtion_pointer[
-                                                    ingress_fp_rule_number]) {
-                /*
-                 * Delete the current CPU queue from the FP entry.
-                 */
-                retval = opennsl_field_action_delete(
-                            unit,
-                            *(copp_packet_class->ops_copp_ingress_fp_entry[unit][
-                                                          ingress_fp_rule_number]),
-                            opennslFieldActionCosQCpuNew,
-                            copp_packet_class->ops_copp_ingress_fp_queue_number,
-                            0);
-                if (OPENNSL_FAILURE(retval)) {
-                    VLOG_ERR("     Ingress action update failure: %s\n",
-                             opennsl_errmsg(retval));
-                    return(OPS_COPP_FAILURE_CODE);
-                }
+static struct ops_copp_tune_state ops_copp_tune;
 
-                /*
-                 * Add the new CPU queue to the FP entry.
-                 */
-                retval = opennsl_field_action_add(
-                            unit,
-                            *(copp_packet_class->ops_copp_ingress_fp_entry[unit][
-                                                           ingress_fp_rule_number]),
-                            opennslFieldActionCosQCpuNew,
-                            *ingress_fp_queue, 0);
-                if (OPENNSL_FAILURE(retval)) {
-                    VLOG_ERR("     Ingress:  Failed to add new action = %s\n",
-                             opennsl_errmsg(retval));
-                    return(OPS_COPP_FAILURE_CODE);
-                }
+/*
+ * ops_copp_tune_bounds
+ *
+ * This function returns the floor and the ceiling of the rate of a
+ * control packet class. Only protocol classes are raised above their
+ * configured rate by default.
+ */
+static void ops_copp_tune_bounds (int packet_class, uint32* floor_rate,
+                                  uint32* ceiling_rate)
+{
+    struct ops_copp_tune_class*    tune_class;
+    uint32                         base_rate;
 
-                /*
-                 * Install the FP entry into the hardware.
-                 */
-                retval = opennsl_field_entry_install(
-                          unit,
-                          *(copp_packet_class->ops_copp_ingress_fp_entry[unit][
-                                                        ingress_fp_rule_number]));
-                if (OPENNSL_FAILURE(retval)) {
-                    VLOG_ERR("     Ingress entry program failure: %s\n",
-                             opennsl_errmsg(retval));
-                    return(OPS_COPP_FAILURE_CODE);
-                }
+    tune_class = &ops_copp_tune.classes[packet_class];
+    base_rate = tune_class->base_rate;
+
+    *floor_rate = tune_class->floor_rate ? tune_class->floor_rate
+                                         : MAX(base_rate / 2, 1);
+    if (tune_class->ceiling_rate) {
+        *ceiling_rate = tune_class->ceiling_rate;
+    } else if (ops_copp_packet_class_t[packet_class].
+                                    ops_copp_ingress_fp_rules[0].valid) {
+        *ceiling_rate = base_rate * OPS_COPP_TUNE_CEILING_FACTOR;
+    } else {
+        *ceiling_rate = base_rate;
+    }
+    *floor_rate = MIN(*floor_rate, *ceiling_rate);
+}
+
+/*
+ * ops_copp_tune_set_rate
+ *
+ * This function programs a new rate for a control packet class on all the
+ * hardware units. The burst is scaled with the rate so that the class
+ * keeps its configured burst duration. The policers are updated in place.
+ */
+static int ops_copp_tune_set_rate (int packet_class, uint32 rate,
+                                   const char* reason)
+{
+    struct ops_copp_fp_rule_t*     copp_packet_class;
+    struct ops_copp_tune_class*    tune_class;
+    uint32                         old_rate;
+    uint32                         burst;
+    uint32                         unit_iterator;
+    int                            retval;
+
+    copp_packet_class = &ops_copp_packet_class_t[packet_class];
+    tune_class = &ops_copp_tune.classes[packet_class];
+    old_rate = copp_packet_class->ops_copp_egress_fp_rate;
 
-                ingress_fp_rule_number++;
-            }
+    if (rate == old_rate) {
+        return(OPS_COPP_SUCCESS_CODE);
+    }
 
-            /*
-             * Need to update the FP entry in the egress as the
-             * qualifier in egress uses CPU QoS Queue.
-             */
-            retval = opennsl_field_qualify_CpuQueue(unit,
-                             *(copp_packet_class->ops_copp_egress_fp_entry[unit]),
-                             *ingress_fp_queue, 0xff);
-            if (OPENNSL_FAILURE(retval)) {
-                VLOG_ERR("     Egress: Failed to qualify on CPU queue %s\n",
-                         opennsl_errmsg(retval));
-                return(OPS_COPP_FAILURE_CODE);
-            }
+    burst = MAX((uint64) tune_class->base_burst * rate /
+                MAX(tune_class->base_rate, 1), 1);
 
-            /*
-             * Install the egress FP entry into the hardware.
-             */
-            retval = opennsl_field_entry_install(
-                        unit,
-                        *(copp_packet_class->ops_copp_egress_fp_entry[unit]));
-            if (OPENNSL_FAILURE(retval)) {
-                VLOG_ERR("     Ingress entry program failure: %s\n",
-                         opennsl_errmsg(retval));
-                return(OPS_COPP_FAILURE_CODE);
-            }
+    ops_copp_stats_invalidate(-1);
 
-            /*
-             * Copy the new CPU queue value into the configured FP rules.
-             */
-            copp_packet_class->ops_copp_ingress_fp_queue_number =
-                                                    *ingress_fp_queue;
+    for (unit_iterator = 0; unit_iterator < OPS_COPP_MAX_UNITS;
+                                                        ++unit_iterator) {
+        if (!copp_packet_class->ops_copp_egress_fp_entry[unit_iterator]) {
+            continue;
+        }
 
-            VLOG_DBG("     Ingress: Successfully reprogrammed the FP rule "
-                     "for %s with new CPU queue %u",
-                     copp_packet_class->ops_copp_packet_name,
-                     *ingress_fp_queue);
+        retval = ops_copp_set_egress_policer(unit_iterator,
+                    copp_packet_class->ops_copp_egress_fp_policer_id[
+                                                            unit_iterator],
+                    rate, burst);
+        if (retval != OPS_COPP_SUCCESS_CODE) {
+            VLOG_ERR("CoPP auto-tuning: failed to set the rate of %s "
+                     "to %u pps", copp_packet_class->ops_copp_packet_name,
+                     rate);
+            log_event("COPP_AUTOTUNE_FAILURE",
+                      EV_KV("class", "%s",
+                            copp_packet_class->ops_copp_packet_name),
+                      EV_KV("rate", "%u", rate));
+            ops_copp_tune.failures++;
+            return(OPS_COPP_FAILURE_CODE);
         }
     }
 
+    copp_packet_class->ops_copp_egress_fp_rate = rate;
+    copp_packet_class->ops_copp_egress_fp_burst = burst;
+
+    VLOG_DBG("CoPP auto-tuning: %s rate %u -> %u pps (%s)",
+             copp_packet_class->ops_copp_packet_name, old_rate, rate, reason);
+    log_event("COPP_AUTOTUNE_RATE_CHANGE",
+              EV_KV("class", "%s", copp_packet_class->ops_copp_packet_name),
+              EV_KV("old_rate", "%u", old_rate),
+              EV_KV("new_rate", "%u", rate),
+              EV_KV("reason", "%s", reason));
+
     return(OPS_COPP_SUCCESS_CODE);
 }
 
 /*
- * ops_copp_egress_fp_programmer
+ * ops_copp_tune_sample
  *
- * This function does the following two operations for a given control packet:-
- * 1. If the egress FP entry for the control packet is NULL, then this
- *    function creates a new ingress FP entry and attaches a policier with
- *    the default rate and burst value and a stats object to the egress FP
- *    entry. This is the case at the initialization time when the plugin
- *    gets loaded in vswitchd for the first time.
- * 2. If the egress FP entry for the control packet is not NULL, then this
- *    function updates the rate and the burst in the policier for the control
- *    packet with the rate and burst values passed to this function.
+ * This function reads the CPU queue drop counters and the counters of
+ * all the control packet classes, and updates the per class rates and
+ * period counts for the last 'elapsed' milliseconds.
  */
-static int ops_copp_egress_fp_programmer (
-                               uint32 unit,
-                               enum ops_copp_packet_class_code_t packet_class,
-                               uint32* egress_fp_rate,
-                               uint32* egress_fp_burst)
+static void ops_copp_tune_sample (long long int elapsed)
 {
-    int32                      retval = -1;
-    bool                       if_init_egress_fp_program = false;
-    bool                       if_config_egress_fp_program = false;
-    struct ops_copp_fp_rule_t* copp_packet_class = NULL;
+    const struct ops_copp_stats_snapshot*  snapshot;
+    struct ops_copp_tune_class*            tune_class;
+    uint64                                 allowed, dropped, delta;
+    uint64                                 value;
+    uint32                                 unit_iterator;
+    uint32                                 rate;
+    int                                    queue;
+    int                                    fp_rule_iterator;
+    int                                    retval;
 
     /*
-     * If the packet class is not valid, then do not do anything and
-     * return from this function.
+     * Read fresh counters whatever the refresh interval of the snapshot.
      */
-    if ((packet_class < 0) ||
-        (packet_class >= PLUGIN_COPP_MAX_CLASSES)) {
-        VLOG_ERR("Not a valid packet class");
-        return(OPS_COPP_FAILURE_CODE);
+    ops_copp_stats_invalidate(-1);
+
+    memset(ops_copp_tune.queue_pressure, 0,
+           sizeof(ops_copp_tune.queue_pressure));
+    for (unit_iterator = 0; unit_iterator < OPS_COPP_MAX_UNITS;
+                                                        ++unit_iterator) {
+        for (queue = OPS_COPP_QOS_QUEUE_MIN; queue <= OPS_COPP_QOS_QUEUE_MAX;
+                                                                ++queue) {
+            retval = opennsl_cosq_stat_get(unit_iterator,
+                                           OPENNSL_GPORT_LOCAL_CPU, queue,
+                                           opennslCosqStatDroppedPackets,
+                                           &value);
+            if (OPENNSL_FAILURE(retval)) {
+                continue;
+            }
+            if (value > ops_copp_tune.queue_drops[unit_iterator][queue]) {
+                ops_copp_tune.queue_pressure[queue] = true;
+            }
+            ops_copp_tune.queue_drops[unit_iterator][queue] = value;
+        }
     }
 
-    /*
-     * Get the pointer reference to the control packet rule.
-     */
-    copp_packet_class = &ops_copp_packet_class_t[packet_class];
+    for (fp_rule_iterator = 0; fp_rule_iterator < PLUGIN_COPP_MAX_CLASSES;
+         ++fp_rule_iterator) {
 
-    if (!copp_packet_class) {
-        VLOG_ERR("Invalid pointer to packet class");
-        return(OPS_COPP_FAILURE_CODE);
-    }
+        tune_class = &ops_copp_tune.classes[fp_rule_iterator];
+        allowed = dropped = 0;
+        for (unit_iterator = 0; unit_iterator < OPS_COPP_MAX_UNITS;
+                                                        ++unit_iterator) {
+            snapshot = ops_copp_stats_lookup(unit_iterator);
+            if (snapshot &&
+                snapshot->classes[fp_rule_iterator].stats_valid) {
+                allowed +=
+                    snapshot->classes[fp_rule_iterator].packets_allowed;
+                dropped +=
+                    snapshot->classes[fp_rule_iterator].packets_dropped;
+            }
+        }
 
-    /*
-     * If the egress FP entry pointer for the control packet is NULL, then
-     * we need to allocate a new FP entry and program the hardware.
-     */
-    if (!(copp_packet_class->ops_copp_egress_fp_entry[unit]) &&
-        copp_packet_class->ops_copp_egress_fp_funtion_pointer) {
-        if_init_egress_fp_program = true;
+        /*
+         * The counters start again from zero when the stat objects of a
+         * class are recreated.
+         */
+        delta = allowed >= tune_class->allowed ?
+                        allowed - tune_class->allowed : allowed;
+        tune_class->allowed_pps = delta * 1000 / MAX(elapsed, 1);
+        delta = dropped >= tune_class->dropped ?
+                        dropped - tune_class->dropped : dropped;
+        tune_class->dropped_pps = delta * 1000 / MAX(elapsed, 1);
+        tune_class->allowed = allowed;
+        tune_class->dropped = dropped;
+
+        rate = ops_copp_packet_class_t[fp_rule_iterator].
+                                                ops_copp_egress_fp_rate;
+        if (tune_class->dropped_pps) {
+            tune_class->drop_periods++;
+            tune_class->calm_periods = 0;
+        } else {
+            tune_class->drop_periods = 0;
+            tune_class->calm_periods++;
+        }
+        if (!tune_class->dropped_pps &&
+            (tune_class->allowed_pps * 4 < rate)) {
+            tune_class->idle_periods++;
+        } else {
+            tune_class->idle_periods = 0;
+        }
     }
+}
 
-    /*
-     * If the egress FP entry pointer for the control packet is not NULL,
-     * then we need to update the FP entry with the new rate and burst values.
-     */
-    if (copp_packet_class->ops_copp_egress_fp_entry[unit] && egress_fp_rate
-        && egress_fp_burst) {
-        if_config_egress_fp_program = true;
-    }
+/*
+ * ops_copp_tune_run
+ *
+ * This function is one run of the CoPP policer auto-tuning controller.
+ * Rates are lowered first, so that the budget they free can be given to
+ * the classes that need it in the same run.
+ */
+static void ops_copp_tune_run (long long int now)
+{
+    struct ops_copp_fp_rule_t*     copp_packet_class;
+    struct ops_copp_tune_class*    tune_class;
+    uint64                         total_rate = 0;
+    uint64                         headroom;
+    uint32                         floor_rate, ceiling_rate;
+    uint32                         rate, next_rate;
+    bool                           queue_pressure;
+    bool                           busy;
+    bool                           reclaim = false;
+    int                            fp_rule_iterator;
+    int                            pass;
+
+    ops_copp_tune_sample(now - ops_copp_tune.last_run);
+    ops_copp_tune.last_run = now;
+    ops_copp_tune.runs++;
 
     /*
-     * If we find that this function is neither called at init time or
-     * at rate/burst modification time, then return from this function.
+     * A lowered class that got busy again takes back the rate given to
+     * the raised classes.
      */
-    if (!if_init_egress_fp_program && !if_config_egress_fp_program) {
-        VLOG_ERR("Invalid use of the egress function for %s",
-                 copp_packet_class->ops_copp_packet_name);
-        return(OPS_COPP_FAILURE_CODE);
+    for (fp_rule_iterator = 0; fp_rule_iterator < PLUGIN_COPP_MAX_CLASSES;
+         ++fp_rule_iterator) {
+        tune_class = &ops_copp_tune.classes[fp_rule_iterator];
+        rate = ops_copp_packet_class_t[fp_rule_iterator].
+                                                ops_copp_egress_fp_rate;
+        total_rate += rate;
+        if ((rate < tune_class->base_rate) &&
+            (tune_class->dropped_pps ||
+             (tune_class->allowed_pps * 4 >= (uint64) rate * 3))) {
+            reclaim = true;
+        }
     }
 
     /*
-     * If the function is called at the initialization time, then allocate
-     * a new FP entry and program the egress pipeline with the FP rule.
+     * Step raised classes back and lower the idle ones.
      */
-    if (if_init_egress_fp_program) {
-
-        VLOG_DBG("Create a new egress FP %s entry with default rate/burst",
-                 copp_packet_class->ops_copp_packet_name);
-
-        /*
-         * Allocate a new FP egress entry.
-         */
-        copp_packet_class->ops_copp_egress_fp_entry[unit] =
-                                xzalloc(sizeof(opennsl_field_entry_t));
+    for (fp_rule_iterator = 0; fp_rule_iterator < PLUGIN_COPP_MAX_CLASSES;
+         ++fp_rule_iterator) {
 
-        /*
-         * Create a new egress FP entry in the egress group for the
-         * given unit.
-         */
-        retval= opennsl_field_entry_create(
-                            unit, ops_copp_egress_fp_group_array[unit],
-                            copp_packet_class->ops_copp_egress_fp_entry[unit]);
+        copp_packet_class = &ops_copp_packet_class_t[fp_rule_iterator];
+        tune_class = &ops_copp_tune.classes[fp_rule_iterator];
+        rate = copp_packet_class->ops_copp_egress_fp_rate;
+        queue_pressure = ops_copp_tune.queue_pressure[
+                    copp_packet_class->ops_copp_ingress_fp_queue_number];
+        ops_copp_tune_bounds(fp_rule_iterator, &floor_rate, &ceiling_rate);
 
-        if (OPENNSL_FAILURE(retval)) {
-            VLOG_ERR("     Egress: Failed to create entry: %s\n",
-                     opennsl_errmsg(retval));
-            free(copp_packet_class->ops_copp_egress_fp_entry[unit]);
-            return(OPS_COPP_FAILURE_CODE);
+        if (rate > ceiling_rate) {
+            next_rate = ceiling_rate;
+        } else if ((rate > tune_class->base_rate) &&
+                   (queue_pressure || reclaim ||
+                    (tune_class->calm_periods >=
+                                       OPS_COPP_TUNE_RESTORE_PERIODS))) {
+            next_rate = MAX(rate - rate / 4, tune_class->base_rate);
+        } else if ((rate > floor_rate) &&
+                   (tune_class->idle_periods >= OPS_COPP_TUNE_IDLE_PERIODS)) {
+            next_rate = MAX(rate - rate / 4, floor_rate);
+        } else {
+            continue;
         }
 
-        /*
-         * Call the function pointer for programming the FP qualifier for this
-         * packet class.
-         */
-        retval = (*copp_packet_class->ops_copp_egress_fp_funtion_pointer)(unit,
-                          copp_packet_class->ops_copp_egress_fp_entry[unit],
-                          copp_packet_class->ops_copp_ingress_fp_queue_number);
-        if (OPENNSL_FAILURE(retval)) {
-            VLOG_ERR("     Egress: Failed to add FP qualifiers\n");
-            ops_copp_fp_entry_cleanup(unit,
-                    copp_packet_class->ops_copp_egress_fp_entry[unit]);
-            return(OPS_COPP_FAILURE_CODE);
+        if (ops_copp_tune_set_rate(fp_rule_iterator, next_rate,
+                                   rate > tune_class->base_rate ?
+                                   "restore" : "idle")
+                                            == OPS_COPP_SUCCESS_CODE) {
+            total_rate -= rate - next_rate;
+            if (rate > tune_class->base_rate) {
+                ops_copp_tune.restores++;
+            } else {
+                ops_copp_tune.lowers++;
+            }
+            tune_class->idle_periods = 0;
+            tune_class->calm_periods = 0;
         }
+    }
 
-        /*
-         * Add the action for the egress FP entry to drop the packet if the
-         * rate/burst is exceeded for the control packet.
-         */
-        retval = opennsl_field_action_add(
-                     unit,
-                     *(copp_packet_class->ops_copp_egress_fp_entry[unit]),
-                     opennslFieldActionRpDrop, 0, 0);
-        if (retval != OPS_COPP_SUCCESS_CODE) {
-            VLOG_ERR("     Egress:  Failed to add action  = %s\n",
-                     opennsl_errmsg(retval));
-            ops_copp_fp_entry_cleanup(unit,
-                    copp_packet_class->ops_copp_egress_fp_entry[unit]);
-            return(OPS_COPP_FAILURE_CODE);
-        }
+    /*
+     * Fit the rates into the budget: raised classes go back to their
+     * configured rate first, then all the classes go down to their floor.
+     */
+    for (pass = 0; (pass < 2) && (total_rate > ops_copp_tune.budget_pps);
+         ++pass) {
+        for (fp_rule_iterator = 0;
+             (fp_rule_iterator < PLUGIN_COPP_MAX_CLASSES) &&
+             (total_rate > ops_copp_tune.budget_pps);
+             ++fp_rule_iterator) {
 
-        /*
-         * Allocate a new policer.
-         */
-        copp_packet_class->ops_copp_egress_fp_policer_id[unit] =
-                                            xzalloc(sizeof(opennsl_policer_t));
+            copp_packet_class = &ops_copp_packet_class_t[fp_rule_iterator];
+            tune_class = &ops_copp_tune.classes[fp_rule_iterator];
+            rate = copp_packet_class->ops_copp_egress_fp_rate;
+            ops_copp_tune_bounds(fp_rule_iterator, &floor_rate,
+                                 &ceiling_rate);
+            if (pass == 0) {
+                floor_rate = MAX(floor_rate, tune_class->base_rate);
+            }
+            if (rate <= floor_rate) {
+                continue;
+            }
 
-        if(!(copp_packet_class->ops_copp_egress_fp_policer_id[unit])) {
-            VLOG_ERR("      Egress: Unable to allocate memory for policer");
-            ops_copp_fp_entry_cleanup(unit,
-                    copp_packet_class->ops_copp_egress_fp_entry[unit]);
-            return(OPS_COPP_FAILURE_CODE);
+            next_rate = rate - MIN(rate - floor_rate,
+                                   total_rate - ops_copp_tune.budget_pps);
+            if (ops_copp_tune_set_rate(fp_rule_iterator, next_rate,
+                                       "budget") == OPS_COPP_SUCCESS_CODE) {
+                total_rate -= rate - next_rate;
+                ops_copp_tune.budget_lowers++;
+                tune_class->idle_periods = 0;
+                tune_class->calm_periods = 0;
+            }
         }
+    }
 
-        /*
-         * Create the policier having the default rate/burst.
-         */
-        retval = ops_copp_create_egress_policer_id(
-                       unit,
-                       copp_packet_class->ops_copp_egress_fp_policer_id[unit],
-                       copp_packet_class->ops_copp_egress_fp_rate,
-                       copp_packet_class->ops_copp_egress_fp_burst);
-        if (retval != OPS_COPP_SUCCESS_CODE) {
-            VLOG_ERR("     Egress policer program failure");
-            ops_copp_fp_entry_cleanup(unit,
-                    copp_packet_class->ops_copp_egress_fp_entry[unit]);
-            free(copp_packet_class->ops_copp_egress_fp_policer_id[unit]);
-            return(OPS_COPP_FAILURE_CODE);
-        }
+    /*
+     * Give the lowered classes that got busy their configured rate back
+     * and raise the protocol classes under sustained drops, within the
+     * budget.
+     */
+    for (fp_rule_iterator = 0; fp_rule_iterator < PLUGIN_COPP_MAX_CLASSES;
+         ++fp_rule_iterator) {
 
-        /*
-         * Attach the policier to the egress FP entry for unicast ARP.
-         */
-        retval = opennsl_field_entry_policer_attach(
-                   unit,
-                   *(copp_packet_class->ops_copp_egress_fp_entry[unit]),
-                   0,
-                   *(copp_packet_class->ops_copp_egress_fp_policer_id[unit]));
-        if (OPENNSL_FAILURE(retval)) {
-            VLOG_ERR("     Egress: Failed to attach the action to FP "
-                     "entry = %s\n", opennsl_errmsg(retval));
-            ops_copp_fp_policer_cleanup(unit,
-                    copp_packet_class->ops_copp_egress_fp_policer_id[unit]);
-            ops_copp_fp_entry_cleanup(unit,
-                    copp_packet_class->ops_copp_egress_fp_entry[unit]);
-            return(OPS_COPP_FAILURE_CODE);
+        copp_packet_class = &ops_copp_packet_class_t[fp_rule_iterator];
+        tune_class = &ops_copp_tune.classes[fp_rule_iterator];
+        rate = copp_packet_class->ops_copp_egress_fp_rate;
+        queue_pressure = ops_copp_tune.queue_pressure[
+                    copp_packet_class->ops_copp_ingress_fp_queue_number];
+        ops_copp_tune_bounds(fp_rule_iterator, &floor_rate, &ceiling_rate);
+        busy = tune_class->dropped_pps ||
+               (tune_class->allowed_pps * 4 >= (uint64) rate * 3);
+
+        if ((rate < floor_rate) ||
+            ((rate < tune_class->base_rate) && busy)) {
+            next_rate = MIN(MAX(tune_class->base_rate, floor_rate),
+                            ceiling_rate);
+        } else if ((rate < ceiling_rate) && !queue_pressure &&
+                   (tune_class->drop_periods >= OPS_COPP_TUNE_DROP_PERIODS)) {
+            next_rate = MIN(rate + MAX(rate / 2, 1), ceiling_rate);
+        } else {
+            continue;
         }
 
-        copp_packet_class->ops_copp_egress_fp_stat_id[unit] =
-                                                        xzalloc(sizeof(int));
+        headroom = ops_copp_tune.budget_pps > total_rate ?
+                            ops_copp_tune.budget_pps - total_rate : 0;
+        if (next_rate - rate > headroom) {
+            ops_copp_tune.budget_limited++;
+            next_rate = rate + headroom;
+        }
+        if (next_rate <= rate) {
+            continue;
+        }
 
-        if (!(copp_packet_class->ops_copp_egress_fp_stat_id[unit])) {
-            VLOG_ERR("     Egress: Unable to allocate for stat id");
-            ops_copp_fp_policer_cleanup(unit,
-                    copp_packet_class->ops_copp_egress_fp_policer_id[unit]);
-            ops_copp_fp_entry_cleanup(unit,
-                    copp_packet_class->ops_copp_egress_fp_entry[unit]);
-            return(OPS_COPP_FAILURE_CODE);
+        if (ops_copp_tune_set_rate(fp_rule_iterator, next_rate,
+                                   rate < tune_class->base_rate ?
+                                   "busy" : "drops")
+                                            == OPS_COPP_SUCCESS_CODE) {
+            total_rate += next_rate - rate;
+            ops_copp_tune.raises++;
+            tune_class->drop_periods = 0;
+            tune_class->idle_periods = 0;
         }
+    }
+}
 
-        /*
-         * Create the stats object to count the number of control packets
-         * dropped from being pushed to CPU or sent to CPU from the egress
-         * pipeline.
-         */
-        retval = ops_copp_create_egress_stat_id(
-                    unit, copp_packet_class->ops_copp_egress_fp_stat_id[unit]);
-        if (retval != OPS_COPP_SUCCESS_CODE) {
-            VLOG_ERR("     Egress stat object program failure");
-            ops_copp_fp_policer_cleanup(unit,
-                    copp_packet_class->ops_copp_egress_fp_policer_id[unit]);
-            ops_copp_fp_entry_cleanup(unit,
-                    copp_packet_class->ops_copp_egress_fp_entry[unit]);
-            free(copp_packet_class->ops_copp_egress_fp_stat_id[unit]);
-            return(OPS_COPP_FAILURE_CODE);
+/*
+ * ops_copp_tune_class_configured
+ *
+ * This function records the rate and burst set by switchd for a control
+ * packet class as its configured values.
+ */
+static void ops_copp_tune_class_configured (int packet_class, uint32 rate,
+                                            uint32 burst)
+{
+    struct ops_copp_tune_class*    tune_class;
+
+    tune_class = &ops_copp_tune.classes[packet_class];
+    tune_class->base_rate = rate;
+    tune_class->base_burst = burst;
+    tune_class->drop_periods = 0;
+    tune_class->idle_periods = 0;
+    tune_class->calm_periods = 0;
+}
+
+/*
+ * ops_copp_tune_enable
+ *
+ * This function enables or disables the CoPP policer auto-tuning. A zero
+ * budget sets the budget to the sum of the configured rates, so that the
+ * controller only moves rate from idle classes to busy ones. Disabling
+ * the controller puts the configured rates back.
+ */
+int ops_copp_tune_enable (bool enable, uint32 budget_pps)
+{
+    struct ops_copp_fp_rule_t*     copp_packet_class;
+    struct ops_copp_tune_class*    tune_class;
+    uint64                         total_rate = 0;
+    int                            fp_rule_iterator;
+    int                            retval = OPS_COPP_SUCCESS_CODE;
+
+    if (!enable) {
+        if (ops_copp_tune.enabled) {
+            for (fp_rule_iterator = 0;
+                 fp_rule_iterator < PLUGIN_COPP_MAX_CLASSES;
+                 ++fp_rule_iterator) {
+                retval |= ops_copp_tune_set_rate(fp_rule_iterator,
+                                ops_copp_tune.classes[fp_rule_iterator].
+                                                            base_rate,
+                                "disabled");
+            }
         }
+        ops_copp_tune.enabled = false;
+        return(retval);
+    }
 
-        /*
-         * Attach the stats object to the egress FP entry
-         */
-        retval = opennsl_field_entry_stat_attach(
-                      unit,
-                      *(copp_packet_class->ops_copp_egress_fp_entry[unit]),
-                      *(copp_packet_class->ops_copp_egress_fp_stat_id[unit]));
-        if (OPENNSL_FAILURE(retval)) {
-            VLOG_ERR("     Egress: Failed to attach the stats object "
-                     "to FP entry = %s\n", opennsl_errmsg(retval));
-            ops_copp_fp_policer_cleanup(unit,
-                    copp_packet_class->ops_copp_egress_fp_policer_id[unit]);
-            ops_copp_fp_statid_cleanup(unit,
-                    copp_packet_class->ops_copp_egress_fp_stat_id[unit]);
-            ops_copp_fp_entry_cleanup(unit,
-                    copp_packet_class->ops_copp_egress_fp_entry[unit]);
-            return(OPS_COPP_FAILURE_CODE);
+    /*
+     * While the controller is disabled the programmed rates are the
+     * configured ones.
+     */
+    for (fp_rule_iterator = 0; fp_rule_iterator < PLUGIN_COPP_MAX_CLASSES;
+         ++fp_rule_iterator) {
+        copp_packet_class = &ops_copp_packet_class_t[fp_rule_iterator];
+        tune_class = &ops_copp_tune.classes[fp_rule_iterator];
+        if (!ops_copp_tune.enabled) {
+            ops_copp_tune_class_configured(
+                                fp_rule_iterator,
+                                copp_packet_class->ops_copp_egress_fp_rate,
+                                copp_packet_class->ops_copp_egress_fp_burst);
         }
+        total_rate += tune_class->base_rate;
+    }
+
+    ops_copp_tune.budget_pps = budget_pps ? budget_pps
+                                          : MIN(total_rate, UINT32_MAX);
+
+    if (!ops_copp_tune.enabled) {
 
         /*
-         * Install the FP entry into the hardware.
+         * Take the current counters as the starting point.
          */
-        retval = opennsl_field_entry_install(
-                   unit, *(copp_packet_class->ops_copp_egress_fp_entry[unit]));
-        if (OPENNSL_FAILURE(retval)) {
-            VLOG_ERR("     Egress entry program failure: %s\n",
-                     opennsl_errmsg(retval));
-            ops_copp_fp_policer_cleanup(unit,
-                    copp_packet_class->ops_copp_egress_fp_policer_id[unit]);
-            ops_copp_fp_statid_cleanup(unit,
-                    copp_packet_class->ops_copp_egress_fp_stat_id[unit]);
-            ops_copp_fp_entry_cleanup(unit,
-                    copp_packet_class->ops_copp_egress_fp_entry[unit]);
-            return(OPS_COPP_FAILURE_CODE);
-        }
+        ops_copp_tune_sample(OPS_COPP_TUNE_PERIOD_MS);
+        ops_copp_tune.last_run = time_msec();
+        ops_copp_tune.enabled = true;
+    }
 
-        VLOG_DBG("     Egress: Successfully programmed the FP rule "
-                 "for %s", copp_packet_class->ops_copp_packet_name);
+    return(OPS_COPP_SUCCESS_CODE);
+}
+
+/*
+ * ops_copp_tune_set_bounds
+ *
+ * This function sets the floor and the ceiling of the rate of a control
+ * packet class. Zero values select the default bounds.
+ */
+int ops_copp_tune_set_bounds (enum ops_copp_packet_class_code_t packet_class,
+                              uint32 floor_rate, uint32 ceiling_rate)
+{
+    if ((packet_class < 0) ||
+        (packet_class >= PLUGIN_COPP_MAX_CLASSES)) {
+        return(OPS_COPP_FAILURE_CODE);
     }
 
-    /*
-     * If the function is called at the configuration time, then detach
-     * the egress policier and attach a new policier having the new rate
-     * and burst values.
-     */
-    if (if_config_egress_fp_program) {
-        if ((copp_packet_class->ops_copp_egress_fp_rate == *egress_fp_rate)
-            && (copp_packet_class->ops_copp_egress_fp_burst
-                                                    == *egress_fp_burst)) {
+    if (floor_rate && ceiling_rate && (floor_rate > ceiling_rate)) {
+        return(OPS_COPP_FAILURE_CODE);
+    }
 
-            /*
-             * If the new rate and burst values are same as the already
-             * configured values, then do nothing and return from this
-             * function.
-             */
-            VLOG_DBG("     Egress: The current rate/burst %u/%u is same new "
-                     " intended rate/burst %u/%u for %s",
-                     copp_packet_class->ops_copp_egress_fp_rate,
-                     copp_packet_class->ops_copp_egress_fp_burst,
-                     *egress_fp_rate, *egress_fp_burst,
-                     copp_packet_class->ops_copp_packet_name);
-        } else {
+    ops_copp_tune.classes[packet_class].floor_rate = floor_rate;
+    ops_copp_tune.classes[packet_class].ceiling_rate = ceiling_rate;
+    return(OPS_COPP_SUCCESS_CODE);
+}
 
-            /*
-             * Detach the current policier from the egress FP entry.
-             */
-            retval = opennsl_field_entry_policer_detach(
-                         unit,
-                         *(copp_packet_class->ops_copp_egress_fp_entry[unit]),
-                         0);
-            if (OPENNSL_FAILURE(retval)) {
-                VLOG_ERR("     Egress: policy detach failed: %s\n",
-                         opennsl_errmsg(retval));
-                return(OPS_COPP_FAILURE_CODE);
-            }
+/*
+ * ops_copp_tune_dump
+ *
+ * This function dumps the state of the CoPP policer auto-tuning.
+ */
+void ops_copp_tune_dump (struct ds *ds)
+{
+    struct ops_copp_tune_class*    tune_class;
+    uint64                         total_rate = 0;
+    uint32                         floor_rate, ceiling_rate;
+    uint32                         rate;
+    int                            fp_rule_iterator;
+    int                            queue;
 
-            /*
-             * Install the FP entry into the hardware to detach the policer
-             * completely from the egress FP entry.
-             */
-            retval = opennsl_field_entry_install(
-                       unit,
-                       *(copp_packet_class->ops_copp_egress_fp_entry[unit]));
-            if (OPENNSL_FAILURE(retval)) {
-                VLOG_ERR("     Egress entry reprogram failure: %s\n",
-                        opennsl_errmsg(retval));
-                return(OPS_COPP_FAILURE_CODE);
-            }
+    ds_put_format(ds, "CoPP policer auto-tuning: %s\n",
+                  ops_copp_tune.enabled ? "enabled" : "disabled");
+    if (!ops_copp_tune.enabled) {
+        return;
+    }
 
-            /*
-             * Destroy the policer and free hardware resources.
-             */
-            retval = opennsl_policer_destroy(unit,
-                        *(copp_packet_class->ops_copp_egress_fp_policer_id[unit]));
-            if (OPENNSL_FAILURE(retval)) {
-                VLOG_ERR("     Egress policer destroy failure: %s\n",
-                        opennsl_errmsg(retval));
-                return(OPS_COPP_FAILURE_CODE);
-            }
+    for (fp_rule_iterator = 0; fp_rule_iterator < PLUGIN_COPP_MAX_CLASSES;
+         ++fp_rule_iterator) {
+        total_rate += ops_copp_packet_class_t[fp_rule_iterator].
+                                                ops_copp_egress_fp_rate;
+    }
+
+    ds_put_format(ds, "  CPU budget: %u pps, in use: %"PRIu64" pps\n",
+                  ops_copp_tune.budget_pps, (uint64_t) total_rate);
+    ds_put_format(ds, "  runs: %"PRIu64", raises: %"PRIu64", lowers: "
+                  "%"PRIu64", restores: %"PRIu64", budget limited: %"PRIu64
+                  ", budget lowers: %"PRIu64", failures: %"PRIu64"\n",
+                  (uint64_t) ops_copp_tune.runs,
+                  (uint64_t) ops_copp_tune.raises,
+                  (uint64_t) ops_copp_tune.lowers,
+                  (uint64_t) ops_copp_tune.restores,
+                  (uint64_t) ops_copp_tune.budget_limited,
+                  (uint64_t) ops_copp_tune.budget_lowers,
+                  (uint64_t) ops_copp_tune.failures);
+    ds_put_format(ds, "  CPU queues dropping in the last period:");
+    for (queue = OPS_COPP_QOS_QUEUE_MIN; queue <= OPS_COPP_QOS_QUEUE_MAX;
+                                                                ++queue) {
+        if (ops_copp_tune.queue_pressure[queue]) {
+            ds_put_format(ds, " %s",
+                          ops_copp_get_name_from_cpu_queue_number(queue));
+        }
+    }
+    ds_put_format(ds, "\n\n");
+
+    ds_put_format(ds, "%-36s %8s %8s %8s %8s %10s %10s\n",
+                  "Control Plane Packet", "Rate", "Config", "Floor",
+                  "Ceiling", "Allowed/s", "Dropped/s");
+    for (fp_rule_iterator = 0; fp_rule_iterator < PLUGIN_COPP_MAX_CLASSES;
+         ++fp_rule_iterator) {
+        tune_class = &ops_copp_tune.classes[fp_rule_iterator];
+        rate = ops_copp_packet_class_t[fp_rule_iterator].
+                                                ops_copp_egress_fp_rate;
+        ops_copp_tune_bounds(fp_rule_iterator, &floor_rate, &ceiling_rate);
+        ds_put_format(ds, "%-36s %8u %8u %8u %8u %10"PRIu64" %10"PRIu64"\n",
+                      ops_copp_packet_class_t[fp_rule_iterator].
+                                                ops_copp_packet_name,
+                      rate, tune_class->base_rate, floor_rate, ceiling_rate,
+                      (uint64_t) tune_class->allowed_pps,
+                      (uint64_t) tune_class->dropped_pps);
+    }
+}
+
+/*
+ * CPU queue monitor
+ *
+ * The monitor samples every CPU queue once per interval, from the ofproto
+ * run loop, while it is enabled. A sample reads:
+ *
+ * 1. The BST occupancy of the queue, in cells. The counter is read without
+ *    clearing it, as the buffer monitoring counters share it. It only holds
+ *    the current occupancy with the BST tracking mode set to current. In
+ *    peak mode it is a watermark that only goes up until bufmon clears it,
+ *    so the occupancy of a unit in peak mode is not sampled, and the
+ *    samples skipped for it are counted and reported. The peak of the
+ *    monitor is tracked locally.
+ * 2. The drop counter of the queue. Consecutive samples with drops form a
+ *    drop burst, which is accounted when the first sample without drops
+ *    ends it.
+ *
+ * Both go into log2 histograms, from which the p99 values are read. With
+ * several units, a queue sample is the highest occupancy and the sum of
+ * the drops over all the units. The sampling interval is at least
+ * OPS_COPP_CPUQ_MIN_INTERVAL_MS, since every sample reads all the queues
+ * from the main loop.
+ */
+struct ops_copp_cpuq_stats {
+    uint64      samples;        /* Samples with an occupancy. */
+    uint64      peak_cells;
+    uint64      occupancy_hist[OPS_COPP_CPUQ_HIST_BUCKETS];
+    uint64      drops;
+    uint64      drop_samples;   /* Samples with drops. */
+    uint64      bursts;         /* Ended drop bursts. */
+    uint64      max_burst;
+    uint64      burst_hist[OPS_COPP_CPUQ_HIST_BUCKETS];
+    uint64      burst_drops;    /* Drops of the burst in progress. */
+};
 
-            /*
-             * Create a new policier with the new rate/burst values.
-             */
-            retval = ops_copp_create_egress_policer_id(
-                         unit,
-                         copp_packet_class->ops_copp_egress_fp_policer_id[unit],
-                         *egress_fp_rate,
-                         *egress_fp_burst);
-            if (retval != OPS_COPP_SUCCESS_CODE) {
-                VLOG_ERR("     Egress policer update failure: %s\n",
-                        opennsl_errmsg(retval));
-                return(OPS_COPP_FAILURE_CODE);
-            }
+struct ops_copp_cpuq_monitor {
+    bool        enabled;
+    int         interval_ms;
+    long long int
+                last_sample;    /* time_msec() of the last sample. */
+    long long int
+                started;        /* time_msec() of the first sample. */
+    uint64      samples;
+    uint64      read_failures;
+    uint64      peak_mode_samples;  /* Samples without occupancy, as a
+                                       unit was in BST peak mode. */
+    uint64      hw_drops[OPS_COPP_MAX_UNITS][OPS_COPP_QOS_QUEUE_MAX + 1];
+    bool        hw_drops_valid[OPS_COPP_MAX_UNITS][OPS_COPP_QOS_QUEUE_MAX + 1];
+    struct ops_copp_cpuq_stats
+                queues[OPS_COPP_QOS_QUEUE_MAX + 1];
+};
 
-            /*
-             * Attach the new policier from the FP entry.
-             * Install the FP entry into the hardware.
-             */
-            retval = opennsl_field_entry_policer_attach(
-                     unit,
-                     *(copp_packet_class->ops_copp_egress_fp_entry[unit]),
-                     0,
-                     *(copp_packet_class->ops_copp_egress_fp_policer_id[unit]));
-            if (OPENNSL_FAILURE(retval)) {
-                VLOG_ERR("     Egress: Failure to attach a new policer to "
-                         "the FP entry = %s\n", opennsl_errmsg(retval));
-                return(OPS_COPP_FAILURE_CODE);
-            }
+static struct ops_copp_cpuq_monitor ops_copp_cpuq;
 
-            /*
-             * Install the FP entry into the hardware.
-             */
-            retval = opennsl_field_entry_install(
-                       unit,
-                       *(copp_packet_class->ops_copp_egress_fp_entry[unit]));
-            if (OPENNSL_FAILURE(retval)) {
-                VLOG_ERR("     Egress entry reprogram failure: %s\n",
-                        opennsl_errmsg(retval));
-                return(OPS_COPP_FAILURE_CODE);
-            }
+/*
+ * ops_copp_cpuq_bucket
+ *
+ * This function returns the histogram bucket of a value. Bucket 0 holds
+ * zero and bucket n the values from 2^(n-1) to 2^n - 1. The last bucket
+ * holds all the values past the others.
+ */
+static int ops_copp_cpuq_bucket (uint64 value)
+{
+    int bucket = 0;
 
-            VLOG_DBG("     Egress: Successfully updated rate/burst %u/%u "
-                     "to new rate/burst %u/%u for %s",
-                     copp_packet_class->ops_copp_egress_fp_rate,
-                     copp_packet_class->ops_copp_egress_fp_burst,
-                     *egress_fp_rate, *egress_fp_burst,
-                     copp_packet_class->ops_copp_packet_name);
+    while (value && (bucket < OPS_COPP_CPUQ_HIST_BUCKETS - 1)) {
+        value >>= 1;
+        bucket++;
+    }
 
-            /*
-             * Copy the new rates/burst into the configured FP rules.
-             */
-            copp_packet_class->ops_copp_egress_fp_rate = *egress_fp_rate;
-            copp_packet_class->ops_copp_egress_fp_burst = *egress_fp_burst;
+    return(bucket);
+}
+
+/*
+ * ops_copp_cpuq_percentile
+ *
+ * This function returns the upper bound of the histogram bucket holding
+ * the given percentile of the values, capped to the peak value.
+ */
+static uint64 ops_copp_cpuq_percentile (const uint64* hist, uint64 count,
+                                        uint64 peak, uint32 percent)
+{
+    uint64      target;
+    uint64      seen = 0;
+    int         bucket;
+
+    if (!count) {
+        return(0);
+    }
+
+    target = (count * percent + 99) / 100;
+    for (bucket = 0; bucket < OPS_COPP_CPUQ_HIST_BUCKETS - 1; ++bucket) {
+        seen += hist[bucket];
+        if (seen >= target) {
+            break;
         }
     }
 
-    return(OPS_COPP_SUCCESS_CODE);
+    if (!bucket) {
+        return(0);
+    }
+
+    return(MIN(((uint64) 1 << bucket) - 1, peak));
 }
 
 /*
- * ops_copp_ingress_fp_group_create
+ * ops_copp_cpuq_sample
  *
- * This function forms group for CoPP FP rules in ingress pipeline on all the
- * available hardware units. This function sets the qualifiers needed in the
- * CoPP group and then iterates over all the hardware units to create the CoPP
- * group ids.
+ * This function takes one sample of the occupancy and of the drops of
+ * all the CPU queues.
  */
-static int ops_copp_ingress_fp_group_create ()
+static void ops_copp_cpuq_sample (void)
 {
-    opennsl_field_qset_t       OpennslFPQualSetIngress;
-    int32                      retval = -1;
-    int                        unit_iterator;
+    struct ops_copp_cpuq_stats*    queue_stats;
+    uint64                         cells[OPS_COPP_QOS_QUEUE_MAX + 1];
+    uint64                         drops[OPS_COPP_QOS_QUEUE_MAX + 1];
+    bool                           cells_valid[OPS_COPP_QOS_QUEUE_MAX + 1];
+    opennsl_gport_t                gport;
+    uint64                         value;
+    uint64                         delta;
+    uint32                         unit_iterator;
+    int                            queue;
+    int                            retval;
+    int                            bst_mode;
+    bool                           bst_valid;
+    bool                           peak_mode = false;
 
-    OPENNSL_FIELD_QSET_INIT(OpennslFPQualSetIngress);
-    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetIngress,
-                                    opennslFieldQualifyStageIngress);
-    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetIngress,
-                                    opennslFieldQualifyEtherType);
-    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetIngress,
-                                    opennslFieldQualifyPacketRes);
-    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetIngress,
-                                    opennslFieldQualifyL4DstPort);
-    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetIngress,
-                                    opennslFieldQualifyIpProtocol);
-    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetIngress,
-                                    opennslFieldQualifyDstIpLocal);
-    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetIngress,
-                                    opennslFieldQualifyDstIp);
-    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetIngress,
-                                    opennslFieldQualifyIp6NextHeader);
-    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetIngress,
-                                    opennslFieldQualifyIpType);
-    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetIngress,
-                                    opennslFieldQualifyDstMac);
-    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetIngress,
-                                    opennslFieldQualifyDstIp6);
+    memset(cells, 0, sizeof(cells));
+    memset(drops, 0, sizeof(drops));
+    memset(cells_valid, 0, sizeof(cells_valid));
+
+    for (unit_iterator = 0; unit_iterator < OPS_COPP_MAX_UNITS;
+                                                        ++unit_iterator) {
+
+        /*
+         * In peak mode the BST counters are watermarks, not occupancy.
+         */
+        if (OPENNSL_FAILURE(opennsl_switch_control_get(unit_iterator,
+                                            opennslSwitchBstTrackingMode,
+                                            &bst_mode))) {
+            bst_mode = OPS_COPP_CPUQ_BST_MODE_CURRENT;
+        }
+        if (bst_mode != OPS_COPP_CPUQ_BST_MODE_CURRENT) {
+            peak_mode = true;
+        }
+
+        /*
+         * The BST counters of the CPU queues hang off the gport of the
+         * CPU port.
+         */
+        bst_valid = !peak_mode &&
+                    !OPENNSL_FAILURE(opennsl_port_gport_get(unit_iterator,
+                                                            0, &gport)) &&
+                    !OPENNSL_FAILURE(opennsl_cosq_bst_stat_sync(
+                                    unit_iterator, opennslBstStatIdCpuQueue));
+
+        for (queue = OPS_COPP_QOS_QUEUE_MIN; queue <= OPS_COPP_QOS_QUEUE_MAX;
+                                                                ++queue) {
+            if (bst_valid) {
+                retval = opennsl_cosq_bst_stat_get(unit_iterator, gport,
+                                                   queue,
+                                                   opennslBstStatIdCpuQueue,
+                                                   0, &value);
+                if (OPENNSL_FAILURE(retval)) {
+                    ops_copp_cpuq.read_failures++;
+                } else {
+                    cells[queue] = MAX(cells[queue], value);
+                    cells_valid[queue] = true;
+                }
+            }
+
+            retval = opennsl_cosq_stat_get(unit_iterator,
+                                           OPENNSL_GPORT_LOCAL_CPU, queue,
+                                           opennslCosqStatDroppedPackets,
+                                           &value);
+            if (OPENNSL_FAILURE(retval)) {
+                ops_copp_cpuq.read_failures++;
+                continue;
+            }
+
+            /*
+             * The first read only sets the base of the drop counter, and
+             * a counter going back is taken as cleared.
+             */
+            if (ops_copp_cpuq.hw_drops_valid[unit_iterator][queue]) {
+                delta = value >=
+                            ops_copp_cpuq.hw_drops[unit_iterator][queue] ?
+                        value - ops_copp_cpuq.hw_drops[unit_iterator][queue] :
+                        value;
+                drops[queue] += delta;
+            }
+            ops_copp_cpuq.hw_drops[unit_iterator][queue] = value;
+            ops_copp_cpuq.hw_drops_valid[unit_iterator][queue] = true;
+        }
+    }
+
+    ops_copp_cpuq.samples++;
+    if (peak_mode) {
+        ops_copp_cpuq.peak_mode_samples++;
+        memset(cells_valid, 0, sizeof(cells_valid));
+    }
+    for (queue = OPS_COPP_QOS_QUEUE_MIN; queue <= OPS_COPP_QOS_QUEUE_MAX;
+                                                                ++queue) {
+        queue_stats = &ops_copp_cpuq.queues[queue];
 
-    /*
-     * Iterate over all the units and create the ingress FP groups
-     */
-    for (unit_iterator = 0; unit_iterator < OPS_COPP_MAX_UNITS;
-                                                ++unit_iterator) {
-        retval = opennsl_field_group_create(
-                                unit_iterator, OpennslFPQualSetIngress,
-                                FP_GROUP_PRIORITY_2,
-                                &ops_copp_ingress_fp_group_array[
-                                                        unit_iterator]);
+        if (cells_valid[queue]) {
+            queue_stats->samples++;
+            queue_stats->peak_cells = MAX(queue_stats->peak_cells,
+                                          cells[queue]);
+            queue_stats->occupancy_hist[
+                                ops_copp_cpuq_bucket(cells[queue])]++;
+        }
 
-        if (OPENNSL_FAILURE(retval)) {
-            VLOG_ERR("\nIngress group create failed : %s\n",
-                     opennsl_errmsg(retval));
-            return(OPS_COPP_FAILURE_CODE);
+        if (drops[queue]) {
+            queue_stats->drops += drops[queue];
+            queue_stats->drop_samples++;
+            queue_stats->burst_drops += drops[queue];
+        } else if (queue_stats->burst_drops) {
+            queue_stats->bursts++;
+            queue_stats->max_burst = MAX(queue_stats->max_burst,
+                                         queue_stats->burst_drops);
+            queue_stats->burst_hist[
+                        ops_copp_cpuq_bucket(queue_stats->burst_drops)]++;
+            queue_stats->burst_drops = 0;
         }
     }
+}
 
-    return(OPS_COPP_SUCCESS_CODE);
+/*
+ * ops_copp_cpu_queue_clear
+ *
+ * This function clears the statistics of the CPU queue monitor. The drop
+ * counters of the queues keep their current values as base.
+ */
+void ops_copp_cpu_queue_clear (void)
+{
+    memset(ops_copp_cpuq.queues, 0, sizeof(ops_copp_cpuq.queues));
+    ops_copp_cpuq.samples = 0;
+    ops_copp_cpuq.read_failures = 0;
+    ops_copp_cpuq.peak_mode_samples = 0;
+    ops_copp_cpuq.started = time_msec();
 }
 
 /*
- * ops_copp_egress_fp_group_create
+ * ops_copp_cpu_queue_monitor_set
  *
- * This function forms group for CoPP FP rules in egress pipeline on all the
- * available hardware units. This function sets the qualifiers needed in the
- * CoPP group and then iterates over all the hardware units to create the CoPP
- * group ids.
+ * This function enables the CPU queue monitor with the given sampling
+ * interval in msec, or disables it. Enabling the monitor clears its
+ * statistics.
  */
-static int ops_copp_egress_fp_group_create ()
+int ops_copp_cpu_queue_monitor_set (bool enable, int interval_ms)
 {
-    opennsl_field_qset_t       OpennslFPQualSetEgress;
-    int32                      retval = -1;
-    int                        unit_iterator;
+    if (!enable) {
+        ops_copp_cpuq.enabled = false;
+        return(OPS_COPP_SUCCESS_CODE);
+    }
 
-    OPENNSL_FIELD_QSET_INIT(OpennslFPQualSetEgress);
-    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetEgress,
-                                        opennslFieldQualifyStageEgress);
-    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetEgress,
-                                        opennslFieldQualifyEtherType);
-    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetEgress,
-                                        opennslFieldQualifyOutPort);
-    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetEgress,
-                                        opennslFieldQualifyL4DstPort);
-    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetEgress,
-                                        opennslFieldQualifyIpProtocol);
-    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetEgress,
-                                        opennslFieldQualifyCpuQueue);
-    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetEgress,
-                                        opennslFieldQualifyDstMac);
-    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetEgress,
-                                        opennslFieldQualifyIp6NextHeader);
-    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetEgress,
-                                        opennslFieldQualifyIpType);
-    OPENNSL_FIELD_QSET_ADD(OpennslFPQualSetEgress,
-                                        opennslFieldQualifyDstIp);
+    if ((interval_ms < OPS_COPP_CPUQ_MIN_INTERVAL_MS) ||
+        (interval_ms > OPS_COPP_CPUQ_MAX_INTERVAL_MS)) {
+        VLOG_ERR("Invalid CPU queue monitor interval %d", interval_ms);
+        return(OPS_COPP_FAILURE_CODE);
+    }
+
+    memset(ops_copp_cpuq.hw_drops_valid, 0,
+           sizeof(ops_copp_cpuq.hw_drops_valid));
+    ops_copp_cpu_queue_clear();
+    ops_copp_cpuq.interval_ms = interval_ms;
+    ops_copp_cpuq.enabled = true;
 
     /*
-     * Iterate over all the units and create the egress FP groups
+     * Set the base of the drop counters, so that the first interval
+     * starts from now.
      */
-    for (unit_iterator = 0; unit_iterator < OPS_COPP_MAX_UNITS;
-                                                    ++unit_iterator) {
-        retval = opennsl_field_group_create(
-                                    unit_iterator, OpennslFPQualSetEgress,
-                                    FP_GROUP_PRIORITY_2,
-                                    &ops_copp_egress_fp_group_array[
-                                                            unit_iterator]);
+    ops_copp_cpuq_sample();
+    ops_copp_cpu_queue_clear();
+    ops_copp_cpuq.last_sample = ops_copp_cpuq.started;
 
-        if (OPENNSL_FAILURE(retval)) {
-            VLOG_ERR("\nEgress group create failed : %s\n",
-                     opennsl_errmsg(retval));
-            return(OPS_COPP_FAILURE_CODE);
+    VLOG_INFO("CPU queue monitor enabled, interval %d msec", interval_ms);
+    return(OPS_COPP_SUCCESS_CODE);
+}
+
+/*
+ * ops_copp_cpu_queue_dump_hist
+ *
+ * This function dumps the non empty buckets of a CPU queue monitor
+ * histogram.
+ */
+static void ops_copp_cpu_queue_dump_hist (struct ds *ds, const char* name,
+                                          const uint64* hist)
+{
+    int bucket;
+
+    ds_put_format(ds, "    %s:", name);
+    for (bucket = 0; bucket < OPS_COPP_CPUQ_HIST_BUCKETS; ++bucket) {
+        if (!hist[bucket]) {
+            continue;
+        }
+        if (!bucket) {
+            ds_put_format(ds, " 0:%"PRIu64, (uint64_t) hist[bucket]);
+        } else if (bucket == OPS_COPP_CPUQ_HIST_BUCKETS - 1) {
+            ds_put_format(ds, " >=%"PRIu64":%"PRIu64,
+                          (uint64_t) 1 << (bucket - 1),
+                          (uint64_t) hist[bucket]);
+        } else {
+            ds_put_format(ds, " <%"PRIu64":%"PRIu64,
+                          (uint64_t) 1 << bucket, (uint64_t) hist[bucket]);
         }
     }
-
-    return(OPS_COPP_SUCCESS_CODE);
+    ds_put_format(ds, "\n");
 }
 
 /*
- * ops_copp_program_fp_defaults
+ * ops_copp_cpu_queue_dump
  *
- * This function iterates over all the hardware units and all the FP
- * rules for CoPP feature and programs the FP rule entries in the ingress
- * and egress pipelines with the default values.
+ * This function dumps the statistics of the CPU queue monitor per CPU
+ * queue, along with the control packet classes mapped to each queue.
  */
-static int ops_copp_program_fp_defaults ()
+void ops_copp_cpu_queue_dump (struct ds *ds)
 {
-    int32                  retval = -1;
-    int                    unit_iterator;
-    int                    fp_rule_iterator;
+    struct ops_copp_cpuq_stats*    queue_stats;
+    long long int                  elapsed;
+    int                            fp_rule_iterator;
+    int                            queue;
 
-    /*
-     * Iterate over all the hardware units
-     */
-    for (unit_iterator = 0; unit_iterator < OPS_COPP_MAX_UNITS;
-                                                        ++unit_iterator) {
+    ds_put_format(ds, "CPU queue monitor: %s", ops_copp_cpuq.enabled ?
+                  "enabled" : "disabled");
+    if (ops_copp_cpuq.interval_ms) {
+        ds_put_format(ds, ", interval %d msec", ops_copp_cpuq.interval_ms);
+    }
+    ds_put_format(ds, "\n");
+    if (!ops_copp_cpuq.interval_ms) {
+        return;
+    }
 
-        /*
-         * Iterate over all the FP rules for control packets and program
-         * ingress and egress FP entries.
-         */
+    elapsed = ops_copp_cpuq.last_sample - ops_copp_cpuq.started;
+    ds_put_format(ds, "  samples: %"PRIu64" over %lld msec, read failures: "
+                  "%"PRIu64"\n", (uint64_t) ops_copp_cpuq.samples,
+                  MAX(elapsed, 0), (uint64_t) ops_copp_cpuq.read_failures);
+    ds_put_format(ds, "  CPU rx rate limit: %d pps\n", OPS_RX_GLOBAL_PPS);
+    if (ops_copp_cpuq.peak_mode_samples) {
+        ds_put_format(ds, "  Occupancy not sampled in %"PRIu64" samples, "
+                      "BST tracking mode was peak, not current\n",
+                      (uint64_t) ops_copp_cpuq.peak_mode_samples);
+    }
+    ds_put_format(ds, "  Occupancy is in cells, the drop bursts in "
+                  "packets\n\n");
+
+    ds_put_format(ds, "%-16s %10s %10s %12s %10s %10s\n", "CPU queue",
+                  "Peak", "p99", "Drops", "Bursts", "Max burst");
+    for (queue = OPS_COPP_QOS_QUEUE_MAX; queue >= OPS_COPP_QOS_QUEUE_MIN;
+                                                                --queue) {
+        queue_stats = &ops_copp_cpuq.queues[queue];
+        ds_put_format(ds, "%-16s %10"PRIu64" %10"PRIu64" %12"PRIu64
+                      " %10"PRIu64" %10"PRIu64"\n",
+                      ops_copp_get_name_from_cpu_queue_number(queue),
+                      (uint64_t) queue_stats->peak_cells,
+                      (uint64_t) ops_copp_cpuq_percentile(
+                                            queue_stats->occupancy_hist,
+                                            queue_stats->samples,
+                                            queue_stats->peak_cells, 99),
+                      (uint64_t) queue_stats->drops,
+                      (uint64_t) queue_stats->bursts,
+                      (uint64_t) queue_stats->max_burst);
+
+        ds_put_format(ds, "    classes:");
         for (fp_rule_iterator = 0; fp_rule_iterator < PLUGIN_COPP_MAX_CLASSES;
              ++fp_rule_iterator) {
-
-            /*
-             * Program the control packet class rules for some
-             * control plane packets.
-             */
-            retval = ops_copp_packet_class_programmer(
-                       unit_iterator, fp_rule_iterator);
-
-            if (retval != OPS_COPP_SUCCESS_CODE) {
-                VLOG_ERR("Packet class rule create failed");
-                log_event("COPP_CLASS_PACKET_RULE_FAILURE",
-                           EV_KV("class", "%s",
-                           (ops_copp_packet_class_t[fp_rule_iterator])
-                           .ops_copp_packet_name));
-                return(OPS_COPP_FAILURE_CODE);
+            if (ops_copp_packet_class_t[fp_rule_iterator].
+                            ops_copp_ingress_fp_queue_number == queue) {
+                ds_put_format(ds, " %s",
+                              ops_copp_packet_class_t[fp_rule_iterator].
+                                                ops_copp_packet_name);
             }
+        }
+        ds_put_format(ds, "\n");
 
-            /*
-             * Program the ingress FP entry with default values.
-             */
-            retval = ops_copp_ingress_fp_programmer(
-                       unit_iterator, fp_rule_iterator, NULL);
-
-            if (retval != OPS_COPP_SUCCESS_CODE) {
-                VLOG_ERR("Ingress FP rule create failed");
-                log_event("COPP_CLASS_INGRESS_FP_CREATE_FAILURE",
-                           EV_KV("class", "%s",
-                           (ops_copp_packet_class_t[fp_rule_iterator])
-                           .ops_copp_packet_name));
-                return(OPS_COPP_FAILURE_CODE);
-            }
+        if (queue_stats->samples) {
+            ops_copp_cpu_queue_dump_hist(ds, "occupancy",
+                                         queue_stats->occupancy_hist);
+        }
+        if (queue_stats->bursts) {
+            ops_copp_cpu_queue_dump_hist(ds, "drop bursts",
+                                         queue_stats->burst_hist);
+        }
+        if (queue_stats->burst_drops) {
+            ds_put_format(ds, "    burst in progress: %"PRIu64" drops\n",
+                          (uint64_t) queue_stats->burst_drops);
+        }
+    }
+}
 
-            /*
-             * Program the egress FP entry with default values.
-             */
-            retval = ops_copp_egress_fp_programmer(
-                       unit_iterator, fp_rule_iterator, NULL, NULL);
+/*
+ * ops_copp_run
+ *
+ * This function runs the periodic CoPP work. It is called from the
+ * ofproto run loop.
+ */
+void ops_copp_run (void)
+{
+    long long int   now;
 
-            if (retval != OPS_COPP_SUCCESS_CODE) {
-                VLOG_ERR("Egress FP rule create failed");
-                log_event("COPP_CLASS_EGRESS_FP_CREATE_FAILURE",
-                           EV_KV("class", "%s",
-                           (ops_copp_packet_class_t[fp_rule_iterator])
-                           .ops_copp_packet_name));
-                return(OPS_COPP_FAILURE_CODE);
-            }
+    if (!ops_copp_tune.enabled && !ops_copp_cpuq.enabled) {
+        return;
+    }
 
-            /*
-             * Set the hardware status in the fp rule structure as valid (true)
-             */
-            retval = ops_copp_packet_class_set_status(
-                       unit_iterator, fp_rule_iterator, true);
-            if (retval != OPS_COPP_SUCCESS_CODE) {
-                VLOG_ERR("Valid status set for  FP rule create failed");
-                return(OPS_COPP_FAILURE_CODE);
-            }
-        }
+    now = time_msec();
+    if (ops_copp_cpuq.enabled &&
+        (now >= ops_copp_cpuq.last_sample + ops_copp_cpuq.interval_ms)) {
+        ops_copp_cpuq_sample();
+        ops_copp_cpuq.last_sample = now;
+    }
+    if (ops_copp_tune.enabled &&
+        (now >= ops_copp_tune.last_run + OPS_COPP_TUNE_PERIOD_MS)) {
+        ops_copp_tune_run(now);
     }
+}
 
-    return(OPS_COPP_SUCCESS_CODE);
+/*
+ * ops_copp_wait
+ *
+ * This function arranges for the poll loop to wake up for the next run of
+ * the periodic CoPP work.
+ */
+void ops_copp_wait (void)
+{
+    if (ops_copp_tune.enabled) {
+        poll_timer_wait_until(ops_copp_tune.last_run +
+                              OPS_COPP_TUNE_PERIOD_MS);
+    }
+    if (ops_copp_cpuq.enabled) {
+        poll_timer_wait_until(ops_copp_cpuq.last_sample +
+                              ops_copp_cpuq.interval_ms);
+    }
 }
 
 /*
@@ -3855,6 +3017,11 @@ static int ops_copp_set_packet_class_config
         return(OPS_COPP_FAILURE_CODE);
     }
 
+    /*
+     * The rules get new stat objects, queue, rate and burst values.
+     */
+    ops_copp_stats_invalidate(-1);
+
     for (unit_iterator = 0; unit_iterator < OPS_COPP_MAX_UNITS;
                                                         ++unit_iterator) {
         /*
@@ -3885,6 +3052,13 @@ static int ops_copp_set_packet_class_config
         }
     }
 
+    /*
+     * The policer auto-tuning works around the new configured rate.
+     */
+    ops_copp_tune_class_configured(copp_config->ops_copp_packet_class,
+                                   copp_config->ops_copp_rate,
+                                   copp_config->ops_copp_burst);
+
     return(OPS_COPP_SUCCESS_CODE);
 }
 
@@ -4145,9 +3319,9 @@ int copp_opennsl_stats_get(const unsigned int hw_asic_id,
                    const enum copp_protocol_class class,
                    struct copp_protocol_stats *const stats)
 {
-    int    retval;
     enum   ops_copp_packet_class_code_t mapped_packet_class;
-    struct ops_copp_stats_t copp_stats_array;
+    const struct ops_copp_stats_snapshot* snapshot;
+    const struct ops_copp_class_snapshot* class_snapshot;
 
     /* Check for stats pointer passed not being NULL */
     if (stats == NULL) {
@@ -4162,24 +3336,23 @@ int copp_opennsl_stats_get(const unsigned int hw_asic_id,
         return EOPNOTSUPP;
     }
 
-    copp_stats_array.ops_copp_packet_class = mapped_packet_class;
-    copp_stats_array.ops_copp_hardware_unit_number = hw_asic_id;
-
     /*
-     * After the above 2 fields are filled, pass it to the get_copp_counts.
-     * The number of copp classes passed is just one.
+     * Serve the stats from the snapshot of the hardware unit, which is
+     * refreshed for all the classes at once when it gets stale.
      */
-    retval = get_copp_counts(1, &copp_stats_array);
-    if (retval != OPS_COPP_SUCCESS_CODE) {
+    snapshot = ops_copp_stats_lookup(hw_asic_id);
+    if (!snapshot ||
+        !snapshot->classes[mapped_packet_class].stats_valid) {
         VLOG_ERR("Error getting stats for hardware unit %u", hw_asic_id);
         return EIO;
     }
 
     /* Fill in the 4 stats field in the stats pointer */
-    stats->packets_passed = copp_stats_array.ops_copp_packets_allowed;
-    stats->bytes_passed = copp_stats_array.ops_copp_bytes_allowed;
-    stats->packets_dropped = copp_stats_array.ops_copp_packets_dropped;
-    stats->bytes_dropped = copp_stats_array.ops_copp_bytes_dropped;
+    class_snapshot = &snapshot->classes[mapped_packet_class];
+    stats->packets_passed = class_snapshot->packets_allowed;
+    stats->bytes_passed = class_snapshot->bytes_allowed;
+    stats->packets_dropped = class_snapshot->packets_dropped;
+    stats->bytes_dropped = class_snapshot->bytes_dropped;
 
     return 0;
 }
@@ -4197,6 +3370,8 @@ int copp_opennsl_hw_status_get(const unsigned int hw_asic_id,
                        struct copp_hw_status *const hw_status)
 {
     enum   ops_copp_packet_class_code_t mapped_packet_class;
+    const struct ops_copp_stats_snapshot* snapshot;
+    const struct ops_copp_class_snapshot* class_snapshot;
 
     /* Check for stats pointer passed not being NULL */
     if (hw_status == NULL) {
@@ -4216,264 +3391,199 @@ int copp_opennsl_hw_status_get(const unsigned int hw_asic_id,
      * if the packet_class struct has egress or ingress fp as NULL ptr,
      * it means that, the configuration has not gone througgh fine.
      */
-    if (ops_copp_packet_class_t[mapped_packet_class].status[hw_asic_id]
-        == false) {
+    snapshot = ops_copp_stats_lookup(hw_asic_id);
+    if (!snapshot ||
+        !snapshot->classes[mapped_packet_class].hw_valid) {
         VLOG_ERR("Error getting hw status for hardware unit %u", hw_asic_id);
         return EIO;
     }
 
-    hw_status->rate =
-          ops_copp_packet_class_t[mapped_packet_class].ops_copp_egress_fp_rate;
-    hw_status->burst =
-          ops_copp_packet_class_t[mapped_packet_class].ops_copp_egress_fp_burst;
-    hw_status->local_priority =
-          ops_copp_packet_class_t[mapped_packet_class].ops_copp_ingress_fp_queue_number;
+    class_snapshot = &snapshot->classes[mapped_packet_class];
+    hw_status->rate = class_snapshot->rate;
+    hw_status->burst = class_snapshot->burst;
+    hw_status->local_priority = class_snapshot->queue_number;
 
     return 0;
 }
 
 /*
- * ops_copp_packet_stats_to_string
+ * ops_copp_stats_dump
  *
- * This function prepares a buffer with the packet statistics
- * for a given control plane packet class. The CoPP stat values are
- * read from the structure ops_copp_stats_t which is passed to this
- * function. The control plane packet stats are populated in the buffer
- * passed to this function.
+ * This function dumps the configuration parameters and packet statistics
+ * of each control plane packet class for all the hardware units, as held
+ * in the CoPP stats snapshot.
  */
-static int ops_copp_packet_stats_to_string (
-                                     struct ops_copp_stats_t copp_stats,
-                                     char* ops_copp_packet_stat_buffer,
-                                     uint32 bytes_already_written,
-                                     uint32 max_length)
+void ops_copp_stats_dump (struct ds *ds)
 {
-    int                        bytes_written;
+    const struct ops_copp_stats_snapshot*   snapshot;
+    const struct ops_copp_class_snapshot*   class_snapshot;
+    uint32                                  unit_iterator;
+    int                                     fp_rule_iterator;
+    char*                                   cpu_queue_name;
 
-    /*
-     * Test for error conditions
-     */
-    if (!ops_copp_packet_stat_buffer || !max_length ||
-        (bytes_already_written >= max_length)) {
-        return(0);
-    }
+    for (unit_iterator = 0; unit_iterator < OPS_COPP_MAX_UNITS;
+                                                        ++unit_iterator) {
 
-    /*
-     * Zero out the buffer for the per control plane packet class.
-     */
-    memset(ops_copp_packet_stat_buffer + bytes_already_written, 0,
-           max_length - bytes_already_written);
+        snapshot = ops_copp_stats_lookup(unit_iterator);
 
-    /*
-     * The following details are entered into the per control plane packet
-     * buffer.
-     * 1. Stats
-     *   a. Packets allowed and bytes allowed
-     *   b. Packets dropped and bytes dropped
-     */
-    bytes_written = snprintf(
-                        ops_copp_packet_stat_buffer + bytes_already_written,
-                        max_length - bytes_already_written,
-                        "\tPacket Statistics:\n"
-                        "\t\tPackets Allowed: %10llu\tBytes Allowed: %10llu\n"
-                        "\t\tPackets Dropped: %10llu\tBytes Dropped: %10llu\n\n",
-                        copp_stats.ops_copp_packets_allowed,
-                        copp_stats.ops_copp_bytes_allowed,
-                        copp_stats.ops_copp_packets_dropped,
-                        copp_stats.ops_copp_bytes_dropped);
+        ds_put_format(ds, "\nHardware Unit: %u\n", unit_iterator);
+        ds_put_format(ds, "Snapshot: age %lld ms, interval %lld ms, "
+                      "sweeps %"PRIu64", read failures %"PRIu64"\n\n",
+                      time_msec() - snapshot->taken,
+                      ops_copp_stats_interval_ms,
+                      (uint64_t) snapshot->sweeps,
+                      (uint64_t) snapshot->read_failures);
 
-    /*
-     * Return the number of bytes written into the per control plane packet
-     * buffer.
-     */
-    return(bytes_written);
+        for (fp_rule_iterator = 0; fp_rule_iterator < PLUGIN_COPP_MAX_CLASSES;
+             ++fp_rule_iterator) {
+            class_snapshot = &snapshot->classes[fp_rule_iterator];
+            cpu_queue_name = ops_copp_get_name_from_cpu_queue_number(
+                                        class_snapshot->queue_number);
+
+            ds_put_format(ds, "Control Plane Packet: %s\n"
+                          "\tConfiguration:\n"
+                          "\t\tCPU QoS queue: %s (%u)\n"
+                          "\t\tRate: %u pps\n"
+                          "\t\tBurst: %u packets\n",
+                          ops_copp_packet_class_t[fp_rule_iterator].
+                                                    ops_copp_packet_name,
+                          cpu_queue_name ? cpu_queue_name : "NULL",
+                          class_snapshot->queue_number,
+                          class_snapshot->rate,
+                          class_snapshot->burst);
+
+            if (!class_snapshot->stats_valid) {
+                ds_put_format(ds, "\tPacket Statistics: unavailable\n\n");
+                continue;
+            }
+
+            ds_put_format(ds, "\tPacket Statistics:\n"
+                          "\t\tPackets Allowed: %10"PRIu64
+                          "\tBytes Allowed: %10"PRIu64"\n"
+                          "\t\tPackets Dropped: %10"PRIu64
+                          "\tBytes Dropped: %10"PRIu64"\n\n",
+                          (uint64_t) class_snapshot->packets_allowed,
+                          (uint64_t) class_snapshot->bytes_allowed,
+                          (uint64_t) class_snapshot->packets_dropped,
+                          (uint64_t) class_snapshot->bytes_dropped);
+        }
+    }
 }
 
 /*
- * ops_copp_packet_config_to_string
+ * ops_copp_rule_qualifier_count
  *
- * This function prepares a buffer with the control packet configuration
- * values for a given control plane packet class. The CoPP configuration
- * values are read from the structure ops_copp_fp_rule_t which is passed to
- * this function. The control plane configuration values are populated in the
- * buffer passed to this function.
+ * This function returns the number of qualifiers of a CoPP FP rule.
  */
-static int ops_copp_packet_config_to_string (
-                                      struct ops_copp_fp_rule_t copp_fp_rule,
-                                      char* ops_copp_packet_stat_buffer,
-                                      uint32 bytes_already_written,
-                                      uint32 max_length)
+static int ops_copp_rule_qualifier_count (
+                               const struct ops_copp_fp_entry_spec_t* rule)
 {
-    int                        bytes_written;
-    char*                      cpu_queue_name;
+    int                    count = 0;
 
-    /*
-     * Test for error conditions
-     */
-    if (!ops_copp_packet_stat_buffer || !max_length ||
-        (bytes_already_written >= max_length)) {
-        return(0);
+    while ((count < OPS_COPP_MAX_QUALIFIERS) &&
+           (rule->qualifiers[count].type != OPS_COPP_QUALIFIER_NONE)) {
+        count++;
     }
 
-    /*
-     * Zero out the buffer for the per control plane packet class.
-     */
-    memset(ops_copp_packet_stat_buffer + bytes_already_written, 0,
-           max_length - bytes_already_written);
-
-    /*
-     * The following details are entered into the per control plane packet
-     * buffer.
-     * 1. Configuration
-     *   a. CPU QoS queue number
-     *   b. Packet rate in pps units
-     *   c. Packet Burst in packet units
-     */
-    cpu_queue_name = ops_copp_get_name_from_cpu_queue_number(
-                            copp_fp_rule.ops_copp_ingress_fp_queue_number);
-    bytes_written = snprintf(
-                        ops_copp_packet_stat_buffer + bytes_already_written,
-                        max_length - bytes_already_written,
-                        "Control Plane Packet: %s\n"
-                        "\tConfiguration:\n"
-                        "\t\tCPU QoS queue: %s (%u)\n"
-                        "\t\tRate: %u pps\n"
-                        "\t\tBurst: %u packets\n",
-                        copp_fp_rule.ops_copp_packet_name,
-                        cpu_queue_name ? cpu_queue_name : "NULL",
-                        copp_fp_rule.ops_copp_ingress_fp_queue_number,
-                        copp_fp_rule.ops_copp_egress_fp_rate,
-                        copp_fp_rule.ops_copp_egress_fp_burst);
-
-    /*
-     * Return the number of bytes written into the per control plane packet
-     * buffer.
-     */
-    return(bytes_written);
-
+    return(count);
 }
 
 /*
- * ops_get_all_packet_stats
+ * ops_copp_footprint_dump
  *
- * This function iterates over all the hardware units and prepares a buffer with
- * the configuration parameters and packet statistics for each control
- * plane packet class.
+ * This function dumps the hardware resources used by the CoPP rules per
+ * hardware unit: the ingress and egress FP entries with their qualifiers,
+ * the policers, the stat objects and the global rx rules.
  */
-int ops_get_all_packet_stats ()
+void ops_copp_footprint_dump (struct ds *ds)
 {
-    int                         unit_iterator;
+    struct ops_copp_fp_rule_t*  copp_packet_class;
+    uint32                      unit_iterator;
     int                         fp_rule_iterator;
-    int                         total_bytes_written;
-    int                         packet_class_config_bytes_written;
-    int                         packet_class_stats_bytes_written;
-    int                         maximum_bytes_available;
-    int                         retval;
-    struct ops_copp_stats_t     copp_stats[PLUGIN_COPP_MAX_CLASSES];
-
-    maximum_bytes_available = COPP_MAX_PACKET_STAT_BUFFER_SIZE
-                                            * PLUGIN_COPP_MAX_CLASSES;
-
-    /*
-     * Zero out the global buffer that will contain all the output for
-     * copp stats.
-     */
-    memset(ops_copp_all_packet_stat_buffer, 0, maximum_bytes_available);
+    int                         rule_iterator;
+    int                         ingress_entries, ingress_qualifiers;
+    int                         egress_entries, egress_qualifiers;
+    int                         policers, stat_objects, rx_rules;
+    int                         total_ingress_entries, total_egress_entries;
+    int                         total_qualifiers, total_policers;
+    int                         total_stat_objects, total_rx_rules;
 
-    /*
-     * Iterate over all the hardware units
-     */
-    total_bytes_written = 0;
     for (unit_iterator = 0; unit_iterator < OPS_COPP_MAX_UNITS;
                                                         ++unit_iterator) {
 
-        /*
-         * Zero out copp_stats array
-         */
-        memset(copp_stats, 0, PLUGIN_COPP_MAX_CLASSES *
-                                      sizeof(struct ops_copp_stats_t));
+        total_ingress_entries = total_egress_entries = 0;
+        total_qualifiers = total_policers = 0;
+        total_stat_objects = total_rx_rules = 0;
 
-        /*
-         * Add the hardware unit number into the buffer.
-         */
-        total_bytes_written += snprintf(
-                                 ops_copp_all_packet_stat_buffer,
-                                 maximum_bytes_available,
-                                 "\nHardware Unit: %u\n\n",
-                                 unit_iterator);
+        ds_put_format(ds, "\nHardware Unit: %u\n", unit_iterator);
+        ds_put_format(ds, "%-36s %8s %8s %8s %6s %8s\n", "Control Plane Packet",
+                      "Ingress", "Egress", "Policer", "Stat", "Rx rule");
 
-        /*
-         * Populate the copp_stats array with the hardware unit and the
-         * CoPP packet class rule to fetch the CoPP stats.
-         */
         for (fp_rule_iterator = 0; fp_rule_iterator < PLUGIN_COPP_MAX_CLASSES;
              ++fp_rule_iterator) {
-            copp_stats[fp_rule_iterator].ops_copp_hardware_unit_number =
-                                                                unit_iterator;
-            copp_stats[fp_rule_iterator].ops_copp_packet_class =
-                                                             fp_rule_iterator;
-        }
-
-        /*
-         * Get CoPP stats for all CoPP control packet classes
-         */
-        retval = get_copp_counts(PLUGIN_COPP_MAX_CLASSES,
-                                 copp_stats);
-        if (retval != OPS_COPP_SUCCESS_CODE) {
-            VLOG_ERR("Error getting stats for hardware unit %u", unit_iterator);
-            continue;
-        }
 
-        /*
-         * Iterate over all the FP rules for control packets and printall
-         * the configuration and statistics into the global buffer
-         */
-        for (fp_rule_iterator = 0; fp_rule_iterator < PLUGIN_COPP_MAX_CLASSES;
-             ++fp_rule_iterator) {
+            copp_packet_class = &ops_copp_packet_class_t[fp_rule_iterator];
+
+            ingress_entries = ingress_qualifiers = 0;
+            for (rule_iterator = 0; rule_iterator < OPS_COPP_MAX_RULES_INGRESS;
+                 ++rule_iterator) {
+                if (copp_packet_class->ops_copp_ingress_fp_entry[unit_iterator][
+                                                             rule_iterator]) {
+                    ingress_entries++;
+                    ingress_qualifiers += ops_copp_rule_qualifier_count(
+                                &copp_packet_class->ops_copp_ingress_fp_rules[
+                                                             rule_iterator]);
+                }
+            }
 
-            /*
-             * Get the per control plane packet class configuration details
-             */
-            packet_class_config_bytes_written =
-                        ops_copp_packet_config_to_string(
-                                 ops_copp_packet_class_t[fp_rule_iterator],
-                                 ops_copp_all_packet_stat_buffer,
-                                 total_bytes_written,
-                                 maximum_bytes_available);
+            egress_entries = egress_qualifiers = 0;
+            if (copp_packet_class->ops_copp_egress_fp_entry[unit_iterator]) {
+                egress_entries = 1;
 
-            /*
-             * If some data was written for the  control packet class, then
-             * update the total_bytes_written with the number of bytes written
-             * into the global buffer.
-             */
-            if (packet_class_config_bytes_written > 0) {
-                total_bytes_written += packet_class_config_bytes_written;
+                /*
+                 * Every egress entry is also qualified on the out port
+                 * and the CPU queue.
+                 */
+                egress_qualifiers = ops_copp_rule_qualifier_count(
+                                &copp_packet_class->ops_copp_egress_fp_rule)
+                                    + 2;
             }
 
-            /*
-             * Get the per control plane packet class packet stats.
-             */
-            packet_class_stats_bytes_written =
-                        ops_copp_packet_stats_to_string(
-                                      copp_stats[fp_rule_iterator],
-                                      ops_copp_all_packet_stat_buffer,
-                                      total_bytes_written,
-                                      maximum_bytes_available);
+            policers = copp_packet_class->
+                        ops_copp_egress_fp_policer_id[unit_iterator] ? 1 : 0;
+            stat_objects = copp_packet_class->
+                        ops_copp_egress_fp_stat_id[unit_iterator] ? 1 : 0;
 
-            /*
-             * If some data was written for the  control packet class, then
-             * update the total_bytes_written with the number of bytes written
-             * into the global buffer.
-             */
-            if (packet_class_stats_bytes_written > 0) {
-                total_bytes_written += packet_class_stats_bytes_written;
+            rx_rules = 0;
+            if (copp_packet_class->status[unit_iterator]) {
+                while ((rx_rules < OPS_COPP_MAX_RX_RULES) &&
+                       copp_packet_class->ops_copp_rx_rules[rx_rules].valid) {
+                    rx_rules++;
+                }
             }
+
+            ds_put_format(ds, "%-36s %3d (%2d) %3d (%2d) %8d %6d %8d\n",
+                          copp_packet_class->ops_copp_packet_name,
+                          ingress_entries, ingress_qualifiers,
+                          egress_entries, egress_qualifiers,
+                          policers, stat_objects, rx_rules);
+
+            total_ingress_entries += ingress_entries;
+            total_egress_entries += egress_entries;
+            total_qualifiers += ingress_qualifiers + egress_qualifiers;
+            total_policers += policers;
+            total_stat_objects += stat_objects;
+            total_rx_rules += rx_rules;
         }
-    }
 
-    /*
-     * Return the total number of bytes written into the global buffer.
-     */
-    return(total_bytes_written);
+        ds_put_format(ds, "\nTotal: %d ingress FP entries, %d egress FP "
+                      "entries, %d qualifiers, %d policers, %d stat objects, "
+                      "%d rx rules (rx index %d)\n",
+                      total_ingress_entries, total_egress_entries,
+                      total_qualifiers, total_policers, total_stat_objects,
+                      total_rx_rules,
+                      ops_copp_packet_class_rx_index[unit_iterator]);
+    }
 }
 
 /*
@@ -51,6 +51,8 @@
 #include "ops-sflow.h"
 #include "ops-classifier.h"
 #include "netdev-bcmsdk.h"
+#include "ops-bcm-init.h"
+#include "bufmon-bcm-provider.h"
 
 VLOG_DEFINE_THIS_MODULE(ops_debug);
 
@@ -61,11 +63,6 @@ uint32 slog_level = 0x0;
 // OPS_TODO: for BPDU TX/RX debugging.
 int pkt_debug = 0;
 
-/*
- * Extern declaration for dumping copp packet stats
- */
-extern char ops_copp_all_packet_stat_buffer[];
-
 /*
  * Extern declaration for dumping the copp CPU queue names
  */
@@ -90,6 +87,7 @@ char cmd_ops_usage[] =
 "   opennsl-version - displays the opennsl version.\n"
 "   vlan <vid> - displays OpenSwitch VLAN info.\n"
 "   hwvlan - displays hardware VLAN info.\n"
+"   vlan-link-bench <hw port> [<iterations> | hw [<cycles>]] - benchmarks finding the VLANs of a port on a link change, with hw also times real link down/up reconfigurations of a link up port, disrupting its traffic.\n"
 "   knet [netif | filter] - displays knet information\n"
 "   l3intf [<interface id>] - display OpenSwitch interface info.\n"
 "   l3host - display OpenSwitch l3 host info.\n"
@@ -101,11 +99,24 @@ char cmd_ops_usage[] =
 "   lag [<lagid>] - displays OpenSwitch LAG info.\n"
 "   stg [hw] <stgid> - displays Spanning Tree Group Info. \n"
 "   fp [<copp-ingress-group> | <copp-egress-group> | <ospf-group> | <acl-ingress-group> | <l3-group> | <l3-subinterface>]- displays programmed fp rules.\n"
-"   copp-stats - displays all the CoPP configuration and statistics.\n"
+"   copp-stats [interval <msec>] - displays all the CoPP configuration and statistics, or sets the snapshot refresh interval.\n"
+"   copp-footprint - displays the FP entries, qualifiers, policers, stat objects and rx rules used by the CoPP rules.\n"
+"   copp-autotune [enable [<budget pps>] | disable | class <packet class name> <floor pps> <ceiling pps>] - displays or configures the CoPP policer auto-tuning.\n"
+"   cpu-queues [enable [<interval msec>] | disable | clear] - displays or configures the CPU queue occupancy and drop monitor.\n"
 "   copp-config <packet class name> <CPU queue class> <Rate> <Burst> - Modifies the CoPP rule for a control packet class \n"
 "   cpu-queue-stats - displays the per cpu queue statistics.\n"
+"   rx-dispatch - displays the RX dispatch per class counters.\n"
+"   rx-stats [reset] - displays or clears the RX per reason counters and latencies.\n"
+"   acl-log [rate <records/s> <burst> | clear] - displays or sets ACL logging admission.\n"
+"   acl-compile - displays the compiled size and last update of each ACL.\n"
+"   acl-pbmp-batch [<msec> | clear] - displays or sets batching of ACL port bitmap updates.\n"
+"   acl-stats [interval <msec> | refresh] - displays or sets the ACL hit count cache.\n"
+"   acl-verify [<packets> | bench <aces> <packets>] - sets ACL install verification or benchmarks the ACL evaluation.\n"
 "   qos [cos-map | dscp-map | trust | dscp-override | queuing | scheduling | "
-        "statistics] - displays QoS information programmed in hardware.\n"
+        "statistics [interval <msec> | bench <iterations>]] - displays QoS information programmed in hardware.\n"
+"   bst-sampler [enable [<interval msec>] | disable | clear] - displays or configures the high frequency BST sampler.\n"
+"   bst-capture [<capture> | rate <captures/s> <burst> | clear] - displays the buffer state captured on BST triggers or sets the capture rate.\n"
+"   sflow-header-bench [<iterations>] - checks and benchmarks the sFlow sampled header builder.\n"
 "   hw-resource [aclv4 | copp | ospf | l3intf] - displays hardware resource utilization.\n"
 "   help - displays this help text.\n"
 ;
@@ -1391,6 +1402,27 @@ bcm_plugin_debug(struct unixctl_conn *conn, int argc,
             ops_hw_vlan_dump(&ds);
             goto done;
 
+        } else if (!strcmp(ch, "vlan-link-bench")) {
+            int hw_port = -1;
+            int iterations = 1000;
+            int hw_cycles = 0;
+
+            if (NULL != (ch = NEXT_ARG())) {
+                hw_port = atoi(ch);
+                if (NULL != (ch = NEXT_ARG())) {
+                    if (!strcmp(ch, "hw")) {
+                        hw_cycles = OPS_VLAN_LINK_BENCH_DFLT_HW_CYCLES;
+                        if (NULL != (ch = NEXT_ARG())) {
+                            hw_cycles = atoi(ch);
+                        }
+                    } else {
+                        iterations = atoi(ch);
+                    }
+                }
+            }
+            ops_vlan_link_bench(&ds, hw_port, iterations, hw_cycles);
+            goto done;
+
         } else if (!strcmp(ch, "stg")) {
             int stgid = -1;
 
@@ -1483,10 +1515,162 @@ bcm_plugin_debug(struct unixctl_conn *conn, int argc,
             goto done;
 
         } else if (!strcmp(ch, "copp-stats")) {
-            if (ops_get_all_packet_stats() > 0) {
-                ds_put_format(&ds, "%s",
-                        ops_copp_all_packet_stat_buffer);
+            if (NULL != (ch = NEXT_ARG())) {
+                if (!strcmp(ch, "interval") && (NULL != (ch = NEXT_ARG()))
+                    && !ops_copp_stats_set_interval(atoi(ch))) {
+                    ds_put_format(&ds, "CoPP stats interval set to %s ms\n",
+                                  ch);
+                } else {
+                    ds_put_format(&ds, "Invalid CoPP stats interval, "
+                                  "expected 0 - %d ms\n",
+                                  OPS_COPP_STATS_MAX_INTERVAL_MS);
+                }
+                goto done;
             }
+            ops_copp_stats_dump(&ds);
+            goto done;
+
+        } else if (!strcmp(ch, "copp-footprint")) {
+            ops_copp_footprint_dump(&ds);
+            goto done;
+
+        } else if (!strcmp(ch, "copp-autotune")) {
+            const char* copp_packet_name;
+            const char* copp_floor;
+            const char* copp_ceiling;
+            enum ops_copp_packet_class_code_t copp_packet_class;
+
+            if (NULL != (ch = NEXT_ARG())) {
+                if (!strcmp(ch, "enable")) {
+                    ch = NEXT_ARG();
+                    ops_copp_tune_enable(true, ch ? atoi(ch) : 0);
+                } else if (!strcmp(ch, "disable")) {
+                    ops_copp_tune_enable(false, 0);
+                } else if (!strcmp(ch, "class")) {
+                    copp_packet_name = NEXT_ARG();
+                    copp_floor = NEXT_ARG();
+                    copp_ceiling = NEXT_ARG();
+                    if (!copp_packet_name || !copp_floor || !copp_ceiling) {
+                        goto copp_autotune_help;
+                    }
+                    copp_packet_class =
+                        ops_copp_get_packet_class_from_packet_name(
+                                                (char*)copp_packet_name);
+                    if ((copp_packet_class == ~0) ||
+                        (atoi(copp_floor) < 0) || (atoi(copp_ceiling) < 0) ||
+                        ops_copp_tune_set_bounds(copp_packet_class,
+                                                 atoi(copp_floor),
+                                                 atoi(copp_ceiling))) {
+                        ds_put_format(&ds, "Invalid packet class or "
+                                      "bounds\n");
+                        goto copp_autotune_help;
+                    }
+                } else {
+                    goto copp_autotune_help;
+                }
+            }
+            ops_copp_tune_dump(&ds);
+            goto done;
+
+copp_autotune_help:
+            ds_put_format(&ds, "%s", "Usage: ovs-appctl plugin/debug "
+                          "copp-autotune [enable [<budget pps>] | disable | "
+                          "class <packet class name> <floor pps> "
+                          "<ceiling pps>]\n");
+            goto done;
+
+        } else if (!strcmp(ch, "cpu-queues")) {
+            if (NULL != (ch = NEXT_ARG())) {
+                if (!strcmp(ch, "enable")) {
+                    ch = NEXT_ARG();
+                    if (ops_copp_cpu_queue_monitor_set(true, ch ? atoi(ch) :
+                                            OPS_COPP_CPUQ_DFLT_INTERVAL_MS)) {
+                        ds_put_format(&ds, "Invalid interval, must be "
+                                      "%d to %d msec\n",
+                                      OPS_COPP_CPUQ_MIN_INTERVAL_MS,
+                                      OPS_COPP_CPUQ_MAX_INTERVAL_MS);
+                        goto done;
+                    }
+                } else if (!strcmp(ch, "disable")) {
+                    ops_copp_cpu_queue_monitor_set(false, 0);
+                } else if (!strcmp(ch, "clear")) {
+                    ops_copp_cpu_queue_clear();
+                } else {
+                    ds_put_format(&ds, "%s", "Usage: ovs-appctl plugin/debug "
+                                  "cpu-queues [enable [<interval msec>] | "
+                                  "disable | clear]\n");
+                    goto done;
+                }
+            }
+            ops_copp_cpu_queue_dump(&ds);
+            goto done;
+
+        } else if (!strcmp(ch, "sflow-header-bench")) {
+            int iterations = 1000000;
+
+            if (NULL != (ch = NEXT_ARG())) {
+                iterations = atoi(ch);
+            }
+            ops_sflow_header_bench(&ds, iterations);
+            goto done;
+
+        } else if (!strcmp(ch, "bst-sampler")) {
+            if (NULL != (ch = NEXT_ARG())) {
+                if (!strcmp(ch, "enable")) {
+                    ch = NEXT_ARG();
+                    if (!bst_tracking_mode_is_current()) {
+                        ds_put_format(&ds, "BST tracking mode is peak, the "
+                                      "sampler needs the current mode\n");
+                        goto done;
+                    }
+                    if (bst_sampler_set(true, ch ? atoi(ch) :
+                                        BST_SAMPLER_DFLT_INTERVAL_MS)) {
+                        ds_put_format(&ds, "Invalid interval, must be "
+                                      "%d to %d msec\n",
+                                      BST_SAMPLER_MIN_INTERVAL_MS,
+                                      BST_SAMPLER_MAX_INTERVAL_MS);
+                        goto done;
+                    }
+                } else if (!strcmp(ch, "disable")) {
+                    bst_sampler_set(false, 0);
+                } else if (!strcmp(ch, "clear")) {
+                    bst_sampler_clear();
+                } else {
+                    ds_put_format(&ds, "%s", "Usage: ovs-appctl plugin/debug "
+                                  "bst-sampler [enable [<interval msec>] | "
+                                  "disable | clear]\n");
+                    goto done;
+                }
+            }
+            bst_sampler_dump(&ds);
+            goto done;
+
+        } else if (!strcmp(ch, "bst-capture")) {
+            unsigned long long int seq = 0;
+
+            if (NULL != (ch = NEXT_ARG())) {
+                if (!strcmp(ch, "rate")) {
+                    const char *rate = NEXT_ARG();
+                    const char *burst = NEXT_ARG();
+
+                    if (!rate || !burst ||
+                        bst_capture_set_rate(atoi(rate), atoi(burst))) {
+                        ds_put_format(&ds, "Invalid rate, must be 1 to %d "
+                                      "captures/s with a burst of 1 to %d\n",
+                                      BST_CAPTURE_MAX_RATE,
+                                      BST_CAPTURE_RING_SIZE);
+                        goto done;
+                    }
+                } else if (!strcmp(ch, "clear")) {
+                    bst_capture_clear();
+                } else if (!str_to_ullong(ch, 10, &seq) || !seq) {
+                    ds_put_format(&ds, "%s", "Usage: ovs-appctl plugin/debug "
+                                  "bst-capture [<capture> | rate "
+                                  "<captures/s> <burst> | clear]\n");
+                    goto done;
+                }
+            }
+            bst_capture_dump(&ds, seq);
             goto done;
 
         } else if (!strcmp(ch, "copp-config")) {
@@ -1599,6 +1783,107 @@ copp_config_help:
             }
             goto done;
 
+        } else if (!strcmp(ch, "rx-dispatch")) {
+            ops_rx_dispatch_dump(&ds);
+            goto done;
+
+        } else if (!strcmp(ch, "rx-stats")) {
+            if (NULL != (ch = NEXT_ARG())) {
+                if (!strcmp(ch, "reset")) {
+                    ops_rx_stats_reset();
+                    ds_put_format(&ds, "RX statistics cleared\n");
+                } else {
+                    ds_put_format(&ds, "Unknown option %s\n", ch);
+                }
+            } else {
+                ops_rx_stats_dump(&ds);
+            }
+            goto done;
+
+        } else if (!strcmp(ch, "acl-log")) {
+            if (NULL != (ch = NEXT_ARG())) {
+                if (!strcmp(ch, "rate")) {
+                    const char *rate = NEXT_ARG();
+                    const char *burst = NEXT_ARG();
+
+                    if (!rate || !burst ||
+                        ops_cls_opennsl_acl_log_set_rate(atoi(rate),
+                                                         atoi(burst))
+                        != OPS_CLS_OK) {
+                        ds_put_format(&ds, "Invalid ACL logging rate\n");
+                        goto done;
+                    }
+                } else if (!strcmp(ch, "clear")) {
+                    ops_cls_opennsl_acl_log_stats_clear();
+                } else {
+                    ds_put_format(&ds, "Unknown option %s\n", ch);
+                    goto done;
+                }
+            }
+            ops_cls_opennsl_acl_log_dump(&ds);
+            goto done;
+
+        } else if (!strcmp(ch, "acl-compile")) {
+            ops_cls_opennsl_compile_dump(&ds);
+            goto done;
+
+        } else if (!strcmp(ch, "acl-pbmp-batch")) {
+            if (NULL != (ch = NEXT_ARG())) {
+                if (!strcmp(ch, "clear")) {
+                    ops_cls_opennsl_pbmp_batch_stats_clear();
+                } else if (ops_cls_opennsl_pbmp_batch_set(atoi(ch))
+                           != OPS_CLS_OK) {
+                    ds_put_format(&ds, "Invalid batching window %s\n", ch);
+                    goto done;
+                }
+            }
+            ops_cls_opennsl_pbmp_batch_dump(&ds);
+            goto done;
+
+        } else if (!strcmp(ch, "acl-stats")) {
+            if (NULL != (ch = NEXT_ARG())) {
+                if (!strcmp(ch, "interval")) {
+                    const char *msec = NEXT_ARG();
+
+                    if (!msec ||
+                        ops_cls_opennsl_stats_cache_set_interval(atoi(msec))
+                        != OPS_CLS_OK) {
+                        ds_put_format(&ds, "Invalid sweep interval\n");
+                        goto done;
+                    }
+                } else if (!strcmp(ch, "refresh")) {
+                    ops_cls_opennsl_stats_cache_refresh();
+                } else {
+                    ds_put_format(&ds, "Unknown option %s\n", ch);
+                    goto done;
+                }
+            }
+            ops_cls_opennsl_stats_cache_dump(&ds);
+            goto done;
+
+        } else if (!strcmp(ch, "acl-verify")) {
+            if (NULL != (ch = NEXT_ARG())) {
+                if (!strcmp(ch, "bench")) {
+                    const char *aces = NEXT_ARG();
+                    const char *packets = NEXT_ARG();
+
+                    if (!aces || !packets) {
+                        ds_put_format(&ds, "Usage: acl-verify bench "
+                                      "<aces> <packets>\n");
+                        goto done;
+                    }
+                    ops_cls_opennsl_eval_bench(&ds, atoi(aces),
+                                               atoi(packets));
+                    goto done;
+                } else if (ops_cls_opennsl_verify_set(atoi(ch))
+                           != OPS_CLS_OK) {
+                    ds_put_format(&ds, "Invalid number of packets %s\n", ch);
+                    goto done;
+                }
+            }
+            ops_cls_opennsl_verify_dump(&ds);
+            goto done;
+
         } else if (!strcmp(ch, "display_copp_stats")) {
             /*
              * TODO: This is currently a helper appctl used prior to
@@ -1629,7 +1914,25 @@ copp_config_help:
                 } else if (!strcmp(option, "scheduling")) {
                     ops_qos_dump_scheduling(&ds);
                 } else if (!strcmp(option, "statistics")) {
-                    ops_qos_dump_statistics(&ds);
+                    const char* param;
+
+                    option = NEXT_ARG();
+                    param = option ? NEXT_ARG() : NULL;
+                    if (!option) {
+                        ops_qos_dump_statistics(&ds);
+                    } else if (!strcmp(option, "interval") && param &&
+                               !ops_qos_cosq_stats_set_interval(
+                                                            atoi(param))) {
+                        ops_qos_dump_statistics(&ds);
+                    } else if (!strcmp(option, "bench") && param &&
+                               atoi(param) > 0) {
+                        ops_qos_cosq_stats_bench(&ds, atoi(param));
+                    } else {
+                        ds_put_format(&ds, "Usage: ovs-appctl plugin/debug "
+                                      "qos statistics [interval <msec> "
+                                      "(0 to %d) | bench <iterations>]\n\n",
+                                      OPS_QOS_COSQ_STATS_MAX_INTERVAL_MS);
+                    }
                 } else {
                     ds_put_format(&ds, "Unsupported qos command - %s.\n\n",
                                   option);
@@ -2058,9 +2361,7 @@ static void copp_diag_dump_cb(struct ds *ds)
     ds_put_format(ds, "\n\n");
 
     ds_put_format(ds, "Output for CoPP stats:\n");
-    if (ops_get_all_packet_stats() > 0) {
-        ds_put_format(ds, "%s", ops_copp_all_packet_stat_buffer);
-    }
+    ops_copp_stats_dump(ds);
 
     ds_put_format(ds, "\n\n");
 }
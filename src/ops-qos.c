@@ -29,6 +29,7 @@
 #include <stdio.h>
 #include <errno.h>
 #include <assert.h>
+#include <inttypes.h>
 #include <util.h>
 
 #include <netdev.h>
@@ -43,6 +44,8 @@
 
 #include "ops-qos.h"
 #include "qos-asic-provider.h"
+#include "hash.h"
+#include "timeval.h"
 
 /*
  * QoS global config structure
@@ -852,7 +855,7 @@ ops_qos_scheduler_init(int hw_unit)
         return OPS_QOS_FAILURE_CODE;
     }
 
-    for (priority = 0; priority < (OPENNSL_COS_COUNT * 2); priority++) {
+    for (priority = 0; priority < OPS_QOS_INT_PRIORITY_COUNT; priority++) {
         cosq = (priority < OPENNSL_COS_COUNT) ?
                 priority : (OPENNSL_COS_COUNT - 1);
 
@@ -864,6 +867,10 @@ ops_qos_scheduler_init(int hw_unit)
                       rc, hw_unit, cosq, opennsl_errmsg(rc));
             return OPS_QOS_FAILURE_CODE;
         }
+
+        /* Update the software copy now */
+        ops_qos_config.cosq_map[hw_unit][priority] = cosq;
+        ops_qos_config.cosq_map_programmed[hw_unit][priority] = true;
     }
 
     /* Configure schedule for HG ports */
@@ -1008,6 +1015,7 @@ ops_qos_set_cos_map(const struct cos_map_settings *settings)
 {
     int   index, hw_unit;
     struct cos_map_entry *entry;
+    ops_cos_map_entry_t *shadow;
     int cos;
 
     int qos_flags;
@@ -1041,6 +1049,9 @@ ops_qos_set_cos_map(const struct cos_map_settings *settings)
 
             ops_qos_config.cos_map_id_default[hw_unit] = cos_map_id;
 
+            /* The new map has to be filled from COS 0 map entry */
+            ops_qos_config.cos_map[0].programmed = false;
+
             /* Log the debug message with INFO level as it is one time event */
             VLOG_INFO("qos default cos map id %d created successfully "
                       "for hw unit %d",
@@ -1060,6 +1071,11 @@ ops_qos_set_cos_map(const struct cos_map_settings *settings)
 
             ops_qos_config.cos_map_id[hw_unit] = cos_map_id;
 
+            /* The new map has to be filled with all the entries */
+            for (cos = 0; cos < OPS_QOS_COS_COUNT; cos++) {
+                ops_qos_config.cos_map[cos].programmed = false;
+            }
+
             /* Log the debug message with INFO level as it is one time event */
             VLOG_INFO("qos cos map id %d created successfully for "
                       "hw unit %d",
@@ -1079,6 +1095,18 @@ ops_qos_set_cos_map(const struct cos_map_settings *settings)
                   index, entry->color,
                   entry->codepoint, entry->local_priority);
 
+        /*
+         * The whole map is pushed on every config change. Skip the
+         * entries already programmed with the same config.
+         */
+        shadow = &ops_qos_config.cos_map[entry->codepoint];
+        if (shadow->programmed &&
+            shadow->int_priority == entry->local_priority &&
+            shadow->color == entry->color) {
+            ops_qos_config.cos_map_writes_skipped++;
+            continue;
+        }
+
         cos_map.pkt_pri = entry->codepoint;
         cos_map.int_pri = entry->local_priority;
         cos_map.color = ops_qos_get_opennsl_color(entry->color);
@@ -1097,10 +1125,14 @@ ops_qos_set_cos_map(const struct cos_map_settings *settings)
             }
         } /* for (hw_unit = 0; ...) */
 
-        /* Update the software copy now */
-        ops_qos_config.cos_map[entry->codepoint].int_priority =
-                                           entry->local_priority;
-        ops_qos_config.cos_map[entry->codepoint].color = entry->color;
+        /*
+         * Update the software copy now. COS 0 map entry is flagged as
+         * programmed only once the default map is updated as well.
+         */
+        shadow->int_priority = entry->local_priority;
+        shadow->color = entry->color;
+        shadow->programmed = (entry->codepoint != 0);
+        ops_qos_config.cos_map_writes++;
 
         /* Log the debug message */
         VLOG_DBG("qos cos map %d: cos cp %d, local pri %d color %d "
@@ -1139,6 +1171,8 @@ ops_qos_set_cos_map(const struct cos_map_settings *settings)
 
             } /* for (cos = 0; ... ) */
 
+            shadow->programmed = true;
+
             /* Log the debug message */
             VLOG_DBG("qos default cos map %d: cos cp %d, local pri %d "
                      "color %d set successfully on hw unit %d",
@@ -1164,6 +1198,8 @@ ops_qos_set_dscp_map(const struct dscp_map_settings *settings)
 {
     int   index, hw_unit;
     struct dscp_map_entry *entry;
+    ops_dscp_map_entry_t *shadow;
+    int dscp;
 
     int qos_flags;
     opennsl_qos_map_t dscp_map;
@@ -1196,6 +1232,11 @@ ops_qos_set_dscp_map(const struct dscp_map_settings *settings)
 
             ops_qos_config.dscp_map_id[hw_unit] = dscp_map_id;
 
+            /* The new map has to be filled with all the entries */
+            for (dscp = 0; dscp < OPS_QOS_DSCP_COUNT; dscp++) {
+                ops_qos_config.dscp_map[dscp].programmed = false;
+            }
+
             /* Log the debug message with INFO level as it is one time event */
             VLOG_INFO("qos dscp map id %d created successfully for "
                       "hw unit %d",
@@ -1216,6 +1257,20 @@ ops_qos_set_dscp_map(const struct dscp_map_settings *settings)
                   entry->codepoint, entry->local_priority,
                   entry->cos);
 
+        /*
+         * The whole map is pushed on every config change. Skip the
+         * entries already programmed with the same config. COS remark
+         * is not programmed in the map, only its software copy is kept.
+         */
+        shadow = &ops_qos_config.dscp_map[entry->codepoint];
+        shadow->cos_remark = entry->cos;
+        if (shadow->programmed &&
+            shadow->int_priority == entry->local_priority &&
+            shadow->color == entry->color) {
+            ops_qos_config.dscp_map_writes_skipped++;
+            continue;
+        }
+
         dscp_map.dscp = entry->codepoint;
         dscp_map.int_pri = entry->local_priority;
         dscp_map.color = ops_qos_get_opennsl_color(entry->color);
@@ -1236,10 +1291,10 @@ ops_qos_set_dscp_map(const struct dscp_map_settings *settings)
         } /* for (hw_unit = 0; ...) */
 
         /* Update the software copy now */
-        ops_qos_config.dscp_map[entry->codepoint].int_priority =
-                                           entry->local_priority;
-        ops_qos_config.dscp_map[entry->codepoint].color = entry->color;
-        ops_qos_config.dscp_map[entry->codepoint].cos_remark = entry->cos;
+        shadow->int_priority = entry->local_priority;
+        shadow->color = entry->color;
+        shadow->programmed = true;
+        ops_qos_config.dscp_map_writes++;
 
         /* Log the debug message */
         VLOG_DBG("qos dscp map %d: dscp cp %d, local pri %d color %d "
@@ -1664,23 +1719,225 @@ ops_qos_set_port_cfg(struct ofbundle *bundle,
 
 }
 
+/*
+ * Queue statistics collector.
+ *
+ * switchd dumps the queue statistics of every port separately on each
+ * stats poll. Instead of reading the MMU counters of a port on each of
+ * these calls, the counters of all the polled ports of a hardware unit are
+ * read in one sweep into a per-unit snapshot table. The table is refreshed
+ * at most once per 'ops_qos_cosq_stats_interval_ms', so a poll round of
+ * switchd costs a single sweep, and the dumps only copy values out of the
+ * table. A port joins the sweeps on its first dump, which reads it
+ * directly, and leaves them when it is deleted or has not been dumped for
+ * OPS_QOS_COSQ_STATS_AGE_MS.
+ *
+ * OpenNSL has no multi-get API for the cosq statistics, so a sweep still
+ * reads each counter with opennsl_cosq_stat_get().
+ */
+typedef struct ops_qos_cosq_port_snapshot_s {
+
+    /* Queue statistics read in the last sweep */
+    struct netdev_queue_stats qstats[OPENNSL_COS_COUNT];
+
+    /* Result of the last read of the port */
+    opennsl_error_t rc;
+
+    /* Flag to identify if the port is dumped, and so swept */
+    bool polled;
+
+    /* time_msec() of the last dump of the port */
+    long long int last_polled;
+
+} ops_qos_cosq_port_snapshot_t;
+
+typedef struct ops_qos_cosq_stats_snapshot_s {
+
+    ops_qos_cosq_port_snapshot_t ports[MAX_HW_PORTS];
+
+    /* time_msec() of the last sweep */
+    long long int taken;
+
+    /* Flag set by a sweep, false until the first one */
+    bool valid;
+
+    /* Number of polled ports */
+    int polled_ports;
+
+    /* Ports removed from the sweeps for not being dumped anymore */
+    uint64_t aged_ports;
+
+    /* Sweep counters and durations */
+    uint64_t sweeps;
+    uint64_t read_failures;
+    long long int last_sweep_usec;
+    long long int max_sweep_usec;
+
+} ops_qos_cosq_stats_snapshot_t;
+
+static ops_qos_cosq_stats_snapshot_t
+                    ops_qos_cosq_stats_table[MAX_SWITCH_UNITS];
+
+static long long int ops_qos_cosq_stats_interval_ms =
+                                    OPS_QOS_COSQ_STATS_DFLT_INTERVAL_MS;
+
+/*
+ * MMU statistics read for each queue, in the order they are stored in
+ * struct netdev_queue_stats by ops_qos_cosq_stats_read_port().
+ */
+static const opennsl_cosq_stat_t ops_qos_cosq_snapshot_stats[] = {
+    opennslCosqStatOutPackets,
+    opennslCosqStatOutBytes,
+    opennslCosqStatDroppedPackets
+};
+
+/*
+ * ops_qos_cosq_stats_read_port
+ *
+ * This function reads the MMU statistics of all the queues of the given
+ * port from Broadcom ASIC.
+ */
+static opennsl_error_t
+ops_qos_cosq_stats_read_port(int hw_unit, int hw_port,
+                             struct netdev_queue_stats *qstats)
+{
+    uint64 values[ARRAY_SIZE(ops_qos_cosq_snapshot_stats)];
+    opennsl_cos_queue_t cosq;
+    opennsl_error_t rc = OPENNSL_E_NONE;
+    int index;
+
+    for (cosq = 0; cosq < OPENNSL_COS_COUNT; cosq++) {
+        for (index = 0; index < ARRAY_SIZE(ops_qos_cosq_snapshot_stats);
+             index++) {
+            rc = opennsl_cosq_stat_get(hw_unit, hw_port, cosq,
+                                       ops_qos_cosq_snapshot_stats[index],
+                                       &values[index]);
+
+            if (OPENNSL_FAILURE(rc)) {
+                /*
+                 * Stats error messages should be logged as DBG
+                 * to avoid flooding of ERR logs.
+                 */
+                VLOG_DBG("qos cosq stats: failed to get stat %d of cosq %d "
+                         "for hw unit %d, port %d, rc = %d, %s",
+                          ops_qos_cosq_snapshot_stats[index], cosq,
+                          hw_unit, hw_port, rc, opennsl_errmsg(rc));
+                return rc;
+            }
+        }
+
+        qstats[cosq].tx_packets = values[0];
+        qstats[cosq].tx_bytes = values[1];
+        qstats[cosq].tx_errors = values[2];
+    }
+
+    return rc;
+}
+
+/*
+ * ops_qos_cosq_stats_sweep
+ *
+ * This function reads the queue statistics of all the polled ports of
+ * a hardware unit into its snapshot.
+ */
+static void
+ops_qos_cosq_stats_sweep(int hw_unit)
+{
+    ops_qos_cosq_stats_snapshot_t *snapshot;
+    ops_qos_cosq_port_snapshot_t *port;
+    long long int start = time_usec();
+    long long int now = time_msec();
+    int hw_port;
+
+    snapshot = &ops_qos_cosq_stats_table[hw_unit];
+
+    for (hw_port = 0; hw_port < MAX_HW_PORTS; hw_port++) {
+        port = &snapshot->ports[hw_port];
+        if (!port->polled) {
+            continue;
+        }
+
+        if (now - port->last_polled >= OPS_QOS_COSQ_STATS_AGE_MS) {
+            port->polled = false;
+            snapshot->polled_ports--;
+            snapshot->aged_ports++;
+            continue;
+        }
+
+        port->rc = ops_qos_cosq_stats_read_port(hw_unit, hw_port,
+                                                port->qstats);
+        if (OPENNSL_FAILURE(port->rc)) {
+            snapshot->read_failures++;
+        }
+    }
+
+    snapshot->taken = now;
+    snapshot->valid = true;
+    snapshot->sweeps++;
+    snapshot->last_sweep_usec = time_usec() - start;
+    snapshot->max_sweep_usec = MAX(snapshot->max_sweep_usec,
+                                   snapshot->last_sweep_usec);
+}
+
+/*
+ * ops_qos_cosq_stats_set_interval
+ *
+ * This function sets the refresh interval of the queue statistics
+ * snapshot. An interval of 0 sweeps the hardware on every dump.
+ */
+int
+ops_qos_cosq_stats_set_interval(int interval_ms)
+{
+    if ((interval_ms < 0) ||
+        (interval_ms > OPS_QOS_COSQ_STATS_MAX_INTERVAL_MS)) {
+        return OPS_QOS_FAILURE_CODE;
+    }
+
+    ops_qos_cosq_stats_interval_ms = interval_ms;
+
+    return OPS_QOS_SUCCESS_CODE;
+}
+
+/*
+ * ops_qos_cosq_stats_port_remove
+ *
+ * This function removes a deleted port from the queue statistics sweeps.
+ */
+void
+ops_qos_cosq_stats_port_remove(int hw_unit, int hw_port)
+{
+    ops_qos_cosq_stats_snapshot_t *snapshot;
+    ops_qos_cosq_port_snapshot_t *port;
+
+    if (!VALID_HW_UNIT(hw_unit) ||
+        !VALID_HW_UNIT_PORT(hw_unit, hw_port)) {
+        return;
+    }
+
+    snapshot = &ops_qos_cosq_stats_table[hw_unit];
+    port = &snapshot->ports[hw_port];
+    if (port->polled) {
+        port->polled = false;
+        snapshot->polled_ports--;
+    }
+}
+
 /*
  * ops_qos_get_cosq_stats
  *
  * This function retrieves the queue statistics of the given
- * port from Broadcom ASIC.
+ * port from the queue statistics snapshot of its hardware unit.
  */
 int
 ops_qos_get_cosq_stats(int hw_unit, int hw_port,
                        netdev_dump_queue_stats_cb* cb,
                        void *aux)
 {
-    struct netdev_queue_stats qstats[OPENNSL_COS_COUNT];
-    opennsl_gport_t gport;
+    ops_qos_cosq_stats_snapshot_t *snapshot;
+    ops_qos_cosq_port_snapshot_t *port;
+    struct netdev_queue_stats qstats;
     opennsl_cos_queue_t cosq;
-    opennsl_cosq_stat_t stat;
-    opennsl_error_t rc = OPENNSL_E_NONE;
-    uint64 value;
+    bool stale;
 
     if (!VALID_HW_UNIT(hw_unit) ||
         !VALID_HW_UNIT_PORT(hw_unit, hw_port)) {
@@ -1694,108 +1951,120 @@ ops_qos_get_cosq_stats(int hw_unit, int hw_port,
         return OPS_QOS_FAILURE_CODE;
     }
 
-    /* Get the gport for the physical port */
-    rc = opennsl_port_gport_get(hw_unit, hw_port, &gport);
-    if (OPENNSL_FAILURE(rc)) {
+    if (!cb) {
         /*
          * Stats error messages should be logged as DBG
          * to avoid flooding of ERR logs.
          */
-        VLOG_DBG("qos cosq stats: failed to get gport for "
-                 "hw unit %d, port %d, rc = %d, %s",
-                  hw_unit, hw_port, rc, opennsl_errmsg(rc));
-        return rc;
+        VLOG_DBG("qos cosq stats: NULL PI callback function for "
+                 "hw unit %d, port %d",
+                  hw_unit, hw_port);
+        return OPS_QOS_FAILURE_CODE;
     }
 
+    snapshot = &ops_qos_cosq_stats_table[hw_unit];
+    port = &snapshot->ports[hw_port];
+    port->last_polled = time_msec();
+    stale = !snapshot->valid ||
+            (port->last_polled - snapshot->taken >=
+                                        ops_qos_cosq_stats_interval_ms);
+
     /*
-     * For each cosq, retrieve the MMU statistics for Txpackets,
-     * TxBytes & TxDrops and call the PI callback function.
+     * A port dumped for the first time is added to the sweeps. Read it
+     * right away if the snapshot is fresh, so that it does not wait for
+     * the next sweep.
      */
-    for (cosq = 0; cosq < OPENNSL_COS_COUNT; cosq++) {
-        /*
-         * OPS_TODO:
-         *     If more stats need to be retrieved in future, use an
-         *     array with needed stats enums and traverse the array
-         *     enums and retrieve each stats.
-         *     Also, check with Broadcom if *_multi_get API is
-         *     available for cosq stats or will be supported in
-         *     future.
-         */
-        stat = opennslCosqStatOutPackets;
-        rc = opennsl_cosq_stat_get(hw_unit, hw_port,
-                                   cosq, stat, &value);
+    if (!port->polled) {
+        port->polled = true;
+        snapshot->polled_ports++;
 
-        if (OPENNSL_FAILURE(rc)) {
-            /*
-             * Stats error messages should be logged as DBG
-             * to avoid flooding of ERR logs.
-             */
-            VLOG_DBG("qos cosq stats: failed to get TxPackets for "
-                     "hw unit %d, port %d gport %x, rc = %d, %s",
-                      hw_unit, hw_port, gport,
-                      rc, opennsl_errmsg(rc));
-            return rc;
+        if (!stale) {
+            port->rc = ops_qos_cosq_stats_read_port(hw_unit, hw_port,
+                                                    port->qstats);
         }
+    }
 
-        qstats[cosq].tx_packets = value;
+    if (stale) {
+        ops_qos_cosq_stats_sweep(hw_unit);
+    }
 
-        stat = opennslCosqStatOutBytes;
-        rc = opennsl_cosq_stat_get(hw_unit, hw_port,
-                                   cosq, stat, &value);
+    if (OPENNSL_FAILURE(port->rc)) {
+        return port->rc;
+    }
 
-        if (OPENNSL_FAILURE(rc)) {
-            /*
-             * Stats error messages should be logged as DBG
-             * to avoid flooding of ERR logs.
-             */
-            VLOG_DBG("qos cosq stats: failed to get TxBytes for "
-                     "hw unit %d, port %d gport %x, rc = %d, %s",
-                      hw_unit, hw_port, gport,
-                      rc, opennsl_errmsg(rc));
-            return rc;
-        }
+    /*
+     * Invoke the PI layer callback function on a copy of the snapshot.
+     * No need for error checking here.
+     */
+    for (cosq = 0; cosq < OPENNSL_COS_COUNT; cosq++) {
+        qstats = port->qstats[cosq];
+        (*cb)(cosq, &qstats, aux);
+    }
 
-        qstats[cosq].tx_bytes = value;
+    return OPENNSL_E_NONE;
+}
 
-        stat = opennslCosqStatDroppedPackets;
-        rc = opennsl_cosq_stat_get(hw_unit, hw_port,
-                                   cosq, stat, &value);
+/*
+ * ops_qos_cosq_stats_bench
+ *
+ * This function measures the time of a queue statistics sweep against
+ * the number of swept ports, over the front panel ports of hardware
+ * unit 0. The snapshot is left untouched.
+ */
+void
+ops_qos_cosq_stats_bench(struct ds *ds, int iterations)
+{
+    struct netdev_queue_stats qstats[OPENNSL_COS_COUNT];
+    int ports[MAX_HW_PORTS];
+    opennsl_gport_t gport;
+    long long int start, elapsed;
+    int n_ports = 0, n_swept, hw_port, index, iteration;
+    int unit = 0;
+    int failures = 0;
 
-        if (OPENNSL_FAILURE(rc)) {
-            /*
-             * Stats error messages should be logged as DBG
-             * to avoid flooding of ERR logs.
-             */
-            VLOG_DBG("qos cosq stats: failed to get DroppedPackets for "
-                     "hw unit %d, port %d gport %x, rc = %d, %s",
-                      hw_unit, hw_port, gport,
-                      rc, opennsl_errmsg(rc));
-            return rc;
+    for (hw_port = 0; hw_port < MAX_HW_PORTS; hw_port++) {
+        if (hw_port == CPU_PORT(unit)) {
+            continue;
         }
+        if (!OPENNSL_FAILURE(opennsl_port_gport_get(unit, hw_port, &gport))) {
+            ports[n_ports++] = hw_port;
+        }
+    }
 
-        qstats[cosq].tx_errors = value;
+    ds_put_format(ds, "QoS COSq statistics sweep benchmark, %d iterations\n",
+                  iterations);
+    ds_put_format(ds, "%8s %12s %12s %12s %10s\n", "Ports", "SDK calls",
+                  "usec/sweep", "usec/port", "Failures");
+
+    n_swept = 1;
+    while (n_ports) {
+        n_swept = MIN(n_swept, n_ports);
+        failures = 0;
+
+        start = time_usec();
+        for (iteration = 0; iteration < iterations; iteration++) {
+            for (index = 0; index < n_swept; index++) {
+                if (OPENNSL_FAILURE(ops_qos_cosq_stats_read_port(unit,
+                                                ports[index], qstats))) {
+                    failures++;
+                }
+            }
+        }
+        elapsed = time_usec() - start;
 
-        /*
-         * Invoke the PI layer callback function.
-         * No need for error checking here.
-         */
-        if (cb) {
-            (*cb)(cosq, &qstats[cosq], aux);
-        } else {
-            /*
-             * Stats error messages should be logged as DBG
-             * to avoid flooding of ERR logs.
-             */
-            VLOG_DBG("qos cosq stats: NULL PI callback function for "
-                     "hw unit %d, port %d",
-                      hw_unit, hw_port);
+        ds_put_format(ds, "%8d %12d %12lld %12lld %10d\n", n_swept,
+                      n_swept * OPENNSL_COS_COUNT *
+                      (int) ARRAY_SIZE(ops_qos_cosq_snapshot_stats),
+                      elapsed / iterations,
+                      elapsed / iterations / n_swept, failures);
 
-            return OPS_QOS_FAILURE_CODE;
+        if (n_swept == n_ports) {
+            break;
         }
-
+        n_swept *= 2;
     }
 
-    return rc;
+    ds_put_format(ds, "\n");
 }
 
 /*
@@ -1815,6 +2084,7 @@ ops_qos_apply_queue_profile(
     struct local_priority_entry *lp_entry;
     opennsl_cos_queue_t cosq;
     int int_priority;
+    bool shadow_valid;
     opennsl_error_t rc = OPENNSL_E_NONE;
 
     for (cosq_index = 0; cosq_index < q_settings->n_entries; cosq_index++) {
@@ -1835,15 +2105,41 @@ ops_qos_apply_queue_profile(
             for (hw_unit = 0; hw_unit <= MAX_SWITCH_UNIT_ID;
                 hw_unit++) {
 
+                /*
+                 * The whole queue profile is pushed on every config
+                 * change. Skip the mappings already programmed.
+                 */
+                shadow_valid = (int_priority >= 0) &&
+                               (int_priority < OPS_QOS_INT_PRIORITY_COUNT);
+                if (shadow_valid &&
+                    ops_qos_config.cosq_map_programmed[hw_unit][int_priority]
+                    && ops_qos_config.cosq_map[hw_unit][int_priority] ==
+                                                                    cosq) {
+                    ops_qos_config.cosq_map_writes_skipped++;
+                    continue;
+                }
+
                 rc = opennsl_cosq_mapping_set(hw_unit, int_priority, cosq);
                 if (OPENNSL_FAILURE(rc)) {
                     VLOG_ERR("ops_qos_apply_queue_profile failed - cosq %d, "
                              "int pri %d, hw_unit %d, rc = %d - %s",
                               cosq, int_priority,
                               hw_unit, rc, opennsl_errmsg(rc));
+                    if (shadow_valid) {
+                        ops_qos_config.cosq_map_programmed[hw_unit][
+                                                    int_priority] = false;
+                    }
                     return rc;
                 }
 
+                /* Update the software copy now */
+                if (shadow_valid) {
+                    ops_qos_config.cosq_map[hw_unit][int_priority] = cosq;
+                    ops_qos_config.cosq_map_programmed[hw_unit][
+                                                    int_priority] = true;
+                }
+                ops_qos_config.cosq_map_writes++;
+
             } /* for (hw_unit = 0 ... */
 
         } /* for (priority_index = 0; ... */
@@ -1882,6 +2178,90 @@ ops_qos_get_opennsl_sched_mode(int algorithm)
     return sched_mode;
 }
 
+/*
+ * Schedule profile cache.
+ *
+ * switchd applies the schedule profile of every port separately, on each
+ * config change and for every port sharing the same profile. The profiles
+ * programmed on the ports are cached by content, and each port points to
+ * the cache entry of the profile it is programmed with. Applying a profile
+ * to a port that is already programmed with the same content is skipped
+ * without any SDK call. An entry is freed when no port uses it anymore.
+ */
+static struct hmap ops_qos_sched_profiles =
+                            HMAP_INITIALIZER(&ops_qos_sched_profiles);
+
+/*
+ * ops_qos_sched_profile_hash
+ *
+ * This function returns the hash of the content of a schedule profile.
+ */
+static uint32_t
+ops_qos_sched_profile_hash(const ops_qos_sched_profile_t *profile)
+{
+    uint32_t hash;
+
+    hash = hash_int(profile->n_entries, 0);
+    hash = hash_bytes(profile->sched_mode, sizeof(profile->sched_mode), hash);
+    return hash_bytes(profile->weight, sizeof(profile->weight), hash);
+}
+
+/*
+ * ops_qos_sched_profile_equal
+ *
+ * This function returns true if the two schedule profiles have the same
+ * content.
+ */
+static bool
+ops_qos_sched_profile_equal(const ops_qos_sched_profile_t *a,
+                            const ops_qos_sched_profile_t *b)
+{
+    return (a->n_entries == b->n_entries &&
+            !memcmp(a->sched_mode, b->sched_mode, sizeof(a->sched_mode)) &&
+            !memcmp(a->weight, b->weight, sizeof(a->weight)));
+}
+
+/*
+ * ops_qos_sched_profile_ref
+ *
+ * This function returns the cache entry of the given schedule profile,
+ * adding it to the cache if needed, with a reference for one more port.
+ */
+static ops_qos_sched_profile_t *
+ops_qos_sched_profile_ref(const ops_qos_sched_profile_t *key)
+{
+    ops_qos_sched_profile_t *profile;
+    uint32_t hash = ops_qos_sched_profile_hash(key);
+
+    HMAP_FOR_EACH_WITH_HASH (profile, node, hash, &ops_qos_sched_profiles) {
+        if (ops_qos_sched_profile_equal(profile, key)) {
+            profile->n_ports++;
+            return profile;
+        }
+    }
+
+    profile = xmemdup(key, sizeof(*profile));
+    profile->n_ports = 1;
+    hmap_insert(&ops_qos_sched_profiles, &profile->node, hash);
+
+    return profile;
+}
+
+/*
+ * ops_qos_sched_profile_unref
+ *
+ * This function releases the reference of one port to a schedule profile
+ * cache entry, freeing the entry once no port uses it.
+ */
+static void
+ops_qos_sched_profile_unref(ops_qos_sched_profile_t *profile)
+{
+    if (profile && --profile->n_ports == 0) {
+        hmap_remove(&ops_qos_sched_profiles, &profile->node);
+        free(profile);
+    }
+}
+
 /*
  * ops_qos_apply_schedule_profile
  *
@@ -1897,6 +2277,7 @@ ops_qos_apply_schedule_profile(struct ofbundle *bundle,
     int cosq_index;
     struct schedule_profile_entry *sp_entry;
     ops_qos_sched_nodes_t *port_sched_node;
+    ops_qos_sched_profile_t key;
     opennsl_cos_queue_t cosq;
     int weight;
     int sched_mode;
@@ -1924,12 +2305,48 @@ ops_qos_apply_schedule_profile(struct ofbundle *bundle,
         return OPS_QOS_FAILURE_CODE;
     }
 
+    if (s_settings->n_entries > OPENNSL_COS_COUNT) {
+        VLOG_ERR("ops_qos_apply_schedule_profile: %d entries in schedule "
+                 "profile for hw unit %d, hw port %d, max is %d",
+                  s_settings->n_entries, hw_unit, hw_port,
+                  OPENNSL_COS_COUNT);
+
+        return OPS_QOS_FAILURE_CODE;
+    }
+
+    /* Build the cache key of the profile */
+    memset(&key, 0, sizeof(key));
+    key.n_entries = s_settings->n_entries;
     for (cosq_index = 0; cosq_index < s_settings->n_entries; cosq_index++) {
         sp_entry = s_settings->entries[cosq_index];
 
+        key.sched_mode[cosq_index] =
+                        ops_qos_get_opennsl_sched_mode(sp_entry->algorithm);
+        key.weight[cosq_index] = sp_entry->weight;
+    }
+
+    /* Skip the port if it is already programmed with the same profile */
+    if (port_sched_node->sched_profile &&
+        ops_qos_sched_profile_equal(port_sched_node->sched_profile, &key)) {
+        VLOG_DBG("ops_qos_apply_schedule_profile: profile already "
+                 "programmed for hw unit %d, hw port %d",
+                  hw_unit, hw_port);
+
+        ops_qos_config.sched_profile_applies_skipped++;
+        return OPS_QOS_SUCCESS_CODE;
+    }
+
+    /*
+     * Until all the COSqs are programmed, the port is not known to be
+     * programmed with any profile.
+     */
+    ops_qos_sched_profile_unref(port_sched_node->sched_profile);
+    port_sched_node->sched_profile = NULL;
+
+    for (cosq_index = 0; cosq_index < s_settings->n_entries; cosq_index++) {
         cosq = cosq_index;
-        weight = sp_entry->weight;
-        sched_mode = ops_qos_get_opennsl_sched_mode(sp_entry->algorithm);
+        weight = key.weight[cosq_index];
+        sched_mode = key.sched_mode[cosq_index];
 
         VLOG_DBG("ops_qos_apply_schedule_profile: mode %d weight %d cosq %d "
                  "for hw unit %d, hw port %d",
@@ -1955,6 +2372,9 @@ ops_qos_apply_schedule_profile(struct ofbundle *bundle,
 
     } /* for (cosq_index = 0; ... */
 
+    port_sched_node->sched_profile = ops_qos_sched_profile_ref(&key);
+    ops_qos_config.sched_profile_applies++;
+
     return rc;
 
 }
@@ -2048,6 +2468,11 @@ ops_qos_dump_cos_map(struct ds *ds)
         return;
     }
 
+    ds_put_format(ds, "COS map entry writes: %"PRIu64", skipped unchanged: "
+                      "%"PRIu64"\n",
+                  ops_qos_config.cos_map_writes,
+                  ops_qos_config.cos_map_writes_skipped);
+
     ds_put_format(ds, "SUCCESS in retrieving QoS COS map config\n\n");
 
     return;
@@ -2088,6 +2513,11 @@ ops_qos_dump_dscp_map(struct ds *ds)
         return;
     }
 
+    ds_put_format(ds, "DSCP map entry writes: %"PRIu64", skipped unchanged: "
+                      "%"PRIu64"\n",
+                  ops_qos_config.dscp_map_writes,
+                  ops_qos_config.dscp_map_writes_skipped);
+
     ds_put_format(ds, "SUCCESS in retrieving QoS DSCP map config\n\n");
 
     return;
@@ -2195,6 +2625,11 @@ ops_qos_dump_queuing(struct ds *ds)
 
     ds_put_format(ds, "\n");
 
+    ds_put_format(ds, "COSq mapping writes: %"PRIu64", skipped unchanged: "
+                      "%"PRIu64"\n",
+                  ops_qos_config.cosq_map_writes,
+                  ops_qos_config.cosq_map_writes_skipped);
+
     ds_put_format(ds, "SUCCESS in retrieving QoS COSq mapping\n\n");
 
     return;
@@ -2216,6 +2651,7 @@ ops_qos_dump_scheduling(struct ds *ds)
     int unit = 0;
     int port = 1;
     ops_qos_sched_nodes_t *port_sched_node;
+    ops_qos_sched_profile_t *profile;
     opennsl_error_t rc;
 
     ds_put_format(ds, "QoS COSq scheduling config\n");
@@ -2278,6 +2714,22 @@ ops_qos_dump_scheduling(struct ds *ds)
 
     ds_put_format(ds, "\n");
 
+    ds_put_format(ds, "Cached schedule profiles: %d\n",
+                  (int) hmap_count(&ops_qos_sched_profiles));
+    HMAP_FOR_EACH (profile, node, &ops_qos_sched_profiles) {
+        ds_put_format(ds, "  %d ports, mode/weight per COSq:",
+                      profile->n_ports);
+        for (cosq = 0; cosq < profile->n_entries; cosq++) {
+            ds_put_format(ds, " 0x%x/%d", profile->sched_mode[cosq],
+                          profile->weight[cosq]);
+        }
+        ds_put_format(ds, "\n");
+    }
+    ds_put_format(ds, "Port schedule profile applies: %"PRIu64", skipped "
+                      "unchanged: %"PRIu64"\n",
+                  ops_qos_config.sched_profile_applies,
+                  ops_qos_config.sched_profile_applies_skipped);
+
     ds_put_format(ds, "SUCCESS in retrieving QoS COSq mapping\n\n");
 
     return;
@@ -2292,6 +2744,9 @@ ops_qos_dump_scheduling(struct ds *ds)
 void
 ops_qos_dump_statistics(struct ds *ds)
 {
+    ops_qos_cosq_stats_snapshot_t *snapshot;
+    int unit;
+
     /*
      * OPS_TODO:
      *    Currently there is no component test (CT) infra to send packets for
@@ -2302,6 +2757,21 @@ ops_qos_dump_statistics(struct ds *ds)
     ds_put_format(ds, "-------------------\n");
     ds_put_format(ds, "SUCCESS (not implemented currently)\n\n");
 
+    ds_put_format(ds, "QoS COSq statistics collector\n");
+    ds_put_format(ds, "-----------------------------\n");
+    ds_put_format(ds, "Refresh interval: %lld msec\n",
+                  ops_qos_cosq_stats_interval_ms);
+    for (unit = 0; unit <= MAX_SWITCH_UNIT_ID; unit++) {
+        snapshot = &ops_qos_cosq_stats_table[unit];
+        ds_put_format(ds, "hw unit %d: polled ports %d, aged ports %"PRIu64
+                          ", sweeps %"PRIu64", read failures %"PRIu64
+                          ", last sweep %lld usec, max sweep %lld usec\n",
+                      unit, snapshot->polled_ports, snapshot->aged_ports,
+                      snapshot->sweeps, snapshot->read_failures,
+                      snapshot->last_sweep_usec, snapshot->max_sweep_usec);
+    }
+    ds_put_format(ds, "\n");
+
     return;
 
 }
@@ -19,32 +19,45 @@
  * Purpose: sflow configuration implementation in BCM shell and show output.
  */
 
+/* Needed for sendmmsg(). */
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <errno.h>
 #include <string.h>
+#include <inttypes.h>
+#include <limits.h>
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <netdb.h>
+#include <netinet/ip.h>
 #include <platform-defines.h>
 #include <diag_dump.h>
+#include <opennsl/cosq.h>
 
-#include "ofproto/collectors.h"
 #include "ops-stats.h"
 #include "ops-sflow.h"
 #include "ops-routing.h"
 #include "netdev-bcmsdk.h"
+#include "ops-copp.h"
 #include "eventlog.h"
+#include "timeval.h"
+#include "poll-loop.h"
+#include "seq.h"
 
 VLOG_DEFINE_THIS_MODULE(ops_sflow);
 
 #define DIAGNOSTIC_BUFFER_LEN   16000
 #define VLAN_HEADER_SIZE        4
 
+/* Largest sampled header the agent copies out of a sampled packet. */
+#define SFLOW_MAX_HEADER_SIZE   256
+
 #define LAG_PORT_NAME_PREFIX            "lag"
 #define LAG_PORT_NAME_PREFIX_LENGTH     3
 #define LAG_AGGREGATE_ID_LENGTH         5
@@ -56,7 +69,6 @@ VLOG_DEFINE_THIS_MODULE(ops_sflow);
 /* sFlow parameters - TODO make these per ofproto */
 SFLAgent *ops_sflow_agent = NULL;
 struct ofproto_sflow_options *sflow_options = NULL;
-struct collectors *sflow_collectors = NULL;
 
 /* sFlow knet filter id's */
 int knet_sflow_source_filter_id;
@@ -64,6 +76,130 @@ int knet_sflow_dest_filter_id;
 
 static struct ovs_mutex mutex;
 
+/* Transmit stage. Datagrams completed by the sFlow library are queued by
+ * ops_sflow_agent_pkt_tx_cb() and sent to all the collectors in batches
+ * by ops_sflow_tx_flush(), without holding the sFlow 'mutex' across the
+ * send syscalls. Producers fill the active batch under 'tx_mutex'; the
+ * flusher swaps batches and sends the retired one without any lock.
+ * 'tx_seq' changes when the active batch becomes non-empty, to wake up
+ * the main loop so that samples are sent without delay. */
+#define SFLOW_MAX_COLLECTORS        8
+#define SFLOW_TX_QUEUE_LEN          16
+#define SFLOW_MAX_DATAGRAM_SIZE     9000
+
+struct ops_sflow_tx_dgram {
+    uint32_t len;
+    uint8_t data[SFLOW_MAX_DATAGRAM_SIZE];
+};
+
+struct ops_sflow_tx_batch {
+    int count;
+    struct ops_sflow_tx_dgram dgrams[SFLOW_TX_QUEUE_LEN];
+};
+
+/* Collector with its pre-resolved destination and send counters. Only
+ * accessed from the main thread (configuration, flush and appctl). */
+struct ops_sflow_collector {
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    char name[IPV6_BUFFER_LEN + PORT_BUF_LEN + 5];
+    uint64_t tx_packets;
+    uint64_t tx_bytes;
+    uint64_t tx_errors;
+};
+
+static struct ovs_mutex tx_mutex = OVS_MUTEX_INITIALIZER;
+static struct ops_sflow_tx_batch tx_batches[2];
+static int tx_active_batch OVS_GUARDED_BY(tx_mutex);
+static uint64_t tx_queue_drops OVS_GUARDED_BY(tx_mutex);
+static struct seq *tx_seq;
+
+static struct ops_sflow_collector sflow_collectors[SFLOW_MAX_COLLECTORS];
+static int n_sflow_collectors;
+static int sflow_tx_fd_v4 = -1;
+static int sflow_tx_fd_v6 = -1;
+
+/* Counter poller scheduling. Every poller gets a timer on a hashed timer
+ * wheel driven by the monotonic millisecond clock. The first expiry of
+ * each timer is spread over the polling interval so that pollers sharing
+ * an interval don't all fire in the same tick. Main thread only. */
+#define SFLOW_POLL_TICK_MS          100
+#define SFLOW_POLL_WHEEL_SLOTS      512
+
+struct ops_sflow_poll_timer {
+    struct hmap_node hmap_node;     /* In 'poll_timers', hashed by 'dsi'. */
+    struct ovs_list wheel_node;     /* In a 'poll_wheel' slot. */
+    SFLDataSource_instance dsi;     /* Data source of the poller. */
+    long long int due;              /* Next expiry, in msec. */
+};
+
+static struct hmap poll_timers = HMAP_INITIALIZER(&poll_timers);
+static struct ovs_list poll_wheel[SFLOW_POLL_WHEEL_SLOTS];
+static long long int poll_wheel_tick;   /* Last processed tick. */
+static uint32_t poll_timer_seq;         /* Used to spread first expiries. */
+
+/* Per-port counter snapshot shared by all the pollers that fire in the
+ * same wheel tick. A port is read from the ASIC at most once per tick,
+ * no matter how many pollers (port, LAGs) refer to it. The snapshot is
+ * refreshed before the pollers run, so the poller callbacks themselves
+ * never access the hardware. */
+struct ops_sflow_port_snapshot {
+    struct ops_sflow_port_stats stats;
+    uint32_t index;
+    uint64_t speed;
+    uint32_t direction;
+    uint32_t status;
+    long long int tick;             /* Tick in which 'stats' were read. */
+};
+
+static struct ops_sflow_port_snapshot
+    port_snapshot[MAX_SWITCH_UNITS][MAX_HW_PORTS];
+
+/* Scratch buffer used to assemble the sampled header. Only used with
+ * 'mutex' held, which also serializes the encoding of the flow sample. */
+static uint8_t sample_header_buf[SFLOW_MAX_HEADER_SIZE] OVS_GUARDED_BY(mutex);
+
+/* Samples whose header was cut to SFLOW_MAX_HEADER_SIZE bytes, shorter
+ * than the configured header size. */
+static uint64_t sample_header_truncated OVS_GUARDED_BY(mutex);
+
+/* Sample pool snapshot per hw port. Refreshed from the periodic interface
+ * statistics poll so that the RX path never has to read ASIC counters. */
+static struct ovs_mutex sample_pool_mutex = OVS_MUTEX_INITIALIZER;
+static struct ops_sflow_sample_pool
+    sample_pool[MAX_SWITCH_UNITS][MAX_HW_PORTS] OVS_GUARDED_BY(sample_pool_mutex);
+
+/* Adaptive sampling rate controller. When enabled, ops_sflow_run() looks
+ * at the sample arrival rate, the depth of the datagram transmit queue and
+ * the drops on the sFlow CPU queue once per period. Under pressure the
+ * rates of the busiest ports are doubled, and once the load is well below
+ * the target they are brought back towards the lower bound. Rates always
+ * stay within [min_rate, max_rate]. Main thread only. */
+#define SFLOW_ADAPT_PERIOD_MS           1000
+#define SFLOW_ADAPT_DFLT_TARGET_PPS     2500    /* Half the sFlow CoPP rate. */
+#define SFLOW_ADAPT_DFLT_MAX_RATE       1000000
+
+struct ops_sflow_adapt {
+    bool enabled;
+    uint32_t target_pps;            /* Sample budget for the whole switch. */
+    uint32_t min_rate;              /* 0 means the configured rate. */
+    uint32_t max_rate;
+    long long int last_run;         /* msec. */
+    uint64_t cpu_drops[MAX_SWITCH_UNITS];   /* sFlow CPU queue drops. */
+    uint64_t tx_drops;              /* Transmit queue drops. */
+
+    /* Status of the last run, reported by sflow/adaptive-rate. */
+    uint32_t samples_pps;
+    uint64_t cpu_drops_delta;
+    uint64_t tx_drops_delta;
+    int tx_depth;
+    bool pressure;
+    uint64_t n_increases;
+    uint64_t n_decreases;
+};
+
+static struct ops_sflow_adapt sflow_adapt;
+
 /* callbacks registered during sFlow initialization; used for various
  * utilities.
  */
@@ -91,13 +227,175 @@ ops_sflow_agent_error_cb(void *magic OVS_UNUSED, SFLAgent *ops_agent OVS_UNUSED,
     VLOG_ERR("%s", err);
 }
 
-/* sFlow library callback to send datagram. */
+/* sFlow library callback to send datagram. The datagram is only queued
+ * here; ops_sflow_tx_flush() sends it to the collectors. */
 static void
 ops_sflow_agent_pkt_tx_cb(void *ds_, SFLAgent *agent OVS_UNUSED,
                           SFLReceiver *receiver OVS_UNUSED, u_char *pkt,
                           uint32_t pktLen)
 {
-    collectors_send(sflow_collectors, pkt, pktLen);
+    struct ops_sflow_tx_batch *batch;
+    struct ops_sflow_tx_dgram *dgram;
+
+    if (pktLen > SFLOW_MAX_DATAGRAM_SIZE) {
+        VLOG_ERR("sFlow datagram of %u bytes is too large to send.", pktLen);
+        return;
+    }
+
+    ovs_mutex_lock(&tx_mutex);
+    batch = &tx_batches[tx_active_batch];
+    if (batch->count < SFLOW_TX_QUEUE_LEN) {
+        dgram = &batch->dgrams[batch->count++];
+        memcpy(dgram->data, pkt, pktLen);
+        dgram->len = pktLen;
+        if (batch->count == 1) {
+            seq_change(tx_seq);
+        }
+    } else {
+        tx_queue_drops++;
+    }
+    ovs_mutex_unlock(&tx_mutex);
+}
+
+/* Wake up the main loop as soon as a datagram is queued. */
+static void
+ops_sflow_tx_wait(void)
+{
+    uint64_t seqno = seq_read(tx_seq);
+    bool pending;
+
+    ovs_mutex_lock(&tx_mutex);
+    pending = tx_batches[tx_active_batch].count > 0;
+    ovs_mutex_unlock(&tx_mutex);
+
+    if (pending) {
+        poll_immediate_wake();
+    } else {
+        seq_wait(tx_seq, seqno);
+    }
+}
+
+/* Send the 'n' messages in 'msgs' on 'fd', retrying after partial sends
+ * and skipping over messages that fail. 'owner' maps each message to the
+ * collector whose counters are updated. */
+static void
+ops_sflow_tx_send(int fd, struct mmsghdr *msgs,
+                  struct ops_sflow_collector **owner, int n)
+{
+    int sent = 0, rc, i;
+
+    while (sent < n) {
+        rc = sendmmsg(fd, msgs + sent, n - sent, 0);
+        if (rc < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            /* The first message of the remaining batch failed. */
+            VLOG_DBG("sFlow: failed to send datagram to %s: %s",
+                     owner[sent]->name, ovs_strerror(errno));
+            owner[sent]->tx_errors++;
+            sent++;
+            continue;
+        }
+        for (i = sent; i < sent + rc; i++) {
+            owner[i]->tx_packets++;
+            owner[i]->tx_bytes += msgs[i].msg_len;
+        }
+        sent += rc;
+    }
+}
+
+/* Send all the queued datagrams to all the configured collectors, with
+ * one sendmmsg() batch per address family. */
+static void
+ops_sflow_tx_flush(void)
+{
+    struct mmsghdr msgs[SFLOW_TX_QUEUE_LEN * SFLOW_MAX_COLLECTORS];
+    struct ops_sflow_collector *owner[SFLOW_TX_QUEUE_LEN *
+                                      SFLOW_MAX_COLLECTORS];
+    struct iovec iov[SFLOW_TX_QUEUE_LEN];
+    struct ops_sflow_tx_batch *batch;
+    struct ops_sflow_collector *c;
+    int families[2] = { AF_INET, AF_INET6 };
+    int f, d, i, n;
+
+    ovs_mutex_lock(&tx_mutex);
+    batch = &tx_batches[tx_active_batch];
+    if (batch->count == 0) {
+        ovs_mutex_unlock(&tx_mutex);
+        return;
+    }
+    tx_active_batch ^= 1;
+    ovs_mutex_unlock(&tx_mutex);
+
+    for (d = 0; d < batch->count; d++) {
+        iov[d].iov_base = batch->dgrams[d].data;
+        iov[d].iov_len = batch->dgrams[d].len;
+    }
+
+    for (f = 0; f < ARRAY_SIZE(families); f++) {
+        int fd = (families[f] == AF_INET) ? sflow_tx_fd_v4 : sflow_tx_fd_v6;
+
+        n = 0;
+        for (i = 0; i < n_sflow_collectors; i++) {
+            c = &sflow_collectors[i];
+            if (c->addr.ss_family != families[f]) {
+                continue;
+            }
+            for (d = 0; d < batch->count; d++) {
+                memset(&msgs[n], 0, sizeof msgs[n]);
+                msgs[n].msg_hdr.msg_name = &c->addr;
+                msgs[n].msg_hdr.msg_namelen = c->addr_len;
+                msgs[n].msg_hdr.msg_iov = &iov[d];
+                msgs[n].msg_hdr.msg_iovlen = 1;
+                owner[n] = c;
+                n++;
+            }
+        }
+        if (n == 0) {
+            continue;
+        }
+        if (fd < 0) {
+            for (i = 0; i < n; i++) {
+                owner[i]->tx_errors++;
+            }
+            continue;
+        }
+        ops_sflow_tx_send(fd, msgs, owner, n);
+    }
+
+    batch->count = 0;
+}
+
+/* Drop any datagram still waiting to be sent. */
+static void
+ops_sflow_tx_clear(void)
+{
+    ovs_mutex_lock(&tx_mutex);
+    tx_batches[0].count = 0;
+    tx_batches[1].count = 0;
+    ovs_mutex_unlock(&tx_mutex);
+}
+
+/* Open the unconnected UDP socket used to send datagrams of family 'af'. */
+static int
+ops_sflow_tx_socket(int af)
+{
+    int fd, tos = IPTOS_PREC_INTERNETCONTROL;
+
+    fd = socket(af, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        VLOG_ERR("sFlow: failed to open %s socket: %s",
+                 af == AF_INET ? "IPv4" : "IPv6", ovs_strerror(errno));
+        return -1;
+    }
+
+    if (af == AF_INET) {
+        setsockopt(fd, IPPROTO_IP, IP_TOS, &tos, sizeof tos);
+    } else {
+        setsockopt(fd, IPPROTO_IPV6, IPV6_TCLASS, &tos, sizeof tos);
+    }
+    return fd;
 }
 
 
@@ -202,6 +500,146 @@ print_pkt(const opennsl_pkt_t *pkt)
     }
 }
 
+/* Copy up to 'buf_len' bytes of the sampled packet into 'buf', walking
+ * all the data blocks of 'pkt'. If 'strip_vlan' is set, the VLAN tag that
+ * follows the DMAC and SMAC is skipped while copying. The packet buffer
+ * owned by the SDK is never modified. Returns the number of bytes copied.
+ */
+static uint32_t
+ops_sflow_build_sample_header(const opennsl_pkt_t *pkt, bool strip_vlan,
+                              uint8_t *buf, uint32_t buf_len)
+{
+    uint32_t copied = 0, offset = 0;
+    uint32_t skip_start, skip_end;
+    uint32_t blk_len, pos, abs_pos, chunk;
+    int i;
+
+    skip_start = 2 * ETHER_ADDR_LEN;
+    skip_end = strip_vlan ? skip_start + VLAN_HEADER_SIZE : skip_start;
+    buf_len = MIN(buf_len, SFLOW_MAX_HEADER_SIZE);
+
+    for (i = 0; i < pkt->blk_count && copied < buf_len; i++) {
+        /* Blocks may be larger than the packet they carry. */
+        if (offset >= pkt->pkt_len) {
+            break;
+        }
+        blk_len = MIN(pkt->pkt_data[i].len, pkt->pkt_len - offset);
+
+        pos = 0;
+        while (pos < blk_len && copied < buf_len) {
+            abs_pos = offset + pos;
+            if (abs_pos >= skip_start && abs_pos < skip_end) {
+                /* Inside the VLAN tag being stripped. */
+                pos += MIN(blk_len - pos, skip_end - abs_pos);
+                continue;
+            }
+            chunk = blk_len - pos;
+            if (abs_pos < skip_start) {
+                chunk = MIN(chunk, skip_start - abs_pos);
+            }
+            chunk = MIN(chunk, buf_len - copied);
+            memcpy(buf + copied, pkt->pkt_data[i].data + pos, chunk);
+            copied += chunk;
+            pos += chunk;
+        }
+        offset += pkt->pkt_data[i].len;
+    }
+
+    return copied;
+}
+
+/* Refresh the sample pool snapshot of a port. Called whenever the interface
+ * counters are read from the ASIC; resets the count of samples seen since
+ * the previous refresh. Counters going back were cleared, so the sample
+ * pool reported may go back as well. */
+void
+ops_sflow_update_sample_pool(int hw_unit, int hw_port, uint64_t rx_packets,
+                             uint64_t tx_packets)
+{
+    struct ops_sflow_sample_pool *pool;
+
+    if (!VALID_HW_UNIT(hw_unit) || !VALID_HW_UNIT_PORT(hw_unit, hw_port)) {
+        return;
+    }
+
+    ovs_mutex_lock(&sample_pool_mutex);
+    pool = &sample_pool[hw_unit][hw_port];
+    if (rx_packets < pool->rx_packets) {
+        pool->rx_reported = 0;
+    }
+    if (tx_packets < pool->tx_packets) {
+        pool->tx_reported = 0;
+    }
+    pool->rx_packets = rx_packets;
+    pool->tx_packets = tx_packets;
+    pool->rx_samples = 0;
+    pool->tx_samples = 0;
+    ovs_mutex_unlock(&sample_pool_mutex);
+}
+
+/* Remember the sampling rates programmed in the ASIC for 'hw_port', so
+ * that its samples report the rate they were actually taken at. */
+static void
+ops_sflow_record_port_rate(int hw_unit, int hw_port, int ingress_rate,
+                           int egress_rate)
+{
+    struct ops_sflow_sample_pool *pool;
+
+    if (!VALID_HW_UNIT(hw_unit) || !VALID_HW_UNIT_PORT(hw_unit, hw_port)) {
+        return;
+    }
+
+    ovs_mutex_lock(&sample_pool_mutex);
+    pool = &sample_pool[hw_unit][hw_port];
+    pool->ingress_rate = MAX(ingress_rate, 0);
+    pool->egress_rate = MAX(egress_rate, 0);
+    ovs_mutex_unlock(&sample_pool_mutex);
+}
+
+/* Account one more sample on 'hw_port' and return the estimated number of
+ * packets the sampler has seen: the last counter snapshot plus '*rate'
+ * packets for every sample received since that snapshot. The estimate may
+ * overshoot the counter read at the next refresh, so the value returned
+ * never goes below the one last returned; collectors take deltas of it.
+ * On input '*rate' is the sampler rate; it is replaced by the rate
+ * programmed on the port, if known. */
+static uint32_t
+ops_sflow_get_sample_pool(int hw_unit, int hw_port, bool ingress,
+                          uint32_t *rate)
+{
+    struct ops_sflow_sample_pool *pool;
+    uint64_t packets;
+
+    if (!VALID_HW_UNIT(hw_unit) || !VALID_HW_UNIT_PORT(hw_unit, hw_port)) {
+        return 0;
+    }
+
+    ovs_mutex_lock(&sample_pool_mutex);
+    pool = &sample_pool[hw_unit][hw_port];
+    if (ingress) {
+        if (pool->ingress_rate) {
+            *rate = pool->ingress_rate;
+        }
+        pool->rx_samples++;
+        pool->rx_window++;
+        packets = pool->rx_packets + (uint64_t)pool->rx_samples * *rate;
+        packets = MAX(packets, pool->rx_reported);
+        pool->rx_reported = packets;
+    } else {
+        if (pool->egress_rate) {
+            *rate = pool->egress_rate;
+        }
+        pool->tx_samples++;
+        pool->tx_window++;
+        packets = pool->tx_packets + (uint64_t)pool->tx_samples * *rate;
+        packets = MAX(packets, pool->tx_reported);
+        pool->tx_reported = packets;
+    }
+    ovs_mutex_unlock(&sample_pool_mutex);
+
+    return (uint32_t)packets;
+}
+
 /* Fn to write received sample pkt to buffer. Wrapper for
  * sfl_sampler_writeFlowSample() routine. */
 void ops_sflow_write_sampled_pkt(int unit, opennsl_pkt_t *pkt)
@@ -210,9 +648,9 @@ void ops_sflow_write_sampled_pkt(int unit, opennsl_pkt_t *pkt)
     SFLFlow_sample_element  hdrElem;
     SFLSampled_header       *header;
     SFLSampler              *sampler;
-    struct netdev_stats     stats;
-
-    memset(&stats, 0, sizeof stats);
+    bool                    strip_vlan;
+    uint32_t                rate;
+    uint32_t                header_len;
 
     if (pkt == NULL) {
         VLOG_ERR("NULL sFlow pkt received. Can't be buffered.");
@@ -250,53 +688,55 @@ void ops_sflow_write_sampled_pkt(int unit, opennsl_pkt_t *pkt)
      */
     header->frame_length = pkt->tot_len;
 
-    if (pkt->vlan && ops_routing_is_internal_vlan(pkt->vlan)) {
-        VLOG_DBG("Internal VLAN from sampled packet (in hex): %02X%02X",
-                 pkt->pkt_data[0].data[14],
-                 pkt->pkt_data[0].data[15]);
-
-        /* Strip internal VLAN ID from the packet and
-         * right shift DMAC and SMAC by 4 bytes. */
-
-        uint8 *new_data = pkt->pkt_data[0].data;
-        pkt->pkt_data[0].data = pkt->pkt_data[0].data + VLAN_HEADER_SIZE;
-        /* Copy SMAC and DMAC (12 bytes) */
-        memmove(pkt->pkt_data[0].data, new_data, 2 * ETHER_ADDR_LEN);
-        /* We stripped VLAN header so reduce frame_length by 4 */
+    strip_vlan = (pkt->vlan && ops_routing_is_internal_vlan(pkt->vlan));
+    if (strip_vlan) {
+        /* Internal VLAN ID is stripped from the copy of the header below.
+         * Reduce frame_length by the size of the VLAN header. */
         header->frame_length = header->frame_length - VLAN_HEADER_SIZE;
     }
 
     /* Ethernet FCS stripped off. */
     header->stripped = 4;
-    header->header_length = MIN(header->frame_length,
-                                sampler->sFlowFsMaximumHeaderSize);
 
-    /* TODO: OpenNSL saves incoming data as an array of structs
-     * containing {len, data} pairs. For each element of the struct, 'data'
-     * can be up to 65535 bytes long. Run traffic to test these boundary
-     * conditions (Jumbo Frames?). */
-    header->header_bytes = (uint8_t *)pkt->pkt_data[0].data;
+    /* Assemble the sampled header from all the packet blocks into the
+     * scratch buffer. The SDK buffer is left untouched. */
+    header_len = MIN(header->frame_length, sampler->sFlowFsMaximumHeaderSize);
+    if (header_len > SFLOW_MAX_HEADER_SIZE) {
+        static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
+
+        sample_header_truncated++;
+        VLOG_WARN_RL(&rl, "sFlow sampled header truncated from %u to %d "
+                     "bytes", header_len, SFLOW_MAX_HEADER_SIZE);
+    }
+    header->header_length =
+        ops_sflow_build_sample_header(pkt, strip_vlan, sample_header_buf,
+                                      header_len);
+    header->header_bytes = sample_header_buf;
 
     fs.input = pkt->src_port;
     fs.output = pkt->dest_port;
 
-    /* Calculate the sample pool data by gathering interface statistics
-     * from ASIC and aggregating unicast, multicast and broadcast packets.
+    /* Calculate the sample pool from the last interface counter snapshot
+     * plus the packets represented by the samples seen since then.
+     * The sampling rate is the one of the port, which may differ from the
+     * sampler rate when the adaptive rate controller is enabled.
      * NOTE: Packet counters will wrap around (this is expected behavior). */
+    rate = sampler->sFlowFsPacketSamplingRate;
     if (OPENNSL_RX_REASON_GET(pkt->rx_reasons,
                               opennslRxReasonSampleSource)) {
         /* Packets were sampled at ingress so sample pool will include
          * all RX packets. */
-        netdev_bcmsdk_get_interface_stats(unit, pkt->src_port, &stats);
-        fs.sample_pool = stats.rx_packets;
+        fs.sample_pool = ops_sflow_get_sample_pool(unit, pkt->src_port, true,
+                                                   &rate);
     }
     if (OPENNSL_RX_REASON_GET(pkt->rx_reasons,
                               opennslRxReasonSampleDest)) {
         /* Packets sampled at egress so sample pool will include
          * all TX packets. */
-        netdev_bcmsdk_get_interface_stats(unit, pkt->dest_port, &stats);
-        fs.sample_pool = stats.tx_packets;
+        fs.sample_pool = ops_sflow_get_sample_pool(unit, pkt->dest_port, false,
+                                                   &rate);
     }
+    fs.sampling_rate = rate;
 
     /* Submit the flow sample to be encoded into the next datagram. */
     SFLADD_ELEMENT(&fs, &hdrElem);
@@ -357,6 +797,7 @@ ops_sflow_set_per_interface (const int unit, const int port, bool set)
                       EV_KV("error", "%s", opennsl_errmsg(rc)));
             return;
         }
+        ops_sflow_record_port_rate(unit, port, ingress_rate, egress_rate);
     } else {
         /* zero rate clears sampling on ASIC */
         rc = opennsl_port_sample_rate_set(unit, port, 0, 0);
@@ -368,6 +809,7 @@ ops_sflow_set_per_interface (const int unit, const int port, bool set)
                       EV_KV("error", "%s", opennsl_errmsg(rc)));
             return;
         }
+        ops_sflow_record_port_rate(unit, port, 0, 0);
     }
 }
 
@@ -387,6 +829,287 @@ ops_sflow_get_lag_aggregate_id(const char *lag_name)
     return aggregate_id;
 }
 
+/* Read the counters and interface info of 'hw_port' into the snapshot,
+ * unless they were already read in the current wheel tick. */
+static void
+ops_sflow_port_snapshot_refresh(int hw_unit, int hw_port)
+{
+    struct ops_sflow_port_snapshot *snap;
+
+    if (!VALID_HW_UNIT(hw_unit) || !VALID_HW_UNIT_PORT(hw_unit, hw_port)) {
+        return;
+    }
+
+    snap = &port_snapshot[hw_unit][hw_port];
+    if (snap->tick != poll_wheel_tick) {
+        memset(&snap->stats, 0, sizeof snap->stats);
+        netdev_bcmsdk_get_sflow_intf_info(hw_unit, hw_port, &snap->index,
+                                          &snap->speed, &snap->direction,
+                                          &snap->status);
+        bcmsdk_get_sflow_port_stats(hw_unit, hw_port, &snap->stats);
+        snap->tick = poll_wheel_tick;
+    }
+}
+
+/* Return the snapshot of 'hw_port'. Never accesses the hardware. */
+static const struct ops_sflow_port_snapshot *
+ops_sflow_port_snapshot_get(int hw_unit, int hw_port)
+{
+    static const struct ops_sflow_port_snapshot zero_snapshot;
+
+    if (!VALID_HW_UNIT(hw_unit) || !VALID_HW_UNIT_PORT(hw_unit, hw_port)) {
+        return &zero_snapshot;
+    }
+    return &port_snapshot[hw_unit][hw_port];
+}
+
+static void
+ops_sflow_port_stats_add(struct ops_sflow_port_stats *sum,
+                         const struct ops_sflow_port_stats *stats)
+{
+    sum->in_octets += stats->in_octets;
+    sum->in_ucastpkts += stats->in_ucastpkts;
+    sum->in_multicastpkts += stats->in_multicastpkts;
+    sum->in_broadcastpkts += stats->in_broadcastpkts;
+    sum->in_discards += stats->in_discards;
+    sum->in_errors += stats->in_errors;
+    sum->in_unknownprotos += stats->in_unknownprotos;
+    sum->out_octets += stats->out_octets;
+    sum->out_ucastpkts += stats->out_ucastpkts;
+    sum->out_multicastpkts += stats->out_multicastpkts;
+    sum->out_broadcastpkts += stats->out_broadcastpkts;
+    sum->out_discards += stats->out_discards;
+    sum->out_errors += stats->out_errors;
+}
+
+/* Refresh the cached list of member ports of a LAG 'bundle'. Called on
+ * every membership change so that the LAG poller doesn't have to walk
+ * the bundle ports. */
+void
+ops_sflow_lag_update_members(struct ofbundle *bundle)
+{
+    struct bcmsdk_provider_ofport_node *port;
+    int hw_unit, hw_port;
+    size_t n = 0;
+
+    if (!bundle || !bundle->name ||
+        strncmp(bundle->name, LAG_PORT_NAME_PREFIX,
+                LAG_PORT_NAME_PREFIX_LENGTH) != 0) {
+        return;
+    }
+
+    bundle->lag_sflow_members = xrealloc(bundle->lag_sflow_members,
+                                         (list_size(&bundle->ports) + 1) *
+                                         sizeof *bundle->lag_sflow_members);
+    LIST_FOR_EACH(port, bundle_node, &bundle->ports) {
+        hw_unit = hw_port = -1;
+        netdev_bcmsdk_get_hw_info(port->up.netdev, &hw_unit, &hw_port, NULL);
+        if (hw_port == -1) {
+            continue;
+        }
+        /* Same unit/port encoding as the poller 'bridgePort'. */
+        bundle->lag_sflow_members[n++] = ((hw_unit & 0x0000FFFF) << 16) |
+                                         (hw_port & 0x0000FFFF);
+    }
+    bundle->lag_sflow_n_members = n;
+}
+
+/* Refresh the snapshot of every port the poller of 'timer' reports on. */
+static void
+ops_sflow_poll_timer_prefetch(struct ops_sflow_poll_timer *timer)
+{
+    struct ofbundle *lag_bundle;
+    SFLPoller *pl;
+    size_t i;
+
+    pl = sfl_agent_getPoller(ops_sflow_agent, &timer->dsi);
+    if (pl == NULL) {
+        return;
+    }
+
+    if (SFL_DS_CLASS(timer->dsi) == SFL_DSCLASS_LOGICAL_ENTITY) {
+        lag_bundle = (struct ofbundle *)pl->magic;
+        for (i = 0; i < lag_bundle->lag_sflow_n_members; i++) {
+            ops_sflow_port_snapshot_refresh(
+                (lag_bundle->lag_sflow_members[i] & 0xFFFF0000) >> 16,
+                lag_bundle->lag_sflow_members[i] & 0x0000FFFF);
+        }
+    } else {
+        ops_sflow_port_snapshot_refresh((pl->bridgePort & 0xFFFF0000) >> 16,
+                                        pl->bridgePort & 0x0000FFFF);
+    }
+}
+
+static uint32_t
+ops_sflow_poll_timer_hash(const SFLDataSource_instance *dsi)
+{
+    return hash_bytes(dsi, sizeof *dsi, 0);
+}
+
+static struct ops_sflow_poll_timer *
+ops_sflow_poll_timer_find(const SFLDataSource_instance *dsi)
+{
+    struct ops_sflow_poll_timer *timer;
+
+    HMAP_FOR_EACH_WITH_HASH(timer, hmap_node,
+                            ops_sflow_poll_timer_hash(dsi), &poll_timers) {
+        if (!memcmp(&timer->dsi, dsi, sizeof *dsi)) {
+            return timer;
+        }
+    }
+    return NULL;
+}
+
+static void
+ops_sflow_poll_timer_insert(struct ops_sflow_poll_timer *timer)
+{
+    size_t slot = (timer->due / SFLOW_POLL_TICK_MS) % SFLOW_POLL_WHEEL_SLOTS;
+
+    list_push_back(&poll_wheel[slot], &timer->wheel_node);
+}
+
+static void
+ops_sflow_poll_timer_delete(struct ops_sflow_poll_timer *timer)
+{
+    list_remove(&timer->wheel_node);
+    hmap_remove(&poll_timers, &timer->hmap_node);
+    free(timer);
+}
+
+/* (Re)arm the timer of the poller of 'dsi' for an 'interval' in seconds.
+ * A zero interval removes the timer. */
+static void
+ops_sflow_poll_timer_set(const SFLDataSource_instance *dsi, int interval)
+{
+    struct ops_sflow_poll_timer *timer;
+    long long int interval_ms = (long long int)interval * 1000;
+
+    timer = ops_sflow_poll_timer_find(dsi);
+    if (interval <= 0) {
+        if (timer) {
+            ops_sflow_poll_timer_delete(timer);
+        }
+        return;
+    }
+
+    if (timer) {
+        list_remove(&timer->wheel_node);
+    } else {
+        timer = xzalloc(sizeof *timer);
+        timer->dsi = *dsi;
+        hmap_insert(&poll_timers, &timer->hmap_node,
+                    ops_sflow_poll_timer_hash(dsi));
+    }
+
+    /* Multiplicative hashing of a sequence number gives an even spread of
+     * first expiries over the interval for any number of pollers. */
+    timer->due = time_msec() +
+                 (uint32_t)(poll_timer_seq++ * 2654435761u) % interval_ms;
+
+    /* A due time in a tick already processed would only be seen on the
+     * next turn of the wheel. */
+    timer->due = MAX(timer->due, (poll_wheel_tick + 1) * SFLOW_POLL_TICK_MS);
+    ops_sflow_poll_timer_insert(timer);
+}
+
+static void
+ops_sflow_poll_timer_clear_all(void)
+{
+    struct ops_sflow_poll_timer *timer, *next;
+
+    HMAP_FOR_EACH_SAFE(timer, next, hmap_node, &poll_timers) {
+        ops_sflow_poll_timer_delete(timer);
+    }
+}
+
+/* Fire the poller of an expired 'timer'. Returns the polling interval of
+ * the poller in seconds, or -1 if the poller no longer exists. */
+static int
+ops_sflow_poll_timer_fire(struct ops_sflow_poll_timer *timer, time_t now)
+{
+    SFL_COUNTERS_SAMPLE_TYPE cs;
+    SFLPoller *pl;
+
+    pl = sfl_agent_getPoller(ops_sflow_agent, &timer->dsi);
+    if (pl == NULL) {
+        return -1;
+    }
+    if ((pl->sFlowCpInterval == 0) ||
+        (pl->sFlowCpReceiver == 0) ||
+        (!pl->getCountersFn)) {
+        return pl->sFlowCpInterval;
+    }
+
+    memset(&cs, 0, sizeof(cs));
+    pl->getCountersFn(pl->magic, pl, &cs);
+    pl->lastPolled = now;
+    return pl->sFlowCpInterval;
+}
+
+/* Advance the poller timer wheel up to the current time and run all the
+ * pollers that expired. */
+static void
+ops_sflow_poll_wheel_run(time_t now)
+{
+    struct ops_sflow_poll_timer *timer, *next;
+    struct ovs_list expired;
+    long long int now_ms = time_msec();
+    long long int now_tick = now_ms / SFLOW_POLL_TICK_MS;
+    long long int tick, first_tick, interval_ms;
+    int interval;
+
+    if (poll_wheel_tick == 0 || now_tick - poll_wheel_tick >
+                                SFLOW_POLL_WHEEL_SLOTS) {
+        /* First run or a long stall: one full turn covers every slot. */
+        first_tick = now_tick - SFLOW_POLL_WHEEL_SLOTS + 1;
+    } else {
+        first_tick = poll_wheel_tick + 1;
+    }
+    if (first_tick > now_tick) {
+        return;
+    }
+
+    /* New snapshot generation for the counters read in this tick. */
+    poll_wheel_tick = now_tick;
+
+    list_init(&expired);
+    for (tick = first_tick; tick <= now_tick; tick++) {
+        struct ovs_list *slot = &poll_wheel[tick % SFLOW_POLL_WHEEL_SLOTS];
+
+        /* Slots also hold timers of later turns of the wheel. */
+        LIST_FOR_EACH_SAFE(timer, next, wheel_node, slot) {
+            if (timer->due / SFLOW_POLL_TICK_MS <= now_tick) {
+                list_remove(&timer->wheel_node);
+                list_push_back(&expired, &timer->wheel_node);
+            }
+        }
+    }
+
+    /* Read all the counters needed in this tick before running any
+     * poller, without holding the sFlow mutex. */
+    LIST_FOR_EACH(timer, wheel_node, &expired) {
+        ops_sflow_poll_timer_prefetch(timer);
+    }
+
+    LIST_FOR_EACH_SAFE(timer, next, wheel_node, &expired) {
+        list_remove(&timer->wheel_node);
+        interval = ops_sflow_poll_timer_fire(timer, now);
+        if (interval < 0) {
+            hmap_remove(&poll_timers, &timer->hmap_node);
+            free(timer);
+            continue;
+        }
+
+        /* Re-arm, keeping the phase of the timer. */
+        interval_ms = (long long int)MAX(interval, 1) * 1000;
+        timer->due += interval_ms;
+        if (timer->due <= now_ms) {
+            timer->due = now_ms + interval_ms;
+        }
+        ops_sflow_poll_timer_insert(timer);
+    }
+}
+
 /* callback function to get the per-port interface counters */
 static void
 ops_sflow_get_port_counters(void *arg, SFLPoller *poller,
@@ -395,6 +1118,7 @@ ops_sflow_get_port_counters(void *arg, SFLPoller *poller,
     uint64_t speed;
     uint32_t hw_unit = 0, hw_port = 0;
     uint32_t index = 0, direction = 0, status = 0;
+    const struct ops_sflow_port_snapshot *snap;
     struct ops_sflow_port_stats stats;
     SFLCounters_sample_element elem, lacp_elem;
     SFLIf_counters *counters;
@@ -410,9 +1134,12 @@ ops_sflow_get_port_counters(void *arg, SFLPoller *poller,
     ovs_mutex_lock(&mutex);
     hw_unit = (poller->bridgePort & 0xFFFF0000) >> 16;
     hw_port = poller->bridgePort & 0x0000FFFF;
-    netdev_bcmsdk_get_sflow_intf_info(hw_unit, hw_port, &index, &speed,
-                                      &direction, &status);
-    bcmsdk_get_sflow_port_stats(hw_unit, hw_port, &stats);
+    snap = ops_sflow_port_snapshot_get(hw_unit, hw_port);
+    index = snap->index;
+    speed = snap->speed;
+    direction = snap->direction;
+    status = snap->status;
+    stats = snap->stats;
 
     elem.tag = SFLCOUNTERS_GENERIC;
     counters = &elem.counterBlock.generic;
@@ -485,49 +1212,39 @@ ops_sflow_get_port_counters(void *arg, SFLPoller *poller,
 
 /**
  * Callback function to get the LAG interface counters and
- * send to sFlow collector.
+ * send to sFlow collector. The counters are summed from the per-port
+ * snapshot over the cached member list of the bundle; no hardware
+ * access is done here.
  */
 static void
 ops_sflow_get_lag_counters(void *arg, SFLPoller *poller,
                             SFL_COUNTERS_SAMPLE_TYPE *cs)
 {
-    uint64_t port_speed = 0, lag_speed = 0;
+    uint64_t lag_speed = 0;
     int hw_unit = 0, hw_port = 0;
-    uint32_t index = 0, direction = 0, status = 0;
-    struct ops_sflow_port_stats port_stats, lag_stats;
+    uint32_t direction = 0, status = 0;
+    struct ops_sflow_port_stats lag_stats;
+    const struct ops_sflow_port_snapshot *snap;
     SFLCounters_sample_element elem;
     SFLIf_counters *counters;
     struct ofbundle *lag_bundle = NULL;
-    struct bcmsdk_provider_ofport_node *port = NULL, *next_port = NULL;
     uint32_t aggregate_id = 0;
+    size_t i;
 
-    ovs_mutex_lock(&mutex);
     lag_bundle = (struct ofbundle *)arg;
     memset(&lag_stats, 0, sizeof(struct ops_sflow_port_stats));
 
     aggregate_id = ops_sflow_get_lag_aggregate_id(lag_bundle->name);
 
-    LIST_FOR_EACH_SAFE(port, next_port, bundle_node, &lag_bundle->ports) {
-        netdev_bcmsdk_get_hw_info(port->up.netdev, &hw_unit, &hw_port, NULL);
+    for (i = 0; i < lag_bundle->lag_sflow_n_members; i++) {
+        hw_unit = (lag_bundle->lag_sflow_members[i] & 0xFFFF0000) >> 16;
+        hw_port = lag_bundle->lag_sflow_members[i] & 0x0000FFFF;
         VLOG_DBG("LAG %s member port : %d", lag_bundle->name, hw_port);
-        netdev_bcmsdk_get_sflow_intf_info(hw_unit, hw_port,
-                                          &index, &port_speed,
-                                          &direction, &status);
-        bcmsdk_get_sflow_port_stats(hw_unit, hw_port, &port_stats);
-        lag_stats.in_octets += port_stats.in_octets;
-        lag_stats.in_ucastpkts += port_stats.in_ucastpkts;
-        lag_stats.in_multicastpkts += port_stats.in_multicastpkts;
-        lag_stats.in_broadcastpkts += port_stats.in_broadcastpkts;
-        lag_stats.in_discards += port_stats.in_discards;
-        lag_stats.in_errors += port_stats.in_errors;
-        lag_stats.in_unknownprotos += port_stats.in_unknownprotos;
-        lag_stats.out_octets += port_stats.out_octets;
-        lag_stats.out_ucastpkts += port_stats.out_ucastpkts;
-        lag_stats.out_multicastpkts += port_stats.out_multicastpkts;
-        lag_stats.out_broadcastpkts += port_stats.out_broadcastpkts;
-        lag_stats.out_discards += port_stats.out_discards;
-        lag_stats.out_errors += port_stats.out_errors;
-        lag_speed += port_speed;
+        snap = ops_sflow_port_snapshot_get(hw_unit, hw_port);
+        ops_sflow_port_stats_add(&lag_stats, &snap->stats);
+        lag_speed += snap->speed;
+        direction = snap->direction;
+        status = snap->status;
     }
 
     elem.tag = SFLCOUNTERS_GENERIC;
@@ -559,6 +1276,8 @@ ops_sflow_get_lag_counters(void *arg, SFLPoller *poller,
              lag_stats.out_ucastpkts, (int)lag_stats.out_octets,
              lag_stats.out_discards, lag_stats.out_errors);
 
+    ovs_mutex_lock(&mutex);
+
     SFLADD_ELEMENT(cs, &elem);
 
     sfl_poller_writeCountersSample(poller, cs);
@@ -607,6 +1326,7 @@ ops_sflow_set_polling_per_interface(int hw_unit, int hw_port,
     sfl_poller_set_sFlowCpInterval(poller, interval);
     sfl_poller_set_sFlowCpReceiver(poller, SFLOW_RECEIVER_INDEX);
     poller->lastPolled = time(NULL);
+    ops_sflow_poll_timer_set(&dsi, interval);
     /* store hw_unit and hw_port into a single uint32 to use in the callback.
      * take the 16 LSB from both and fit into the uint32
      */
@@ -637,11 +1357,13 @@ ops_sflow_set_polling_interval_on_lag_interface(struct ofbundle *lag_bundle,
     ovs_mutex_unlock(&mutex);
     ops_sflow_set_dsi_for_lag_interface(&dsi, aggregate_id);
 
+    ops_sflow_lag_update_members(lag_bundle);
     poller = sfl_agent_addPoller(ops_sflow_agent, &dsi, lag_bundle,
                                  ops_sflow_get_lag_counters);
     sfl_poller_set_sFlowCpInterval(poller, interval);
     sfl_poller_set_sFlowCpReceiver(poller, SFLOW_RECEIVER_INDEX);
     poller->lastPolled = time(NULL);
+    ops_sflow_poll_timer_set(&dsi, interval);
 }
 
 /**
@@ -665,6 +1387,7 @@ ops_sflow_remove_polling_on_lag_interface(struct ofbundle *lag_bundle)
 
     ops_sflow_set_dsi_for_lag_interface(&dsi, aggregate_id);
 
+    ops_sflow_poll_timer_set(&dsi, 0);
     sfl_agent_removePoller(ops_sflow_agent, &dsi);
 }
 
@@ -847,6 +1570,7 @@ ops_sflow_set_sampling_rate(const int unit, const int port,
                       EV_KV("error", "%s", opennsl_errmsg(rc)));
             return;
         }
+        ops_sflow_record_port_rate(unit, port, ingress_rate, egress_rate);
         /* sFlow needs the following explicit configuration on
            Tomahawk to sample ingress packets. This setting
            might not be supported on Trident2.
@@ -882,6 +1606,8 @@ ops_sflow_set_sampling_rate(const int unit, const int port,
                           EV_KV("error", "%s", opennsl_errmsg(rc)));
                 return;
             }
+            ops_sflow_record_port_rate(unit, fp_port, ingress_rate,
+                                       egress_rate);
             /* sFlow needs the following explicit configuration on
                Tomahawk to sample ingress packets. This setting
                might not be supported on Trident2.
@@ -953,10 +1679,311 @@ ops_sflow_set_header_size(const int size)
             log_event("SFLOW_SAMPLER_MISSING_FAILURE", NULL);
             return;
         }
+        if (size > SFLOW_MAX_HEADER_SIZE) {
+            VLOG_WARN("sFlow header size %d is larger than the %d bytes "
+                      "supported, sampled headers will be truncated",
+                      size, SFLOW_MAX_HEADER_SIZE);
+        }
         sfl_sampler_set_sFlowFsMaximumHeaderSize(sampler, size);
     }
 }
 
+/* Read the drop counter of the CPU queue sFlow samples are sent to. */
+static int
+ops_sflow_adapt_cpu_drops(int unit, uint64_t *drops)
+{
+    uint64 value;
+    int rc;
+
+    rc = opennsl_cosq_stat_get(unit, OPENNSL_GPORT_LOCAL_CPU,
+                               OPS_COPP_QOS_QUEUE_SFLOW,
+                               opennslCosqStatDroppedPackets, &value);
+    if (OPENNSL_FAILURE(rc)) {
+        VLOG_DBG("Failed to get sFlow CPU queue drops on unit %d (%s)",
+                 unit, opennsl_errmsg(rc));
+        return rc;
+    }
+    *drops = value;
+
+    return 0;
+}
+
+/* Returns the sampling rate in effect for the configuration, the library
+ * default when none is configured. */
+static uint32_t
+ops_sflow_configured_rate(void)
+{
+    if (sflow_options && sflow_options->sampling_rate) {
+        return sflow_options->sampling_rate;
+    }
+    return SFL_DEFAULT_SAMPLING_RATE;
+}
+
+/* Returns the new rate of one direction of a port. 'pps' is the sample
+ * rate seen on it during the last period and 'share' its fair part of the
+ * sample budget. */
+static uint32_t
+ops_sflow_adapt_next_rate(uint32_t rate, uint32_t pps, uint32_t share,
+                          bool hot, uint32_t min_rate, uint32_t max_rate)
+{
+    uint64_t next = rate;
+
+    if (sflow_adapt.pressure) {
+        if (hot) {
+            next = (uint64_t)rate * 2;
+        }
+    } else if ((uint64_t)sflow_adapt.samples_pps * 4
+               < sflow_adapt.target_pps && (uint64_t)pps * 2 <= share) {
+        /* Comfortably below the target: sample more often again. */
+        next = rate / 2;
+    }
+
+    return MIN(MAX(next, min_rate), max_rate);
+}
+
+/* One run of the adaptive sampling rate controller. */
+static void
+ops_sflow_adapt_run(long long int now)
+{
+    static struct {
+        uint32_t rate[2];           /* Ingress, egress. */
+        uint32_t samples[2];
+    } ports[MAX_SWITCH_UNITS][MAX_HW_PORTS];
+    struct ops_sflow_sample_pool *pool;
+    uint32_t min_rate, max_rate, share, pps, next[2];
+    uint64_t total = 0, drops, tx_drops;
+    long long int elapsed;
+    int n_active = 0, n_hot = 0;
+    int unit, port, dir, rc;
+
+    if (!sflow_adapt.enabled || !sflow_options
+        || now < sflow_adapt.last_run + SFLOW_ADAPT_PERIOD_MS) {
+        return;
+    }
+    elapsed = now - sflow_adapt.last_run;
+    sflow_adapt.last_run = now;
+
+    max_rate = sflow_adapt.max_rate;
+    min_rate = sflow_adapt.min_rate ? sflow_adapt.min_rate
+                                    : ops_sflow_configured_rate();
+    min_rate = MIN(min_rate, max_rate);
+
+    /* Collect the samples seen on each port since the last run. */
+    ovs_mutex_lock(&sample_pool_mutex);
+    for (unit = 0; unit < MAX_SWITCH_UNITS; unit++) {
+        for (port = 0; port < MAX_HW_PORTS; port++) {
+            pool = &sample_pool[unit][port];
+            ports[unit][port].rate[0] = pool->ingress_rate;
+            ports[unit][port].rate[1] = pool->egress_rate;
+            ports[unit][port].samples[0] = pool->rx_window;
+            ports[unit][port].samples[1] = pool->tx_window;
+            pool->rx_window = pool->tx_window = 0;
+        }
+    }
+    ovs_mutex_unlock(&sample_pool_mutex);
+
+    for (unit = 0; unit < MAX_SWITCH_UNITS; unit++) {
+        for (port = 0; port < MAX_HW_PORTS; port++) {
+            for (dir = 0; dir < 2; dir++) {
+                if (ports[unit][port].rate[dir]
+                    && ports[unit][port].samples[dir]) {
+                    total += ports[unit][port].samples[dir];
+                    n_active++;
+                }
+            }
+        }
+    }
+
+    /* Pressure signals: drops on the sFlow CPU queue and drops or backlog
+     * in the datagram transmit queue. */
+    sflow_adapt.cpu_drops_delta = 0;
+    for (unit = 0; unit < MAX_SWITCH_UNITS; unit++) {
+        if (!ops_sflow_adapt_cpu_drops(unit, &drops)) {
+            if (drops > sflow_adapt.cpu_drops[unit]) {
+                sflow_adapt.cpu_drops_delta +=
+                    drops - sflow_adapt.cpu_drops[unit];
+            }
+            sflow_adapt.cpu_drops[unit] = drops;
+        }
+    }
+
+    ovs_mutex_lock(&tx_mutex);
+    tx_drops = tx_queue_drops;
+    sflow_adapt.tx_depth = tx_batches[tx_active_batch].count;
+    ovs_mutex_unlock(&tx_mutex);
+    sflow_adapt.tx_drops_delta = tx_drops >= sflow_adapt.tx_drops
+                                 ? tx_drops - sflow_adapt.tx_drops : 0;
+    sflow_adapt.tx_drops = tx_drops;
+
+    sflow_adapt.samples_pps = total * 1000 / MAX(elapsed, 1);
+    sflow_adapt.pressure = sflow_adapt.samples_pps > sflow_adapt.target_pps
+                           || sflow_adapt.cpu_drops_delta
+                           || sflow_adapt.tx_drops_delta
+                           || sflow_adapt.tx_depth >= SFLOW_TX_QUEUE_LEN / 2;
+
+    /* Under pressure, slow down the ports using more than their share of
+     * the budget. If no port stands out, slow down all the active ones. */
+    share = sflow_adapt.target_pps / MAX(n_active, 1);
+    for (unit = 0; unit < MAX_SWITCH_UNITS; unit++) {
+        for (port = 0; port < MAX_HW_PORTS; port++) {
+            for (dir = 0; dir < 2; dir++) {
+                pps = ports[unit][port].samples[dir] * 1000 / MAX(elapsed, 1);
+                if (ports[unit][port].rate[dir] && pps >= share && pps) {
+                    n_hot++;
+                }
+            }
+        }
+    }
+
+    for (unit = 0; unit < MAX_SWITCH_UNITS; unit++) {
+        for (port = 0; port < MAX_HW_PORTS; port++) {
+            bool changed = false;
+
+            for (dir = 0; dir < 2; dir++) {
+                uint32_t rate = ports[unit][port].rate[dir];
+                bool hot;
+
+                next[dir] = rate;
+                if (!rate) {
+                    continue;
+                }
+                pps = ports[unit][port].samples[dir] * 1000 / MAX(elapsed, 1);
+                hot = n_hot ? pps >= share && pps
+                            : ports[unit][port].samples[dir] != 0;
+                next[dir] = ops_sflow_adapt_next_rate(rate, pps, share, hot,
+                                                      min_rate, max_rate);
+                if (next[dir] != rate) {
+                    changed = true;
+                }
+            }
+            if (!changed) {
+                continue;
+            }
+
+            rc = opennsl_port_sample_rate_set(unit, port, next[0], next[1]);
+            if (OPENNSL_FAILURE(rc)) {
+                VLOG_ERR("Failed to set sampling rate on port: %d, (error-%s).",
+                         port, opennsl_errmsg(rc));
+                log_event("SFLOW_SET_SAMPLING_RATE_FAILURE",
+                          EV_KV("port", "%d", port),
+                          EV_KV("error", "%s", opennsl_errmsg(rc)));
+                continue;
+            }
+            ops_sflow_record_port_rate(unit, port, next[0], next[1]);
+
+            for (dir = 0; dir < 2; dir++) {
+                if (next[dir] > ports[unit][port].rate[dir]) {
+                    sflow_adapt.n_increases++;
+                } else if (next[dir] < ports[unit][port].rate[dir]) {
+                    sflow_adapt.n_decreases++;
+                }
+            }
+            VLOG_DBG("Adaptive sampling: port %d ingress %u -> %u, "
+                     "egress %u -> %u", port, ports[unit][port].rate[0],
+                     next[0], ports[unit][port].rate[1], next[1]);
+        }
+    }
+}
+
+/* Enables or disables the adaptive rate controller. Disabling it puts the
+ * configured rate back on all the ports. */
+static void
+ops_sflow_adapt_set(bool enable, uint32_t target_pps, uint32_t min_rate,
+                    uint32_t max_rate)
+{
+    bool was_enabled = sflow_adapt.enabled;
+
+    sflow_adapt.enabled = enable;
+    sflow_adapt.target_pps = target_pps;
+    sflow_adapt.min_rate = min_rate;
+    sflow_adapt.max_rate = max_rate;
+    sflow_adapt.last_run = time_msec();
+
+    if (was_enabled && !enable && ops_sflow_agent && sflow_options) {
+        ops_sflow_set_sampling_rate(0, 0, ops_sflow_configured_rate(),
+                                    ops_sflow_configured_rate());
+    }
+}
+
+static void
+ops_sflow_adaptive_rate(struct unixctl_conn *conn, int argc,
+                        const char *argv[], void *aux OVS_UNUSED)
+{
+    struct ds ds = DS_EMPTY_INITIALIZER;
+    struct ops_sflow_sample_pool *pool;
+    uint32_t target_pps = SFLOW_ADAPT_DFLT_TARGET_PPS;
+    uint32_t min_rate = 0, max_rate = SFLOW_ADAPT_DFLT_MAX_RATE;
+    int unit, port;
+
+    if (argc > 1) {
+        if (!strcmp(argv[1], "disable")) {
+            ops_sflow_adapt_set(false, sflow_adapt.target_pps,
+                                sflow_adapt.min_rate, sflow_adapt.max_rate);
+        } else if (!strcmp(argv[1], "enable")) {
+            if (argc > 2) {
+                target_pps = strtoul(argv[2], NULL, 10);
+            }
+            if (argc > 3) {
+                min_rate = strtoul(argv[3], NULL, 10);
+            }
+            if (argc > 4) {
+                max_rate = strtoul(argv[4], NULL, 10);
+            }
+            if (!target_pps || !max_rate || max_rate > INT_MAX
+                || min_rate > max_rate) {
+                unixctl_command_reply_error(conn, "Invalid controller "
+                                            "parameters");
+                return;
+            }
+            ops_sflow_adapt_set(true, target_pps, min_rate, max_rate);
+        } else {
+            unixctl_command_reply_error(conn, "Unknown option");
+            return;
+        }
+    }
+
+    ds_put_format(&ds, "Adaptive sampling rate: %s\n",
+                  sflow_adapt.enabled ? "enabled" : "disabled");
+    if (!sflow_adapt.enabled) {
+        unixctl_command_reply(conn, ds_cstr(&ds));
+        ds_destroy(&ds);
+        return;
+    }
+
+    ds_put_format(&ds, "  target: %u samples/s, rate bounds: ",
+                  sflow_adapt.target_pps);
+    if (sflow_adapt.min_rate) {
+        ds_put_format(&ds, "%u", sflow_adapt.min_rate);
+    } else {
+        ds_put_format(&ds, "configured");
+    }
+    ds_put_format(&ds, " - %u\n", sflow_adapt.max_rate);
+    ds_put_format(&ds, "  last period: %u samples/s, sflow cpu queue drops "
+                  "%"PRIu64", tx queue depth %d, tx queue drops %"PRIu64
+                  "%s\n", sflow_adapt.samples_pps,
+                  sflow_adapt.cpu_drops_delta, sflow_adapt.tx_depth,
+                  sflow_adapt.tx_drops_delta,
+                  sflow_adapt.pressure ? " (pressure)" : "");
+    ds_put_format(&ds, "  rate increases: %"PRIu64", decreases: %"PRIu64
+                  "\n\n", sflow_adapt.n_increases, sflow_adapt.n_decreases);
+
+    ds_put_format(&ds, "%-8s %-12s %-12s\n", "Port", "Ingress", "Egress");
+    ovs_mutex_lock(&sample_pool_mutex);
+    for (unit = 0; unit < MAX_SWITCH_UNITS; unit++) {
+        for (port = 0; port < MAX_HW_PORTS; port++) {
+            pool = &sample_pool[unit][port];
+            if (pool->ingress_rate || pool->egress_rate) {
+                ds_put_format(&ds, "%-8d %-12u %-12u\n", port,
+                              pool->ingress_rate, pool->egress_rate);
+            }
+        }
+    }
+    ovs_mutex_unlock(&sample_pool_mutex);
+
+    unixctl_command_reply(conn, ds_cstr(&ds));
+    ds_destroy(&ds);
+}
+
 static void
 ops_sflow_set_rate(struct unixctl_conn *conn, int argc, const char *argv[],
                    void *aux OVS_UNUSED)
@@ -1308,8 +2335,10 @@ ops_sflow_agent_disable(struct bcmsdk_provider_node *ofproto)
         }
 
         /* Delete sFlow Agent */
+        ops_sflow_poll_timer_clear_all();
         sfl_agent_release(ops_sflow_agent);
         ops_sflow_agent = NULL;
+        ops_sflow_tx_clear();
     }
 }
 
@@ -1430,26 +2459,28 @@ ops_sflow_set_collector_ip(const char *ip, const char *port)
     VLOG_DBG("Set IP/port (%s/%d) on receiver", ip, portN);
 }
 
-/* Configure the collectors */
+/* Configure the collectors. Each target is resolved once here into the
+ * destination address used by the transmit stage. Returns 0 on success,
+ * otherwise the error of the last target that could not be configured;
+ * the valid targets are configured in any case. */
 int
 ops_sflow_set_collectors(struct sset *ops_targets)
 {
-    int ret;
+    int ret = 0;
     char *port, *vrf;
-    struct sset targets;
-    int target_count = 0;
     const char *collector_ip;
-    char buf[IPV6_BUFFER_LEN + PORT_BUF_LEN + 5]; /* 5 for the separators */
+    struct ops_sflow_collector *c;
+    struct sockaddr_in *sin;
+    struct sockaddr_in6 *sin6;
+    bool valid;
 
     if (!ops_targets) {
         return -1;
     }
 
-    sset_init(&targets);
-    collectors_destroy(sflow_collectors);
-    /* ops_targets is in the form <IP>/<port>.
-     * need to convert it to <IP>:<port> as expected by collectors util.
-     */
+    memset(sflow_collectors, 0, sizeof sflow_collectors);
+    n_sflow_collectors = 0;
+
     /* Collector ip -- could be of form ip/port/vrf */
     SSET_FOR_EACH(collector_ip, ops_targets) {
         char *tmp_ip = xstrdup(collector_ip); /* so we don't modify ops_targets */
@@ -1466,17 +2497,76 @@ ops_sflow_set_collectors(struct sset *ops_targets)
             port = SFLOW_COLLECTOR_DFLT_PORT;
         }
 
-        snprintf(buf, IPV6_BUFFER_LEN + PORT_BUF_LEN + 5 - 1,
-                 "[%s]:[%s]", tmp_ip, port);
-        sset_add(&targets, buf);
+        if (n_sflow_collectors >= SFLOW_MAX_COLLECTORS) {
+            VLOG_ERR("sflow: too many collectors, ignoring '%s'", collector_ip);
+            free(tmp_ip);
+            ret = EINVAL;
+            continue;
+        }
+
+        c = &sflow_collectors[n_sflow_collectors];
+        if (strchr(tmp_ip, ':')) {
+            sin6 = (struct sockaddr_in6 *)&c->addr;
+            sin6->sin6_family = AF_INET6;
+            sin6->sin6_port = htons(atoi(port));
+            valid = (inet_pton(AF_INET6, tmp_ip, &sin6->sin6_addr) == 1);
+            c->addr_len = sizeof *sin6;
+        } else {
+            sin = (struct sockaddr_in *)&c->addr;
+            sin->sin_family = AF_INET;
+            sin->sin_port = htons(atoi(port));
+            valid = (inet_pton(AF_INET, tmp_ip, &sin->sin_addr) == 1);
+            c->addr_len = sizeof *sin;
+        }
+
+        if (!valid) {
+            VLOG_ERR("sflow: invalid collector address '%s'", collector_ip);
+            memset(c, 0, sizeof *c);
+            free(tmp_ip);
+            ret = EINVAL;
+            continue;
+        }
+
+        snprintf(c->name, sizeof c->name, "[%s]:[%s]", tmp_ip, port);
         free(tmp_ip);
-        VLOG_DBG("sflow: adding collector [%d] : '%s'", target_count++, buf);
+        VLOG_DBG("sflow: adding collector [%d] : '%s'",
+                 n_sflow_collectors, c->name);
+        n_sflow_collectors++;
+    }
+
+    if (n_sflow_collectors && sflow_tx_fd_v4 < 0) {
+        sflow_tx_fd_v4 = ops_sflow_tx_socket(AF_INET);
+    }
+    if (n_sflow_collectors && sflow_tx_fd_v6 < 0) {
+        sflow_tx_fd_v6 = ops_sflow_tx_socket(AF_INET6);
     }
-    ret = collectors_create(&targets, atoi(SFLOW_COLLECTOR_DFLT_PORT),
-                            &sflow_collectors);
     return ret;
 }
 
+static void
+ops_sflow_show_collectors(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                          const char *argv[] OVS_UNUSED, void *aux OVS_UNUSED)
+{
+    struct ds ds = DS_EMPTY_INITIALIZER;
+    struct ops_sflow_collector *c;
+    int i;
+
+    ds_put_format(&ds, "%-40s %12s %16s %10s\n", "Collector", "Datagrams",
+                  "Bytes", "Errors");
+    for (i = 0; i < n_sflow_collectors; i++) {
+        c = &sflow_collectors[i];
+        ds_put_format(&ds, "%-40s %12"PRIu64" %16"PRIu64" %10"PRIu64"\n",
+                      c->name, c->tx_packets, c->tx_bytes, c->tx_errors);
+    }
+    ovs_mutex_lock(&tx_mutex);
+    ds_put_format(&ds, "Datagrams dropped (transmit queue full): %"PRIu64"\n",
+                  tx_queue_drops);
+    ovs_mutex_unlock(&tx_mutex);
+
+    unixctl_command_reply(conn, ds_cstr(&ds));
+    ds_destroy(&ds);
+}
+
 /* This function creates a receiver and sets an IP for it. */
 static void
 ops_sflow_collector(struct unixctl_conn *conn, int argc, const char *argv[],
@@ -1547,12 +2637,114 @@ done:
     unixctl_command_reply(conn, '\0');
 }
 
+/* Build sampled headers out of synthetic multi-block packets, verify them
+ * against the expected bytes and report the builder throughput. */
+void
+ops_sflow_header_bench(struct ds *ds, int iterations)
+{
+    /* Block layouts of the synthetic packets. A block boundary falls
+     * inside the MACs, inside the VLAN tag and right after it. */
+    static const int blk_layouts[][3] = {
+        { 200, 0, 0 },
+        { 5, 10, 185 },
+        { 14, 2, 184 },
+        { 16, 64, 120 },
+    };
+    uint8_t frame[200], expected[200], out[SFLOW_MAX_HEADER_SIZE];
+    opennsl_pkt_blk_t blks[3];
+    opennsl_pkt_t pkt;
+    long long int start, elapsed;
+    uint32_t len, exp_len, offset;
+    int i, j, n, failed = 0;
+
+    for (i = 0; i < sizeof frame; i++) {
+        frame[i] = (uint8_t)i;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(blk_layouts); i++) {
+        memset(&pkt, 0, sizeof pkt);
+        pkt.pkt_data = blks;
+        offset = 0;
+        for (j = 0; j < 3 && blk_layouts[i][j]; j++) {
+            blks[j].data = frame + offset;
+            blks[j].len = blk_layouts[i][j];
+            offset += blk_layouts[i][j];
+        }
+        pkt.blk_count = j;
+        pkt.pkt_len = pkt.tot_len = sizeof frame;
+
+        for (n = 0; n < 2; n++) {
+            bool strip = (n == 1);
+
+            /* Expected header: MACs, then the rest of the frame with the
+             * VLAN tag optionally removed. */
+            memcpy(expected, frame, 2 * ETHER_ADDR_LEN);
+            exp_len = sizeof frame - (strip ? VLAN_HEADER_SIZE : 0);
+            memcpy(expected + 2 * ETHER_ADDR_LEN,
+                   frame + 2 * ETHER_ADDR_LEN +
+                   (strip ? VLAN_HEADER_SIZE : 0),
+                   exp_len - 2 * ETHER_ADDR_LEN);
+            exp_len = MIN(exp_len, SFL_DEFAULT_HEADER_SIZE);
+
+            len = ops_sflow_build_sample_header(&pkt, strip, out,
+                                                SFL_DEFAULT_HEADER_SIZE);
+            if (len != exp_len || memcmp(out, expected, len)) {
+                ds_put_format(ds, "FAIL: layout %d strip_vlan %d "
+                              "(len %u, expected %u)\n",
+                              i, strip, len, exp_len);
+                failed++;
+            }
+            /* Source packet must be left untouched. */
+            for (j = 0; j < sizeof frame; j++) {
+                if (frame[j] != (uint8_t)j) {
+                    ds_put_format(ds, "FAIL: layout %d modified the "
+                                  "packet buffer\n", i);
+                    failed++;
+                    break;
+                }
+            }
+        }
+    }
+    ds_put_format(ds, "Header builder checks: %s\n",
+                  failed ? "FAILED" : "passed");
+
+    /* Throughput of the worst case layout (3 blocks, VLAN stripped). */
+    pkt.pkt_data = blks;
+    blks[0].data = frame;
+    blks[0].len = 5;
+    blks[1].data = frame + 5;
+    blks[1].len = 10;
+    blks[2].data = frame + 15;
+    blks[2].len = sizeof frame - 15;
+    pkt.blk_count = 3;
+    start = time_msec();
+    for (i = 0; i < iterations; i++) {
+        ops_sflow_build_sample_header(&pkt, true, out,
+                                      SFL_DEFAULT_HEADER_SIZE);
+    }
+    elapsed = time_msec() - start;
+    ds_put_format(ds, "%d headers of %d bytes built in %lld ms",
+                  iterations, SFL_DEFAULT_HEADER_SIZE, elapsed);
+    if (elapsed > 0) {
+        ds_put_format(ds, " (%lld headers/s)",
+                      (long long int)iterations * 1000 / elapsed);
+    }
+    ds_put_format(ds, "\n");
+
+    ovs_mutex_lock(&mutex);
+    ds_put_format(ds, "Sampled headers truncated to %d bytes: %"PRIu64"\n",
+                  SFLOW_MAX_HEADER_SIZE, sample_header_truncated);
+    ovs_mutex_unlock(&mutex);
+}
+
 static void sflow_main()
 {
     unixctl_command_register("sflow/set-rate", "[port-id | global] ingress-rate egress-rate", 2, 3, ops_sflow_set_rate, NULL);
     unixctl_command_register("sflow/show-rate", "[port-id]", 0 , 1, ops_sflow_show, NULL);
     unixctl_command_register("sflow/set-collector-ip", "collector-ip [port]", 1 , 2, ops_sflow_collector, NULL);
     unixctl_command_register("sflow/send-test-pkt", "collector-ip [port]", 1 , 2, ops_sflow_send_test_pkt, NULL);
+    unixctl_command_register("sflow/show-collectors", "", 0 , 0, ops_sflow_show_collectors, NULL);
+    unixctl_command_register("sflow/adaptive-rate", "[enable [target-pps [min-rate [max-rate]]] | disable]", 0 , 4, ops_sflow_adaptive_rate, NULL);
 }
 
 void
@@ -1560,34 +2752,20 @@ ops_sflow_run(struct bcmsdk_provider_node *ofproto)
 {
 
     time_t now;
-    SFLPoller *pl;
     SFLReceiver *rcv;
-    SFL_COUNTERS_SAMPLE_TYPE cs;
 
     if (ops_sflow_agent) {
         now = time(NULL);
-        pl = ops_sflow_agent->pollers;
         /* Set the current time in the sFlow agent to calculate and set
          * 'sysUpTime' field in the sFlow datagram. */
         ops_sflow_agent->now = now;
-        for(; pl != NULL; pl = pl->nxt) {
-            if ((pl->countersCountdown == 0) ||
-                (pl->sFlowCpReceiver == 0) ||
-                (!pl->getCountersFn)) {
-                continue;
-            }
-            if ((now - pl->lastPolled) >= pl->countersCountdown) {
-                memset(&cs, 0, sizeof(cs));
-                pl->getCountersFn(pl->magic, pl, &cs);
-                pl->lastPolled = now;
-                /* after the first random distribution, reset everyone to
-                 * configured polling interval.
-                 */
-                if (pl->countersCountdown != pl->sFlowCpInterval) {
-                    pl->countersCountdown = pl->sFlowCpInterval;
-                }
-            }
-        }
+
+        /* Run the counter pollers whose timers expired. */
+        ops_sflow_poll_wheel_run(now);
+
+        /* Adjust the port sampling rates to the load, if enabled. */
+        ops_sflow_adapt_run(time_msec());
+
         /*
          * A mutex lock/unlock is needed before calling the sflow_receiver_tick
          * which flushes the receiver and sends the packets to the sFlow
@@ -1603,6 +2781,40 @@ ops_sflow_run(struct bcmsdk_provider_node *ofproto)
             sfl_receiver_tick(rcv, now);
         }
         ovs_mutex_unlock(&mutex);
+
+        /* Send the datagrams flushed above, or by the RX path, to the
+         * collectors outside of the sFlow mutex. */
+        ops_sflow_tx_flush();
+    }
+}
+
+/* Wake up the main loop for queued datagrams, for the next tick that has a
+ * poller timer, and for the next run of the adaptive rate controller. */
+void
+ops_sflow_wait(void)
+{
+    long long int tick;
+
+    if (!ops_sflow_agent) {
+        return;
+    }
+
+    ops_sflow_tx_wait();
+
+    if (sflow_adapt.enabled) {
+        poll_timer_wait_until(sflow_adapt.last_run + SFLOW_ADAPT_PERIOD_MS);
+    }
+
+    if (hmap_is_empty(&poll_timers)) {
+        return;
+    }
+
+    for (tick = poll_wheel_tick + 1;
+         tick <= poll_wheel_tick + SFLOW_POLL_WHEEL_SLOTS; tick++) {
+        if (!list_is_empty(&poll_wheel[tick % SFLOW_POLL_WHEEL_SLOTS])) {
+            poll_timer_wait_until(tick * SFLOW_POLL_TICK_MS);
+            return;
+        }
     }
 }
 
@@ -1612,6 +2824,16 @@ ops_sflow_run(struct bcmsdk_provider_node *ofproto)
 int
 ops_sflow_init (int unit OVS_UNUSED)
 {
+    int i;
+
+    for (i = 0; i < SFLOW_POLL_WHEEL_SLOTS; i++) {
+        list_init(&poll_wheel[i]);
+    }
+
+    if (!tx_seq) {
+        tx_seq = seq_create();
+    }
+
     /* TODO: Make this in to a thread so as to read messages from callback
      * function in Rx thread. */
     sflow_main();
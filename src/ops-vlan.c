@@ -21,8 +21,11 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <openvswitch/vlog.h>
+#include <ovs/util.h>
+#include <ovs/bitmap.h>
 #include <opennsl/error.h>
 #include <opennsl/types.h>
 #include <opennsl/port.h>
@@ -34,6 +37,7 @@
 #include "ops-port.h"
 #include "ops-vlan.h"
 #include "eventlog.h"
+#include "timeval.h"
 
 VLOG_DEFINE_THIS_MODULE(ops_vlan);
 
@@ -565,6 +569,80 @@ free_vlan_data(int vid, bool internal)
 
 } // free_vlan_data
 
+// Reverse index of the configured VLAN memberships of each port, by role,
+// so that a link change only visits the VLANs the port belongs to instead
+// of scanning all the VLANs. It mirrors the cfg_*_ports bitmaps of the
+// (non internal) VLANs.
+typedef enum ops_vlan_role {
+    OPS_VLAN_ROLE_ACCESS,
+    OPS_VLAN_ROLE_TRUNK,
+    OPS_VLAN_ROLE_NATIVE_TAG,
+    OPS_VLAN_ROLE_NATIVE_UNTAG,
+    OPS_VLAN_ROLE_SUBINTERFACE,
+    OPS_VLAN_ROLE_COUNT
+} ops_vlan_role_t;
+
+static const char *ops_vlan_role_names[OPS_VLAN_ROLE_COUNT] = {
+    "access", "trunk", "native tagged", "native untagged", "subinterface"
+};
+
+typedef struct ops_vlan_port_index {
+    unsigned long vids[OPS_VLAN_ROLE_COUNT][BITMAP_N_LONGS(OPS_VLAN_COUNT)];
+} ops_vlan_port_index_t;
+
+// Allocated on the first membership of a port.
+static ops_vlan_port_index_t *ops_vlan_port_index[MAX_SWITCH_UNITS][MAX_HW_PORTS];
+
+static void
+vlan_port_index_update(int unit, int vid, ops_vlan_role_t role,
+                       opennsl_pbmp_t pbm, bool add)
+{
+    opennsl_port_t hw_port;
+    ops_vlan_port_index_t *index;
+
+    OPENNSL_PBMP_ITER(pbm, hw_port) {
+        if (hw_port < 0 || hw_port >= MAX_HW_PORTS) {
+            continue;
+        }
+
+        index = ops_vlan_port_index[unit][hw_port];
+        if (!index) {
+            if (!add) {
+                continue;
+            }
+            index = xzalloc(sizeof *index);
+            ops_vlan_port_index[unit][hw_port] = index;
+        }
+        bitmap_set(index->vids[role], vid, add);
+    }
+
+} // vlan_port_index_update
+
+// Get the VLANs a port is configured in, in any role.  Returns false
+// if the port is not a member of any VLAN.
+static bool
+vlan_port_index_get(int unit, opennsl_port_t hw_port, unsigned long *vids)
+{
+    int role, i;
+    ops_vlan_port_index_t *index;
+
+    if (hw_port < 0 || hw_port >= MAX_HW_PORTS ||
+        !ops_vlan_port_index[unit][hw_port]) {
+        return false;
+    }
+
+    index = ops_vlan_port_index[unit][hw_port];
+    memcpy(vids, index->vids[0], sizeof index->vids[0]);
+    for (role = 1; role < OPS_VLAN_ROLE_COUNT; role++) {
+        for (i = 0; i < BITMAP_N_LONGS(OPS_VLAN_COUNT); i++) {
+            vids[i] |= index->vids[role][i];
+        }
+    }
+
+    return true;
+
+} // vlan_port_index_get
+
 //////////////////////////////// Public API //////////////////////////////
 
 int
@@ -716,6 +794,10 @@ bcmsdk_destroy_vlan(int vid, bool internal)
             if (OPENNSL_PBMP_NOT_NULL(bcm_pbm)) {
                 hw_del_ports_from_vlan(unit, bcm_pbm, bcm_pbm, vid, 1);
                 OPENNSL_PBMP_CLEAR(vlanp->hw_access_ports[unit]);
+                if (!internal) {
+                    vlan_port_index_update(unit, vid, OPS_VLAN_ROLE_ACCESS,
+                                           vlanp->cfg_access_ports[unit], false);
+                }
                 OPENNSL_PBMP_CLEAR(vlanp->cfg_access_ports[unit]);
             }
 
@@ -723,6 +805,10 @@ bcmsdk_destroy_vlan(int vid, bool internal)
             if (OPENNSL_PBMP_NOT_NULL(bcm_pbm)) {
                 hw_del_ports_from_vlan(unit, bcm_pbm, g_empty_pbm, vid, 0);
                 OPENNSL_PBMP_CLEAR(vlanp->hw_trunk_ports[unit]);
+                if (!internal) {
+                    vlan_port_index_update(unit, vid, OPS_VLAN_ROLE_TRUNK,
+                                           vlanp->cfg_trunk_ports[unit], false);
+                }
                 OPENNSL_PBMP_CLEAR(vlanp->cfg_trunk_ports[unit]);
             }
 
@@ -730,6 +816,10 @@ bcmsdk_destroy_vlan(int vid, bool internal)
             if (OPENNSL_PBMP_NOT_NULL(bcm_pbm)) {
                 hw_del_ports_from_vlan(unit, bcm_pbm, g_empty_pbm, vid, 0);
                 OPENNSL_PBMP_CLEAR(vlanp->hw_native_tag_ports[unit]);
+                if (!internal) {
+                    vlan_port_index_update(unit, vid, OPS_VLAN_ROLE_NATIVE_TAG,
+                                           vlanp->cfg_native_tag_ports[unit], false);
+                }
                 OPENNSL_PBMP_CLEAR(vlanp->cfg_native_tag_ports[unit]);
 
                 // Clear native VLAN on the ports.
@@ -740,6 +830,10 @@ bcmsdk_destroy_vlan(int vid, bool internal)
             if (OPENNSL_PBMP_NOT_NULL(bcm_pbm)) {
                 hw_del_ports_from_vlan(unit, bcm_pbm, bcm_pbm, vid, 0);
                 OPENNSL_PBMP_CLEAR(vlanp->hw_native_untag_ports[unit]);
+                if (!internal) {
+                    vlan_port_index_update(unit, vid, OPS_VLAN_ROLE_NATIVE_UNTAG,
+                                           vlanp->cfg_native_untag_ports[unit], false);
+                }
                 OPENNSL_PBMP_CLEAR(vlanp->cfg_native_untag_ports[unit]);
             }
 
@@ -749,6 +843,12 @@ bcmsdk_destroy_vlan(int vid, bool internal)
                    subinterface bitmap */
                 hw_add_ports_to_vlan(unit, bcm_pbm, g_empty_pbm, vid, 0);
                 vlanp->hw_trunk_ports[unit] = bcm_pbm;
+                if (!internal) {
+                    vlan_port_index_update(unit, vid, OPS_VLAN_ROLE_TRUNK,
+                                           vlanp->cfg_trunk_ports[unit], false);
+                    vlan_port_index_update(unit, vid, OPS_VLAN_ROLE_TRUNK,
+                                           bcm_pbm, true);
+                }
                 vlanp->cfg_trunk_ports[unit] = bcm_pbm;
                 /* we should not destroy the vlan as subinterface
                    is part of the vlan. So just continue and skip the
@@ -801,6 +901,7 @@ bcmsdk_add_access_ports(int vid, opennsl_pbmp_t *pbm)
         // Save access port membership info.
         bcm_pbm = pbm[unit];
         OPENNSL_PBMP_OR(vlanp->cfg_access_ports[unit], bcm_pbm);
+        vlan_port_index_update(unit, vid, OPS_VLAN_ROLE_ACCESS, bcm_pbm, true);
 
         // Filter out ports that are not linked up.
         OPENNSL_PBMP_AND(bcm_pbm, ops_get_link_up_pbm(unit));
@@ -834,6 +935,8 @@ bcmsdk_del_access_ports(int vid, opennsl_pbmp_t *pbm)
             // Update access port membership info.
             bcm_pbm = pbm[unit];
             OPENNSL_PBMP_REMOVE(vlanp->cfg_access_ports[unit], bcm_pbm);
+            vlan_port_index_update(unit, vid, OPS_VLAN_ROLE_ACCESS, bcm_pbm,
+                                   false);
 
             // Only need to worry about ports that are actually
             // configured in h/w.
@@ -891,6 +994,7 @@ bcmsdk_add_trunk_ports(int vid, opennsl_pbmp_t *pbm)
         // Save trunk port membership info.
         bcm_pbm = pbm[unit];
         OPENNSL_PBMP_OR(vlanp->cfg_trunk_ports[unit], bcm_pbm);
+        vlan_port_index_update(unit, vid, OPS_VLAN_ROLE_TRUNK, bcm_pbm, true);
 
         // Filter out ports that are not linked up.
         OPENNSL_PBMP_AND(bcm_pbm, ops_get_link_up_pbm(unit));
@@ -941,6 +1045,8 @@ bcmsdk_add_subinterface_ports(int vid, opennsl_pbmp_t *pbm)
         /* Save subinterface port membership info. */
         bcm_pbm = pbm[unit];
         OPENNSL_PBMP_OR(vlanp->cfg_subinterface_ports[unit], bcm_pbm);
+        vlan_port_index_update(unit, vid, OPS_VLAN_ROLE_SUBINTERFACE, bcm_pbm,
+                               true);
 
         /* Filter out ports that are not linked up. */
         OPENNSL_PBMP_AND(bcm_pbm, ops_get_link_up_pbm(unit));
@@ -974,6 +1080,8 @@ bcmsdk_del_subinterface_ports(int vid, opennsl_pbmp_t *pbm)
             /* Update subinterface port membership info.*/
             bcm_pbm = pbm[unit];
             OPENNSL_PBMP_REMOVE(vlanp->cfg_subinterface_ports[unit], bcm_pbm);
+            vlan_port_index_update(unit, vid, OPS_VLAN_ROLE_SUBINTERFACE,
+                                   bcm_pbm, false);
 
             /* Only need to worry about ports that are actually
                configured in h/w.*/
@@ -1013,6 +1121,8 @@ bcmsdk_del_trunk_ports(int vid, opennsl_pbmp_t *pbm)
             // Update trunk port membership info.
             bcm_pbm = pbm[unit];
             OPENNSL_PBMP_REMOVE(vlanp->cfg_trunk_ports[unit], bcm_pbm);
+            vlan_port_index_update(unit, vid, OPS_VLAN_ROLE_TRUNK, bcm_pbm,
+                                   false);
 
             // Only need to worry about ports that are actually
             // configured in h/w.
@@ -1066,6 +1176,8 @@ bcmsdk_add_native_tagged_ports(int vid, opennsl_pbmp_t *pbm)
         // Save native tagged port membership info.
         bcm_pbm = pbm[unit];
         OPENNSL_PBMP_OR(vlanp->cfg_native_tag_ports[unit], bcm_pbm);
+        vlan_port_index_update(unit, vid, OPS_VLAN_ROLE_NATIVE_TAG, bcm_pbm,
+                               true);
 
         // Filter out ports that are not linked up.
         OPENNSL_PBMP_AND(bcm_pbm, ops_get_link_up_pbm(unit));
@@ -1101,6 +1213,8 @@ bcmsdk_del_native_tagged_ports(int vid, opennsl_pbmp_t *pbm)
             // Update native tagged port membership info.
             bcm_pbm = pbm[unit];
             OPENNSL_PBMP_REMOVE(vlanp->cfg_native_tag_ports[unit], bcm_pbm);
+            vlan_port_index_update(unit, vid, OPS_VLAN_ROLE_NATIVE_TAG,
+                                   bcm_pbm, false);
 
             // Only need to worry about ports that are actually
             // configured in h/w.
@@ -1152,6 +1266,10 @@ bcmsdk_add_native_untagged_ports(int vid, opennsl_pbmp_t *pbm, bool internal)
         // Save native untagged port membership info.
         bcm_pbm = pbm[unit];
         OPENNSL_PBMP_OR(vlanp->cfg_native_untag_ports[unit], bcm_pbm);
+        if (!internal) {
+            vlan_port_index_update(unit, vid, OPS_VLAN_ROLE_NATIVE_UNTAG,
+                                   bcm_pbm, true);
+        }
 
         // Filter out ports that are not linked up.
         if (!internal) {
@@ -1190,6 +1308,10 @@ bcmsdk_del_native_untagged_ports(int vid, opennsl_pbmp_t *pbm, bool internal)
             // Update native untagged port membership info.
             bcm_pbm = pbm[unit];
             OPENNSL_PBMP_REMOVE(vlanp->cfg_native_untag_ports[unit], bcm_pbm);
+            if (!internal) {
+                vlan_port_index_update(unit, vid, OPS_VLAN_ROLE_NATIVE_UNTAG,
+                                       bcm_pbm, false);
+            }
 
             // Only need to worry about ports that are actually
             // configured in h/w.
@@ -1212,77 +1334,212 @@ bcmsdk_del_native_untagged_ports(int vid, opennsl_pbmp_t *pbm, bool internal)
 
 } // bcmsdk_del_native_untagged_ports
 
+static void
+vlan_reconfig_port_on_vlan(int unit, opennsl_port_t hw_port, opennsl_pbmp_t pbm,
+                           ops_vlan_data_t *vlanp, int link_is_up)
+{
+    int vid = vlanp->vid;
+
+    if (link_is_up) {
+        // Link has come up.
+        if (OPENNSL_PBMP_MEMBER(vlanp->cfg_access_ports[unit], hw_port)) {
+            hw_add_ports_to_vlan(unit, pbm, pbm, vid, 1);
+            OPENNSL_PBMP_OR(vlanp->hw_access_ports[unit], pbm);
+
+        } else if (OPENNSL_PBMP_MEMBER(vlanp->cfg_trunk_ports[unit], hw_port)) {
+            hw_add_ports_to_vlan(unit, pbm, g_empty_pbm, vid, 0);
+            OPENNSL_PBMP_OR(vlanp->hw_trunk_ports[unit], pbm);
+
+        } else if (OPENNSL_PBMP_MEMBER(vlanp->cfg_native_tag_ports[unit], hw_port)) {
+            hw_add_ports_to_vlan(unit, pbm, g_empty_pbm, vid, 0);
+            OPENNSL_PBMP_OR(vlanp->hw_native_tag_ports[unit], pbm);
+            native_vlan_set(unit, vid, pbm, 0);
+
+        } else if (OPENNSL_PBMP_MEMBER(vlanp->cfg_native_untag_ports[unit], hw_port)) {
+            hw_add_ports_to_vlan(unit, pbm, pbm, vid, 0);
+            OPENNSL_PBMP_OR(vlanp->hw_native_untag_ports[unit], pbm);
+
+        }
+
+        if (OPENNSL_PBMP_MEMBER(vlanp->cfg_subinterface_ports[unit], hw_port)) {
+            hw_add_ports_to_vlan(unit, pbm, g_empty_pbm, vid, 0);
+            OPENNSL_PBMP_OR(vlanp->hw_subinterface_ports[unit], pbm);
+        }
+    } else {
+        // Link has gone down.
+        if (OPENNSL_PBMP_MEMBER(vlanp->hw_access_ports[unit], hw_port)) {
+            hw_del_ports_from_vlan(unit, pbm, pbm, vid, 1);
+            OPENNSL_PBMP_PORT_REMOVE(vlanp->hw_access_ports[unit], hw_port);
+
+        } else if (OPENNSL_PBMP_MEMBER(vlanp->hw_trunk_ports[unit], hw_port)) {
+            hw_del_ports_from_vlan(unit, pbm, g_empty_pbm, vid, 0);
+            OPENNSL_PBMP_PORT_REMOVE(vlanp->hw_trunk_ports[unit], hw_port);
+
+        } else if (OPENNSL_PBMP_MEMBER(vlanp->hw_native_tag_ports[unit], hw_port)) {
+            hw_del_ports_from_vlan(unit, pbm, g_empty_pbm, vid, 0);
+            OPENNSL_PBMP_PORT_REMOVE(vlanp->hw_native_tag_ports[unit], hw_port);
+            native_vlan_clear(unit, pbm, 0);
+
+        } else if (OPENNSL_PBMP_MEMBER(vlanp->hw_native_untag_ports[unit], hw_port)) {
+            hw_del_ports_from_vlan(unit, pbm, pbm, vid, 0);
+            OPENNSL_PBMP_PORT_REMOVE(vlanp->hw_native_untag_ports[unit], hw_port);
+
+        }
+
+        if (OPENNSL_PBMP_MEMBER(vlanp->hw_subinterface_ports[unit], hw_port)) {
+            hw_del_ports_from_vlan(unit, pbm, g_empty_pbm, vid, 0);
+            OPENNSL_PBMP_PORT_REMOVE(vlanp->hw_subinterface_ports[unit], hw_port);
+        }
+    }
+
+} // vlan_reconfig_port_on_vlan
+
 void
 vlan_reconfig_on_link_change(int unit, opennsl_port_t hw_port, int link_is_up)
 {
-    int vid, count;
+    int vid;
     opennsl_pbmp_t pbm;
     ops_vlan_data_t *vlanp;
+    unsigned long vids[BITMAP_N_LONGS(OPS_VLAN_COUNT)];
+
+    // Only the VLANs the port is configured in need an update, as the
+    // installed ports of a VLAN are always configured ports too.
+    if (!vlan_port_index_get(unit, hw_port, vids)) {
+        return;
+    }
 
     OPENNSL_PBMP_CLEAR(pbm);
     OPENNSL_PBMP_PORT_ADD(pbm, hw_port);
 
-    for (vid=0, count=0; vid<OPS_VLAN_COUNT && count<ops_vlan_count; vid++) {
-        if (ops_vlans[vid] != NULL) {
-            count++;
-            vlanp = ops_vlans[vid];
-            if (vlanp->hw_created) {
-                if (link_is_up) {
-                    // Link has come up.
-                    if (OPENNSL_PBMP_MEMBER(vlanp->cfg_access_ports[unit], hw_port)) {
-                        hw_add_ports_to_vlan(unit, pbm, pbm, vid, 1);
-                        OPENNSL_PBMP_OR(vlanp->hw_access_ports[unit], pbm);
-
-                    } else if (OPENNSL_PBMP_MEMBER(vlanp->cfg_trunk_ports[unit], hw_port)) {
-                        hw_add_ports_to_vlan(unit, pbm, g_empty_pbm, vid, 0);
-                        OPENNSL_PBMP_OR(vlanp->hw_trunk_ports[unit], pbm);
-
-                    } else if (OPENNSL_PBMP_MEMBER(vlanp->cfg_native_tag_ports[unit], hw_port)) {
-                        hw_add_ports_to_vlan(unit, pbm, g_empty_pbm, vid, 0);
-                        OPENNSL_PBMP_OR(vlanp->hw_native_tag_ports[unit], pbm);
-                        native_vlan_set(unit, vid, pbm, 0);
-
-                    } else if (OPENNSL_PBMP_MEMBER(vlanp->cfg_native_untag_ports[unit], hw_port)) {
-                        hw_add_ports_to_vlan(unit, pbm, pbm, vid, 0);
-                        OPENNSL_PBMP_OR(vlanp->hw_native_untag_ports[unit], pbm);
-
-                    }
-
-                    if (OPENNSL_PBMP_MEMBER(vlanp->cfg_subinterface_ports[unit], hw_port)) {
-                        hw_add_ports_to_vlan(unit, pbm, g_empty_pbm, vid, 0);
-                        OPENNSL_PBMP_OR(vlanp->hw_subinterface_ports[unit], pbm);
-                    }
-                } else {
-                    // Link has gone down.
-                    if (OPENNSL_PBMP_MEMBER(vlanp->hw_access_ports[unit], hw_port)) {
-                        hw_del_ports_from_vlan(unit, pbm, pbm, vid, 1);
-                        OPENNSL_PBMP_PORT_REMOVE(vlanp->hw_access_ports[unit], hw_port);
-
-                    } else if (OPENNSL_PBMP_MEMBER(vlanp->hw_trunk_ports[unit], hw_port)) {
-                        hw_del_ports_from_vlan(unit, pbm, g_empty_pbm, vid, 0);
-                        OPENNSL_PBMP_PORT_REMOVE(vlanp->hw_trunk_ports[unit], hw_port);
+    for (vid = bitmap_scan(vids, true, 0, OPS_VLAN_COUNT);
+         vid < OPS_VLAN_COUNT;
+         vid = bitmap_scan(vids, true, vid + 1, OPS_VLAN_COUNT)) {
+        vlanp = ops_vlans[vid];
+        if (vlanp != NULL && vlanp->hw_created) {
+            vlan_reconfig_port_on_vlan(unit, hw_port, pbm, vlanp, link_is_up);
+        }
+    }
 
-                    } else if (OPENNSL_PBMP_MEMBER(vlanp->hw_native_tag_ports[unit], hw_port)) {
-                        hw_del_ports_from_vlan(unit, pbm, g_empty_pbm, vid, 0);
-                        OPENNSL_PBMP_PORT_REMOVE(vlanp->hw_native_tag_ports[unit], hw_port);
-                        native_vlan_clear(unit, pbm, 0);
+} // vlan_reconfig_on_link_change
 
-                    } else if (OPENNSL_PBMP_MEMBER(vlanp->hw_native_untag_ports[unit], hw_port)) {
-                        hw_del_ports_from_vlan(unit, pbm, pbm, vid, 0);
-                        OPENNSL_PBMP_PORT_REMOVE(vlanp->hw_native_untag_ports[unit], hw_port);
+static bool
+vlan_port_is_member(ops_vlan_data_t *vlanp, int unit, opennsl_port_t hw_port)
+{
+    return (OPENNSL_PBMP_MEMBER(vlanp->cfg_access_ports[unit], hw_port) ||
+            OPENNSL_PBMP_MEMBER(vlanp->cfg_trunk_ports[unit], hw_port) ||
+            OPENNSL_PBMP_MEMBER(vlanp->cfg_native_tag_ports[unit], hw_port) ||
+            OPENNSL_PBMP_MEMBER(vlanp->cfg_native_untag_ports[unit], hw_port) ||
+            OPENNSL_PBMP_MEMBER(vlanp->cfg_subinterface_ports[unit], hw_port));
+
+} // vlan_port_is_member
+
+// Benchmark finding the VLANs to update on a link change of a port with
+// the port index against a scan of all the VLANs, and check that both
+// agree.  Nothing is changed in h/w unless 'hw_cycles' is set: then the
+// actual reconfiguration of the port on a link down and up, SDK calls
+// included, is timed over 'hw_cycles' down/up cycles.  That pass only
+// runs on a port whose link is up, which it leaves as found, but its
+// traffic is disrupted while the benchmark runs.
+void
+ops_vlan_link_bench(struct ds *ds, int hw_port, int iterations,
+                    int hw_cycles)
+{
+    int unit, vid, count, role, i;
+    int n_scan = 0, n_index = 0, n_hw = 0;
+    long long int start, scan_usec, index_usec, reconfig_usec;
+    opennsl_pbmp_t linkup_pbm;
+    unsigned long scan[BITMAP_N_LONGS(OPS_VLAN_COUNT)];
+    unsigned long vids[BITMAP_N_LONGS(OPS_VLAN_COUNT)];
+    ops_vlan_port_index_t *index;
+    ops_vlan_data_t *vlanp;
 
-                    }
+    if (hw_port < 0 || hw_port >= MAX_HW_PORTS || iterations <= 0 ||
+        hw_cycles < 0 || hw_cycles > OPS_VLAN_LINK_BENCH_MAX_HW_CYCLES) {
+        ds_put_format(ds, "Invalid port, iterations or h/w cycles.\n");
+        return;
+    }
 
-                    if (OPENNSL_PBMP_MEMBER(vlanp->hw_subinterface_ports[unit], hw_port)) {
-                        hw_del_ports_from_vlan(unit, pbm, g_empty_pbm, vid, 0);
-                        OPENNSL_PBMP_PORT_REMOVE(vlanp->hw_subinterface_ports[unit], hw_port);
+    for (unit = 0; unit <= MAX_SWITCH_UNIT_ID; unit++) {
+        // Scan of all the VLANs, as done without the index.
+        start = time_usec();
+        for (i = 0; i < iterations; i++) {
+            memset(scan, 0, sizeof scan);
+            n_scan = 0;
+            for (vid=0, count=0; vid<OPS_VLAN_COUNT && count<ops_vlan_count; vid++) {
+                vlanp = ops_vlans[vid];
+                if (vlanp != NULL) {
+                    count++;
+                    if (vlan_port_is_member(vlanp, unit, hw_port)) {
+                        bitmap_set1(scan, vid);
+                        n_scan++;
                     }
                 }
             }
         }
+        scan_usec = time_usec() - start;
+
+        start = time_usec();
+        for (i = 0; i < iterations; i++) {
+            n_index = 0;
+            n_hw = 0;
+            if (!vlan_port_index_get(unit, hw_port, vids)) {
+                memset(vids, 0, sizeof vids);
+                continue;
+            }
+            for (vid = bitmap_scan(vids, true, 0, OPS_VLAN_COUNT);
+                 vid < OPS_VLAN_COUNT;
+                 vid = bitmap_scan(vids, true, vid + 1, OPS_VLAN_COUNT)) {
+                n_index++;
+                vlanp = ops_vlans[vid];
+                if (vlanp != NULL && vlanp->hw_created) {
+                    n_hw++;
+                }
+            }
+        }
+        index_usec = time_usec() - start;
+
+        ds_put_format(ds, "Unit %d port %d: member of %d VLANs (", unit,
+                      hw_port, n_index);
+        index = ops_vlan_port_index[unit][hw_port];
+        for (role = 0; role < OPS_VLAN_ROLE_COUNT; role++) {
+            ds_put_format(ds, "%s%s %d", role ? ", " : "",
+                          ops_vlan_role_names[role],
+                          index ? (int)bitmap_count1(index->vids[role],
+                                                     OPS_VLAN_COUNT) : 0);
+        }
+        ds_put_format(ds, "), %d created in h/w\n", n_hw);
+        ds_put_format(ds, "  VLAN scan:  %.2f usec per link change\n",
+                      (double)scan_usec / iterations);
+        ds_put_format(ds, "  port index: %.2f usec per link change\n",
+                      (double)index_usec / iterations);
+        ds_put_format(ds, "  port index %s the VLAN data (%d VLANs)\n",
+                      (n_scan == n_index && !memcmp(scan, vids, sizeof scan))
+                      ? "matches" : "DOES NOT MATCH", n_scan);
+
+        if (!hw_cycles) {
+            continue;
+        }
+
+        // Real link changes of the port.  Taking a down port up would
+        // install it in its VLANs while its link is down.
+        linkup_pbm = ops_get_link_up_pbm(unit);
+        if (!OPENNSL_PBMP_MEMBER(linkup_pbm, hw_port)) {
+            ds_put_format(ds, "  h/w reconfig: skipped, link is down\n");
+            continue;
+        }
+        start = time_usec();
+        for (i = 0; i < hw_cycles; i++) {
+            vlan_reconfig_on_link_change(unit, hw_port, 0);
+            vlan_reconfig_on_link_change(unit, hw_port, 1);
+        }
+        reconfig_usec = time_usec() - start;
+        ds_put_format(ds, "  h/w reconfig: %.2f usec per link change, "
+                      "%d VLANs in h/w, %d down/up cycles\n",
+                      (double)reconfig_usec / (2 * hw_cycles), n_hw,
+                      hw_cycles);
     }
 
-} // vlan_reconfig_on_link_change
+} // ops_vlan_link_bench
 
 bool is_user_created_vlan(int vid)
 {